@@ -94,6 +94,9 @@
  */
 #include "cycfg_system.h"
 
+/* ENABLE_TLSF_HEAP selects the heap scheme below. */
+#include "heap_config.h"
+
 #define configUSE_PREEMPTION                    1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
 extern uint32_t SystemCoreClock;
@@ -105,6 +108,10 @@ extern uint32_t SystemCoreClock;
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_TASK_NOTIFICATIONS            1
+/* Index 0 is used by the application, index 1 by the virtual-time delays
+ * (APP_TIME_NOTIFY_INDEX).
+ */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   2
 #define configUSE_MUTEXES                       1
 #define configUSE_RECURSIVE_MUTEXES             1
 #define configUSE_COUNTING_SEMAPHORES           1
@@ -130,6 +137,8 @@ extern uint32_t SystemCoreClock;
 /* Run time and task stats gathering related definitions. */
 #define configGENERATE_RUN_TIME_STATS           0
 #define configUSE_TRACE_FACILITY                1
+/* The TLSF heap keeps the allocation tag of each task in its application tag. */
+#define configUSE_APPLICATION_TASK_TAG          ENABLE_TLSF_HEAP
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
 /* Co-routine related definitions. */
@@ -229,7 +238,12 @@ standard names - or at least those used in the unmodified vector table. */
 #define HEAP_ALLOCATION_TYPE5                   (5)     /* heap_5.c*/
 #define NO_HEAP_ALLOCATION                      (0)
 
+/* The TLSF heap (source/app_heap.c) defines pvPortMalloc() and vPortFree(). */
+#if ENABLE_TLSF_HEAP
+#define configHEAP_ALLOCATION_SCHEME            (NO_HEAP_ALLOCATION)
+#else
 #define configHEAP_ALLOCATION_SCHEME            (HEAP_ALLOCATION_TYPE3)
+#endif /* ENABLE_TLSF_HEAP */
 
 /* Check if the ModusToolbox Device Configurator Power personality parameter
  * "System Idle Power Mode" is set to either "CPU Sleep" or "System Deep Sleep".
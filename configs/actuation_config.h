@@ -0,0 +1,53 @@
+/******************************************************************************
+* File Name:   actuation_config.h
+*
+* Description: This file contains the configuration macros for the actuation
+*              verifier that watches the ambient light sensor for the fountain
+*              light to come on after a presence command.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef ACTUATION_CONFIG_H_
+#define ACTUATION_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to verify that the smart plug switched after every
+ * "on" published on MQTT_PUB_TOPIC at night, else 0. The fountain light must
+ * be in view of the ambient light sensor.
+ */
+#define ENABLE_ACTUATION_VERIFIER         ( 0 )
+
+/* Filtered ambient light level in percent below which it is night, so that
+ * the fountain light makes a visible step. Commands in daylight are not
+ * verified.
+ */
+#define ACTUATION_DARK_LEVEL_PERCENT      (20u)
+
+/* Rise of the filtered light level in percent over its level at the command
+ * that confirms the light came on.
+ */
+#define ACTUATION_STEP_PERCENT            (8u)
+
+/* Smoothing of the light level: the filter moves 1/2^ACTUATION_FILTER_SHIFT
+ * of the way towards every sample.
+ */
+#define ACTUATION_FILTER_SHIFT            (1u)
+
+/* Time after a command, or a retry, within which the light must come on. */
+#define ACTUATION_TIMEOUT_MS              (5000u)
+
+/* Number of times the command is republished before an alert is raised. */
+#define ACTUATION_MAX_RETRIES             (2u)
+
+/* Interval at which the latency percentiles are published on
+ * MQTT_ACTUATION_TOPIC, if any command was verified in the interval.
+ */
+#define ACTUATION_REPORT_INTERVAL_MS      (15u * 60u * 1000u)
+
+#endif /* ACTUATION_CONFIG_H_ */
+
+/* [] END OF FILE */
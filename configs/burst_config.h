@@ -0,0 +1,47 @@
+/******************************************************************************
+* File Name:   burst_config.h
+*
+* Description: This file contains the configuration macros for the
+*              duty-cycled burst-connect mode of battery or solar powered
+*              radar nodes.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef BURST_CONFIG_H_
+#define BURST_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to stay disassociated from the AP, buffer the radar
+ * events and send them in bursts, else 0 for the always-connected mode. In
+ * burst mode the subscriber, RPC and roaming tasks are not started.
+ */
+#define ENABLE_BURST_CONNECT              ( 0 )
+
+/* A burst is started at the latest this long after the previous one. */
+#define BURST_BATCH_INTERVAL_MS           (15u * 60u * 1000u)
+
+/* Number of buffered events. A full buffer starts a burst; while a burst
+ * fails the oldest events are overwritten.
+ */
+#define BURST_MAX_EVENTS                  (32u)
+
+/* Largest payload a buffered event holds. The payloads are copied into the
+ * buffer, which takes BURST_MAX_EVENTS x BURST_MAX_PAYLOAD_SIZE bytes; a
+ * larger message is dropped. The topics are not copied and must be static.
+ */
+#define BURST_MAX_PAYLOAD_SIZE            (128u)
+
+/* Energy model of a burst: supply voltage and average current of the MCU and
+ * the Wi-Fi module while the radio is joining, connected or disconnecting.
+ * The current is a placeholder and must be measured for the board.
+ */
+#define BURST_SUPPLY_MV                   (3300u)
+#define BURST_ACTIVE_CURRENT_MA           (60u)
+
+#endif /* BURST_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,38 @@
+/******************************************************************************
+* File Name:   credentials_config.h
+*
+* Description: This file contains the configuration macros of the TLS
+*              credentials of a secure MQTT connection (MQTT_SECURE_CONNECTION
+*              in mqtt_client_config.h).
+*
+*              The file is included by mbedtls_user_config.h, so it must only
+*              contain macros.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef CREDENTIALS_CONFIG_H_
+#define CREDENTIALS_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to link the credentials of mqtt_client_config.h as DER,
+ * else 0 for the PEM strings. The PREBUILD step of the Makefile converts them
+ * with scripts/pem_to_der.py into configs/mqtt_credentials_der.h. mbedTLS is
+ * then built without the PEM parser, and no credential is base64-decoded
+ * during a connect. Every credential must hold a single PEM block without
+ * encryption.
+ */
+#define ENABLE_DER_CREDENTIALS            ( 0 )
+
+/* Set this macro to 1 to parse the root CA certificate once into the global
+ * trusted chain of the secure sockets library, which is kept across
+ * reconnects, else 0 to parse it again on every connect.
+ */
+#define ENABLE_ROOT_CA_CACHE              ( 0 )
+
+#endif /* CREDENTIALS_CONFIG_H_ */
+
+/* [] END OF FILE */
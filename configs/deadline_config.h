@@ -0,0 +1,42 @@
+/******************************************************************************
+* File Name:   deadline_config.h
+*
+* Description: This file contains the configuration macros for the priority
+*              of the TLS handshake and for the deadlines of the radar edge
+*              handling and the display updates.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef DEADLINE_CONFIG_H_
+#define DEADLINE_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to lower the MQTT client task to
+ * MQTT_HANDSHAKE_TASK_PRIORITY while it connects to the broker, so that the
+ * ECDHE and certificate verification of the TLS handshake only run when the
+ * publisher, subscriber and TFT tasks are idle, else 0.
+ */
+#define ENABLE_HANDSHAKE_DEMOTION         ( 1 )
+
+/* Set this macro to 1 to check the radar edge handling and the display
+ * updates against their deadlines and count the misses, separately for the
+ * time the MQTT client task spends in a broker handshake, else 0.
+ */
+#define ENABLE_DEADLINE_MONITOR           ( 1 )
+
+/* Deadline from the radar ISR to the publisher task handling the edge. */
+#define RADAR_EDGE_DEADLINE_US            (10000u)
+
+/* Deadline from posting a draw command to the end of the frame that drew
+ * it. A command waits up to one frame period of the TFT task, 100 ms, for
+ * its frame.
+ */
+#define DISPLAY_UPDATE_DEADLINE_US        (200000u)
+
+#endif /* DEADLINE_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/******************************************************************************
+* File Name:   effect_config.h
+*
+* Description: This file contains the configuration macros for the lighting
+*              and pump effect sequencer.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef EFFECT_CONFIG_H_
+#define EFFECT_CONFIG_H_
+
+#include "cyhal.h"
+#include "cybsp.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to drive a low-voltage WS2812 LED strip and a PWM pump
+ * driver from the effect sequencer, else 0.
+ */
+#define ENABLE_EFFECT_SEQUENCER           ( 0 )
+
+/* Number of LEDs on the WS2812 strip. */
+#define EFFECT_LED_COUNT                  (30u)
+
+/* SPI pins used to generate the WS2812 bitstream. Only MOSI is connected to
+ * the strip; the clock pin must still be an SCB SPI clock pin of the same SCB
+ * and must not be used by the TFT shield.
+ */
+#define EFFECT_LED_SPI_MOSI_PIN           (P12_0)
+#define EFFECT_LED_SPI_SCLK_PIN           (P12_2)
+
+/* TCPWM pin driving the pump speed controller and its PWM frequency. */
+#define EFFECT_PUMP_PWM_PIN               (P9_4)
+#define EFFECT_PUMP_PWM_FREQ_HZ           (20000u)
+
+/* Frame period of the sequencer in milliseconds (20 ms = 50 frames/s). */
+#define EFFECT_FRAME_PERIOD_MS            (20u)
+
+#endif /* EFFECT_CONFIG_H_ */
+
+/* [] END OF FILE */
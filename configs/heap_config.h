@@ -0,0 +1,35 @@
+/******************************************************************************
+* File Name:   heap_config.h
+*
+* Description: This file contains the configuration macros of the heap that
+*              serves pvPortMalloc() and the newlib malloc().
+*
+*              The file is included by FreeRTOSConfig.h and by
+*              mbedtls_user_config.h, so it must only contain macros.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef HEAP_CONFIG_H_
+#define HEAP_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to serve pvPortMalloc() and malloc() from the TLSF heap
+ * (source/app_heap.c), else 0 for the FreeRTOS heap_3 scheme, where every
+ * pvPortMalloc() is the newlib malloc() with the scheduler suspended. The TLSF
+ * heap takes the linker heap region (__HeapBase to __HeapLimit) and needs no
+ * extra RAM.
+ */
+#define ENABLE_TLSF_HEAP                  ( 0 )
+
+/* Set this macro to 1 to time every allocation and free with the DWT cycle
+ * counter, including the time spent with interrupts masked, else 0.
+ */
+#define APP_HEAP_ENABLE_TIMING            ( 1 )
+
+#endif /* HEAP_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,96 @@
+/******************************************************************************
+* File Name:   irq_priority_config.h
+*
+* Description: This file contains the interrupt priority map of the
+*              application and the configuration of the interrupt latency
+*              probe. Every interrupt enabled by the application takes its
+*              priority from here, and the map is checked against the FreeRTOS
+*              interrupt configuration at build time.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef IRQ_PRIORITY_CONFIG_H_
+#define IRQ_PRIORITY_CONFIG_H_
+
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* NVIC priorities of the CM4 (3 priority bits): 0 is the highest and 7 the
+ * lowest. The FreeRTOS kernel (SysTick, PendSV) runs at IRQ_PRIORITY_KERNEL,
+ * and interrupts that call the FreeRTOS "FromISR" API must not be more urgent
+ * than IRQ_PRIORITY_MAX_API_CALL.
+ */
+#define IRQ_PRIORITY_KERNEL               (configKERNEL_INTERRUPT_PRIORITY >> (8u - __NVIC_PRIO_BITS))
+#define IRQ_PRIORITY_MAX_API_CALL         (configMAX_API_CALL_INTERRUPT_PRIORITY >> (8u - __NVIC_PRIO_BITS))
+
+/* Wi-Fi SDIO interrupt, which the BSP Wi-Fi layer leaves at the HAL default.
+ * The out-of-band host wake interrupt is not used (CY_WIFI_HOST_WAKE_SW_FORCE
+ * is 0 in the Makefile). Listed so that the map is complete.
+ */
+#define IRQ_PRIORITY_WIFI_SDIO            (CYHAL_ISR_PRIORITY_DEFAULT)
+
+/* Radar TD edges. The ISR samples TD/PD and passes them to the publisher. */
+#define IRQ_PRIORITY_RADAR_TD             (3u)
+
+/* BMI160 orientation interrupt. */
+#define IRQ_PRIORITY_BMI160               (5u)
+
+/* SPI transfer done event of the LED strip DMA. */
+#define IRQ_PRIORITY_EFFECT_SPI           (6u)
+
+/* Loopback edge of the latency probe. It uses the radar priority by default,
+ * so that the probe measures the latency seen by the radar ISR.
+ */
+#define IRQ_PRIORITY_LATENCY_PROBE        IRQ_PRIORITY_RADAR_TD
+
+/* Set this macro to 1 to measure the interrupt and task wake latency with a
+ * GPIO loopback, else 0. LATENCY_PROBE_OUT_PIN must be a TCPWM PWM pin wired
+ * to LATENCY_PROBE_IN_PIN; no other interrupt may use the port of the input
+ * pin, because all pins of a port share one interrupt. The pins are
+ * placeholders and must match the wiring.
+ */
+#define ENABLE_LATENCY_PROBE              ( 0 )
+#define LATENCY_PROBE_OUT_PIN             (P13_0)
+#define LATENCY_PROBE_IN_PIN              (P13_1)
+
+/* Counter clock of the probe PWM, which sets the resolution (100 ns), and
+ * the interval between two probe edges. The period must fit in the 16-bit
+ * counter: LATENCY_PROBE_PERIOD_US * LATENCY_PROBE_CLOCK_HZ / 10^6 < 65536.
+ */
+#define LATENCY_PROBE_CLOCK_HZ            (10000000u)
+#define LATENCY_PROBE_PERIOD_US           (5000u)
+
+/*******************************************************************************
+* Priority map checks
+********************************************************************************/
+/* Interrupts that call the FreeRTOS API. */
+#if (IRQ_PRIORITY_RADAR_TD < IRQ_PRIORITY_MAX_API_CALL) || \
+    (IRQ_PRIORITY_BMI160 < IRQ_PRIORITY_MAX_API_CALL) || \
+    (IRQ_PRIORITY_EFFECT_SPI < IRQ_PRIORITY_MAX_API_CALL) || \
+    (IRQ_PRIORITY_LATENCY_PROBE < IRQ_PRIORITY_MAX_API_CALL) || \
+    (IRQ_PRIORITY_WIFI_SDIO < IRQ_PRIORITY_MAX_API_CALL)
+    #error "Interrupts that call the FreeRTOS API must not be more urgent than IRQ_PRIORITY_MAX_API_CALL."
+#endif
+
+#if (IRQ_PRIORITY_RADAR_TD > IRQ_PRIORITY_KERNEL) || \
+    (IRQ_PRIORITY_BMI160 > IRQ_PRIORITY_KERNEL) || \
+    (IRQ_PRIORITY_EFFECT_SPI > IRQ_PRIORITY_KERNEL) || \
+    (IRQ_PRIORITY_LATENCY_PROBE > IRQ_PRIORITY_KERNEL) || \
+    (IRQ_PRIORITY_WIFI_SDIO > IRQ_PRIORITY_KERNEL)
+    #error "Interrupt priorities must be within the NVIC priority range."
+#endif
+
+/* Presence detection must not wait for the motion sensor or the LED strip. */
+#if (IRQ_PRIORITY_RADAR_TD >= IRQ_PRIORITY_BMI160) || (IRQ_PRIORITY_RADAR_TD >= IRQ_PRIORITY_EFFECT_SPI)
+    #error "The radar TD interrupt must be more urgent than the BMI160 and LED strip interrupts."
+#endif
+
+#endif /* IRQ_PRIORITY_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -787,6 +787,55 @@
  */
 #undef MBEDTLS_SSL_KEEP_PEER_CERTIFICATE
 
+/**
+ * \def MBEDTLS_SSL_OUT_CONTENT_LEN
+ *
+ * Maximum length (in bytes) of outgoing plaintext fragments. mbedTLS
+ * allocates the output record buffer of every TLS connection with this size
+ * (16384 bytes by default).
+ *
+ * The MQTT library sends the fixed header, the topic, the packet identifier
+ * and the payload of a PUBLISH as separate writes, and mbedTLS encrypts every
+ * write into its own record. The largest application record is therefore the
+ * largest payload: a metrics snapshot of up to METRICS_EXPORT_BUFFER_SIZE
+ * (448) bytes, or an RPC response chunk of up to MQTT_RPC_CHUNK_HEADER_SIZE +
+ * MQTT_RPC_CHUNK_SIZE (288) bytes. This is checked at build time in
+ * mqtt_client_config.c.
+ *
+ * The size is set by the largest handshake message sent by the client
+ * instead, the Certificate message with the client certificate chain, which
+ * mbedTLS does not fragment: 4096 bytes hold a device certificate and one
+ * intermediate CA certificate. Incoming records keep the full 16384 bytes
+ * because the broker may send full-size records.
+ */
+#define MBEDTLS_SSL_OUT_CONTENT_LEN 4096
+
+/**
+ * \def MBEDTLS_PLATFORM_MEMORY
+ *
+ * With the TLSF heap (ENABLE_TLSF_HEAP in heap_config.h), mbedTLS allocates
+ * through app_heap_mbedtls_calloc() so that its buffers are accounted to the
+ * mbedtls tag whichever task runs the handshake.
+ */
+#include "heap_config.h"
+#if ENABLE_TLSF_HEAP
+#include "app_heap.h"
+#define MBEDTLS_PLATFORM_MEMORY
+#define MBEDTLS_PLATFORM_CALLOC_MACRO app_heap_mbedtls_calloc
+#define MBEDTLS_PLATFORM_FREE_MACRO app_heap_free
+#endif /* ENABLE_TLSF_HEAP */
+
+/**
+ * \def MBEDTLS_PEM_PARSE_C
+ *
+ * With DER credentials (ENABLE_DER_CREDENTIALS in credentials_config.h),
+ * nothing is parsed from PEM, and the PEM parser is left out of the build.
+ */
+#include "credentials_config.h"
+#if ENABLE_DER_CREDENTIALS
+#undef MBEDTLS_PEM_PARSE_C
+#endif /* ENABLE_DER_CREDENTIALS */
+
 /**
  * \def MBEDTLS_DEPRECATED_REMOVED
  *
@@ -0,0 +1,65 @@
+/******************************************************************************
+* File Name:   metrics_config.h
+*
+* Description: This file contains the configuration macros for the metrics
+*              registry and its periodic export over MQTT.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef METRICS_CONFIG_H_
+#define METRICS_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to keep the counters, gauges and histograms of
+ * metrics.h and publish a snapshot of all of them on MQTT_METRICS_TOPIC every
+ * METRICS_EXPORT_INTERVAL_MS, else 0.
+ */
+#define ENABLE_METRICS                    ( 0 )
+
+/* Formats of the snapshot. */
+#define METRICS_FORMAT_BINARY             (0)
+#define METRICS_FORMAT_PROMETHEUS         (1)
+
+/* METRICS_FORMAT_BINARY publishes the values as varints, 40 to 100 bytes for
+ * all metrics, and the names and bucket bounds separately on
+ * MQTT_METRICS_SCHEMA_TOPIC. METRICS_FORMAT_PROMETHEUS publishes the
+ * Prometheus text exposition format, about 1.3 KB and at most 1610 bytes
+ * for the current metrics, which also needs a larger MQTT_NETWORK_BUFFER_SIZE.
+ */
+#define METRICS_EXPORT_FORMAT             METRICS_FORMAT_BINARY
+
+/* Interval between two snapshots. */
+#define METRICS_EXPORT_INTERVAL_MS        (60u * 1000u)
+
+/* With the binary format, the schema is published with the first snapshot
+ * and then every METRICS_SCHEMA_INTERVAL snapshots, so that a scraper
+ * started later can decode them.
+ */
+#define METRICS_SCHEMA_INTERVAL           (10u)
+
+/* Size of the snapshot and schema buffers. A snapshot that does not fit is
+ * not published and counted as failed.
+ */
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_PROMETHEUS)
+#define METRICS_EXPORT_BUFFER_SIZE        (1664u)
+#else
+#define METRICS_EXPORT_BUFFER_SIZE        (448u)
+#endif
+
+/* Smallest buffer that holds the Prometheus snapshot of the current metrics
+ * with every value at its widest, and its terminator.
+ */
+#define METRICS_PROMETHEUS_MIN_BUFFER_SIZE  (1611u)
+
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_PROMETHEUS) && \
+    (METRICS_EXPORT_BUFFER_SIZE < METRICS_PROMETHEUS_MIN_BUFFER_SIZE)
+#error "METRICS_EXPORT_BUFFER_SIZE is too small for the Prometheus snapshot."
+#endif
+
+#endif /* METRICS_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -95,6 +95,91 @@
 #define MQTT_DEVICE_ON_MESSAGE            "true"
 #define MQTT_DEVICE_OFF_MESSAGE           "false"
 
+/* Topic on which the occupancy predictor publishes MQTT_DEVICE_ON_MESSAGE /
+ * MQTT_DEVICE_OFF_MESSAGE to pre-start the pump before a likely arrival.
+ */
+#define MQTT_PRESTART_TOPIC               MQTT_PUB_TOPIC "/prestart"
+
+/* Topic on which every burst of the burst-connect mode publishes its phase
+ * timings and energy estimate.
+ */
+#define MQTT_BURST_TOPIC                  MQTT_PUB_TOPIC "/burst"
+
+/* Topic on which the actuation verifier publishes the latency percentiles of
+ * the smart plug.
+ */
+#define MQTT_ACTUATION_TOPIC              MQTT_PUB_TOPIC "/actuation"
+
+/* Topic of the broker round-trip time probe, published and subscribed to by
+ * the client.
+ */
+#define MQTT_RTT_PROBE_TOPIC              MQTT_PUB_TOPIC "/rtt"
+
+/* Topics on which the metrics registry publishes its snapshots and, with the
+ * binary format, their schema.
+ */
+#define MQTT_METRICS_TOPIC                MQTT_PUB_TOPIC "/metrics"
+#define MQTT_METRICS_SCHEMA_TOPIC         MQTT_METRICS_TOPIC "/schema"
+
+
+/********************* MQTT RPC CONFIGURATION MACROS **************************/
+/* Set this macro to 1 to enable the request/response RPC layer used for remote
+ * diagnostics, else 0. Requests are published on 'MQTT_RPC_REQUEST_TOPIC' as
+ * "<correlation id> <command>" and the responses are published in chunks on
+ * 'MQTT_RPC_RESPONSE_TOPIC'. Supported commands: get-stats, get-heap,
+ * get-task-list, get-conn, trace-start, trace-stop, dump-history.
+ */
+#define ENABLE_MQTT_RPC                   ( 1 )
+#if ENABLE_MQTT_RPC
+    #define MQTT_RPC_REQUEST_TOPIC        MQTT_PUB_TOPIC "/rpc/request"
+    #define MQTT_RPC_RESPONSE_TOPIC       MQTT_PUB_TOPIC "/rpc/response"
+#endif
+
+/* Maximum payload bytes of a single RPC response chunk. */
+#define MQTT_RPC_CHUNK_SIZE               ( 256 )
+
+/* Room reserved in front of every RPC response chunk for the chunk header. */
+#define MQTT_RPC_CHUNK_HEADER_SIZE        ( 32 )
+
+
+/******************** MQTT TRANSPORT CONFIGURATION MACROS *********************/
+/* Transports the publisher can publish through. */
+#define MQTT_TRANSPORT_TCP                (0)
+#define MQTT_TRANSPORT_SN                 (1)
+
+/* MQTT_TRANSPORT_TCP publishes with MQTT 3.1.1 over TCP (and TLS) to
+ * MQTT_BROKER_ADDRESS. MQTT_TRANSPORT_SN publishes with MQTT-SN 1.2 over UDP
+ * to the MQTT-SN gateway below, which forwards the messages to the broker.
+ * The MQTT-SN client only publishes, so the subscriber, RPC and roaming tasks
+ * are not started with it.
+ */
+#define MQTT_TRANSPORT                    MQTT_TRANSPORT_TCP
+
+/* IPv4 address (not a host name) and UDP port of the MQTT-SN gateway. */
+#define MQTTSN_GATEWAY_ADDRESS            "ipaddr"
+#define MQTTSN_GATEWAY_PORT               (1884u)
+
+/* QoS of the MQTT-SN publish messages: -1, 0 or 1. QoS -1 needs no
+ * connection to the gateway and can only publish on predefined topics.
+ */
+#define MQTTSN_QOS                        ( 1 )
+
+/* Topic IDs of MQTT_PUB_TOPIC and MQTT_PRESTART_TOPIC. They must be
+ * predefined with the same IDs on the gateway; set an ID to 0 to register the
+ * topic after every connection instead. Other topics are always registered.
+ */
+#define MQTTSN_PUB_TOPIC_ID               (1u)
+#define MQTTSN_PRESTART_TOPIC_ID          (2u)
+
+/* Maximum number of registered topics per connection. */
+#define MQTTSN_MAX_REGISTERED_TOPICS      (8u)
+
+/* Time to wait for an acknowledgement before a retransmission, and the
+ * number of retransmissions before an operation fails.
+ */
+#define MQTTSN_RETRY_INTERVAL_MS          (2000u)
+#define MQTTSN_MAX_RETRIES                (3u)
+
 
 /******************* OTHER MQTT CLIENT CONFIGURATION MACROS *******************/
 /* A unique client identifier to be used for every MQTT connection. */
@@ -165,7 +250,10 @@
 
 /**************** MQTT CLIENT CERTIFICATE CONFIGURATION MACROS ****************/
 
-/* Configure the below credentials in case of a secure MQTT connection. */
+/* Configure the below credentials in case of a secure MQTT connection. With
+ * ENABLE_DER_CREDENTIALS in credentials_config.h, they are converted to DER at
+ * build time by scripts/pem_to_der.py.
+ */
 /* PEM-encoded client certificate */
 #define CLIENT_CERTIFICATE      \
 "-----BEGIN CERTIFICATE-----\n" \
@@ -0,0 +1,36 @@
+/******************************************************************************
+* File Name:   nn_config.h
+*
+* Description: This file contains the configuration macros for the int8
+*              neural network that classifies radar activations.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef NN_CONFIG_H_
+#define NN_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to classify radar activations as person, animal or
+ * foliage with the model returned by nn_model_get_blob(), else 0.
+ */
+#define ENABLE_NN_CLASSIFIER              ( 0 )
+
+/* Size of the static activation arena in bytes. It must hold the input and
+ * the output of the largest layer of the model; the model is rejected at
+ * start-up otherwise.
+ */
+#define NN_ARENA_SIZE                     (2048u)
+
+/* Number of most recent TD pulses in the input window of the model. */
+#define NN_WINDOW_PULSES                  (8u)
+
+/* Window over which the inference rate is measured. */
+#define NN_STATS_WINDOW_MS                (60000u)
+
+#endif /* NN_CONFIG_H_ */
+
+/* [] END OF FILE */
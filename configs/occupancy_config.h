@@ -0,0 +1,51 @@
+/******************************************************************************
+* File Name:   occupancy_config.h
+*
+* Description: This file contains the configuration macros for the occupancy
+*              predictor that pre-starts the pump before a likely arrival.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef OCCUPANCY_CONFIG_H_
+#define OCCUPANCY_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to learn arrival times and pre-start the pump, else 0.
+ * The time of week is read from the RTC, which is set from the SNTP server
+ * after a Wi-Fi join; the predictor waits until it has been set.
+ */
+#define ENABLE_OCCUPANCY_PREDICTOR        ( 0 )
+
+/* Learning rate: a bin moves 1/2^OCCUPANCY_DECAY_SHIFT of the way towards
+ * the outcome of every week, so a week's weight halves about every
+ * 2^OCCUPANCY_DECAY_SHIFT * 0.7 weeks.
+ */
+#define OCCUPANCY_DECAY_SHIFT             (2u)
+
+/* Arrival probability in percent at which the pump is pre-started. */
+#define OCCUPANCY_PRESTART_THRESHOLD_PERCENT  (50u)
+
+/* Minutes before the start of a likely bin at which the pump is pre-started. */
+#define OCCUPANCY_PRESTART_LEAD_MINUTES   (5u)
+
+/* SNTP server that sets the RTC. */
+#define WALL_CLOCK_NTP_SERVER             "pool.ntp.org"
+
+/* Offset of the local time, in which the arrivals are learned, from UTC.
+ * Daylight saving time is not applied.
+ */
+#define WALL_CLOCK_UTC_OFFSET_MINUTES     (0)
+
+/* Time to wait for the SNTP reply. */
+#define WALL_CLOCK_TIMEOUT_MS             (2000u)
+
+/* Interval after which a Wi-Fi join sets the RTC again. */
+#define WALL_CLOCK_RESYNC_MS              (24u * 60u * 60u * 1000u)
+
+#endif /* OCCUPANCY_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,82 @@
+/******************************************************************************
+* File Name:   radar_config.h
+*
+* Description: This file contains the configuration macros and the pin table
+*              for the BGT60LTR11 radar sensors used for presence detection.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RADAR_CONFIG_H_
+#define RADAR_CONFIG_H_
+
+#include "cyhal.h"
+#include "cybsp.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Number of radar sensors. Every sensor needs an entry in RADAR_SENSOR_TABLE. */
+#define RADAR_SENSOR_COUNT                (1u)
+
+/* Pin table of the radar sensors: { TD pin, PD pin, zone }.
+ * The TD (target detect) line is active low and the PD (phase detect) line is
+ * high while the target is approaching. Zones are numbered from the outermost
+ * approach (0) towards the fountain and are used to derive the direction of
+ * movement across sensors.
+ */
+#define RADAR_SENSOR_TABLE                                                  \
+{                                                                           \
+    { CYBSP_A7, CYBSP_A15, 0u },    /* TD outside row, PD inside row */     \
+}
+
+/* Number of sensors that must detect a target for presence to be reported. */
+#define RADAR_FUSION_VOTE_THRESHOLD       (1u)
+
+/* Maximum time in milliseconds between detections in two zones for them to
+ * define a direction of movement.
+ */
+#define RADAR_FUSION_DIRECTION_WINDOW_MS  (3000u)
+
+/* Set this macro to 1 to pass the TD edges through the adaptive classifier
+ * that learns and suppresses spurious activations, else 0.
+ */
+#define ENABLE_EDGE_CLASSIFIER            ( 1 )
+
+/* TD pulses at least this long (ms) are always treated as genuine presence. */
+#define EDGE_CLASSIFIER_GENUINE_MIN_MS    (2000u)
+
+/* Short pulses that start within this time (ms) of the previous pulse of the
+ * same sensor, without PD activity, are learned as chatter.
+ */
+#define EDGE_CLASSIFIER_BURST_GAP_MS      (5000u)
+
+/* Upper limit (ms) of the learned hold before an activation is reported. */
+#define EDGE_CLASSIFIER_MAX_HOLD_MS       (1500u)
+
+/* Ambient light levels in percent that form the dusk/dawn band. Chatter is
+ * learned separately below, within and above this band.
+ */
+#define EDGE_CLASSIFIER_DUSK_LIGHT_MIN    (5u)
+#define EDGE_CLASSIFIER_DUSK_LIGHT_MAX    (30u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* One entry of the radar sensor pin table. */
+typedef struct
+{
+    cyhal_gpio_t td_pin;
+    cyhal_gpio_t pd_pin;
+    uint8_t zone;
+} radar_sensor_config_t;
+
+/*******************************************************************************
+* Extern Variables
+********************************************************************************/
+extern const radar_sensor_config_t radar_sensors[RADAR_SENSOR_COUNT];
+
+#endif /* RADAR_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,39 @@
+/******************************************************************************
+* File Name:   rtt_probe_config.h
+*
+* Description: This file contains the configuration macros for the broker
+*              round-trip time probe.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RTT_PROBE_CONFIG_H_
+#define RTT_PROBE_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to publish a timestamped probe on MQTT_RTT_PROBE_TOPIC,
+ * which the client subscribes to as well, and measure the round-trip time
+ * through the broker from its echo, else 0. Only for the TCP transport
+ * outside of burst-connect mode.
+ */
+#define ENABLE_RTT_PROBE                  ( 0 )
+
+/* Interval between two probes. A probe whose echo has not arrived when the
+ * next one is due is lost.
+ */
+#define RTT_PROBE_INTERVAL_MS             (10000u)
+
+/* Round-trip time above which a probe counts as degraded. */
+#define RTT_PROBE_THRESHOLD_MS            (2000u)
+
+/* Number of degraded or lost probes in a row after which the broker
+ * connection is dropped and reconnected.
+ */
+#define RTT_PROBE_DEGRADED_COUNT          (3u)
+
+#endif /* RTT_PROBE_CONFIG_H_ */
+
+/* [] END OF FILE */
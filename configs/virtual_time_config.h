@@ -0,0 +1,33 @@
+/******************************************************************************
+* File Name:   virtual_time_config.h
+*
+* Description: This file contains the configuration macros for the
+*              virtual-time mode used to replay long scenarios in a simulator
+*              build.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef VIRTUAL_TIME_CONFIG_H_
+#define VIRTUAL_TIME_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set this macro to 1 to run all application delays, timeouts and timestamps
+ * on a discrete-event virtual clock instead of the FreeRTOS tick, else 0.
+ * Only for simulator builds in which the network and HAL are stubbed: a task
+ * that blocks on anything other than the virtual clock or an RTOS object lets
+ * virtual time run ahead of it.
+ */
+#define ENABLE_VIRTUAL_TIME               ( 0 )
+
+/* Maximum number of pending virtual-time events. Every task blocked in a
+ * virtual delay or timeout holds one event, the trace replay holds one more.
+ */
+#define VIRTUAL_TIME_MAX_EVENTS           (16u)
+
+#endif /* VIRTUAL_TIME_CONFIG_H_ */
+
+/* [] END OF FILE */
@@ -65,4 +65,27 @@
 /* Wi-Fi re-connection time interval in milliseconds. */
 #define WIFI_CONN_RETRY_INTERVAL_MS       (5000)
 
+/* Set this macro to 1 to roam between access points that share WIFI_SSID,
+ * else 0.
+ */
+#define ENABLE_WIFI_ROAMING               ( 1 )
+
+/* Interval in milliseconds at which the RSSI of the current AP is checked. */
+#define WIFI_ROAM_MONITOR_INTERVAL_MS     (1000u)
+
+/* Below this RSSI a background scan refreshes the list of candidate APs. */
+#define WIFI_ROAM_SCAN_RSSI_DBM           (-65)
+
+/* Minimum interval in milliseconds between two background scans. */
+#define WIFI_ROAM_SCAN_INTERVAL_MS        (20000u)
+
+/* Below this RSSI the client hands over to the best candidate, if that
+ * candidate is at least WIFI_ROAM_HYSTERESIS_DB stronger.
+ */
+#define WIFI_ROAM_RSSI_THRESHOLD_DBM      (-72)
+#define WIFI_ROAM_HYSTERESIS_DB           (8)
+
+/* Maximum number of candidate APs kept from a scan. */
+#define WIFI_ROAM_MAX_CANDIDATES          (4u)
+
 #endif /* WIFI_CONFIG_H_ */
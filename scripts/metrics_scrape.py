@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Scrapes the metrics snapshots of the device into a CSV file.
+
+Subscribes to MQTT_METRICS_TOPIC and MQTT_METRICS_SCHEMA_TOPIC and appends
+one "time,metric,value" row per value of every snapshot, in the naming of the
+Prometheus text format for both snapshot formats, so that the file can be
+graphed with any spreadsheet or plotting tool. Binary snapshots are decoded
+once their schema has been received; see source/metrics.c for the layout.
+
+Needs the paho-mqtt package.
+
+Usage: metrics_scrape.py [--broker host] [--port port] [--topic topic]
+                         [--count n] <output.csv>
+"""
+
+import argparse
+import csv
+import datetime
+import sys
+
+BINARY_VERSION = 1
+FNV_OFFSET_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+
+def schema_id(schema):
+    """32-bit FNV-1a hash of the schema, as metrics_schema_id()."""
+    value = FNV_OFFSET_BASIS
+    for byte in schema:
+        value = ((value ^ byte) * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def parse_schema(schema):
+    """Returns the (type, name, bounds) of every metric in registry order."""
+    metrics = []
+    for line in schema.decode().splitlines():
+        fields = line.split()
+        if fields:
+            metrics.append((fields[0], fields[1], [int(bound) for bound in fields[2:]]))
+    return metrics
+
+
+def read_varint(payload, offset):
+    """Decodes an unsigned LEB128 varint. Returns the value and next offset."""
+    value = 0
+    shift = 0
+    while True:
+        byte = payload[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, offset
+
+
+def decode_binary(payload, schemas):
+    """Decodes a binary snapshot into (metric, value) pairs."""
+    if payload[0] != BINARY_VERSION:
+        raise ValueError("unknown snapshot version %d" % payload[0])
+    snapshot_schema = int.from_bytes(payload[1:5], "little")
+    if snapshot_schema not in schemas:
+        raise KeyError("schema %08x not received yet" % snapshot_schema)
+
+    uptime_ms, offset = read_varint(payload, 5)
+    values = [("uptime_ms", uptime_ms)]
+    for kind, name, bounds in schemas[snapshot_schema]:
+        if kind == "counter":
+            value, offset = read_varint(payload, offset)
+            values.append((name, value))
+        elif kind == "gauge":
+            value, offset = read_varint(payload, offset)
+            values.append((name, (value >> 1) ^ -(value & 1)))
+        else:
+            total, offset = read_varint(payload, offset)
+            cumulative = 0
+            for bound in bounds + ["+Inf"]:
+                count, offset = read_varint(payload, offset)
+                cumulative += count
+                values.append(('%s_bucket{le="%s"}' % (name, bound), cumulative))
+            values.append((name + "_sum", total))
+            values.append((name + "_count", cumulative))
+    return values
+
+
+def decode_prometheus(payload):
+    """Parses a snapshot in the Prometheus text format into (metric, value) pairs."""
+    values = []
+    for line in payload.decode().splitlines():
+        if line and not line.startswith("#"):
+            metric, value = line.rsplit(" ", 1)
+            values.append((metric, int(value)))
+    return values
+
+
+def main(argv):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.stderr.write("metrics_scrape: install the paho-mqtt package\n")
+        return 1
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--broker", default="localhost", help="MQTT broker address")
+    parser.add_argument("--port", type=int, default=1883, help="MQTT broker port")
+    parser.add_argument("--topic", default="presencedetected/metrics",
+                        help="MQTT_METRICS_TOPIC of the device")
+    parser.add_argument("--count", type=int, default=0,
+                        help="number of snapshots to scrape, 0 for no limit")
+    parser.add_argument("output", help="CSV file the rows are appended to")
+    args = parser.parse_args(argv[1:])
+
+    schema_topic = args.topic + "/schema"
+    schemas = {}
+    scraped = [0]
+
+    output = open(args.output, "a", newline="", encoding="utf-8")
+    writer = csv.writer(output)
+    if output.tell() == 0:
+        writer.writerow(["time", "metric", "value"])
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe([(args.topic, 0), (schema_topic, 0)])
+
+    def on_message(client, userdata, message):
+        if message.topic == schema_topic:
+            schemas[schema_id(message.payload)] = parse_schema(message.payload)
+            return
+        try:
+            if message.payload[:1] == bytes([BINARY_VERSION]):
+                values = decode_binary(message.payload, schemas)
+            else:
+                values = decode_prometheus(message.payload)
+        except (KeyError, ValueError, IndexError) as error:
+            print("metrics_scrape: skipped snapshot: %s" % error)
+            return
+
+        now = datetime.datetime.now().isoformat(timespec="seconds")
+        writer.writerows([now, metric, value] for metric, value in values)
+        output.flush()
+        scraped[0] += 1
+        print("metrics_scrape: %d values at %s" % (len(values), now))
+        if scraped[0] == args.count:
+            client.disconnect()
+
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    else:
+        client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    try:
+        client.loop_forever()
+    except KeyboardInterrupt:
+        pass
+    output.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
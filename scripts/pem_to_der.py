@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Converts the PEM credentials of configs/mqtt_client_config.h to DER.
+
+Reads the CLIENT_CERTIFICATE, CLIENT_PRIVATE_KEY and ROOT_CA_CERTIFICATE
+macros and writes a header with one DER array per credential, which
+source/mqtt_client_config.c links instead of the PEM strings when
+ENABLE_DER_CREDENTIALS is 1. Run by the PREBUILD step of the Makefile.
+
+Usage: pem_to_der.py <mqtt_client_config.h> <output header>
+"""
+
+import base64
+import binascii
+import re
+import sys
+
+CREDENTIALS = (
+    ("CLIENT_CERTIFICATE", "client_certificate_der"),
+    ("CLIENT_PRIVATE_KEY", "client_private_key_der"),
+    ("ROOT_CA_CERTIFICATE", "root_ca_certificate_der"),
+)
+
+PEM_BLOCK = re.compile(r"-----BEGIN ([A-Z0-9 ]+)-----(.*?)-----END \1-----", re.S)
+
+
+def read_macro(text, name):
+    """Returns the string literal of '#define <name>' or None."""
+    match = re.search(r"^[ \t]*#define[ \t]+%s[ \t]*\\?\n?((?:.*\\\n)*.*)$" % name, text, re.M)
+    if match is None:
+        return None
+    literals = re.findall(r'"((?:[^"\\]|\\.)*)"', match.group(1))
+    return "".join(literals).encode().decode("unicode_escape")
+
+
+def pem_to_der(pem, name):
+    """Decodes the single PEM block of a credential."""
+    blocks = PEM_BLOCK.findall(pem)
+    if len(blocks) != 1:
+        raise ValueError("%s: expected one PEM block, found %d" % (name, len(blocks)))
+    label, body = blocks[0]
+    if "ENCRYPTED" in label or "Proc-Type" in body:
+        raise ValueError("%s: encrypted keys are not supported" % name)
+    try:
+        return base64.b64decode("".join(body.split()), validate=True)
+    except binascii.Error as error:
+        raise ValueError("%s: invalid base64 data (%s)" % (name, error))
+
+
+def c_array(name, data):
+    lines = ["static const uint8_t %s[%d] =" % (name, len(data)), "{"]
+    for offset in range(0, len(data), 12):
+        chunk = data[offset:offset + 12]
+        lines.append("    " + ", ".join("0x%02X" % byte for byte in chunk) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+
+    with open(argv[1], encoding="utf-8") as config:
+        text = config.read()
+
+    body = []
+    errors = []
+    pem_size = 0
+    der_size = 0
+    for macro, array in CREDENTIALS:
+        pem = read_macro(text, macro)
+        if pem is None:
+            continue
+        try:
+            der = pem_to_der(pem, macro)
+        except ValueError as error:
+            errors.append(str(error))
+            continue
+        pem_size += len(pem) + 1
+        der_size += len(der)
+        body.append(c_array(array, der))
+        body.append("#define %s_DER %s\n" % (macro, array))
+        print("pem_to_der: %s %d bytes PEM, %d bytes DER" % (macro, len(pem) + 1, len(der)))
+
+    out = [
+        "/* Generated by scripts/pem_to_der.py from %s. Do not edit. */" % argv[1],
+        "",
+        "#ifndef MQTT_CREDENTIALS_DER_H_",
+        "#define MQTT_CREDENTIALS_DER_H_",
+        "",
+        "#include <stdint.h>",
+        "",
+    ]
+    if errors:
+        # Only an error if the DER credentials are used.
+        for error in errors:
+            print("pem_to_der: skipped %s" % error)
+            out.append('#error "pem_to_der.py: %s"' % error)
+        out.append("")
+    out.append("/* Flash taken by the credentials as PEM strings and as DER. */")
+    out.append("#define MQTT_CREDENTIALS_PEM_SIZE         (%du)" % pem_size)
+    out.append("#define MQTT_CREDENTIALS_DER_SIZE         (%du)" % der_size)
+    out.append("")
+    out.extend(body)
+    out.append("#endif /* MQTT_CREDENTIALS_DER_H_ */")
+    out.append("")
+
+    contents = "\n".join(out)
+    try:
+        with open(argv[2], encoding="utf-8") as previous:
+            if previous.read() == contents:
+                return 0
+    except OSError:
+        pass
+    with open(argv[2], "w", encoding="utf-8") as header:
+        header.write(contents)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
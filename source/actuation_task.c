@@ -0,0 +1,315 @@
+/******************************************************************************
+* File Name:   actuation_task.c
+*
+* Description: This file contains the task that runs the actuation verifier.
+*              The publisher task notes every presence command it publishes,
+*              and the task feeds the ambient light samples of the sensor
+*              scheduler into the verifier. A command without a light edge is
+*              republished on MQTT_PUB_TOPIC, and after the last retry an alert
+*              is shown on the display. The latency percentiles are published
+*              on MQTT_ACTUATION_TOPIC every ACTUATION_REPORT_INTERVAL_MS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "actuation_task.h"
+#include "publisher_task.h"
+#include "sensor_scheduler.h"
+#include "render_server.h"
+#include "app_time.h"
+
+/* Configuration file for MQTT client */
+#include "mqtt_client_config.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+#if ENABLE_ACTUATION_VERIFIER
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* Name of the ambient light sensor driver in the sensor scheduler. */
+#define LIGHT_SENSOR_NAME           "light"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Verifier, owned by this task. */
+static actuation_verifier_t verifier;
+
+/* Latest command noted by the publisher task, not yet passed to the verifier. */
+static bool command_pending;
+static bool command_on;
+static uint32_t command_ms;
+
+/* Copy of the statistics for other tasks. */
+static actuation_stats_t last_stats;
+
+/* Payload of the last report, read by the publisher task. */
+static char report[128];
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void apply_command(void);
+static void handle_event(actuation_event_t event);
+static void publish_report(void);
+
+/******************************************************************************
+ * Function Name: actuation_task
+ ******************************************************************************
+ * Summary:
+ *  Feeds the light samples and the presence commands into the verifier and
+ *  acts on its outcome.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void actuation_task(void *pvParameters)
+{
+    uint8_t light_id = SENSOR_SCHEDULER_INVALID_ID;
+    uint32_t cursor = 0;
+    uint32_t last_report_ms;
+    uint32_t reported = 0;
+    sensor_sample_t sample;
+    actuation_stats_t stats;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    actuation_verifier_init(&verifier, ACTUATION_DARK_LEVEL_PERCENT, ACTUATION_STEP_PERCENT,
+                            ACTUATION_FILTER_SHIFT, ACTUATION_TIMEOUT_MS, ACTUATION_MAX_RETRIES);
+    last_report_ms = app_time_now_ms();
+
+    while (true)
+    {
+        app_time_delay_ms(ACTUATION_POLL_MS);
+
+        /* The TFT task registers the light sensor after it starts. */
+        if (light_id == SENSOR_SCHEDULER_INVALID_ID)
+        {
+            light_id = sensor_scheduler_find(LIGHT_SENSOR_NAME);
+            continue;
+        }
+
+        while (sensor_scheduler_read(&cursor, &sample))
+        {
+            if (sample.driver_id != light_id)
+            {
+                continue;
+            }
+
+            /* A command takes its baseline from the samples before it. */
+            if (command_pending && ((int32_t)(sample.timestamp_ms - command_ms) >= 0))
+            {
+                apply_command();
+            }
+            handle_event(actuation_verifier_sample(&verifier, sample.timestamp_ms, sample.value));
+        }
+        if (command_pending)
+        {
+            apply_command();
+        }
+
+        actuation_verifier_get_stats(&verifier, &stats);
+        taskENTER_CRITICAL();
+        last_stats = stats;
+        taskEXIT_CRITICAL();
+
+        if ((app_time_now_ms() - last_report_ms) >= ACTUATION_REPORT_INTERVAL_MS)
+        {
+            last_report_ms = app_time_now_ms();
+            if ((stats.confirmed + stats.missed) != reported)
+            {
+                reported = stats.confirmed + stats.missed;
+                publish_report();
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: actuation_note_command
+ ******************************************************************************
+ * Summary:
+ *  Records that a presence command was published. Called by the publisher
+ *  task. Only the latest command is kept until the next poll.
+ *
+ * Parameters:
+ *  bool on : true for MQTT_DEVICE_ON_MESSAGE
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void actuation_note_command(bool on)
+{
+    uint32_t now_ms = app_time_now_ms();
+
+    taskENTER_CRITICAL();
+    command_on = on;
+    command_ms = now_ms;
+    command_pending = true;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: actuation_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the verified commands, retries, misses and latency percentiles.
+ *
+ * Parameters:
+ *  actuation_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void actuation_get_stats(actuation_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* Passes the noted command to the verifier. */
+static void apply_command(void)
+{
+    bool on;
+    uint32_t at_ms;
+
+    taskENTER_CRITICAL();
+    on = command_on;
+    at_ms = command_ms;
+    command_pending = false;
+    taskEXIT_CRITICAL();
+
+    (void)actuation_verifier_command(&verifier, at_ms, on);
+}
+
+/* Republishes a command without light edge and raises an alert after the
+ * last retry.
+ */
+static void handle_event(actuation_event_t event)
+{
+    publisher_data_t publisher_q_data;
+
+    switch (event)
+    {
+        case ACTUATION_EVENT_CONFIRMED:
+        {
+            printf("Actuation: light on after %lu ms\n",
+                   (unsigned long)verifier.stats.last_latency_ms);
+            break;
+        }
+
+        case ACTUATION_EVENT_RETRY:
+        {
+            printf("Actuation: no light, republishing the command\n");
+            publisher_q_data.cmd = PUBLISH_MQTT_MSG;
+            publisher_q_data.data = MQTT_DEVICE_ON_MESSAGE;
+            (void)publisher_task_send(&publisher_q_data, 0);
+            break;
+        }
+
+        case ACTUATION_EVENT_MISSED:
+        {
+            printf("Actuation: the light did not come on\n");
+            render_show_alert("Light did not switch on");
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/* Publishes the latency percentiles in milliseconds and the counters. */
+static void publish_report(void)
+{
+    publisher_data_t publisher_q_data;
+
+    if (publisher_task_q == NULL)
+    {
+        return;
+    }
+
+    snprintf(report, sizeof(report),
+             "count %lu p50 %lu p90 %lu p99 %lu max %lu retries %lu missed %lu",
+             (unsigned long)last_stats.latency_ms.count,
+             (unsigned long)last_stats.latency_ms.p50,
+             (unsigned long)last_stats.latency_ms.p90,
+             (unsigned long)last_stats.latency_ms.p99,
+             (unsigned long)last_stats.latency_ms.max,
+             (unsigned long)last_stats.retries,
+             (unsigned long)last_stats.missed);
+
+    publisher_q_data.cmd = PUBLISH_ACTUATION;
+    publisher_q_data.data = report;
+    (void)publisher_task_send(&publisher_q_data, 0);
+}
+
+/******************************************************************************
+ * Function Name: actuation_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the verification counters and latency percentiles for the
+ *  get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t actuation_format_stats(char *buf, size_t size)
+{
+    actuation_stats_t stats;
+    int len;
+
+    actuation_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "actuation_commands %lu skipped %lu cancelled %lu\n"
+                   "actuation_confirmed %lu retries %lu missed %lu\n"
+                   "actuation_latency_ms p50 %lu p90 %lu p99 %lu max %lu\n",
+                   (unsigned long)stats.commands,
+                   (unsigned long)stats.skipped,
+                   (unsigned long)stats.cancelled,
+                   (unsigned long)stats.confirmed,
+                   (unsigned long)stats.retries,
+                   (unsigned long)stats.missed,
+                   (unsigned long)stats.latency_ms.p50,
+                   (unsigned long)stats.latency_ms.p90,
+                   (unsigned long)stats.latency_ms.p99,
+                   (unsigned long)stats.latency_ms.max);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_ACTUATION_VERIFIER */
+
+/* [] END OF FILE */
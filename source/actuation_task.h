@@ -0,0 +1,44 @@
+/******************************************************************************
+* File Name:   actuation_task.h
+*
+* Description: This file is the public interface of actuation_task.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef ACTUATION_TASK_H_
+#define ACTUATION_TASK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "actuation_config.h"
+#include "actuation_verifier.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Actuation Task. */
+#define ACTUATION_TASK_PRIORITY           (1)
+#define ACTUATION_TASK_STACK_SIZE         (1024 * 1)
+
+/* Interval at which the light samples are read from the sensor scheduler. */
+#define ACTUATION_POLL_MS                 (100u)
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_ACTUATION_VERIFIER
+void actuation_task(void *pvParameters);
+void actuation_note_command(bool on);
+void actuation_get_stats(actuation_stats_t *stats);
+size_t actuation_format_stats(char *buf, size_t size);
+#else
+#define actuation_note_command(on)        do { (void)(on); } while (0)
+#endif /* ENABLE_ACTUATION_VERIFIER */
+
+#endif /* ACTUATION_TASK_H_ */
+
+/* [] END OF FILE */
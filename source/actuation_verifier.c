@@ -0,0 +1,219 @@
+/******************************************************************************
+* File Name:   actuation_verifier.c
+*
+* Description: This file contains the actuation verifier. The fountain light
+*              is next to the ambient light sensor, so when the smart plug
+*              switches on at night the filtered light level makes a step.
+*              After an "on" command the verifier waits for that step and
+*              takes the first raw sample above the step as the light edge,
+*              which gives the latency from the command to the light actually
+*              coming on. Without a step within the timeout the command is
+*              retried, and after the last retry it is reported as missed.
+*
+*              Commands in daylight, before the first light sample, or while
+*              the light is already known to be on are not verified. An "off"
+*              command cancels a pending verification.
+*
+*              The verifier has no dependency on the HAL or FreeRTOS, so a
+*              recorded light trace can be replayed on a host.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "actuation_verifier.h"
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* Fixed-point fraction bits of the filtered light level. */
+#define LEVEL_FRACTION_BITS         (4u)
+
+/******************************************************************************
+ * Function Name: actuation_verifier_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes a verifier.
+ *
+ * Parameters:
+ *  actuation_verifier_t *verifier : Verifier to be initialized
+ *  uint8_t dark_level : Filtered light level in percent below which it is night
+ *  uint8_t step : Rise of the filtered light level in percent that confirms
+ *  uint8_t filter_shift : The filter moves 1/2^filter_shift towards a sample
+ *  uint32_t timeout_ms : Time within which the light must come on
+ *  uint8_t max_retries : Retries before a command is reported as missed
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void actuation_verifier_init(actuation_verifier_t *verifier, uint8_t dark_level,
+                             uint8_t step, uint8_t filter_shift, uint32_t timeout_ms,
+                             uint8_t max_retries)
+{
+    memset(verifier, 0, sizeof(actuation_verifier_t));
+    verifier->dark_level_x16 = (int32_t)dark_level << LEVEL_FRACTION_BITS;
+    verifier->step_x16 = (int32_t)step << LEVEL_FRACTION_BITS;
+    verifier->filter_shift = filter_shift;
+    verifier->timeout_ms = timeout_ms;
+    verifier->max_retries = max_retries;
+    latency_histogram_init(&verifier->latency);
+}
+
+/******************************************************************************
+ * Function Name: actuation_verifier_command
+ ******************************************************************************
+ * Summary:
+ *  Notes an "on" or "off" command. An "on" at night starts a verification,
+ *  unless one is already pending.
+ *
+ * Parameters:
+ *  actuation_verifier_t *verifier : Verifier
+ *  uint32_t now_ms : Time of the command
+ *  bool on : true for "on", false for "off"
+ *
+ * Return:
+ *  bool : true if a verification was started
+ *
+ ******************************************************************************/
+bool actuation_verifier_command(actuation_verifier_t *verifier, uint32_t now_ms, bool on)
+{
+    if (!on)
+    {
+        if (verifier->pending)
+        {
+            verifier->pending = false;
+            verifier->stats.cancelled++;
+        }
+        verifier->light_on = false;
+        return false;
+    }
+
+    if (verifier->pending)
+    {
+        return false;
+    }
+
+    verifier->stats.commands++;
+    if (!verifier->filter_valid || verifier->light_on ||
+        (verifier->filtered_x16 >= verifier->dark_level_x16))
+    {
+        verifier->stats.skipped++;
+        return false;
+    }
+
+    verifier->pending = true;
+    verifier->attempts = 0;
+    verifier->command_ms = now_ms;
+    verifier->attempt_ms = now_ms;
+    verifier->baseline_x16 = verifier->filtered_x16;
+    verifier->edge_seen = false;
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: actuation_verifier_sample
+ ******************************************************************************
+ * Summary:
+ *  Filters a light sample and advances a pending verification. Samples must
+ *  be passed in time order.
+ *
+ * Parameters:
+ *  actuation_verifier_t *verifier : Verifier
+ *  uint32_t timestamp_ms : Time of the sample
+ *  int32_t level : Ambient light level in percent
+ *
+ * Return:
+ *  actuation_event_t : Outcome of the sample
+ *
+ ******************************************************************************/
+actuation_event_t actuation_verifier_sample(actuation_verifier_t *verifier, uint32_t timestamp_ms,
+                                            int32_t level)
+{
+    int32_t level_x16 = level * (1 << LEVEL_FRACTION_BITS);
+    uint32_t latency_ms;
+
+    if (!verifier->filter_valid)
+    {
+        verifier->filtered_x16 = level_x16;
+        verifier->filter_valid = true;
+    }
+    else
+    {
+        verifier->filtered_x16 += (level_x16 - verifier->filtered_x16) >> verifier->filter_shift;
+    }
+
+    /* Samples taken before the command do not count. */
+    if (!verifier->pending || ((int32_t)(timestamp_ms - verifier->command_ms) < 0))
+    {
+        return ACTUATION_EVENT_NONE;
+    }
+
+    /* The edge is the first raw sample above the step, as long as the level
+     * stays above it until the filtered level confirms.
+     */
+    if ((level_x16 - verifier->baseline_x16) >= verifier->step_x16)
+    {
+        if (!verifier->edge_seen)
+        {
+            verifier->edge_seen = true;
+            verifier->edge_ms = timestamp_ms;
+        }
+    }
+    else
+    {
+        verifier->edge_seen = false;
+    }
+
+    if (verifier->edge_seen &&
+        ((verifier->filtered_x16 - verifier->baseline_x16) >= verifier->step_x16))
+    {
+        latency_ms = verifier->edge_ms - verifier->command_ms;
+        latency_histogram_record(&verifier->latency, latency_ms);
+        verifier->stats.last_latency_ms = latency_ms;
+        verifier->stats.confirmed++;
+        verifier->pending = false;
+        verifier->light_on = true;
+        return ACTUATION_EVENT_CONFIRMED;
+    }
+
+    if ((timestamp_ms - verifier->attempt_ms) < verifier->timeout_ms)
+    {
+        return ACTUATION_EVENT_NONE;
+    }
+
+    if (verifier->attempts < verifier->max_retries)
+    {
+        verifier->attempts++;
+        verifier->attempt_ms = timestamp_ms;
+        verifier->stats.retries++;
+        return ACTUATION_EVENT_RETRY;
+    }
+
+    verifier->pending = false;
+    verifier->stats.missed++;
+    return ACTUATION_EVENT_MISSED;
+}
+
+/******************************************************************************
+ * Function Name: actuation_verifier_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the counters and the latency percentiles.
+ *
+ * Parameters:
+ *  const actuation_verifier_t *verifier : Verifier
+ *  actuation_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void actuation_verifier_get_stats(const actuation_verifier_t *verifier, actuation_stats_t *stats)
+{
+    *stats = verifier->stats;
+    latency_histogram_summarize(&verifier->latency, &stats->latency_ms);
+}
+
+/* [] END OF FILE */
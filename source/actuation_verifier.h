@@ -0,0 +1,80 @@
+/******************************************************************************
+* File Name:   actuation_verifier.h
+*
+* Description: This file is the public interface of actuation_verifier.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef ACTUATION_VERIFIER_H_
+#define ACTUATION_VERIFIER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "latency_histogram.h"
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Outcome of a light sample. */
+typedef enum
+{
+    ACTUATION_EVENT_NONE,
+    ACTUATION_EVENT_CONFIRMED,  /* The light came on */
+    ACTUATION_EVENT_RETRY,      /* No light within the timeout: republish the command */
+    ACTUATION_EVENT_MISSED      /* No light after all retries */
+} actuation_event_t;
+
+/* Counters of the verifier. */
+typedef struct
+{
+    uint32_t commands;          /* "on" commands */
+    uint32_t skipped;           /* Not verified: daylight, no light level yet or already on */
+    uint32_t confirmed;
+    uint32_t retries;
+    uint32_t missed;
+    uint32_t cancelled;         /* "off" before the light came on */
+    uint32_t last_latency_ms;
+    latency_summary_t latency_ms; /* From the first command to the light edge */
+} actuation_stats_t;
+
+/* Verifier state. All fields are private to actuation_verifier.c. */
+typedef struct
+{
+    int32_t dark_level_x16;
+    int32_t step_x16;
+    uint8_t filter_shift;
+    uint8_t max_retries;
+    uint32_t timeout_ms;
+
+    int32_t filtered_x16;
+    bool filter_valid;
+    bool light_on;
+
+    bool pending;
+    uint8_t attempts;
+    uint32_t command_ms;
+    uint32_t attempt_ms;
+    int32_t baseline_x16;
+    bool edge_seen;
+    uint32_t edge_ms;
+
+    actuation_stats_t stats;
+    latency_histogram_t latency;
+} actuation_verifier_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void actuation_verifier_init(actuation_verifier_t *verifier, uint8_t dark_level,
+                             uint8_t step, uint8_t filter_shift, uint32_t timeout_ms,
+                             uint8_t max_retries);
+bool actuation_verifier_command(actuation_verifier_t *verifier, uint32_t now_ms, bool on);
+actuation_event_t actuation_verifier_sample(actuation_verifier_t *verifier, uint32_t timestamp_ms,
+                                            int32_t level);
+void actuation_verifier_get_stats(const actuation_verifier_t *verifier, actuation_stats_t *stats);
+
+#endif /* ACTUATION_VERIFIER_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,538 @@
+/******************************************************************************
+* File Name:   app_heap.c
+*
+* Description: This file contains the heap of the application when
+*              ENABLE_TLSF_HEAP is set. It replaces the FreeRTOS heap_3
+*              scheme and the newlib allocator: pvPortMalloc(), vPortFree(),
+*              malloc(), free(), calloc(), realloc() and their reentrant
+*              variants are served from one TLSF heap (tlsf_heap.c) on the
+*              linker heap region.
+*
+*              heap_3 suspends the scheduler around the newlib malloc(), whose
+*              time depends on the number of free chunks it walks. The TLSF
+*              operations run in bounded time, so they are serialized with a
+*              short critical section instead; clearing and copying memory
+*              for calloc() and realloc() run outside of it.
+*
+*              Every allocation is accounted to a subsystem tag, which is
+*              looked up once per task from its name and then kept in the
+*              application tag of the task.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include "heap_config.h"
+
+#if ENABLE_TLSF_HEAP
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <reent.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "app_heap.h"
+#include "tlsf_heap.h"
+
+#if APP_HEAP_ENABLE_TIMING
+#include "cycle_counter.h"
+#endif /* APP_HEAP_ENABLE_TIMING */
+
+#if !defined(__GNUC__) || defined(__ARMCC_VERSION)
+#error "The TLSF heap takes the heap region of the GCC_ARM linker script."
+#endif
+
+#if (configHEAP_ALLOCATION_SCHEME != NO_HEAP_ALLOCATION) || !configUSE_APPLICATION_TASK_TAG
+#error "ENABLE_TLSF_HEAP requires NO_HEAP_ALLOCATION and configUSE_APPLICATION_TASK_TAG."
+#endif
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Tag of the tasks whose name starts with a prefix. Tasks of the libraries
+ * are listed with the names they are created with.
+ */
+typedef struct
+{
+    const char *prefix;
+    app_heap_tag_t tag;
+} task_tag_t;
+
+static const task_tag_t task_tags[] =
+{
+    { "tcpip_thread",   APP_HEAP_TAG_LWIP },
+    { "WHD",            APP_HEAP_TAG_WIFI },
+    { "WCM",            APP_HEAP_TAG_WIFI },
+    { "Roam",           APP_HEAP_TAG_WIFI },
+    { "MQTT",           APP_HEAP_TAG_MQTT },
+    { "Publisher",      APP_HEAP_TAG_MQTT },
+    { "Subscriber",     APP_HEAP_TAG_MQTT },
+    { "RPC",            APP_HEAP_TAG_MQTT },
+    { "tftTask",        APP_HEAP_TAG_GUI  }
+};
+
+static const char *const tag_names[APP_HEAP_TAG_COUNT] =
+{
+    [APP_HEAP_TAG_OTHER]   = "other",
+    [APP_HEAP_TAG_STARTUP] = "startup",
+    [APP_HEAP_TAG_LWIP]    = "lwip",
+    [APP_HEAP_TAG_WIFI]    = "wifi",
+    [APP_HEAP_TAG_MBEDTLS] = "mbedtls",
+    [APP_HEAP_TAG_MQTT]    = "mqtt",
+    [APP_HEAP_TAG_GUI]     = "gui",
+    [APP_HEAP_TAG_APP]     = "app"
+};
+
+/* Heap region exported by the linker. */
+extern uint8_t __HeapBase;
+extern uint8_t __HeapLimit;
+
+static tlsf_heap_t heap;
+static bool heap_ready;
+
+/* Time spent with interrupts masked. */
+static uint32_t heap_operations;
+static uint64_t heap_locked_cycles;
+static uint32_t heap_max_locked_cycles;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint8_t task_tag(void);
+static void *heap_alloc(size_t size, uint8_t tag);
+static void heap_release(void *ptr);
+static void *heap_realloc(void *ptr, size_t size, uint8_t tag);
+static void *heap_calloc(size_t count, size_t size, uint8_t tag);
+
+/******************************************************************************
+* Locking
+*******************************************************************************/
+/* Masks the interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY, from a task
+ * or from an interrupt, and initializes the heap on the first call, which may
+ * come from the C runtime before main().
+ */
+static inline UBaseType_t heap_lock(void)
+{
+    UBaseType_t saved = 0;
+
+    if (xPortIsInsideInterrupt())
+    {
+        saved = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+    }
+
+    if (!heap_ready)
+    {
+        (void)tlsf_heap_init(&heap, &__HeapBase, (size_t)(&__HeapLimit - &__HeapBase));
+#if APP_HEAP_ENABLE_TIMING
+        cycle_counter_init();
+#endif /* APP_HEAP_ENABLE_TIMING */
+        heap_ready = true;
+    }
+
+    return saved;
+}
+
+static inline void heap_unlock(UBaseType_t saved)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(saved);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/* Start and end of a heap operation, called with the heap locked. */
+static inline uint32_t operation_start(void)
+{
+#if APP_HEAP_ENABLE_TIMING
+    return cycle_counter_get();
+#else
+    return 0;
+#endif /* APP_HEAP_ENABLE_TIMING */
+}
+
+static inline void operation_end(uint32_t start)
+{
+#if APP_HEAP_ENABLE_TIMING
+    uint32_t cycles = cycle_counter_get() - start;
+
+    heap_locked_cycles += cycles;
+    if (cycles > heap_max_locked_cycles)
+    {
+        heap_max_locked_cycles = cycles;
+    }
+#else
+    (void)start;
+#endif /* APP_HEAP_ENABLE_TIMING */
+    heap_operations++;
+}
+
+/******************************************************************************
+* FreeRTOS heap interface
+*******************************************************************************/
+void *pvPortMalloc(size_t xWantedSize)
+{
+    void *ptr = heap_alloc(xWantedSize, task_tag());
+
+    traceMALLOC(ptr, xWantedSize);
+
+#if (configUSE_MALLOC_FAILED_HOOK == 1)
+    if (ptr == NULL)
+    {
+        extern void vApplicationMallocFailedHook(void);
+        vApplicationMallocFailedHook();
+    }
+#endif /* configUSE_MALLOC_FAILED_HOOK */
+
+    return ptr;
+}
+
+void vPortFree(void *pv)
+{
+    if (pv != NULL)
+    {
+        traceFREE(pv, tlsf_heap_block_size(pv));
+        heap_release(pv);
+    }
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+    UBaseType_t saved = heap_lock();
+    size_t free_bytes = heap.free_bytes;
+
+    heap_unlock(saved);
+    return free_bytes;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+    UBaseType_t saved = heap_lock();
+    size_t min_free_bytes = heap.min_free_bytes;
+
+    heap_unlock(saved);
+    return min_free_bytes;
+}
+
+/******************************************************************************
+* newlib allocator
+*******************************************************************************/
+void *_malloc_r(struct _reent *reent, size_t size)
+{
+    void *ptr = heap_alloc(size, task_tag());
+
+    if (ptr == NULL)
+    {
+        reent->_errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void _free_r(struct _reent *reent, void *ptr)
+{
+    (void)reent;
+    heap_release(ptr);
+}
+
+void *_calloc_r(struct _reent *reent, size_t count, size_t size)
+{
+    void *ptr = heap_calloc(count, size, task_tag());
+
+    if (ptr == NULL)
+    {
+        reent->_errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void *_realloc_r(struct _reent *reent, void *ptr, size_t size)
+{
+    void *new_ptr = heap_realloc(ptr, size, task_tag());
+
+    if ((new_ptr == NULL) && (size != 0))
+    {
+        reent->_errno = ENOMEM;
+    }
+    return new_ptr;
+}
+
+void *malloc(size_t size)
+{
+    return _malloc_r(_REENT, size);
+}
+
+void free(void *ptr)
+{
+    heap_release(ptr);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    return _calloc_r(_REENT, count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    return _realloc_r(_REENT, ptr, size);
+}
+
+/******************************************************************************
+* mbedTLS platform allocator (MBEDTLS_PLATFORM_CALLOC_MACRO)
+*******************************************************************************/
+void *app_heap_mbedtls_calloc(size_t count, size_t size)
+{
+    return heap_calloc(count, size, APP_HEAP_TAG_MBEDTLS);
+}
+
+void app_heap_free(void *ptr)
+{
+    heap_release(ptr);
+}
+
+/******************************************************************************
+ * Function Name: app_heap_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the statistics of the heap and of every tag. All of them are
+ *  counters kept by the heap operations, so the heap is locked for a
+ *  bounded time.
+ *
+ * Parameters:
+ *  app_heap_stats_t *stats : Statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void app_heap_get_stats(app_heap_stats_t *stats)
+{
+    tlsf_heap_stats_t heap_stats;
+    UBaseType_t saved = heap_lock();
+
+    tlsf_heap_get_stats(&heap, &heap_stats);
+    for (uint32_t i = 0; i < APP_HEAP_TAG_COUNT; i++)
+    {
+        stats->tags[i].in_use = heap.tags[i].in_use;
+        stats->tags[i].peak = heap.tags[i].peak;
+        stats->tags[i].blocks = heap.tags[i].blocks;
+        stats->tags[i].allocations = heap.tags[i].allocations;
+        stats->tags[i].failures = heap.tags[i].failures;
+    }
+    stats->operations = heap_operations;
+    stats->avg_locked_cycles = (heap_operations > 0) ?
+                               (uint32_t)(heap_locked_cycles / heap_operations) : 0;
+    stats->max_locked_cycles = heap_max_locked_cycles;
+    heap_unlock(saved);
+
+    stats->pool_size = heap_stats.pool_size;
+    stats->free_bytes = heap_stats.free_bytes;
+    stats->min_free_bytes = heap_stats.min_free_bytes;
+    stats->free_blocks = heap_stats.free_blocks;
+    stats->largest_free_estimate = heap_stats.largest_free_estimate;
+    stats->fragmentation_pct_estimate = heap_stats.fragmentation_pct_estimate;
+}
+
+/******************************************************************************
+ * Function Name: app_heap_format
+ ******************************************************************************
+ * Summary:
+ *  Prints the heap statistics as text lines for the get-heap RPC command:
+ *
+ *    heap_free_blocks <n>
+ *    heap_largest_free_estimate <bytes>
+ *    heap_fragmentation_pct_estimate <percent>
+ *    heap_locked_cycles avg <n> max <n>
+ *    heap_tag <name> in_use <bytes> peak <bytes> blocks <n> allocations <n> failures <n>
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t app_heap_format(char *buf, size_t size)
+{
+    app_heap_stats_t stats;
+    size_t pos = 0;
+    int len;
+
+    app_heap_get_stats(&stats);
+
+    len = snprintf(buf, size,
+                   "heap_free_blocks %lu\n"
+                   "heap_largest_free_estimate %lu\n"
+                   "heap_fragmentation_pct_estimate %lu\n"
+                   "heap_locked_cycles avg %lu max %lu\n",
+                   (unsigned long)stats.free_blocks,
+                   (unsigned long)stats.largest_free_estimate,
+                   (unsigned long)stats.fragmentation_pct_estimate,
+                   (unsigned long)stats.avg_locked_cycles, (unsigned long)stats.max_locked_cycles);
+    pos = (len > 0) ? (size_t)len : 0;
+
+    for (uint32_t i = 0; (i < APP_HEAP_TAG_COUNT) && (pos < size); i++)
+    {
+        if (stats.tags[i].allocations == 0)
+        {
+            continue;
+        }
+        len = snprintf(&buf[pos], size - pos,
+                       "heap_tag %s in_use %lu peak %lu blocks %lu allocations %lu failures %lu\n",
+                       tag_names[i], (unsigned long)stats.tags[i].in_use,
+                       (unsigned long)stats.tags[i].peak, (unsigned long)stats.tags[i].blocks,
+                       (unsigned long)stats.tags[i].allocations,
+                       (unsigned long)stats.tags[i].failures);
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+const char *app_heap_tag_name(app_heap_tag_t tag)
+{
+    return (tag < APP_HEAP_TAG_COUNT) ? tag_names[tag] : "?";
+}
+
+/* Tag of the calling context. The tag of a task is looked up from its name
+ * on its first allocation and stored, plus one, in its application tag.
+ */
+static uint8_t task_tag(void)
+{
+    TaskHandle_t task;
+    TaskHookFunction_t stored;
+    const char *name;
+    uint8_t tag = APP_HEAP_TAG_APP;
+
+    if (xPortIsInsideInterrupt())
+    {
+        return APP_HEAP_TAG_OTHER;
+    }
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+    {
+        return APP_HEAP_TAG_STARTUP;
+    }
+
+    task = xTaskGetCurrentTaskHandle();
+    stored = xTaskGetApplicationTaskTag(task);
+    if (stored != NULL)
+    {
+        return (uint8_t)((uintptr_t)stored - 1u);
+    }
+
+    name = pcTaskGetName(task);
+    for (uint32_t i = 0; i < (sizeof(task_tags) / sizeof(task_tags[0])); i++)
+    {
+        if (strncmp(name, task_tags[i].prefix, strlen(task_tags[i].prefix)) == 0)
+        {
+            tag = (uint8_t)task_tags[i].tag;
+            break;
+        }
+    }
+
+    vTaskSetApplicationTaskTag(task, (TaskHookFunction_t)((uintptr_t)tag + 1u));
+    return tag;
+}
+
+static void *heap_alloc(size_t size, uint8_t tag)
+{
+    UBaseType_t saved = heap_lock();
+    uint32_t start = operation_start();
+    void *ptr = tlsf_heap_malloc(&heap, size, tag);
+
+    operation_end(start);
+    heap_unlock(saved);
+    return ptr;
+}
+
+static void heap_release(void *ptr)
+{
+    UBaseType_t saved;
+    uint32_t start;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    saved = heap_lock();
+    start = operation_start();
+    tlsf_heap_free(&heap, ptr);
+    operation_end(start);
+    heap_unlock(saved);
+}
+
+/* Resizes in place if the neighbouring memory allows it, else allocates a new
+ * block and copies the data with the heap unlocked.
+ */
+static void *heap_realloc(void *ptr, size_t size, uint8_t tag)
+{
+    UBaseType_t saved;
+    uint32_t start;
+    void *new_ptr;
+    size_t old_size;
+
+    if (ptr == NULL)
+    {
+        return heap_alloc(size, tag);
+    }
+    if (size == 0)
+    {
+        heap_release(ptr);
+        return NULL;
+    }
+
+    saved = heap_lock();
+    start = operation_start();
+    new_ptr = tlsf_heap_resize(&heap, ptr, size);
+    operation_end(start);
+    heap_unlock(saved);
+    if (new_ptr != NULL)
+    {
+        return new_ptr;
+    }
+
+    new_ptr = heap_alloc(size, tlsf_heap_block_tag(ptr));
+    if (new_ptr != NULL)
+    {
+        old_size = tlsf_heap_block_size(ptr);
+        memcpy(new_ptr, ptr, (old_size < size) ? old_size : size);
+        heap_release(ptr);
+    }
+    return new_ptr;
+}
+
+static void *heap_calloc(size_t count, size_t size, uint8_t tag)
+{
+    void *ptr;
+
+    if ((size != 0) && (count > (SIZE_MAX / size)))
+    {
+        return NULL;
+    }
+
+    ptr = heap_alloc(count * size, tag);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+#endif /* ENABLE_TLSF_HEAP */
+
+/* [] END OF FILE */
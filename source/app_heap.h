@@ -0,0 +1,81 @@
+/******************************************************************************
+* File Name:   app_heap.h
+*
+* Description: This file is the public interface of app_heap.c, the TLSF heap
+*              that serves pvPortMalloc() and the newlib malloc() when
+*              ENABLE_TLSF_HEAP is set.
+*
+*              The header is included by mbedtls_user_config.h, so it only
+*              depends on the C library.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef APP_HEAP_H_
+#define APP_HEAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "heap_config.h"
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Subsystems the allocations are accounted to. The tag of an allocation is
+ * taken from the name of the calling task, except for mbedTLS, whose
+ * allocations are tagged through its platform calloc() in whatever task the
+ * handshake runs.
+ */
+typedef enum
+{
+    APP_HEAP_TAG_OTHER,         /* Interrupts and unknown tasks */
+    APP_HEAP_TAG_STARTUP,       /* Before the scheduler starts: tasks and queues of main() */
+    APP_HEAP_TAG_LWIP,          /* lwIP TCP/IP thread */
+    APP_HEAP_TAG_WIFI,          /* Wi-Fi host driver and connection manager */
+    APP_HEAP_TAG_MBEDTLS,       /* TLS sessions and certificates */
+    APP_HEAP_TAG_MQTT,          /* MQTT client, publisher, subscriber and RPC tasks */
+    APP_HEAP_TAG_GUI,           /* emWin and the TFT task */
+    APP_HEAP_TAG_APP,           /* Other application tasks */
+    APP_HEAP_TAG_COUNT
+} app_heap_tag_t;
+
+/* Statistics of one tag. */
+typedef struct
+{
+    uint32_t in_use;            /* Bytes currently allocated */
+    uint32_t peak;
+    uint32_t blocks;
+    uint32_t allocations;
+    uint32_t failures;
+} app_heap_tag_stats_t;
+
+/* Statistics of the heap. */
+typedef struct
+{
+    uint32_t pool_size;
+    uint32_t free_bytes;
+    uint32_t min_free_bytes;
+    uint32_t free_blocks;
+    uint32_t largest_free_estimate;
+    uint32_t fragmentation_pct_estimate;
+    uint32_t operations;        /* Allocations, frees and in-place resizes */
+    uint32_t avg_locked_cycles; /* Interrupts masked, per operation */
+    uint32_t max_locked_cycles;
+    app_heap_tag_stats_t tags[APP_HEAP_TAG_COUNT];
+} app_heap_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_TLSF_HEAP
+void app_heap_get_stats(app_heap_stats_t *stats);
+size_t app_heap_format(char *buf, size_t size);
+const char *app_heap_tag_name(app_heap_tag_t tag);
+void *app_heap_mbedtls_calloc(size_t count, size_t size);
+void app_heap_free(void *ptr);
+#endif /* ENABLE_TLSF_HEAP */
+
+#endif /* APP_HEAP_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,249 @@
+/******************************************************************************
+* File Name:   app_time.c
+*
+* Description: This file contains the virtual-time mode. A task that delays or
+*              waits with a timeout schedules a wakeup event on the virtual
+*              clock and blocks on its task notification: a delay on its own
+*              notification index, a timeout on the index other tasks notify,
+*              with the event cancelled when it ends early. The time master task
+*              runs at the idle priority, so it only gets the CPU when every
+*              other task is blocked; it then advances the clock straight to
+*              the next event and runs it. Idle time is skipped, so days of
+*              retry intervals and sensor polling pass in seconds, and the
+*              order of events only depends on the inputs.
+*
+*              Without ENABLE_VIRTUAL_TIME the functions in app_time.h map
+*              directly to the FreeRTOS tick and this file is empty.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "app_time.h"
+#include "radar_replay.h"
+
+#if ENABLE_VIRTUAL_TIME
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Virtual clock and its pending events, accessed in critical sections. */
+static virtual_clock_t virtual_clock;
+static virtual_clock_event_t virtual_clock_events[VIRTUAL_TIME_MAX_EVENTS];
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void wake_task(void *arg);
+static void end_delay(void *arg);
+static uint64_t now_ms(void);
+
+/******************************************************************************
+ * Function Name: app_time_task
+ ******************************************************************************
+ * Summary:
+ *  Time master task. Whenever it runs, no other task is ready, so it advances
+ *  the virtual clock to the next event and runs it. A task woken by the event
+ *  preempts this task immediately.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void app_time_task(void *pvParameters)
+{
+    bool stepped;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    radar_replay_start();
+
+    while (true)
+    {
+        taskENTER_CRITICAL();
+        stepped = virtual_clock_step(&virtual_clock);
+        taskEXIT_CRITICAL();
+
+        if (!stepped)
+        {
+            /* Every task waits for an event without a timeout; let the idle
+             * task clean up and check again on the next real tick.
+             */
+            vTaskDelay(1);
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: app_time_now_ms
+ ******************************************************************************
+ * Summary:
+ *  Returns the current virtual time.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  uint32_t : Virtual time in milliseconds
+ *
+ ******************************************************************************/
+uint32_t app_time_now_ms(void)
+{
+    return (uint32_t)now_ms();
+}
+
+uint32_t app_time_now_ms_from_isr(void)
+{
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    uint64_t now = virtual_clock_now(&virtual_clock);
+
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+    return (uint32_t)now;
+}
+
+/******************************************************************************
+ * Function Name: app_time_delay_ms
+ ******************************************************************************
+ * Summary:
+ *  Blocks the calling task until 'delay_ms' of virtual time have passed. The
+ *  delay waits on APP_TIME_NOTIFY_INDEX, so notifications given to the task
+ *  for other reasons neither end it early nor are consumed by it.
+ *
+ * Parameters:
+ *  uint32_t delay_ms : Delay in milliseconds
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void app_time_delay_ms(uint32_t delay_ms)
+{
+    uint64_t deadline_ms = now_ms() + delay_ms;
+    uint64_t current_ms;
+
+    while ((current_ms = now_ms()) < deadline_ms)
+    {
+        if (app_time_schedule((uint32_t)(deadline_ms - current_ms), end_delay,
+                              xTaskGetCurrentTaskHandle()))
+        {
+            (void)ulTaskNotifyTakeIndexed(APP_TIME_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+        }
+        else
+        {
+            /* The event storage is full; retry once another event ran. */
+            vTaskDelay(1);
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: app_time_notify_take
+ ******************************************************************************
+ * Summary:
+ *  Waits for a task notification for at most 'timeout_ms' of virtual time.
+ *  The timeout itself is delivered as a notification and cancelled when
+ *  another notification arrives first. A timeout that fired just before the
+ *  cancel is a spurious wakeup, which the caller must tolerate as it must
+ *  with a real tick.
+ *
+ * Parameters:
+ *  uint32_t timeout_ms : Timeout in milliseconds, or APP_TIME_WAIT_FOREVER
+ *
+ * Return:
+ *  uint32_t : Notification value before it was cleared
+ *
+ ******************************************************************************/
+uint32_t app_time_notify_take(uint32_t timeout_ms)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint32_t value;
+
+    if (timeout_ms == APP_TIME_WAIT_FOREVER)
+    {
+        return ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    if (!app_time_schedule(timeout_ms, wake_task, task))
+    {
+        return ulTaskNotifyTake(pdTRUE, 1);
+    }
+
+    value = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    /* Do not leave a stale timeout in the event storage. */
+    taskENTER_CRITICAL();
+    (void)virtual_clock_cancel(&virtual_clock, wake_task, task);
+    taskEXIT_CRITICAL();
+
+    return value;
+}
+
+/******************************************************************************
+ * Function Name: app_time_schedule
+ ******************************************************************************
+ * Summary:
+ *  Schedules a callback 'delay_ms' after the current virtual time. The
+ *  callback runs in the time master task inside a critical section and must
+ *  not block.
+ *
+ * Parameters:
+ *  uint32_t delay_ms : Delay in milliseconds
+ *  virtual_clock_callback_t callback : Function to be called
+ *  void *arg : Argument passed to the callback
+ *
+ * Return:
+ *  bool : true if the callback was scheduled, false if the clock is full.
+ *
+ ******************************************************************************/
+bool app_time_schedule(uint32_t delay_ms, virtual_clock_callback_t callback, void *arg)
+{
+    static bool initialized = false;
+    bool scheduled;
+
+    taskENTER_CRITICAL();
+    if (!initialized)
+    {
+        virtual_clock_init(&virtual_clock, virtual_clock_events, VIRTUAL_TIME_MAX_EVENTS);
+        initialized = true;
+    }
+    scheduled = virtual_clock_schedule(&virtual_clock, delay_ms, callback, arg);
+    taskEXIT_CRITICAL();
+
+    return scheduled;
+}
+
+/* Virtual clock event that ends a timeout of a task. */
+static void wake_task(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+/* Virtual clock event that ends a delay of a task. */
+static void end_delay(void *arg)
+{
+    xTaskNotifyGiveIndexed((TaskHandle_t)arg, APP_TIME_NOTIFY_INDEX);
+}
+
+static uint64_t now_ms(void)
+{
+    uint64_t now;
+
+    taskENTER_CRITICAL();
+    now = virtual_clock_now(&virtual_clock);
+    taskEXIT_CRITICAL();
+
+    return now;
+}
+
+#endif /* ENABLE_VIRTUAL_TIME */
+
+/* [] END OF FILE */
@@ -0,0 +1,80 @@
+/******************************************************************************
+* File Name:   app_time.h
+*
+* Description: This file is the public interface of app_time.c. All
+*              application delays, timeouts and timestamps go through these
+*              functions so that they run either on the FreeRTOS tick or, with
+*              ENABLE_VIRTUAL_TIME, on the virtual clock.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef APP_TIME_H_
+#define APP_TIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "virtual_time_config.h"
+#include "virtual_clock.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the virtual-time master task. It runs at the idle
+ * priority so that it advances the clock only when every other task is
+ * blocked.
+ */
+#define APP_TIME_TASK_PRIORITY            (tskIDLE_PRIORITY)
+#define APP_TIME_TASK_STACK_SIZE          (1024 * 1)
+
+/* Timeout value that waits without a time limit. */
+#define APP_TIME_WAIT_FOREVER             (UINT32_MAX)
+
+/* Task notification index that ends the virtual-time delays, so that a
+ * delay neither consumes nor changes the notification value at index 0 that
+ * other tasks set.
+ */
+#define APP_TIME_NOTIFY_INDEX             (1u)
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_VIRTUAL_TIME
+void app_time_task(void *pvParameters);
+uint32_t app_time_now_ms(void);
+uint32_t app_time_now_ms_from_isr(void);
+void app_time_delay_ms(uint32_t delay_ms);
+uint32_t app_time_notify_take(uint32_t timeout_ms);
+bool app_time_schedule(uint32_t delay_ms, virtual_clock_callback_t callback, void *arg);
+#else
+/* Current time in milliseconds. */
+static inline uint32_t app_time_now_ms(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static inline uint32_t app_time_now_ms_from_isr(void)
+{
+    return (uint32_t)(xTaskGetTickCountFromISR() * portTICK_PERIOD_MS);
+}
+
+/* Blocks the calling task for 'delay_ms' milliseconds. */
+static inline void app_time_delay_ms(uint32_t delay_ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+}
+
+/* Waits for a task notification for at most 'timeout_ms' milliseconds. */
+static inline uint32_t app_time_notify_take(uint32_t timeout_ms)
+{
+    return ulTaskNotifyTake(pdTRUE, (timeout_ms == APP_TIME_WAIT_FOREVER) ?
+                                    portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+#endif /* ENABLE_VIRTUAL_TIME */
+
+#endif /* APP_TIME_H_ */
+
+/* [] END OF FILE */
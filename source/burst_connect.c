@@ -0,0 +1,275 @@
+/******************************************************************************
+* File Name:   burst_connect.c
+*
+* Description: This file contains the event buffer and the accounting of the
+*              burst-connect mode. While the node is disassociated, the
+*              publisher task posts its messages here instead of publishing
+*              them. The MQTT client task sleeps in burst_connect_wait() until
+*              a presence rise, a full buffer or the batch deadline, then
+*              joins the AP, connects, publishes the buffered messages in
+*              order and disconnects again, and records the duration of every
+*              phase.
+*
+*              The energy of a burst is estimated as supply voltage x active
+*              current x burst duration, and divided by the number of events
+*              sent in the burst.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "burst_connect.h"
+#include "app_time.h"
+
+#if ENABLE_BURST_CONNECT
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Ring of buffered messages, oldest first. The payloads are copied, the
+ * topics must be static strings. Every message gets the next sequence
+ * number, so that a message overwritten while it was being published is not
+ * confused with the one that took its place.
+ */
+static burst_event_t events[BURST_MAX_EVENTS];
+static uint32_t events_head;
+static uint32_t events_count;
+static uint32_t events_sequence;
+
+/* Task that runs the bursts, woken by urgent or overflowing events. */
+static TaskHandle_t burst_task_handle;
+
+/* Time of the last burst. */
+static uint32_t last_burst_ms;
+
+static burst_stats_t stats;
+static uint64_t total_energy_uj;
+
+/******************************************************************************
+ * Function Name: burst_connect_init
+ ******************************************************************************
+ * Summary:
+ *  Registers the calling task as the task that runs the bursts.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void burst_connect_init(void)
+{
+    burst_task_handle = xTaskGetCurrentTaskHandle();
+    last_burst_ms = app_time_now_ms();
+}
+
+/******************************************************************************
+ * Function Name: burst_connect_post
+ ******************************************************************************
+ * Summary:
+ *  Buffers a copy of a message until the next burst. An urgent message, or
+ *  one that fills the buffer, starts a burst right away. A payload larger
+ *  than BURST_MAX_PAYLOAD_SIZE is dropped.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Message with a static topic
+ *  bool urgent : true to start a burst now
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void burst_connect_post(const cy_mqtt_publish_info_t *info, bool urgent)
+{
+    burst_event_t *event;
+    bool full;
+
+    if (info->payload_len > BURST_MAX_PAYLOAD_SIZE)
+    {
+        taskENTER_CRITICAL();
+        stats.events_dropped++;
+        taskEXIT_CRITICAL();
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if (events_count == BURST_MAX_EVENTS)
+    {
+        /* Overwrite the oldest message. */
+        events_head = (events_head + 1u) % BURST_MAX_EVENTS;
+        events_count--;
+        stats.events_dropped++;
+    }
+    event = &events[(events_head + events_count) % BURST_MAX_EVENTS];
+    event->sequence = events_sequence++;
+    event->info = *info;
+    memcpy(event->payload, info->payload, info->payload_len);
+    events_count++;
+    full = (events_count == BURST_MAX_EVENTS);
+    taskEXIT_CRITICAL();
+
+    if ((urgent || full) && (burst_task_handle != NULL))
+    {
+        xTaskNotifyGive(burst_task_handle);
+    }
+}
+
+/******************************************************************************
+ * Function Name: burst_connect_wait
+ ******************************************************************************
+ * Summary:
+ *  Blocks until the next burst is due: an urgent or overflowing message was
+ *  posted, or BURST_BATCH_INTERVAL_MS passed since the last burst with at
+ *  least one message buffered.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void burst_connect_wait(void)
+{
+    uint32_t elapsed_ms;
+    uint32_t count;
+    bool due;
+
+    while (true)
+    {
+        elapsed_ms = app_time_now_ms() - last_burst_ms;
+        due = (elapsed_ms >= BURST_BATCH_INTERVAL_MS) ||
+              (app_time_notify_take(BURST_BATCH_INTERVAL_MS - elapsed_ms) > 0) ||
+              ((app_time_now_ms() - last_burst_ms) >= BURST_BATCH_INTERVAL_MS);
+        if (!due)
+        {
+            continue;
+        }
+
+        taskENTER_CRITICAL();
+        count = events_count;
+        taskEXIT_CRITICAL();
+
+        /* A notification left over from messages that were already sent by
+         * the previous burst does not start another one.
+         */
+        if (count > 0)
+        {
+            break;
+        }
+
+        if ((app_time_now_ms() - last_burst_ms) >= BURST_BATCH_INTERVAL_MS)
+        {
+            /* Nothing to send at the deadline: start a new interval. */
+            last_burst_ms = app_time_now_ms();
+        }
+    }
+
+    last_burst_ms = app_time_now_ms();
+}
+
+/******************************************************************************
+ * Function Name: burst_connect_peek
+ ******************************************************************************
+ * Summary:
+ *  Returns a copy of the oldest buffered message without removing it, so
+ *  that it is kept when publishing fails. The copy stays valid while new
+ *  messages are posted.
+ *
+ * Parameters:
+ *  burst_event_t *event : Copy of the oldest message
+ *
+ * Return:
+ *  bool : true if a message is buffered
+ *
+ ******************************************************************************/
+bool burst_connect_peek(burst_event_t *event)
+{
+    bool available;
+
+    taskENTER_CRITICAL();
+    available = (events_count > 0);
+    if (available)
+    {
+        *event = events[events_head];
+    }
+    taskEXIT_CRITICAL();
+
+    if (available)
+    {
+        event->info.payload = (const char *)event->payload;
+    }
+    return available;
+}
+
+/* Removes the oldest buffered message after it was published, unless a post
+ * overwrote it meanwhile; that message was already counted as dropped.
+ */
+void burst_connect_pop(uint32_t sequence)
+{
+    taskENTER_CRITICAL();
+    if ((events_count > 0) && (events[events_head].sequence == sequence))
+    {
+        events_head = (events_head + 1u) % BURST_MAX_EVENTS;
+        events_count--;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: burst_connect_record
+ ******************************************************************************
+ * Summary:
+ *  Records the phases of a burst and updates the energy estimate.
+ *
+ * Parameters:
+ *  const burst_phases_t *phases : Phase durations
+ *  uint32_t events : Messages sent in the burst
+ *  bool success : false if the burst could not connect
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void burst_connect_record(const burst_phases_t *phases, uint32_t events, bool success)
+{
+    uint32_t active_ms = phases->join_ms + phases->connect_ms +
+                         phases->publish_ms + phases->disconnect_ms;
+
+    /* mV x mA x ms = nJ */
+    uint32_t energy_uj = (uint32_t)(((uint64_t)BURST_SUPPLY_MV * BURST_ACTIVE_CURRENT_MA * active_ms) / 1000u);
+
+    taskENTER_CRITICAL();
+    stats.bursts++;
+    stats.events_sent += events;
+    total_energy_uj += energy_uj;
+    if (success)
+    {
+        stats.last = *phases;
+        stats.last_events = events;
+        stats.last_energy_estimate_uj = energy_uj;
+    }
+    else
+    {
+        stats.failed_bursts++;
+    }
+    stats.energy_estimate_per_event_uj = (stats.events_sent > 0) ?
+                                (uint32_t)(total_energy_uj / stats.events_sent) : 0;
+    taskEXIT_CRITICAL();
+}
+
+void burst_connect_get_stats(burst_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = stats;
+    taskEXIT_CRITICAL();
+}
+
+#endif /* ENABLE_BURST_CONNECT */
+
+/* [] END OF FILE */
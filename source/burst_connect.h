@@ -0,0 +1,68 @@
+/******************************************************************************
+* File Name:   burst_connect.h
+*
+* Description: This file is the public interface of burst_connect.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef BURST_CONNECT_H_
+#define BURST_CONNECT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cy_mqtt_api.h"
+#include "burst_config.h"
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Durations of the phases of one burst in milliseconds. */
+typedef struct
+{
+    uint32_t join_ms;           /* Wi-Fi association and DHCP */
+    uint32_t connect_ms;        /* TCP/TLS and MQTT CONNECT */
+    uint32_t publish_ms;        /* Publishing the batch */
+    uint32_t disconnect_ms;     /* MQTT DISCONNECT and leaving the AP */
+} burst_phases_t;
+
+/* Burst statistics. */
+typedef struct
+{
+    uint32_t bursts;
+    uint32_t failed_bursts;
+    uint32_t events_sent;
+    uint32_t events_dropped;
+    burst_phases_t last;        /* Phases of the last successful burst */
+    uint32_t last_events;
+    uint32_t last_energy_estimate_uj;       /* Energy of the last burst */
+    uint32_t energy_estimate_per_event_uj;  /* Average over all successful bursts */
+} burst_stats_t;
+
+/* Buffered message. The descriptor points to the copy of the payload. */
+typedef struct
+{
+    uint32_t sequence;
+    cy_mqtt_publish_info_t info;
+    uint8_t payload[BURST_MAX_PAYLOAD_SIZE];
+} burst_event_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_BURST_CONNECT
+void burst_connect_init(void);
+void burst_connect_post(const cy_mqtt_publish_info_t *info, bool urgent);
+void burst_connect_wait(void);
+bool burst_connect_peek(burst_event_t *event);
+void burst_connect_pop(uint32_t sequence);
+void burst_connect_record(const burst_phases_t *phases, uint32_t events, bool success);
+void burst_connect_get_stats(burst_stats_t *stats);
+#endif /* ENABLE_BURST_CONNECT */
+
+#endif /* BURST_CONNECT_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,329 @@
+/******************************************************************************
+* File Name:   column_codec.c
+*
+* Description: This file contains the columnar encoder and decoder for the
+*              presence/light history. Samples are split into columns and
+*              each column is compressed with an encoding suited to its data:
+*
+*              - timestamps : first value, first delta, then delta-of-delta,
+*                             each as a zig-zag varint.
+*              - light      : first value, then zig-zag varint deltas.
+*              - TD / PD    : one bit per sample, LSB first.
+*
+*              Block layout:
+*              | 'P' 'H' ver | count | timestamp column | light column |
+*              | TD bitmap | PD bitmap |
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "column_codec.h"
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static size_t put_varint(uint8_t *out, size_t out_size, size_t pos, uint32_t value);
+static size_t get_varint(const uint8_t *in, size_t in_size, size_t pos, uint32_t *value);
+static uint32_t zigzag_encode(int32_t value);
+static int32_t zigzag_decode(uint32_t value);
+
+/******************************************************************************
+ * Function Name: column_codec_encode
+ ******************************************************************************
+ * Summary:
+ *  Encodes 'count' samples into 'out' using the columnar format described at
+ *  the top of this file.
+ *
+ * Parameters:
+ *  const column_codec_sample_t *samples : Samples to be encoded, oldest first
+ *  size_t count : Number of samples
+ *  uint8_t *out : Output buffer
+ *  size_t out_size : Size of the output buffer in bytes. Sizing the buffer with
+ *                    COLUMN_CODEC_MAX_ENCODED_SIZE(count) never overflows.
+ *
+ * Return:
+ *  size_t : Number of bytes written, or 0 if the output buffer is too small.
+ *
+ ******************************************************************************/
+size_t column_codec_encode(const column_codec_sample_t *samples, size_t count,
+                           uint8_t *out, size_t out_size)
+{
+    size_t pos = 0;
+    size_t bitmap_size = (count + 7u) / 8u;
+    uint32_t prev_delta = 0;
+
+    if ((out == NULL) || ((samples == NULL) && (count > 0)) ||
+        (out_size < COLUMN_CODEC_HEADER_SIZE))
+    {
+        return 0;
+    }
+
+    out[pos++] = COLUMN_CODEC_MAGIC_0;
+    out[pos++] = COLUMN_CODEC_MAGIC_1;
+    out[pos++] = COLUMN_CODEC_VERSION;
+
+    pos = put_varint(out, out_size, pos, (uint32_t)count);
+
+    /* Timestamp column. Arithmetic is modulo 2^32 so that a wrapping
+     * millisecond counter round-trips exactly.
+     */
+    for (size_t i = 0; (i < count) && (pos != 0); i++)
+    {
+        if (i == 0)
+        {
+            pos = put_varint(out, out_size, pos, samples[0].timestamp_ms);
+        }
+        else
+        {
+            uint32_t delta = samples[i].timestamp_ms - samples[i - 1].timestamp_ms;
+            pos = put_varint(out, out_size, pos,
+                             zigzag_encode((int32_t)(delta - prev_delta)));
+            prev_delta = delta;
+        }
+    }
+
+    /* Light column. */
+    for (size_t i = 0; (i < count) && (pos != 0); i++)
+    {
+        if (i == 0)
+        {
+            pos = put_varint(out, out_size, pos, samples[0].light);
+        }
+        else
+        {
+            pos = put_varint(out, out_size, pos,
+                             zigzag_encode((int32_t)samples[i].light - (int32_t)samples[i - 1].light));
+        }
+    }
+
+    /* TD and PD bitmaps. */
+    if ((pos == 0) || ((out_size - pos) < (2u * bitmap_size)))
+    {
+        return 0;
+    }
+
+    memset(&out[pos], 0, 2u * bitmap_size);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (samples[i].td)
+        {
+            out[pos + (i / 8u)] |= (uint8_t)(1u << (i % 8u));
+        }
+        if (samples[i].pd)
+        {
+            out[pos + bitmap_size + (i / 8u)] |= (uint8_t)(1u << (i % 8u));
+        }
+    }
+
+    return pos + (2u * bitmap_size);
+}
+
+/******************************************************************************
+ * Function Name: column_codec_decoded_count
+ ******************************************************************************
+ * Summary:
+ *  Returns the number of samples stored in an encoded block without decoding
+ *  it, so that the caller can size the sample array.
+ *
+ * Parameters:
+ *  const uint8_t *in : Encoded block
+ *  size_t in_size : Size of the encoded block in bytes
+ *
+ * Return:
+ *  size_t : Number of samples in the block, or 0 if the header is invalid.
+ *
+ ******************************************************************************/
+size_t column_codec_decoded_count(const uint8_t *in, size_t in_size)
+{
+    uint32_t count = 0;
+
+    if ((in == NULL) || (in_size < COLUMN_CODEC_HEADER_SIZE) ||
+        (in[0] != COLUMN_CODEC_MAGIC_0) || (in[1] != COLUMN_CODEC_MAGIC_1) ||
+        (in[2] != COLUMN_CODEC_VERSION))
+    {
+        return 0;
+    }
+
+    if (get_varint(in, in_size, COLUMN_CODEC_HEADER_SIZE, &count) == 0)
+    {
+        return 0;
+    }
+
+    return (size_t)count;
+}
+
+/******************************************************************************
+ * Function Name: column_codec_decode
+ ******************************************************************************
+ * Summary:
+ *  Decodes a block produced by column_codec_encode().
+ *
+ * Parameters:
+ *  const uint8_t *in : Encoded block
+ *  size_t in_size : Size of the encoded block in bytes
+ *  column_codec_sample_t *samples : Output array for the decoded samples
+ *  size_t max_count : Capacity of 'samples'
+ *
+ * Return:
+ *  size_t : Number of samples decoded, or 0 if the block is malformed or does
+ *           not fit into 'samples'.
+ *
+ ******************************************************************************/
+size_t column_codec_decode(const uint8_t *in, size_t in_size,
+                           column_codec_sample_t *samples, size_t max_count)
+{
+    size_t pos;
+    size_t count = column_codec_decoded_count(in, in_size);
+    size_t bitmap_size = (count + 7u) / 8u;
+    uint32_t value = 0;
+    uint32_t delta = 0;
+
+    if ((count == 0) || (count > max_count) || (samples == NULL))
+    {
+        return 0;
+    }
+
+    /* Skip the header and the count varint. */
+    pos = get_varint(in, in_size, COLUMN_CODEC_HEADER_SIZE, &value);
+
+    for (size_t i = 0; (i < count) && (pos != 0); i++)
+    {
+        pos = get_varint(in, in_size, pos, &value);
+        if (i == 0)
+        {
+            samples[0].timestamp_ms = value;
+        }
+        else
+        {
+            delta += (uint32_t)zigzag_decode(value);
+            samples[i].timestamp_ms = samples[i - 1].timestamp_ms + delta;
+        }
+    }
+
+    for (size_t i = 0; (i < count) && (pos != 0); i++)
+    {
+        pos = get_varint(in, in_size, pos, &value);
+        if (i == 0)
+        {
+            samples[0].light = (uint8_t)value;
+        }
+        else
+        {
+            samples[i].light = (uint8_t)((int32_t)samples[i - 1].light + zigzag_decode(value));
+        }
+    }
+
+    if ((pos == 0) || ((in_size - pos) < (2u * bitmap_size)))
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i].td = ((in[pos + (i / 8u)] >> (i % 8u)) & 1u) != 0u;
+        samples[i].pd = ((in[pos + bitmap_size + (i / 8u)] >> (i % 8u)) & 1u) != 0u;
+    }
+
+    return count;
+}
+
+/******************************************************************************
+ * Function Name: put_varint
+ ******************************************************************************
+ * Summary:
+ *  Writes an unsigned LEB128 varint (7 bits per byte, MSB = continuation).
+ *
+ * Parameters:
+ *  uint8_t *out : Output buffer
+ *  size_t out_size : Size of the output buffer
+ *  size_t pos : Write position
+ *  uint32_t value : Value to be written
+ *
+ * Return:
+ *  size_t : Position after the varint, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+static size_t put_varint(uint8_t *out, size_t out_size, size_t pos, uint32_t value)
+{
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    do
+    {
+        if (pos >= out_size)
+        {
+            return 0;
+        }
+
+        out[pos] = (uint8_t)(value & 0x7Fu);
+        value >>= 7;
+        if (value != 0)
+        {
+            out[pos] |= 0x80u;
+        }
+        pos++;
+    } while (value != 0);
+
+    return pos;
+}
+
+/******************************************************************************
+ * Function Name: get_varint
+ ******************************************************************************
+ * Summary:
+ *  Reads an unsigned LEB128 varint written by put_varint().
+ *
+ * Parameters:
+ *  const uint8_t *in : Input buffer
+ *  size_t in_size : Size of the input buffer
+ *  size_t pos : Read position
+ *  uint32_t *value : Decoded value
+ *
+ * Return:
+ *  size_t : Position after the varint, or 0 if the varint is truncated or
+ *           longer than COLUMN_CODEC_MAX_VARINT_SIZE.
+ *
+ ******************************************************************************/
+static size_t get_varint(const uint8_t *in, size_t in_size, size_t pos, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    for (uint32_t shift = 0; shift < (7u * COLUMN_CODEC_MAX_VARINT_SIZE); shift += 7u)
+    {
+        if (pos >= in_size)
+        {
+            return 0;
+        }
+
+        result |= (uint32_t)(in[pos] & 0x7Fu) << shift;
+        if ((in[pos++] & 0x80u) == 0)
+        {
+            *value = result;
+            return pos;
+        }
+    }
+
+    return 0;
+}
+
+/* Zig-zag mapping so that small negative deltas become small varints. */
+static uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1u);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,70 @@
+/******************************************************************************
+* File Name:   column_codec.h
+*
+* Description: This file is the public interface of column_codec.c, the
+*              columnar encoder/decoder used for the presence/light history
+*              and for batched telemetry uploads.
+*
+*              The codec has no dependency on the HAL or on FreeRTOS so that
+*              the same file can be compiled into host tools for decoding.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef COLUMN_CODEC_H_
+#define COLUMN_CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Magic bytes and format version placed at the start of every encoded block. */
+#define COLUMN_CODEC_MAGIC_0              (0x50u)   /* 'P' */
+#define COLUMN_CODEC_MAGIC_1              (0x48u)   /* 'H' */
+#define COLUMN_CODEC_VERSION              (1u)
+
+/* Size of the fixed block header (magic + version). */
+#define COLUMN_CODEC_HEADER_SIZE          (3u)
+
+/* Size of one sample when stored uncompressed (timestamp, light, TD, PD). Used
+ * as the baseline for the compression ratio.
+ */
+#define COLUMN_CODEC_RAW_SAMPLE_SIZE      (7u)
+
+/* Maximum number of bytes a 32-bit varint can occupy. */
+#define COLUMN_CODEC_MAX_VARINT_SIZE      (5u)
+
+/* Worst case encoded size for 'n' samples. Use this to size output buffers. */
+#define COLUMN_CODEC_MAX_ENCODED_SIZE(n)  (COLUMN_CODEC_HEADER_SIZE +              \
+                                           COLUMN_CODEC_MAX_VARINT_SIZE +          \
+                                           ((n) * 2u * COLUMN_CODEC_MAX_VARINT_SIZE) + \
+                                           (2u * (((n) + 7u) / 8u)))
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* One row of the presence/light history. */
+typedef struct
+{
+    uint32_t timestamp_ms;
+    uint8_t light;
+    bool td;
+    bool pd;
+} column_codec_sample_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+size_t column_codec_encode(const column_codec_sample_t *samples, size_t count,
+                           uint8_t *out, size_t out_size);
+size_t column_codec_decode(const uint8_t *in, size_t in_size,
+                           column_codec_sample_t *samples, size_t max_count);
+size_t column_codec_decoded_count(const uint8_t *in, size_t in_size);
+
+#endif /* COLUMN_CODEC_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/******************************************************************************
+* File Name:   command_mailbox.c
+*
+* Description: This file contains the latest-value-wins command mailbox of an
+*              actuator. The mailbox holds at most one command: a command
+*              posted before the previous one was taken replaces it, so a
+*              burst of commands is applied once with its last value. A
+*              command equal to the state the actuator is already in, or
+*              will be in once the command taken last is applied, is skipped.
+*
+*              The mailbox has no dependency on the HAL or FreeRTOS, so a
+*              command burst can be replayed on a host; the caller
+*              serializes posting and taking.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "command_mailbox.h"
+
+/******************************************************************************
+ * Function Name: command_mailbox_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes an empty mailbox.
+ *
+ * Parameters:
+ *  command_mailbox_t *mailbox : Mailbox to be initialized
+ *  uint32_t state : Initial state of the actuator
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void command_mailbox_init(command_mailbox_t *mailbox, uint32_t state)
+{
+    memset(mailbox, 0, sizeof(command_mailbox_t));
+    mailbox->state = state;
+    latency_histogram_init(&mailbox->latency);
+}
+
+/******************************************************************************
+ * Function Name: command_mailbox_post
+ ******************************************************************************
+ * Summary:
+ *  Posts a command. A command still in the mailbox is merged into the new
+ *  one. A command equal to the actuator state is skipped unless it replaces
+ *  a different command.
+ *
+ * Parameters:
+ *  command_mailbox_t *mailbox : Mailbox
+ *  uint32_t value : Command value
+ *  uint32_t now : Time of the post, in the unit of the latency
+ *
+ * Return:
+ *  bool : true if the mailbox was empty and now holds a command, so that the
+ *         actuator task must be woken
+ *
+ ******************************************************************************/
+bool command_mailbox_post(command_mailbox_t *mailbox, uint32_t value, uint32_t now)
+{
+    bool was_empty = !mailbox->pending;
+
+    mailbox->stats.received++;
+
+    if (mailbox->pending)
+    {
+        mailbox->stats.merged++;
+    }
+    else if (value == mailbox->state)
+    {
+        mailbox->stats.skipped++;
+        return false;
+    }
+
+    mailbox->pending = true;
+    mailbox->value = value;
+    mailbox->posted = now;
+
+    return was_empty;
+}
+
+/******************************************************************************
+ * Function Name: command_mailbox_take
+ ******************************************************************************
+ * Summary:
+ *  Takes the command in the mailbox. A command that a burst merged back to
+ *  the actuator state is skipped. The caller applies the value and reports
+ *  it with command_mailbox_applied().
+ *
+ * Parameters:
+ *  command_mailbox_t *mailbox : Mailbox
+ *  uint32_t *value : Output command value
+ *  uint32_t *posted : Output time of the post
+ *
+ * Return:
+ *  bool : true if a command must be applied
+ *
+ ******************************************************************************/
+bool command_mailbox_take(command_mailbox_t *mailbox, uint32_t *value, uint32_t *posted)
+{
+    if (!mailbox->pending)
+    {
+        return false;
+    }
+    mailbox->pending = false;
+
+    if (mailbox->value == mailbox->state)
+    {
+        mailbox->stats.skipped++;
+        return false;
+    }
+
+    mailbox->state = mailbox->value;
+    *value = mailbox->value;
+    *posted = mailbox->posted;
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: command_mailbox_applied
+ ******************************************************************************
+ * Summary:
+ *  Records that the command taken last was applied.
+ *
+ * Parameters:
+ *  command_mailbox_t *mailbox : Mailbox
+ *  uint32_t latency : Time from the post of the command to its application
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void command_mailbox_applied(command_mailbox_t *mailbox, uint32_t latency)
+{
+    mailbox->stats.applied++;
+    mailbox->stats.last_latency = latency;
+    latency_histogram_record(&mailbox->latency, latency);
+}
+
+/******************************************************************************
+ * Function Name: command_mailbox_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the counters and the latency percentiles of a mailbox.
+ *
+ * Parameters:
+ *  const command_mailbox_t *mailbox : Mailbox
+ *  command_mailbox_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void command_mailbox_get_stats(const command_mailbox_t *mailbox, command_mailbox_stats_t *stats)
+{
+    command_mailbox_get_counters(mailbox, stats);
+    command_mailbox_get_latency(mailbox, &stats->latency);
+}
+
+/* Returns the counters of a mailbox without the latency percentiles, in
+ * constant time.
+ */
+void command_mailbox_get_counters(const command_mailbox_t *mailbox, command_mailbox_stats_t *stats)
+{
+    *stats = mailbox->stats;
+}
+
+/* Returns the latency percentiles of a mailbox. Scans the whole histogram. */
+void command_mailbox_get_latency(const command_mailbox_t *mailbox, latency_summary_t *latency)
+{
+    latency_histogram_summarize(&mailbox->latency, latency);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,56 @@
+/******************************************************************************
+* File Name:   command_mailbox.h
+*
+* Description: This file is the public interface of command_mailbox.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef COMMAND_MAILBOX_H_
+#define COMMAND_MAILBOX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "latency_histogram.h"
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Counters of a mailbox. */
+typedef struct
+{
+    uint32_t received;          /* Commands posted */
+    uint32_t merged;            /* Superseded by a later command before they were taken */
+    uint32_t skipped;           /* Equal to the state the actuator is already in */
+    uint32_t applied;
+    uint32_t last_latency;
+    latency_summary_t latency;  /* From the post of a command to its application */
+} command_mailbox_stats_t;
+
+/* Mailbox of an actuator. All fields are private to command_mailbox.c. */
+typedef struct
+{
+    bool pending;
+    uint32_t value;
+    uint32_t posted;
+    uint32_t state;
+
+    command_mailbox_stats_t stats;
+    latency_histogram_t latency;
+} command_mailbox_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void command_mailbox_init(command_mailbox_t *mailbox, uint32_t state);
+bool command_mailbox_post(command_mailbox_t *mailbox, uint32_t value, uint32_t now);
+bool command_mailbox_take(command_mailbox_t *mailbox, uint32_t *value, uint32_t *posted);
+void command_mailbox_applied(command_mailbox_t *mailbox, uint32_t latency);
+void command_mailbox_get_stats(const command_mailbox_t *mailbox, command_mailbox_stats_t *stats);
+void command_mailbox_get_counters(const command_mailbox_t *mailbox, command_mailbox_stats_t *stats);
+void command_mailbox_get_latency(const command_mailbox_t *mailbox, latency_summary_t *latency);
+
+#endif /* COMMAND_MAILBOX_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,334 @@
+/******************************************************************************
+* File Name:   conn_fsm.c
+*
+* Description: This file contains the engine of the connection state machine.
+*              The states, events and the transition table with its actions
+*              are declared by the MQTT client task; the engine looks up the
+*              row of every event, runs its action and dispatches the event
+*              the action returns, so that a whole connection attempt is one
+*              chain of transitions.
+*
+*              Every transition is counted and logged with its timestamp, and
+*              the time spent in every state is kept in a latency histogram.
+*
+*              The engine has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "conn_fsm.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+static const char *const state_names[CONN_STATE_COUNT] =
+{
+    [CONN_STATE_IDLE]              = "idle",
+    [CONN_STATE_WIFI_JOINING]      = "wifi-joining",
+    [CONN_STATE_WIFI_BACKOFF]      = "wifi-backoff",
+    [CONN_STATE_BROKER_CONNECTING] = "broker-connecting",
+    [CONN_STATE_BROKER_BACKOFF]    = "broker-backoff",
+    [CONN_STATE_SUBSCRIBING]       = "subscribing",
+    [CONN_STATE_CONNECTED]         = "connected",
+    [CONN_STATE_PINGING]           = "pinging",
+    [CONN_STATE_RECOVERING]        = "recovering",
+    [CONN_STATE_FAILED]            = "failed"
+};
+
+static const char *const event_names[CONN_EVENT_COUNT] =
+{
+    [CONN_EVENT_NONE]              = "none",
+    [CONN_EVENT_START]             = "start",
+    [CONN_EVENT_SETUP_FAILED]      = "setup-failed",
+    [CONN_EVENT_WIFI_UP]           = "wifi-up",
+    [CONN_EVENT_WIFI_DOWN]         = "wifi-down",
+    [CONN_EVENT_WIFI_FAILED]       = "wifi-failed",
+    [CONN_EVENT_BROKER_UP]         = "broker-up",
+    [CONN_EVENT_BROKER_FAILED]     = "broker-failed",
+    [CONN_EVENT_BROKER_LOST]       = "broker-lost",
+    [CONN_EVENT_SUBSCRIBED]        = "subscribed",
+    [CONN_EVENT_SUBSCRIBE_FAILED]  = "subscribe-failed",
+    [CONN_EVENT_PUBLISH_FAILED]    = "publish-failed",
+    [CONN_EVENT_LINK_DEGRADED]     = "link-degraded",
+    [CONN_EVENT_TIMER]             = "timer",
+    [CONN_EVENT_RETRIES_EXHAUSTED] = "retries-exhausted",
+    [CONN_EVENT_DONE]              = "done"
+};
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void leave_state(conn_fsm_t *fsm, uint32_t now_ms);
+
+/******************************************************************************
+ * Function Name: conn_fsm_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes the state machine with its transition table. Every state and
+ *  event of the table must be in range.
+ *
+ * Parameters:
+ *  conn_fsm_t *fsm : State machine
+ *  const conn_fsm_transition_t *table : Transition table
+ *  size_t table_len : Number of rows, at most CONN_FSM_MAX_TRANSITIONS
+ *  conn_state_t initial : Initial state
+ *  uint32_t (*now_ms)(void) : Clock used for the timestamps
+ *
+ * Return:
+ *  bool : false if the table is invalid
+ *
+ ******************************************************************************/
+bool conn_fsm_init(conn_fsm_t *fsm, const conn_fsm_transition_t *table, size_t table_len,
+                   conn_state_t initial, uint32_t (*now_ms)(void))
+{
+    if ((table == NULL) || (table_len > CONN_FSM_MAX_TRANSITIONS) || (now_ms == NULL) ||
+        (initial >= CONN_STATE_COUNT))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < table_len; i++)
+    {
+        if ((table[i].state >= CONN_STATE_COUNT) || (table[i].next >= CONN_STATE_COUNT) ||
+            (table[i].event == CONN_EVENT_NONE) || (table[i].event >= CONN_EVENT_COUNT))
+        {
+            return false;
+        }
+    }
+
+    memset(fsm, 0, sizeof(*fsm));
+    fsm->table = table;
+    fsm->table_len = table_len;
+    fsm->now_ms = now_ms;
+    fsm->state = initial;
+    fsm->entered_ms = now_ms();
+    fsm->visits[initial] = 1u;
+    for (uint32_t s = 0; s < CONN_STATE_COUNT; s++)
+    {
+        latency_histogram_init(&fsm->time_in_state[s]);
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: conn_fsm_dispatch
+ ******************************************************************************
+ * Summary:
+ *  Dispatches an event and every follow-up event returned by the actions.
+ *
+ * Parameters:
+ *  conn_fsm_t *fsm : State machine
+ *  conn_event_t event : Event
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void conn_fsm_dispatch(conn_fsm_t *fsm, conn_event_t event)
+{
+    const conn_fsm_transition_t *row;
+    conn_fsm_log_entry_t *entry;
+    uint32_t now_ms;
+    size_t i;
+
+    while (event != CONN_EVENT_NONE)
+    {
+        for (i = 0; i < fsm->table_len; i++)
+        {
+            if ((fsm->table[i].state == fsm->state) && (fsm->table[i].event == event))
+            {
+                break;
+            }
+        }
+
+        if (i == fsm->table_len)
+        {
+            fsm->ignored_events++;
+            return;
+        }
+
+        row = &fsm->table[i];
+        now_ms = fsm->now_ms();
+        fsm->transition_count[i]++;
+
+        entry = &fsm->log[fsm->log_count % CONN_FSM_LOG_SIZE];
+        entry->timestamp_ms = now_ms;
+        entry->from = (uint8_t)row->state;
+        entry->to = (uint8_t)row->next;
+        entry->event = (uint8_t)event;
+        fsm->log_count++;
+
+        if (row->next != fsm->state)
+        {
+            leave_state(fsm, now_ms);
+            fsm->state = row->next;
+            fsm->entered_ms = now_ms;
+            fsm->visits[row->next]++;
+        }
+
+        event = (row->action != NULL) ? row->action() : CONN_EVENT_NONE;
+    }
+}
+
+const char *conn_fsm_state_name(conn_state_t state)
+{
+    return (state < CONN_STATE_COUNT) ? state_names[state] : "?";
+}
+
+const char *conn_fsm_event_name(conn_event_t event)
+{
+    return (event < CONN_EVENT_COUNT) ? event_names[event] : "?";
+}
+
+/******************************************************************************
+ * Function Name: conn_fsm_get_counters
+ ******************************************************************************
+ * Summary:
+ *  Copies the state, the counters and the transition log of the state
+ *  machine. The copy takes constant time.
+ *
+ * Parameters:
+ *  const conn_fsm_t *fsm : State machine
+ *  conn_fsm_counters_t *counters : Output copy
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void conn_fsm_get_counters(const conn_fsm_t *fsm, conn_fsm_counters_t *counters)
+{
+    counters->state = fsm->state;
+    counters->entered_ms = fsm->entered_ms;
+    memcpy(counters->transition_count, fsm->transition_count, sizeof(counters->transition_count));
+    counters->ignored_events = fsm->ignored_events;
+    memcpy(counters->visits, fsm->visits, sizeof(counters->visits));
+    memcpy(counters->total_ms, fsm->total_ms, sizeof(counters->total_ms));
+    memcpy(counters->log, fsm->log, sizeof(counters->log));
+    counters->log_count = fsm->log_count;
+}
+
+/* Summarizes the time-in-state histogram of every state. */
+void conn_fsm_summarize_time_in_state(const conn_fsm_t *fsm,
+                                      latency_summary_t summary[CONN_STATE_COUNT])
+{
+    for (uint32_t s = 0; s < CONN_STATE_COUNT; s++)
+    {
+        latency_histogram_summarize(&fsm->time_in_state[s], &summary[s]);
+    }
+}
+
+/******************************************************************************
+ * Function Name: conn_fsm_format
+ ******************************************************************************
+ * Summary:
+ *  Prints the current state, the transition log, the count of every
+ *  transition taken and the time-in-state percentiles as text lines:
+ *
+ *    state <name> <ms in state>
+ *    log <timestamp> <from> <event> <to>
+ *    transition <from> <event> <to> <count>
+ *    time_in_state <name> visits <n> total_ms <ms> p50_ms <ms> p90_ms <ms> p99_ms <ms> max_ms <ms>
+ *    ignored_events <n>
+ *
+ *  The percentiles cover the completed visits; the current visit of the
+ *  current state is only counted in visits. Only the transition table and
+ *  the clock of the state machine are read; the counters and summaries come
+ *  from conn_fsm_get_counters and conn_fsm_summarize_time_in_state.
+ *
+ * Parameters:
+ *  const conn_fsm_t *fsm : State machine
+ *  const conn_fsm_counters_t *counters : Copy of the counters
+ *  const latency_summary_t time_in_state[] : Time-in-state summaries
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t conn_fsm_format(const conn_fsm_t *fsm, const conn_fsm_counters_t *counters,
+                       const latency_summary_t time_in_state[CONN_STATE_COUNT],
+                       char *buf, size_t size)
+{
+    const conn_fsm_log_entry_t *entry;
+    const latency_summary_t *summary;
+    uint32_t first;
+    size_t pos = 0;
+    int len;
+
+#define APPEND(...)                                                      \
+    do                                                                   \
+    {                                                                    \
+        if (pos < size)                                                  \
+        {                                                                \
+            len = snprintf(&buf[pos], size - pos, __VA_ARGS__);          \
+            pos = (len > 0) ? (pos + (size_t)len) : pos;                 \
+        }                                                                \
+    } while (0)
+
+    APPEND("state %s %lu\n", state_names[counters->state],
+           (unsigned long)(fsm->now_ms() - counters->entered_ms));
+
+    first = (counters->log_count > CONN_FSM_LOG_SIZE) ?
+            (counters->log_count - CONN_FSM_LOG_SIZE) : 0u;
+    for (uint32_t i = first; i < counters->log_count; i++)
+    {
+        entry = &counters->log[i % CONN_FSM_LOG_SIZE];
+        APPEND("log %lu %s %s %s\n", (unsigned long)entry->timestamp_ms,
+               state_names[entry->from], event_names[entry->event], state_names[entry->to]);
+    }
+
+    for (size_t i = 0; i < fsm->table_len; i++)
+    {
+        if (counters->transition_count[i] > 0)
+        {
+            APPEND("transition %s %s %s %lu\n", state_names[fsm->table[i].state],
+                   event_names[fsm->table[i].event], state_names[fsm->table[i].next],
+                   (unsigned long)counters->transition_count[i]);
+        }
+    }
+
+    for (uint32_t s = 0; s < CONN_STATE_COUNT; s++)
+    {
+        if (counters->visits[s] == 0)
+        {
+            continue;
+        }
+        summary = &time_in_state[s];
+        APPEND("time_in_state %s visits %lu total_ms %" PRIu64
+               " p50_ms %lu p90_ms %lu p99_ms %lu max_ms %lu\n", state_names[s],
+               (unsigned long)counters->visits[s], counters->total_ms[s],
+               (unsigned long)summary->p50, (unsigned long)summary->p90,
+               (unsigned long)summary->p99, (unsigned long)summary->max);
+    }
+
+    APPEND("ignored_events %lu\n", (unsigned long)counters->ignored_events);
+
+#undef APPEND
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+/* Adds the visit of the current state that ends at 'now_ms' to its
+ * statistics.
+ */
+static void leave_state(conn_fsm_t *fsm, uint32_t now_ms)
+{
+    uint32_t duration_ms = now_ms - fsm->entered_ms;
+
+    fsm->total_ms[fsm->state] += duration_ms;
+    latency_histogram_record(&fsm->time_in_state[fsm->state], duration_ms);
+}
+
+/* [] END OF FILE */
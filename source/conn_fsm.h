@@ -0,0 +1,151 @@
+/******************************************************************************
+* File Name:   conn_fsm.h
+*
+* Description: This file is the public interface of conn_fsm.c, the
+*              table-driven state machine of the Wi-Fi and MQTT connection.
+*
+*              The state machine has no dependency on the HAL or on FreeRTOS
+*              so that the same file can be compiled into host tools.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef CONN_FSM_H_
+#define CONN_FSM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "latency_histogram.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Largest transition table. */
+#define CONN_FSM_MAX_TRANSITIONS          (40u)
+
+/* Number of timestamped transitions kept in the log. */
+#define CONN_FSM_LOG_SIZE                 (16u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Connection states. */
+typedef enum
+{
+    CONN_STATE_IDLE,                /* Not associated, waiting to start */
+    CONN_STATE_WIFI_JOINING,        /* Joining the AP and acquiring an IP address */
+    CONN_STATE_WIFI_BACKOFF,        /* Waiting before the next join attempt */
+    CONN_STATE_BROKER_CONNECTING,   /* TCP, TLS and MQTT CONNECT (or MQTT-SN CONNECT) */
+    CONN_STATE_BROKER_BACKOFF,      /* Waiting before the next connect attempt */
+    CONN_STATE_SUBSCRIBING,         /* Subscribing to the topics */
+    CONN_STATE_CONNECTED,           /* Publishing */
+    CONN_STATE_PINGING,             /* Checking the MQTT-SN gateway */
+    CONN_STATE_RECOVERING,          /* Broker lost, waiting for a roam to finish */
+    CONN_STATE_FAILED,              /* Retries exhausted or setup failed */
+    CONN_STATE_COUNT
+} conn_state_t;
+
+/* Events that drive the state machine. */
+typedef enum
+{
+    CONN_EVENT_NONE,                /* No follow-up event */
+    CONN_EVENT_START,
+    CONN_EVENT_SETUP_FAILED,
+    CONN_EVENT_WIFI_UP,
+    CONN_EVENT_WIFI_DOWN,
+    CONN_EVENT_WIFI_FAILED,
+    CONN_EVENT_BROKER_UP,
+    CONN_EVENT_BROKER_FAILED,
+    CONN_EVENT_BROKER_LOST,
+    CONN_EVENT_SUBSCRIBED,
+    CONN_EVENT_SUBSCRIBE_FAILED,
+    CONN_EVENT_PUBLISH_FAILED,
+    CONN_EVENT_LINK_DEGRADED,       /* Broker round-trip time too slow */
+    CONN_EVENT_TIMER,
+    CONN_EVENT_RETRIES_EXHAUSTED,
+    CONN_EVENT_DONE,
+    CONN_EVENT_COUNT
+} conn_event_t;
+
+/* Action run on a transition, after the state has changed. It returns the
+ * next event to dispatch, or CONN_EVENT_NONE.
+ */
+typedef conn_event_t (*conn_fsm_action_t)(void);
+
+/* Row of the transition table. An event without a row in the current state
+ * is ignored and counted. A row with next == state is an internal transition:
+ * its action runs but the time in state is not restarted.
+ */
+typedef struct
+{
+    conn_state_t state;
+    conn_event_t event;
+    conn_state_t next;
+    conn_fsm_action_t action;
+} conn_fsm_transition_t;
+
+/* Timestamped transition of the log. */
+typedef struct
+{
+    uint32_t timestamp_ms;
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;
+} conn_fsm_log_entry_t;
+
+/* State machine with its statistics. */
+typedef struct
+{
+    const conn_fsm_transition_t *table;
+    size_t table_len;
+    uint32_t (*now_ms)(void);
+
+    conn_state_t state;
+    uint32_t entered_ms;
+
+    uint32_t transition_count[CONN_FSM_MAX_TRANSITIONS];
+    uint32_t ignored_events;
+
+    uint32_t visits[CONN_STATE_COUNT];
+    uint64_t total_ms[CONN_STATE_COUNT];
+    latency_histogram_t time_in_state[CONN_STATE_COUNT];   /* Completed visits in ms */
+
+    conn_fsm_log_entry_t log[CONN_FSM_LOG_SIZE];
+    uint32_t log_count;
+} conn_fsm_t;
+
+/* Copy of the state machine without the histograms, small enough to be taken
+ * in a critical section.
+ */
+typedef struct
+{
+    conn_state_t state;
+    uint32_t entered_ms;
+    uint32_t transition_count[CONN_FSM_MAX_TRANSITIONS];
+    uint32_t ignored_events;
+    uint32_t visits[CONN_STATE_COUNT];
+    uint64_t total_ms[CONN_STATE_COUNT];
+    conn_fsm_log_entry_t log[CONN_FSM_LOG_SIZE];
+    uint32_t log_count;
+} conn_fsm_counters_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+bool conn_fsm_init(conn_fsm_t *fsm, const conn_fsm_transition_t *table, size_t table_len,
+                   conn_state_t initial, uint32_t (*now_ms)(void));
+void conn_fsm_dispatch(conn_fsm_t *fsm, conn_event_t event);
+const char *conn_fsm_state_name(conn_state_t state);
+const char *conn_fsm_event_name(conn_event_t event);
+void conn_fsm_get_counters(const conn_fsm_t *fsm, conn_fsm_counters_t *counters);
+void conn_fsm_summarize_time_in_state(const conn_fsm_t *fsm,
+                                      latency_summary_t summary[CONN_STATE_COUNT]);
+size_t conn_fsm_format(const conn_fsm_t *fsm, const conn_fsm_counters_t *counters,
+                       const latency_summary_t time_in_state[CONN_STATE_COUNT],
+                       char *buf, size_t size);
+
+#endif /* CONN_FSM_H_ */
+
+/* [] END OF FILE */
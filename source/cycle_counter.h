@@ -0,0 +1,40 @@
+/******************************************************************************
+* File Name:   cycle_counter.h
+*
+* Description: This file contains inline helpers around the Cortex-M DWT
+*              cycle counter used for timing measurements.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef CYCLE_COUNTER_H_
+#define CYCLE_COUNTER_H_
+
+#include "cy_pdl.h"
+
+/*******************************************************************************
+* Function Definitions
+********************************************************************************/
+/* Enables the DWT cycle counter. Safe to call more than once. */
+static inline void cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* Returns the current value of the free running 32-bit cycle counter. */
+static inline uint32_t cycle_counter_get(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* Converts a cycle count to microseconds at the current core clock. */
+static inline uint32_t cycle_counter_to_us(uint32_t cycles)
+{
+    return (uint32_t)(((uint64_t)cycles * 1000000u) / SystemCoreClock);
+}
+
+#endif /* CYCLE_COUNTER_H_ */
+
+/* [] END OF FILE */
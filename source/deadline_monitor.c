@@ -0,0 +1,200 @@
+/******************************************************************************
+* File Name:   deadline_monitor.c
+*
+* Description: This file contains the deadline monitor. The publisher task
+*              reports how long a radar edge waited for it and the TFT task
+*              how long its draw commands waited for their frame. Every report
+*              is checked against the deadline of its activity and counted as
+*              a miss when it is late. The MQTT client task marks the time it
+*              spends in a broker handshake, so that the misses caused by the
+*              TLS handshake can be told apart from the others.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "deadline_monitor.h"
+#include "metrics.h"
+
+#if ENABLE_DEADLINE_MONITOR
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Written by the MQTT client task only. */
+static volatile bool handshake_active;
+static volatile uint32_t handshake_count;
+
+static deadline_stats_t sources[DEADLINE_SOURCE_COUNT];
+
+static const uint32_t source_deadlines_us[DEADLINE_SOURCE_COUNT] =
+{
+    [DEADLINE_RADAR_EDGE] = RADAR_EDGE_DEADLINE_US,
+    [DEADLINE_DISPLAY_UPDATE] = DISPLAY_UPDATE_DEADLINE_US
+};
+
+static const char *const source_names[DEADLINE_SOURCE_COUNT] =
+{
+    [DEADLINE_RADAR_EDGE] = "radar-edge",
+    [DEADLINE_DISPLAY_UPDATE] = "display-update"
+};
+
+/******************************************************************************
+ * Function Name: deadline_monitor_set_handshake
+ ******************************************************************************
+ * Summary:
+ *  Marks the start or the end of a broker handshake. The checks reported in
+ *  between are also counted as handshake checks.
+ *
+ * Parameters:
+ *  bool active : true at the start of the handshake, false at its end
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void deadline_monitor_set_handshake(bool active)
+{
+    if (active)
+    {
+        handshake_count++;
+    }
+    handshake_active = active;
+}
+
+/******************************************************************************
+ * Function Name: deadline_monitor_record
+ ******************************************************************************
+ * Summary:
+ *  Checks the time an activity took against its deadline.
+ *
+ * Parameters:
+ *  deadline_source_t source : Activity
+ *  uint32_t elapsed_us : Time from the event to its handling
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void deadline_monitor_record(deadline_source_t source, uint32_t elapsed_us)
+{
+    deadline_stats_t *stats = &sources[source];
+    bool missed = (elapsed_us > source_deadlines_us[source]);
+
+    taskENTER_CRITICAL();
+    stats->checks++;
+    stats->misses += missed ? 1u : 0u;
+    if (elapsed_us > stats->max_us)
+    {
+        stats->max_us = elapsed_us;
+    }
+
+    if (handshake_active)
+    {
+        stats->handshake_checks++;
+        stats->handshake_misses += missed ? 1u : 0u;
+        if (elapsed_us > stats->handshake_max_us)
+        {
+            stats->handshake_max_us = elapsed_us;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (missed)
+    {
+        metrics_counter_inc(METRIC_DEADLINE_MISSES);
+    }
+}
+
+/******************************************************************************
+ * Function Name: deadline_monitor_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the checks of an activity since start-up.
+ *
+ * Parameters:
+ *  deadline_source_t source : Activity
+ *  deadline_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void deadline_monitor_get_stats(deadline_source_t source, deadline_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = sources[source];
+    taskEXIT_CRITICAL();
+}
+
+/* Returns the number of broker handshakes since start-up. */
+uint32_t deadline_monitor_handshakes(void)
+{
+    return handshake_count;
+}
+
+/* Returns the name of an activity for the diagnostics. */
+const char *deadline_monitor_name(deadline_source_t source)
+{
+    return source_names[source];
+}
+
+/******************************************************************************
+ * Function Name: deadline_monitor_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the checks and misses of every activity and the number of
+ *  handshakes for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t deadline_monitor_format_stats(char *buf, size_t size)
+{
+    deadline_stats_t stats;
+    size_t pos = 0;
+    int len;
+
+    for (uint32_t source = 0; (source < DEADLINE_SOURCE_COUNT) && (pos < size); source++)
+    {
+        deadline_monitor_get_stats((deadline_source_t)source, &stats);
+        len = snprintf(&buf[pos], size - pos,
+                       "deadline %s checks %lu misses %lu max_us %lu "
+                       "handshake checks %lu misses %lu max_us %lu\n",
+                       deadline_monitor_name((deadline_source_t)source),
+                       (unsigned long)stats.checks,
+                       (unsigned long)stats.misses,
+                       (unsigned long)stats.max_us,
+                       (unsigned long)stats.handshake_checks,
+                       (unsigned long)stats.handshake_misses,
+                       (unsigned long)stats.handshake_max_us);
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+    if (pos < size)
+    {
+        len = snprintf(&buf[pos], size - pos, "deadline_handshakes %lu\n",
+                       (unsigned long)deadline_monitor_handshakes());
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+#endif /* ENABLE_DEADLINE_MONITOR */
+
+/* [] END OF FILE */
@@ -0,0 +1,56 @@
+/******************************************************************************
+* File Name:   deadline_monitor.h
+*
+* Description: This file is the public interface of deadline_monitor.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef DEADLINE_MONITOR_H_
+#define DEADLINE_MONITOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "deadline_config.h"
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Activities that have a deadline. */
+typedef enum
+{
+    DEADLINE_RADAR_EDGE,
+    DEADLINE_DISPLAY_UPDATE,
+    DEADLINE_SOURCE_COUNT
+} deadline_source_t;
+
+/* Checks of an activity since start-up. */
+typedef struct
+{
+    uint32_t checks;
+    uint32_t misses;
+    uint32_t max_us;
+    uint32_t handshake_checks;  /* Checks while a broker handshake ran */
+    uint32_t handshake_misses;
+    uint32_t handshake_max_us;
+} deadline_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_DEADLINE_MONITOR
+void deadline_monitor_set_handshake(bool active);
+void deadline_monitor_record(deadline_source_t source, uint32_t elapsed_us);
+void deadline_monitor_get_stats(deadline_source_t source, deadline_stats_t *stats);
+size_t deadline_monitor_format_stats(char *buf, size_t size);
+uint32_t deadline_monitor_handshakes(void);
+const char *deadline_monitor_name(deadline_source_t source);
+#else
+#define deadline_monitor_set_handshake(active)          do { } while (0)
+#define deadline_monitor_record(source, elapsed_us)     do { } while (0)
+#endif /* ENABLE_DEADLINE_MONITOR */
+
+#endif /* DEADLINE_MONITOR_H_ */
+
+/* [] END OF FILE */
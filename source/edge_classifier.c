@@ -0,0 +1,315 @@
+/******************************************************************************
+* File Name:   edge_classifier.c
+*
+* Description: This file contains the online classifier that suppresses
+*              spurious radar activations, such as the TD chatter caused by
+*              wind-blown plants at dusk. It sits between the raw TD/PD edges
+*              and the fusion stage.
+*
+*              Every finished TD pulse is labelled from its own features: a
+*              pulse shorter than 'genuine_min_ms', without PD activity, that
+*              starts less than 'burst_gap_ms' after the previous pulse of the
+*              same sensor is chatter. The widths of chatter pulses are tracked
+*              per ambient light band as a running mean and mean absolute
+*              deviation. Once a band has seen enough chatter, a new onset in
+*              that band is held for mean + 3 * deviation (at most
+*              'max_hold_ms') and only passed to the fusion stage if TD is
+*              still active when the hold expires, or as soon as PD
+*              corroborates it. A pulse that ends within the hold is
+*              suppressed. Sites without chatter never learn a hold and pass
+*              every onset immediately.
+*
+*              The memory is constant and every edge costs a few comparisons
+*              and integer updates. The classifier has no dependency on the
+*              HAL or FreeRTOS, so recorded edges can be replayed on a host.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "edge_classifier.h"
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Weight of a new sample in the running statistics: 1/2^shift. */
+#define EDGE_CLASSIFIER_AVERAGING_SHIFT   (3u)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint8_t light_band(const edge_classifier_t *classifier, uint8_t light);
+static uint32_t hold_ms(const edge_classifier_t *classifier, uint8_t band);
+static void learn_pulse(edge_classifier_t *classifier, const edge_classifier_sensor_t *sensor,
+                        uint32_t width_ms);
+static void pass_onset(edge_classifier_sensor_t *sensor, uint8_t index, uint32_t timestamp_ms,
+                       radar_fusion_input_t *output);
+
+/******************************************************************************
+ * Function Name: edge_classifier_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes the classifier with all TD lines inactive and nothing learned.
+ *
+ * Parameters:
+ *  edge_classifier_t *classifier : Classifier to be initialized
+ *  uint8_t sensor_count : Number of sensors, at most RADAR_FUSION_MAX_SENSORS
+ *  const edge_classifier_config_t *config : Tuning of the classifier
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void edge_classifier_init(edge_classifier_t *classifier, uint8_t sensor_count,
+                          const edge_classifier_config_t *config)
+{
+    memset(classifier, 0, sizeof(edge_classifier_t));
+    classifier->config = *config;
+    classifier->sensor_count = (sensor_count < RADAR_FUSION_MAX_SENSORS) ?
+                               sensor_count : RADAR_FUSION_MAX_SENSORS;
+}
+
+/******************************************************************************
+ * Function Name: edge_classifier_process
+ ******************************************************************************
+ * Summary:
+ *  Classifies a raw edge of a sensor. TD is active low.
+ *
+ * Parameters:
+ *  edge_classifier_t *classifier : Classifier
+ *  const radar_fusion_input_t *input : Raw line levels at the edge
+ *  uint8_t light : Ambient light level in percent
+ *  radar_fusion_input_t *output : Edge to be passed to the fusion stage
+ *
+ * Return:
+ *  bool : true if 'output' must be passed to the fusion stage
+ *
+ ******************************************************************************/
+bool edge_classifier_process(edge_classifier_t *classifier, const radar_fusion_input_t *input,
+                             uint8_t light, radar_fusion_input_t *output)
+{
+    edge_classifier_sensor_t *sensor;
+    bool active = !input->td_level;
+    uint32_t hold;
+
+    if (input->sensor >= classifier->sensor_count)
+    {
+        return false;
+    }
+    sensor = &classifier->sensors[input->sensor];
+    sensor->pd_level = input->pd_level;
+
+    if (active == sensor->raw_active)
+    {
+        /* PD changed while TD did not. */
+        if (active)
+        {
+            sensor->pd_seen |= input->pd_level;
+        }
+        if (sensor->pending && input->pd_level)
+        {
+            classifier->stats.passed_after_hold++;
+            pass_onset(sensor, input->sensor, input->timestamp_ms, output);
+            return true;
+        }
+        if (sensor->passed_active)
+        {
+            *output = *input;
+            return true;
+        }
+        return false;
+    }
+
+    sensor->raw_active = active;
+
+    if (active)
+    {
+        classifier->stats.activations++;
+        sensor->onset_ms = input->timestamp_ms;
+        sensor->pd_seen = input->pd_level;
+        sensor->band = light_band(classifier, light);
+
+        hold = hold_ms(classifier, sensor->band);
+        if (input->pd_level || (hold == 0))
+        {
+            classifier->stats.passed_immediately++;
+            pass_onset(sensor, input->sensor, input->timestamp_ms, output);
+            return true;
+        }
+
+        sensor->pending = true;
+        sensor->deadline_ms = input->timestamp_ms + hold;
+        return false;
+    }
+
+    /* TD released: learn from the pulse, then drop or pass the release. */
+    learn_pulse(classifier, sensor, input->timestamp_ms - sensor->onset_ms);
+    sensor->last_release_ms = input->timestamp_ms;
+
+    if (sensor->pending)
+    {
+        sensor->pending = false;
+        classifier->stats.suppressed++;
+        return false;
+    }
+    if (sensor->passed_active)
+    {
+        sensor->passed_active = false;
+        *output = *input;
+        return true;
+    }
+
+    return false;
+}
+
+/******************************************************************************
+ * Function Name: edge_classifier_poll
+ ******************************************************************************
+ * Summary:
+ *  Passes a held onset whose hold has expired. Call until it returns false
+ *  whenever the deadline from edge_classifier_next_deadline() is reached.
+ *
+ * Parameters:
+ *  edge_classifier_t *classifier : Classifier
+ *  uint32_t now_ms : Current time in milliseconds
+ *  radar_fusion_input_t *output : Edge to be passed to the fusion stage
+ *
+ * Return:
+ *  bool : true if 'output' must be passed to the fusion stage
+ *
+ ******************************************************************************/
+bool edge_classifier_poll(edge_classifier_t *classifier, uint32_t now_ms,
+                          radar_fusion_input_t *output)
+{
+    edge_classifier_sensor_t *sensor;
+
+    for (uint8_t i = 0; i < classifier->sensor_count; i++)
+    {
+        sensor = &classifier->sensors[i];
+        if (sensor->pending && ((int32_t)(now_ms - sensor->deadline_ms) >= 0))
+        {
+            classifier->stats.passed_after_hold++;
+            pass_onset(sensor, i, now_ms, output);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/******************************************************************************
+ * Function Name: edge_classifier_next_deadline
+ ******************************************************************************
+ * Summary:
+ *  Returns the earliest time at which a held onset expires.
+ *
+ * Parameters:
+ *  const edge_classifier_t *classifier : Classifier
+ *  uint32_t *deadline_ms : Earliest deadline
+ *
+ * Return:
+ *  bool : true if any onset is held
+ *
+ ******************************************************************************/
+bool edge_classifier_next_deadline(const edge_classifier_t *classifier, uint32_t *deadline_ms)
+{
+    bool any = false;
+
+    for (uint8_t i = 0; i < classifier->sensor_count; i++)
+    {
+        const edge_classifier_sensor_t *sensor = &classifier->sensors[i];
+
+        if (sensor->pending &&
+            (!any || ((int32_t)(sensor->deadline_ms - *deadline_ms) < 0)))
+        {
+            *deadline_ms = sensor->deadline_ms;
+            any = true;
+        }
+    }
+
+    return any;
+}
+
+void edge_classifier_get_stats(const edge_classifier_t *classifier, edge_classifier_stats_t *stats)
+{
+    *stats = classifier->stats;
+    for (uint8_t band = 0; band < EDGE_CLASSIFIER_LIGHT_BANDS; band++)
+    {
+        stats->hold_ms[band] = hold_ms(classifier, band);
+    }
+}
+
+/* Dark, dusk/dawn or day. */
+static uint8_t light_band(const edge_classifier_t *classifier, uint8_t light)
+{
+    if (light < classifier->config.dusk_light_min)
+    {
+        return 0u;
+    }
+    return (light <= classifier->config.dusk_light_max) ? 1u : 2u;
+}
+
+/* Learned hold of a band, 0 until the band has seen enough chatter. */
+static uint32_t hold_ms(const edge_classifier_t *classifier, uint8_t band)
+{
+    const edge_classifier_band_t *chatter = &classifier->chatter[band];
+    uint32_t hold;
+
+    if (chatter->samples < EDGE_CLASSIFIER_MIN_SAMPLES)
+    {
+        return 0;
+    }
+
+    hold = chatter->mean_ms + (3u * chatter->deviation_ms);
+    return (hold < classifier->config.max_hold_ms) ? hold : classifier->config.max_hold_ms;
+}
+
+/* Labels a finished pulse and updates the chatter statistics of its band. */
+static void learn_pulse(edge_classifier_t *classifier, const edge_classifier_sensor_t *sensor,
+                        uint32_t width_ms)
+{
+    edge_classifier_band_t *chatter = &classifier->chatter[sensor->band];
+    uint32_t distance;
+
+    if ((width_ms >= classifier->config.genuine_min_ms) || sensor->pd_seen ||
+        ((sensor->onset_ms - sensor->last_release_ms) >= classifier->config.burst_gap_ms))
+    {
+        return;
+    }
+
+    if (chatter->samples == 0)
+    {
+        chatter->mean_ms = width_ms;
+        chatter->deviation_ms = width_ms / 2u;
+    }
+    else
+    {
+        distance = (width_ms > chatter->mean_ms) ? (width_ms - chatter->mean_ms) :
+                                                   (chatter->mean_ms - width_ms);
+        chatter->mean_ms = chatter->mean_ms - (chatter->mean_ms >> EDGE_CLASSIFIER_AVERAGING_SHIFT) +
+                           (width_ms >> EDGE_CLASSIFIER_AVERAGING_SHIFT);
+        chatter->deviation_ms = chatter->deviation_ms - (chatter->deviation_ms >> EDGE_CLASSIFIER_AVERAGING_SHIFT) +
+                                (distance >> EDGE_CLASSIFIER_AVERAGING_SHIFT);
+    }
+
+    if (chatter->samples < UINT32_MAX)
+    {
+        chatter->samples++;
+    }
+}
+
+/* Passes a TD onset to the fusion stage. */
+static void pass_onset(edge_classifier_sensor_t *sensor, uint8_t index, uint32_t timestamp_ms,
+                       radar_fusion_input_t *output)
+{
+    sensor->pending = false;
+    sensor->passed_active = true;
+
+    output->sensor = index;
+    output->td_level = false;
+    output->pd_level = sensor->pd_level;
+    output->timestamp_ms = timestamp_ms;
+}
+
+/* [] END OF FILE */
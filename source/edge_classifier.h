@@ -0,0 +1,95 @@
+/******************************************************************************
+* File Name:   edge_classifier.h
+*
+* Description: This file is the public interface of edge_classifier.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef EDGE_CLASSIFIER_H_
+#define EDGE_CLASSIFIER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radar_fusion.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Ambient light bands with separate thresholds: dark, dusk/dawn, day. */
+#define EDGE_CLASSIFIER_LIGHT_BANDS       (3u)
+
+/* Chatter pulses that must be seen in a band before it holds activations. */
+#define EDGE_CLASSIFIER_MIN_SAMPLES       (8u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Tuning of the classifier. */
+typedef struct
+{
+    uint32_t genuine_min_ms;    /* Pulses at least this long are genuine */
+    uint32_t burst_gap_ms;      /* Pulses closer than this form a burst */
+    uint32_t max_hold_ms;       /* Upper limit of the learned hold time */
+    uint8_t dusk_light_min;     /* Light levels of the dusk band in percent */
+    uint8_t dusk_light_max;
+} edge_classifier_config_t;
+
+/* Running pulse width statistics of one light band, in milliseconds. */
+typedef struct
+{
+    uint32_t mean_ms;
+    uint32_t deviation_ms;
+    uint32_t samples;
+} edge_classifier_band_t;
+
+/* Per sensor state. */
+typedef struct
+{
+    bool raw_active;
+    bool passed_active;
+    bool pending;
+    bool pd_seen;
+    bool pd_level;
+    uint8_t band;
+    uint32_t onset_ms;
+    uint32_t deadline_ms;
+    uint32_t last_release_ms;
+} edge_classifier_sensor_t;
+
+/* Classifier counters. */
+typedef struct
+{
+    uint32_t activations;       /* TD onsets seen */
+    uint32_t passed_immediately;/* Onsets passed without a hold */
+    uint32_t passed_after_hold; /* Onsets passed once the hold expired */
+    uint32_t suppressed;        /* Onsets released within the hold */
+    uint32_t hold_ms[EDGE_CLASSIFIER_LIGHT_BANDS];
+} edge_classifier_stats_t;
+
+/* Classifier context. All fields are private to edge_classifier.c. */
+typedef struct
+{
+    edge_classifier_config_t config;
+    edge_classifier_sensor_t sensors[RADAR_FUSION_MAX_SENSORS];
+    edge_classifier_band_t chatter[EDGE_CLASSIFIER_LIGHT_BANDS];
+    uint8_t sensor_count;
+    edge_classifier_stats_t stats;
+} edge_classifier_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void edge_classifier_init(edge_classifier_t *classifier, uint8_t sensor_count,
+                          const edge_classifier_config_t *config);
+bool edge_classifier_process(edge_classifier_t *classifier, const radar_fusion_input_t *input,
+                             uint8_t light, radar_fusion_input_t *output);
+bool edge_classifier_poll(edge_classifier_t *classifier, uint32_t now_ms,
+                          radar_fusion_input_t *output);
+bool edge_classifier_next_deadline(const edge_classifier_t *classifier, uint32_t *deadline_ms);
+void edge_classifier_get_stats(const edge_classifier_t *classifier, edge_classifier_stats_t *stats);
+
+#endif /* EDGE_CLASSIFIER_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,463 @@
+/******************************************************************************
+* File Name:   effect_sequencer.c
+*
+* Description: This file contains the lighting and pump effect sequencer. The
+*              task renders every frame one period ahead into the back buffer
+*              of a double-buffered frame pipeline while the SPI DMA streams
+*              the front buffer to the WS2812 strip, so no CPU time is spent
+*              per LED bit. The pump speed of each frame is applied through
+*              the TCPWM hardware PWM. The active effect follows the fused
+*              radar presence state.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "effect_sequencer.h"
+#include "ws2812_encoder.h"
+#include "cycle_counter.h"
+#include "isr_signal.h"
+#include "irq_priority_config.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+#if ENABLE_EFFECT_SEQUENCER
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Size of the bitstream of one frame. */
+#define EFFECT_FRAME_SIZE                 WS2812_FRAME_SIZE(EFFECT_LED_COUNT)
+
+/* Period of the breathing effect in milliseconds. */
+#define EFFECT_BREATHE_PERIOD_MS          (3000u)
+
+/* Phase advance of the running wave per frame and per LED (256 = full wave). */
+#define EFFECT_WAVE_FRAME_STEP            (6u)
+#define EFFECT_WAVE_LED_STEP              (24u)
+
+/* Pump duty cycle in percent for every effect. */
+#define EFFECT_PUMP_IDLE_DUTY             (0u)
+#define EFFECT_PUMP_PRESENCE_DUTY         (60u)
+#define EFFECT_PUMP_APPROACHING_DUTY      (100u)
+
+/* Number of frames over which the frame rate and jitter are measured. */
+#define EFFECT_STATS_WINDOW_FRAMES        (250u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Double-buffered frame pipeline. */
+static uint8_t frame_buffers[2][EFFECT_FRAME_SIZE];
+static uint8_t back_index;
+static uint8_t back_pump_duty;
+
+/* Colors of the frame being rendered. */
+static ws2812_color_t led_colors[EFFECT_LED_COUNT];
+
+/* Active effect, written by the publisher task. */
+static volatile effect_t active_effect = EFFECT_IDLE;
+
+/* Pump pre-start requested by the occupancy predictor. */
+static volatile bool prestart_active;
+
+/* HAL objects for the LED SPI and the pump PWM. */
+static cyhal_spi_t led_spi;
+static cyhal_pwm_t pump_pwm;
+
+/* Frame timing statistics. */
+static effect_sequencer_stats_t last_stats;
+static uint32_t window_jitter_sum_us;
+static uint32_t window_jitter_max_us;
+static uint32_t window_late_transfers;
+static uint32_t window_start_cycles;
+static uint32_t window_frames;
+static uint32_t total_frames;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static cy_rslt_t effect_hw_init(void);
+static void render_frame(uint32_t frame, effect_t effect);
+static uint8_t triangle(uint32_t phase);
+static void spi_event_callback(void *callback_arg, cyhal_spi_event_t event);
+static void update_stats(uint32_t frame_start_cycles, uint32_t prev_frame_cycles);
+
+/******************************************************************************
+ * Function Name: effect_sequencer_task
+ ******************************************************************************
+ * Summary:
+ *  Task that runs the frame pipeline at EFFECT_FRAME_PERIOD_MS. In every
+ *  period the previously rendered back buffer becomes the front buffer and is
+ *  handed to the SPI DMA, its pump duty is applied, and the next frame is
+ *  rendered into the new back buffer.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void effect_sequencer_task(void *pvParameters)
+{
+    TickType_t last_wake_time;
+    uint32_t frame = 0;
+    uint32_t frame_start_cycles;
+    uint32_t prev_frame_cycles = 0;
+    uint8_t front_index;
+    cy_rslt_t result;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    /* The SPI transfer done event signals this task. */
+    (void)isr_signal_register(ISR_SIGNAL_EFFECT_SPI, xTaskGetCurrentTaskHandle(), 0, 0);
+    cycle_counter_init();
+
+    result = effect_hw_init();
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("Effect sequencer: hardware initialization failed with error 0x%0X\n", (int)result);
+        vTaskSuspend(NULL);
+    }
+
+    /* Prime the pipeline with the first frame. */
+    render_frame(frame, active_effect);
+    last_wake_time = xTaskGetTickCount();
+    window_start_cycles = cycle_counter_get();
+
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(EFFECT_FRAME_PERIOD_MS));
+        frame_start_cycles = cycle_counter_get();
+
+        /* The previous transfer must have completed before its buffer is
+         * rendered into again.
+         */
+        if (cyhal_spi_is_busy(&led_spi))
+        {
+            window_late_transfers++;
+            (void)isr_signal_wait(pdMS_TO_TICKS(EFFECT_FRAME_PERIOD_MS));
+        }
+        (void)isr_signal_wait(0);
+
+        /* Swap the buffers and stream the front buffer. */
+        front_index = back_index;
+        back_index ^= 1u;
+        cyhal_spi_transfer_async(&led_spi, frame_buffers[front_index], EFFECT_FRAME_SIZE, NULL, 0);
+        cyhal_pwm_set_duty_cycle(&pump_pwm, (float)back_pump_duty, EFFECT_PUMP_PWM_FREQ_HZ);
+
+        /* Render the next frame while the DMA streams this one. */
+        render_frame(++frame, active_effect);
+
+        if (prev_frame_cycles != 0)
+        {
+            update_stats(frame_start_cycles, prev_frame_cycles);
+        }
+        prev_frame_cycles = frame_start_cycles;
+    }
+}
+
+/******************************************************************************
+ * Function Name: effect_sequencer_set_presence
+ ******************************************************************************
+ * Summary:
+ *  Selects the effect that matches the fused radar presence state.
+ *
+ * Parameters:
+ *  bool presence : Fused presence state
+ *  bool approaching : Fused approaching state
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void effect_sequencer_set_presence(bool presence, bool approaching)
+{
+    active_effect = !presence ? EFFECT_IDLE :
+                    (approaching ? EFFECT_APPROACHING : EFFECT_PRESENCE);
+}
+
+/******************************************************************************
+ * Function Name: effect_sequencer_set_prestart
+ ******************************************************************************
+ * Summary:
+ *  Runs the pump at the presence speed with the LEDs off while nobody is
+ *  present, so that the flow has built up by the time somebody arrives.
+ *
+ * Parameters:
+ *  bool prestart : true to pre-start the pump
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void effect_sequencer_set_prestart(bool prestart)
+{
+    prestart_active = prestart;
+}
+
+/******************************************************************************
+ * Function Name: effect_sequencer_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the frame rate and jitter of the last measurement window.
+ *
+ * Parameters:
+ *  effect_sequencer_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void effect_sequencer_get_stats(effect_sequencer_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: effect_hw_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes the SPI master in DMA mode for the LED strip and the PWM for
+ *  the pump.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code
+ *
+ ******************************************************************************/
+static cy_rslt_t effect_hw_init(void)
+{
+    cy_rslt_t result;
+
+    result = cyhal_spi_init(&led_spi, EFFECT_LED_SPI_MOSI_PIN, NC, EFFECT_LED_SPI_SCLK_PIN, NC,
+                            NULL, 8, CYHAL_SPI_MODE_00_MSB, false);
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_spi_set_frequency(&led_spi, WS2812_SPI_FREQ_HZ);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_spi_set_async_mode(&led_spi, CYHAL_ASYNC_DMA, CYHAL_DMA_PRIORITY_DEFAULT);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        cyhal_spi_register_callback(&led_spi, spi_event_callback, NULL);
+        cyhal_spi_enable_event(&led_spi, CYHAL_SPI_IRQ_DONE, IRQ_PRIORITY_EFFECT_SPI, true);
+
+        result = cyhal_pwm_init(&pump_pwm, EFFECT_PUMP_PWM_PIN, NULL);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_pwm_set_duty_cycle(&pump_pwm, 0.0f, EFFECT_PUMP_PWM_FREQ_HZ);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_pwm_start(&pump_pwm);
+    }
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: render_frame
+ ******************************************************************************
+ * Summary:
+ *  Computes the LED colors and the pump duty of a frame and encodes the
+ *  colors into the back buffer.
+ *
+ * Parameters:
+ *  uint32_t frame : Frame number
+ *  effect_t effect : Effect to be rendered
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void render_frame(uint32_t frame, effect_t effect)
+{
+    uint32_t time_ms = frame * EFFECT_FRAME_PERIOD_MS;
+    uint8_t level;
+
+    switch (effect)
+    {
+        case EFFECT_PRESENCE:
+        {
+            level = triangle(((time_ms % EFFECT_BREATHE_PERIOD_MS) * 256u) / EFFECT_BREATHE_PERIOD_MS);
+            for (uint32_t i = 0; i < EFFECT_LED_COUNT; i++)
+            {
+                led_colors[i] = (ws2812_color_t){ .r = 0, .g = level / 4u, .b = level };
+            }
+            back_pump_duty = EFFECT_PUMP_PRESENCE_DUTY;
+            break;
+        }
+
+        case EFFECT_APPROACHING:
+        {
+            for (uint32_t i = 0; i < EFFECT_LED_COUNT; i++)
+            {
+                level = triangle((frame * EFFECT_WAVE_FRAME_STEP) + (i * EFFECT_WAVE_LED_STEP));
+                led_colors[i] = (ws2812_color_t){ .r = level / 8u, .g = level / 2u, .b = level };
+            }
+            back_pump_duty = EFFECT_PUMP_APPROACHING_DUTY;
+            break;
+        }
+
+        case EFFECT_IDLE:
+        default:
+        {
+            memset(led_colors, 0, sizeof(led_colors));
+            back_pump_duty = prestart_active ? EFFECT_PUMP_PRESENCE_DUTY : EFFECT_PUMP_IDLE_DUTY;
+            break;
+        }
+    }
+
+    (void)ws2812_encode(led_colors, EFFECT_LED_COUNT, frame_buffers[back_index], EFFECT_FRAME_SIZE);
+}
+
+/* Triangle wave over an 8-bit phase: 0 -> 255 -> 0. */
+static uint8_t triangle(uint32_t phase)
+{
+    phase &= 0xFFu;
+    return (uint8_t)((phase < 128u) ? (phase * 2u) : ((255u - phase) * 2u));
+}
+
+/******************************************************************************
+ * Function Name: spi_event_callback
+ ******************************************************************************
+ * Summary:
+ *  SPI event callback that notifies the sequencer task when the DMA transfer
+ *  of a frame has completed.
+ *
+ * Parameters:
+ *  void *callback_arg : Callback argument (unused)
+ *  cyhal_spi_event_t event : SPI event
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void spi_event_callback(void *callback_arg, cyhal_spi_event_t event)
+{
+    uint32_t entry_cycles = isr_signal_timestamp();
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    (void)callback_arg;
+
+    if ((event & CYHAL_SPI_IRQ_DONE) != 0)
+    {
+        isr_signal_from_isr(ISR_SIGNAL_EFFECT_SPI, entry_cycles, NULL, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+/******************************************************************************
+ * Function Name: update_stats
+ ******************************************************************************
+ * Summary:
+ *  Accumulates the deviation of the frame period from EFFECT_FRAME_PERIOD_MS
+ *  and closes the measurement window every EFFECT_STATS_WINDOW_FRAMES frames.
+ *
+ * Parameters:
+ *  uint32_t frame_start_cycles : Cycle counter at the start of this frame
+ *  uint32_t prev_frame_cycles : Cycle counter at the start of the last frame
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void update_stats(uint32_t frame_start_cycles, uint32_t prev_frame_cycles)
+{
+    uint32_t period_us = cycle_counter_to_us(frame_start_cycles - prev_frame_cycles);
+    uint32_t expected_us = EFFECT_FRAME_PERIOD_MS * 1000u;
+    uint32_t jitter_us = (period_us > expected_us) ? (period_us - expected_us) : (expected_us - period_us);
+    uint32_t window_us;
+
+    total_frames++;
+    window_frames++;
+    window_jitter_sum_us += jitter_us;
+    if (jitter_us > window_jitter_max_us)
+    {
+        window_jitter_max_us = jitter_us;
+    }
+
+    if (window_frames < EFFECT_STATS_WINDOW_FRAMES)
+    {
+        return;
+    }
+
+    window_us = cycle_counter_to_us(frame_start_cycles - window_start_cycles);
+
+    taskENTER_CRITICAL();
+    last_stats.frame_count = total_frames;
+    last_stats.frames_per_sec_x100 = (uint32_t)(((uint64_t)window_frames * 100000000u) / window_us);
+    last_stats.jitter_max_us = window_jitter_max_us;
+    last_stats.jitter_avg_us = window_jitter_sum_us / window_frames;
+    last_stats.late_transfers = window_late_transfers;
+    taskEXIT_CRITICAL();
+
+    window_start_cycles = frame_start_cycles;
+    window_frames = 0;
+    window_jitter_sum_us = 0;
+    window_jitter_max_us = 0;
+    window_late_transfers = 0;
+}
+
+/******************************************************************************
+ * Function Name: effect_sequencer_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the frame rate, jitter and late transfers for the get-stats RPC
+ *  command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t effect_sequencer_format_stats(char *buf, size_t size)
+{
+    effect_sequencer_stats_t stats;
+    int len;
+
+    effect_sequencer_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "effect_frames %lu\n"
+                   "effect_frames_per_sec_x100 %lu\n"
+                   "effect_jitter_us avg %lu max %lu\n"
+                   "effect_late_transfers %lu\n",
+                   (unsigned long)stats.frame_count,
+                   (unsigned long)stats.frames_per_sec_x100,
+                   (unsigned long)stats.jitter_avg_us,
+                   (unsigned long)stats.jitter_max_us,
+                   (unsigned long)stats.late_transfers);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_EFFECT_SEQUENCER */
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/******************************************************************************
+* File Name:   effect_sequencer.h
+*
+* Description: This file is the public interface of effect_sequencer.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef EFFECT_SEQUENCER_H_
+#define EFFECT_SEQUENCER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "effect_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Effect Sequencer Task. */
+#define EFFECT_SEQUENCER_TASK_PRIORITY    (3)
+#define EFFECT_SEQUENCER_TASK_STACK_SIZE  (1024 * 1)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Lighting and pump effects. */
+typedef enum
+{
+    EFFECT_IDLE,            /* LEDs off, pump off */
+    EFFECT_PRESENCE,        /* Slow blue breathing, pump at medium speed */
+    EFFECT_APPROACHING      /* Running wave, pump at full speed */
+} effect_t;
+
+/* Frame timing statistics. */
+typedef struct
+{
+    uint32_t frame_count;
+    uint32_t frames_per_sec_x100;
+    uint32_t jitter_max_us;
+    uint32_t jitter_avg_us;
+    uint32_t late_transfers;
+} effect_sequencer_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_EFFECT_SEQUENCER
+void effect_sequencer_task(void *pvParameters);
+void effect_sequencer_set_presence(bool presence, bool approaching);
+void effect_sequencer_get_stats(effect_sequencer_stats_t *stats);
+size_t effect_sequencer_format_stats(char *buf, size_t size);
+void effect_sequencer_set_prestart(bool prestart);
+#else
+#define effect_sequencer_set_prestart(prestart) \
+                                          do { (void)(prestart); } while (0)
+#define effect_sequencer_set_presence(presence, approaching) \
+                                          do { (void)(presence); (void)(approaching); } while (0)
+#endif /* ENABLE_EFFECT_SEQUENCER */
+
+#endif /* EFFECT_SEQUENCER_H_ */
+
+/* [] END OF FILE */
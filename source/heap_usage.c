@@ -47,6 +47,11 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include "heap_config.h"
+
+#if ENABLE_TLSF_HEAP
+#include "app_heap.h"
+#endif /* ENABLE_TLSF_HEAP */
 
 /* ARM compiler also defines __GNUC__ */
 #if defined (__GNUC__) && !defined(__ARMCC_VERSION)
@@ -68,13 +73,33 @@
 * Function Name: print_heap_usage
 ********************************************************************************
 * Summary:
-* Prints the available heap and utilized heap by using mallinfo().
+* Prints the available heap and utilized heap by using mallinfo(), or the
+* statistics of the TLSF heap when ENABLE_TLSF_HEAP is set.
 *
 *******************************************************************************/
 void print_heap_usage(char *msg)
 {
+#if defined(PRINT_HEAP_USAGE) && ENABLE_TLSF_HEAP
+    uint32_t heap_size;
+    uint32_t max_used;
+    uint32_t in_use;
+
+    get_heap_usage(&heap_size, &max_used, &in_use);
+
+    printf("\r\n\n********** Heap Usage **********\r\n");
+    printf(msg);
+    printf("\r\nTotal available heap        : %"PRIu32" bytes/%.2f KB\r\n", heap_size, TO_KB(heap_size));
+
+    printf("Maximum heap utilized so far: %"PRIu32" bytes/%.2f KB, %.2f%% of available heap\r\n",
+            max_used, TO_KB(max_used), ((float) max_used * 100u)/heap_size);
+
+    printf("Heap in use at this point   : %"PRIu32" bytes/%.2f KB, %.2f%% of available heap\r\n",
+            in_use, TO_KB(in_use), ((float) in_use * 100u)/heap_size);
+
+    printf("********************************\r\n\n");
+
     /* ARM compiler also defines __GNUC__ */
-#if defined(PRINT_HEAP_USAGE) && defined (__GNUC__) && !defined(__ARMCC_VERSION)
+#elif defined(PRINT_HEAP_USAGE) && defined (__GNUC__) && !defined(__ARMCC_VERSION)
     struct mallinfo mall_info = mallinfo();
 
     extern uint8_t __HeapBase;  /* Symbol exported by the linker. */
@@ -95,7 +120,43 @@ void print_heap_usage(char *msg)
             mall_info.uordblks, TO_KB(mall_info.uordblks), ((float) mall_info.uordblks * 100u)/heap_size);
 
     printf("********************************\r\n\n");
-#endif /* #if defined(PRINT_HEAP_USAGE) && defined (__GNUC__) && !defined(__ARMCC_VERSION) */
+#endif /* #if defined(PRINT_HEAP_USAGE) && ENABLE_TLSF_HEAP */
+}
+
+/*******************************************************************************
+* Function Name: get_heap_usage
+********************************************************************************
+* Summary:
+* Returns the available heap, the maximum heap utilized so far and the heap in
+* use by using mallinfo(), or from the TLSF heap when ENABLE_TLSF_HEAP is set.
+* All values are zero if not supported by the compiler.
+*
+*******************************************************************************/
+void get_heap_usage(uint32_t *heap_size, uint32_t *max_used, uint32_t *in_use)
+{
+    *heap_size = 0;
+    *max_used = 0;
+    *in_use = 0;
+
+#if ENABLE_TLSF_HEAP
+    app_heap_stats_t stats;
+
+    app_heap_get_stats(&stats);
+    *heap_size = stats.pool_size;
+    *max_used = stats.pool_size - stats.min_free_bytes;
+    *in_use = stats.pool_size - stats.free_bytes;
+
+    /* ARM compiler also defines __GNUC__ */
+#elif defined (__GNUC__) && !defined(__ARMCC_VERSION)
+    struct mallinfo mall_info = mallinfo();
+
+    extern uint8_t __HeapBase;  /* Symbol exported by the linker. */
+    extern uint8_t __HeapLimit; /* Symbol exported by the linker. */
+
+    *heap_size = (uint32_t)((uint8_t *)&__HeapLimit - (uint8_t *)&__HeapBase);
+    *max_used = (uint32_t)mall_info.arena;
+    *in_use = (uint32_t)mall_info.uordblks;
+#endif /* #if ENABLE_TLSF_HEAP */
 }
 
 /* [] END OF FILE */
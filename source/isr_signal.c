@@ -0,0 +1,394 @@
+/******************************************************************************
+* File Name:   isr_signal.c
+*
+* Description: This file contains the signalling path from interrupts to
+*              tasks. Every interrupt source owns one bit of the notification
+*              value of the task that serves it: the ISR sets the bit with
+*              xTaskNotifyFromISR(eSetBits), which wakes the task without a
+*              queue copy and never fails, and signals of one source that
+*              arrive before the task runs merge into one wakeup. A source
+*              that passes data to the task writes fixed-size records into
+*              its own stream buffer before setting its bit.
+*
+*              The ISR passes its entry time, taken from the DWT cycle
+*              counter as its first statement, so that the time spent in the
+*              ISR and the latency until the task resumes are measured for
+*              every source.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_buffer.h"
+
+#include "isr_signal.h"
+#include "metrics.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* State of an interrupt source. The ISR writes its counters without a
+ * critical section: interrupts of one source run at the same priority and
+ * do not preempt each other, and the task side masks them while it reads.
+ */
+typedef struct
+{
+    TaskHandle_t task;
+    StreamBufferHandle_t buffer;
+    size_t record_size;
+
+    /* Entry time of the first signal not yet seen by the task. */
+    bool pending;
+    uint32_t pending_cycles;
+
+    uint32_t signals;
+    uint32_t dropped;
+    uint32_t wakes;
+    uint32_t isr_max_cycles;
+    uint64_t isr_total_cycles;
+    uint32_t wake_max_cycles;
+    uint64_t wake_total_cycles;
+    uint32_t wake_last_cycles;
+} isr_signal_state_t;
+
+static isr_signal_state_t sources[ISR_SIGNAL_SOURCE_COUNT];
+
+static const char *const source_names[ISR_SIGNAL_SOURCE_COUNT] =
+{
+    [ISR_SIGNAL_RADAR_TD] = "radar",
+    [ISR_SIGNAL_BMI160] = "bmi160",
+    [ISR_SIGNAL_EFFECT_SPI] = "effect-spi",
+    [ISR_SIGNAL_LATENCY_PROBE] = "latency-probe"
+};
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint32_t cycles_to_ns(uint64_t cycles);
+
+/******************************************************************************
+ * Function Name: isr_signal_register
+ ******************************************************************************
+ * Summary:
+ *  Attaches an interrupt source to the task that serves it, and for sources
+ *  that pass data, creates the stream buffer of the records on the first
+ *  call. Must be called before the interrupt is enabled. A task recreated
+ *  after a reconnection registers again with the same record size; records
+ *  left from the previous task are discarded.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *  TaskHandle_t task : Task that waits for the signals of the source
+ *  size_t record_size : Size of a record, or 0 for a signal without data
+ *  size_t record_count : Records the stream buffer holds
+ *
+ * Return:
+ *  bool : false if the stream buffer could not be allocated
+ *
+ ******************************************************************************/
+bool isr_signal_register(isr_signal_source_t source, TaskHandle_t task,
+                         size_t record_size, size_t record_count)
+{
+    isr_signal_state_t *state = &sources[source];
+    StreamBufferHandle_t buffer = state->buffer;
+
+    cycle_counter_init();
+    isr_signal_detach(source);
+
+    if ((record_size > 0) && (buffer == NULL))
+    {
+        buffer = xStreamBufferCreate(record_size * record_count, record_size);
+        if (buffer == NULL)
+        {
+            return false;
+        }
+    }
+    if (buffer != NULL)
+    {
+        (void)xStreamBufferReset(buffer);
+    }
+
+    taskENTER_CRITICAL();
+    state->buffer = buffer;
+    state->record_size = record_size;
+    state->pending = false;
+    state->task = task;
+    taskEXIT_CRITICAL();
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_detach
+ ******************************************************************************
+ * Summary:
+ *  Detaches an interrupt source from its task, so that the task can be
+ *  deleted while the interrupt is still enabled. Later signals are counted
+ *  as dropped.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void isr_signal_detach(isr_signal_source_t source)
+{
+    taskENTER_CRITICAL();
+    sources[source].task = NULL;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_from_isr
+ ******************************************************************************
+ * Summary:
+ *  Signals the task of an interrupt source from its ISR, after storing the
+ *  record if there is one. A record is stored whole or not at all. The
+ *  caller ends the ISR with portYIELD_FROM_ISR(), as with the FreeRTOS
+ *  "FromISR" functions.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *  uint32_t entry_cycles : Value of isr_signal_timestamp() at ISR entry
+ *  const void *record : Record of record_size bytes, or NULL
+ *  BaseType_t *higher_priority_task_woken : Set to pdTRUE if a context
+ *                                           switch is needed
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void isr_signal_from_isr(isr_signal_source_t source, uint32_t entry_cycles,
+                         const void *record, BaseType_t *higher_priority_task_woken)
+{
+    isr_signal_state_t *state = &sources[source];
+    bool has_record = (record != NULL) && (state->buffer != NULL);
+    uint32_t cycles;
+
+    if ((state->task == NULL) ||
+        (has_record && (xStreamBufferSpacesAvailable(state->buffer) < state->record_size)))
+    {
+        state->dropped++;
+        metrics_counter_inc(METRIC_ISR_DROPS);
+    }
+    else
+    {
+        if (has_record)
+        {
+            (void)xStreamBufferSendFromISR(state->buffer, record, state->record_size,
+                                           higher_priority_task_woken);
+        }
+        if (!state->pending)
+        {
+            state->pending = true;
+            state->pending_cycles = entry_cycles;
+        }
+        state->signals++;
+        (void)xTaskNotifyFromISR(state->task, ISR_SIGNAL_BIT(source), eSetBits,
+                                 higher_priority_task_woken);
+    }
+
+    cycles = cycle_counter_get() - entry_cycles;
+    state->isr_total_cycles += cycles;
+    if (cycles > state->isr_max_cycles)
+    {
+        state->isr_max_cycles = cycles;
+    }
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_wait
+ ******************************************************************************
+ * Summary:
+ *  Blocks the calling task until one of its interrupt sources signals it or
+ *  another task sets ISR_SIGNAL_BIT_TASK, and records the wake latency of
+ *  the sources that signalled.
+ *
+ * Parameters:
+ *  TickType_t ticks_to_wait : Timeout in ticks
+ *
+ * Return:
+ *  uint32_t : Notification bits that were set, 0 on timeout
+ *
+ ******************************************************************************/
+uint32_t isr_signal_wait(TickType_t ticks_to_wait)
+{
+    uint32_t bits = 0;
+    uint32_t now_cycles;
+    uint32_t cycles;
+    isr_signal_state_t *state;
+
+    (void)xTaskNotifyWait(0, UINT32_MAX, &bits, ticks_to_wait);
+    now_cycles = cycle_counter_get();
+
+    for (uint32_t source = 0; source < ISR_SIGNAL_SOURCE_COUNT; source++)
+    {
+        if ((bits & ISR_SIGNAL_BIT(source)) == 0)
+        {
+            continue;
+        }
+
+        state = &sources[source];
+        taskENTER_CRITICAL();
+        if (state->pending)
+        {
+            state->pending = false;
+            cycles = now_cycles - state->pending_cycles;
+            state->wakes++;
+            state->wake_last_cycles = cycles;
+            state->wake_total_cycles += cycles;
+            if (cycles > state->wake_max_cycles)
+            {
+                state->wake_max_cycles = cycles;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    return bits;
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_receive
+ ******************************************************************************
+ * Summary:
+ *  Takes the oldest record of an interrupt source without blocking. Only the
+ *  task registered for the source may call this function.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *  void *record : Output record of record_size bytes
+ *
+ * Return:
+ *  bool : true if a record was taken
+ *
+ ******************************************************************************/
+bool isr_signal_receive(isr_signal_source_t source, void *record)
+{
+    isr_signal_state_t *state = &sources[source];
+
+    return (state->buffer != NULL) &&
+           (xStreamBufferReceive(state->buffer, record, state->record_size, 0) == state->record_size);
+}
+
+/* Returns the wake latency of a source at the last isr_signal_wait() it
+ * signalled, in microseconds.
+ */
+uint32_t isr_signal_last_wake_us(isr_signal_source_t source)
+{
+    return cycle_counter_to_us(sources[source].wake_last_cycles);
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the counters of an interrupt source and the time spent in its ISR
+ *  and until its task resumed.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *  isr_signal_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void isr_signal_get_stats(isr_signal_source_t source, isr_signal_stats_t *stats)
+{
+    isr_signal_state_t state;
+    uint32_t calls;
+
+    taskENTER_CRITICAL();
+    state = sources[source];
+    taskEXIT_CRITICAL();
+
+    calls = state.signals + state.dropped;
+    stats->signals = state.signals;
+    stats->dropped = state.dropped;
+    stats->wakes = state.wakes;
+    stats->isr_avg_ns = (calls > 0) ? cycles_to_ns(state.isr_total_cycles / calls) : 0;
+    stats->isr_max_ns = cycles_to_ns(state.isr_max_cycles);
+    stats->wake_avg_ns = (state.wakes > 0) ? cycles_to_ns(state.wake_total_cycles / state.wakes) : 0;
+    stats->wake_max_ns = cycles_to_ns(state.wake_max_cycles);
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_name
+ ******************************************************************************
+ * Summary:
+ *  Returns the name of an interrupt source for the statistics.
+ *
+ * Parameters:
+ *  isr_signal_source_t source : Interrupt source
+ *
+ * Return:
+ *  const char * : Name of the source
+ *
+ ******************************************************************************/
+const char *isr_signal_name(isr_signal_source_t source)
+{
+    return source_names[source];
+}
+
+/* Converts cycles to nanoseconds, saturating at UINT32_MAX. */
+static uint32_t cycles_to_ns(uint64_t cycles)
+{
+    uint64_t ns = (cycles * 1000u) / (SystemCoreClock / 1000000u);
+
+    return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+
+/******************************************************************************
+ * Function Name: isr_signal_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the signals, drops, ISR durations and wake latencies of every
+ *  source for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t isr_signal_format_stats(char *buf, size_t size)
+{
+    isr_signal_stats_t stats;
+    size_t pos = 0;
+    int len;
+
+    for (uint32_t source = 0; (source < ISR_SIGNAL_SOURCE_COUNT) && (pos < size); source++)
+    {
+        isr_signal_get_stats((isr_signal_source_t)source, &stats);
+        len = snprintf(&buf[pos], size - pos,
+                       "isr_signal %s signals %lu dropped %lu wakes %lu "
+                       "isr_ns avg %lu max %lu wake_ns avg %lu max %lu\n",
+                       isr_signal_name((isr_signal_source_t)source),
+                       (unsigned long)stats.signals,
+                       (unsigned long)stats.dropped,
+                       (unsigned long)stats.wakes,
+                       (unsigned long)stats.isr_avg_ns,
+                       (unsigned long)stats.isr_max_ns,
+                       (unsigned long)stats.wake_avg_ns,
+                       (unsigned long)stats.wake_max_ns);
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+/* [] END OF FILE */
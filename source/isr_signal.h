@@ -0,0 +1,82 @@
+/******************************************************************************
+* File Name:   isr_signal.h
+*
+* Description: This file is the public interface of isr_signal.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef ISR_SIGNAL_H_
+#define ISR_SIGNAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cycle_counter.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Notification bit of an interrupt source. */
+#define ISR_SIGNAL_BIT(source)            (1uL << (uint32_t)(source))
+
+/* Notification bit set by tasks after they queue a command to a task that
+ * also waits for interrupt signals.
+ */
+#define ISR_SIGNAL_BIT_TASK               (1uL << 31)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Interrupt sources that signal a task. */
+typedef enum
+{
+    ISR_SIGNAL_RADAR_TD,
+    ISR_SIGNAL_BMI160,
+    ISR_SIGNAL_EFFECT_SPI,
+    ISR_SIGNAL_LATENCY_PROBE,
+    ISR_SIGNAL_SOURCE_COUNT
+} isr_signal_source_t;
+
+/* Statistics of a source since start-up. */
+typedef struct
+{
+    uint32_t signals;           /* Interrupts that signalled the task */
+    uint32_t dropped;           /* Records not stored: buffer full or no task */
+    uint32_t wakes;             /* Task wakeups; several signals may share one */
+    uint32_t isr_avg_ns;        /* Time spent in the ISR */
+    uint32_t isr_max_ns;
+    uint32_t wake_avg_ns;       /* ISR entry to the task resuming */
+    uint32_t wake_max_ns;
+} isr_signal_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+bool isr_signal_register(isr_signal_source_t source, TaskHandle_t task,
+                         size_t record_size, size_t record_count);
+void isr_signal_detach(isr_signal_source_t source);
+void isr_signal_from_isr(isr_signal_source_t source, uint32_t entry_cycles,
+                         const void *record, BaseType_t *higher_priority_task_woken);
+uint32_t isr_signal_wait(TickType_t ticks_to_wait);
+bool isr_signal_receive(isr_signal_source_t source, void *record);
+uint32_t isr_signal_last_wake_us(isr_signal_source_t source);
+void isr_signal_get_stats(isr_signal_source_t source, isr_signal_stats_t *stats);
+size_t isr_signal_format_stats(char *buf, size_t size);
+const char *isr_signal_name(isr_signal_source_t source);
+
+/*******************************************************************************
+* Function Definitions
+********************************************************************************/
+/* Captures the entry time of an ISR. Must be the first statement of the ISR. */
+static inline uint32_t isr_signal_timestamp(void)
+{
+    return cycle_counter_get();
+}
+
+#endif /* ISR_SIGNAL_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,195 @@
+/******************************************************************************
+* File Name:   latency_histogram.c
+*
+* Description: This file contains a fixed-memory latency histogram with
+*              log-linear buckets, in the manner of an HDR histogram: every
+*              power of two is split into LATENCY_HISTOGRAM_SUB_COUNT equal
+*              buckets, so a percentile read from the histogram is within
+*              12.5 % of the recorded value over the whole 32-bit range.
+*              Recording is O(1) and a percentile walks the buckets once.
+*
+*              The histogram has no dependency on the HAL or FreeRTOS; the
+*              caller serializes recording and reading.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "latency_histogram.h"
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint32_t bucket_index(uint32_t value);
+static uint32_t bucket_upper(uint32_t index);
+
+/******************************************************************************
+ * Function Name: latency_histogram_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes an empty histogram.
+ *
+ * Parameters:
+ *  latency_histogram_t *histogram : Histogram to be initialized
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void latency_histogram_init(latency_histogram_t *histogram)
+{
+    memset(histogram, 0, sizeof(latency_histogram_t));
+    histogram->min = UINT32_MAX;
+}
+
+/******************************************************************************
+ * Function Name: latency_histogram_record
+ ******************************************************************************
+ * Summary:
+ *  Records one latency.
+ *
+ * Parameters:
+ *  latency_histogram_t *histogram : Histogram
+ *  uint32_t value : Latency
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void latency_histogram_record(latency_histogram_t *histogram, uint32_t value)
+{
+    histogram->counts[bucket_index(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value < histogram->min)
+    {
+        histogram->min = value;
+    }
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+/******************************************************************************
+ * Function Name: latency_histogram_percentile
+ ******************************************************************************
+ * Summary:
+ *  Returns the latency below which 'permille'/1000 of the recorded latencies
+ *  lie, as the upper bound of its bucket limited to the recorded range.
+ *
+ * Parameters:
+ *  const latency_histogram_t *histogram : Histogram
+ *  uint32_t permille : Percentile in 1/1000, for example 990 for p99
+ *
+ * Return:
+ *  uint32_t : Latency, 0 if the histogram is empty
+ *
+ ******************************************************************************/
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram, uint32_t permille)
+{
+    uint32_t rank;
+    uint32_t seen = 0;
+    uint32_t value = histogram->max;
+
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+
+    /* Rank of the sample, rounded up, from 1 to count. */
+    rank = (uint32_t)((((uint64_t)histogram->count * permille) + 999u) / 1000u);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= rank)
+        {
+            value = bucket_upper(i);
+            break;
+        }
+    }
+
+    if (value > histogram->max)
+    {
+        value = histogram->max;
+    }
+    if (value < histogram->min)
+    {
+        value = histogram->min;
+    }
+
+    return value;
+}
+
+/******************************************************************************
+ * Function Name: latency_histogram_summarize
+ ******************************************************************************
+ * Summary:
+ *  Returns the count, minimum, average, p50, p90, p99 and maximum.
+ *
+ * Parameters:
+ *  const latency_histogram_t *histogram : Histogram
+ *  latency_summary_t *summary : Output summary, all zero if empty
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void latency_histogram_summarize(const latency_histogram_t *histogram, latency_summary_t *summary)
+{
+    memset(summary, 0, sizeof(latency_summary_t));
+    if (histogram->count == 0)
+    {
+        return;
+    }
+
+    summary->count = histogram->count;
+    summary->min = histogram->min;
+    summary->avg = (uint32_t)(histogram->sum / histogram->count);
+    summary->p50 = latency_histogram_percentile(histogram, 500u);
+    summary->p90 = latency_histogram_percentile(histogram, 900u);
+    summary->p99 = latency_histogram_percentile(histogram, 990u);
+    summary->max = histogram->max;
+}
+
+/* Values below 2 * LATENCY_HISTOGRAM_SUB_COUNT are their own index. Above,
+ * the index is the position of the leading one followed by the next
+ * LATENCY_HISTOGRAM_SUB_LOG2 bits.
+ */
+static uint32_t bucket_index(uint32_t value)
+{
+    uint32_t shift;
+
+    if (value < (2u * LATENCY_HISTOGRAM_SUB_COUNT))
+    {
+        return value;
+    }
+
+    shift = (31u - (uint32_t)__builtin_clz(value)) - LATENCY_HISTOGRAM_SUB_LOG2;
+    return ((shift + 1u) * LATENCY_HISTOGRAM_SUB_COUNT) +
+           ((value >> shift) & (LATENCY_HISTOGRAM_SUB_COUNT - 1u));
+}
+
+/* Largest value of a bucket. */
+static uint32_t bucket_upper(uint32_t index)
+{
+    uint32_t shift;
+    uint32_t sub;
+
+    if (index < (2u * LATENCY_HISTOGRAM_SUB_COUNT))
+    {
+        return index;
+    }
+
+    shift = (index / LATENCY_HISTOGRAM_SUB_COUNT) - 1u;
+    sub = index % LATENCY_HISTOGRAM_SUB_COUNT;
+    return (((LATENCY_HISTOGRAM_SUB_COUNT + sub) << shift) - 1u) + (1u << shift);
+}
+
+/* [] END OF FILE */
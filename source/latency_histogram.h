@@ -0,0 +1,66 @@
+/******************************************************************************
+* File Name:   latency_histogram.h
+*
+* Description: This file is the public interface of latency_histogram.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Every power of two is split into 2^LATENCY_HISTOGRAM_SUB_LOG2 buckets, so a
+ * bucket is at most 1/8 of its lower bound wide. Values below
+ * 2^(LATENCY_HISTOGRAM_SUB_LOG2 + 1) have a bucket of their own.
+ */
+#define LATENCY_HISTOGRAM_SUB_LOG2        (3u)
+#define LATENCY_HISTOGRAM_SUB_COUNT       (1u << LATENCY_HISTOGRAM_SUB_LOG2)
+
+/* Buckets covering the full 32-bit range. */
+#define LATENCY_HISTOGRAM_BUCKETS         ((32u - LATENCY_HISTOGRAM_SUB_LOG2 + 1u) * LATENCY_HISTOGRAM_SUB_COUNT)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Histogram of latencies in any unit. All fields are private to
+ * latency_histogram.c.
+ */
+typedef struct
+{
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} latency_histogram_t;
+
+/* Summary of a histogram. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t avg;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+} latency_summary_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void latency_histogram_init(latency_histogram_t *histogram);
+void latency_histogram_record(latency_histogram_t *histogram, uint32_t value);
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram, uint32_t permille);
+void latency_histogram_summarize(const latency_histogram_t *histogram, latency_summary_t *summary);
+
+#endif /* LATENCY_HISTOGRAM_H_ */
+
+/* [] END OF FILE */
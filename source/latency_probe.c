@@ -0,0 +1,449 @@
+/******************************************************************************
+* File Name:   latency_probe.c
+*
+* Description: This file contains the interrupt latency probe. A TCPWM PWM
+*              drives LATENCY_PROBE_OUT_PIN, which is wired back to
+*              LATENCY_PROBE_IN_PIN. The rising edge is generated by hardware
+*              when the PWM counter restarts from 0, independent of what the
+*              CPU is doing, so the counter value read at any later point is
+*              the time elapsed since the edge.
+*
+*              The GPIO callback reads the counter as its first statement
+*              (latency to the ISR, including the HAL interrupt dispatch) and
+*              as its last (time spent in the ISR), and signals the probe
+*              task, which reads it again when it resumes (latency to task
+*              wake). The edges take the signalling paths of
+*              latency_probe_path_t in turn: a queue copy, and the
+*              notification bit and stream buffer of isr_signal.c. The probe
+*              runs alongside the application, so the worst case includes
+*              Wi-Fi, TLS and every other source of interrupt masking and
+*              preemption.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "latency_probe.h"
+#include "isr_signal.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+#if ENABLE_LATENCY_PROBE
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* PWM that generates the probe edges, and its counter clock. */
+static cyhal_pwm_t probe_pwm;
+static cyhal_clock_t probe_clock;
+static uint32_t probe_clock_hz;
+
+static cyhal_gpio_callback_data_t probe_cb_data;
+
+/* Queue of the queue path. */
+static QueueHandle_t probe_q;
+
+/* Edges seen by the ISR, which selects the path of each edge, and the counter
+ * values read at ISR entry and the time spent in the ISR.
+ */
+static volatile uint32_t isr_edges;
+static volatile uint32_t isr_counts;
+static volatile uint32_t isr_duration_counts;
+
+/* Range of one latency in counter ticks, and the sum of its samples. */
+typedef struct
+{
+    uint32_t min_counts;
+    uint32_t max_counts;
+    uint64_t total_counts;
+} probe_range_t;
+
+/* Statistics of a signalling path in counter ticks, converted to nanoseconds
+ * by latency_probe_get_stats().
+ */
+typedef struct
+{
+    uint32_t samples;
+    uint32_t missed;
+    probe_range_t isr;
+    probe_range_t duration;
+    probe_range_t task;
+} probe_path_t;
+
+static probe_path_t paths[LATENCY_PROBE_PATH_COUNT];
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static cy_rslt_t probe_init(void);
+static uint32_t read_counter(void);
+static bool wait_edge(latency_probe_path_t path, uint32_t *edge_counts);
+static void drain_paths(void);
+static uint32_t counts_to_ns(uint32_t counts);
+static void update_range(probe_range_t *range, uint32_t counts);
+static void range_to_ns(const probe_range_t *range, uint32_t samples, latency_probe_range_t *out);
+static void isr_probe_edge(void *callback_arg, cyhal_gpio_event_t event);
+
+/******************************************************************************
+ * Function Name: latency_probe_task
+ ******************************************************************************
+ * Summary:
+ *  Starts the probe PWM and records the latency of every probe edge to the
+ *  ISR and to this task resuming.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void latency_probe_task(void *pvParameters)
+{
+    uint32_t expected_edge = 0;
+    latency_probe_path_t path;
+    probe_path_t *path_stats;
+    bool received;
+    uint32_t wake_counts;
+    uint32_t edge_counts = 0;
+    uint32_t duration_counts;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    for (uint32_t i = 0; i < LATENCY_PROBE_PATH_COUNT; i++)
+    {
+        paths[i].isr.min_counts = UINT32_MAX;
+        paths[i].duration.min_counts = UINT32_MAX;
+        paths[i].task.min_counts = UINT32_MAX;
+    }
+
+    probe_q = xQueueCreate(2u, sizeof(uint32_t));
+    if ((probe_q == NULL) ||
+        !isr_signal_register(ISR_SIGNAL_LATENCY_PROBE, xTaskGetCurrentTaskHandle(),
+                             sizeof(uint32_t), 2u) ||
+        (probe_init() != CY_RSLT_SUCCESS))
+    {
+        printf("Latency probe: Initialization failed\n");
+        vTaskSuspend(NULL);
+    }
+
+    while (true)
+    {
+        path = (latency_probe_path_t)(expected_edge % LATENCY_PROBE_PATH_COUNT);
+        path_stats = &paths[path];
+
+        received = wait_edge(path, &edge_counts);
+        wake_counts = read_counter();
+        duration_counts = isr_duration_counts;
+
+        /* No edge, more than one edge, or a counter restart before the task
+         * resumed: the latency of this edge is unknown. The ISR and the task
+         * agree on the path again from the next edge.
+         */
+        if (!received || (isr_edges != (expected_edge + 1u)) || (wake_counts < edge_counts))
+        {
+            taskENTER_CRITICAL();
+            path_stats->missed++;
+            taskEXIT_CRITICAL();
+
+            drain_paths();
+            expected_edge = isr_edges;
+            continue;
+        }
+        expected_edge++;
+
+        taskENTER_CRITICAL();
+        path_stats->samples++;
+        update_range(&path_stats->isr, edge_counts);
+        update_range(&path_stats->duration, duration_counts);
+        update_range(&path_stats->task, wake_counts);
+        taskEXIT_CRITICAL();
+    }
+}
+
+/******************************************************************************
+ * Function Name: latency_probe_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the latency statistics, converted to nanoseconds.
+ *
+ * Parameters:
+ *  latency_probe_stats_t *out : Output statistics, latencies in ns
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void latency_probe_get_stats(latency_probe_stats_t *out)
+{
+    probe_path_t snapshot[LATENCY_PROBE_PATH_COUNT];
+    latency_probe_path_stats_t *path_stats;
+
+    taskENTER_CRITICAL();
+    memcpy(snapshot, paths, sizeof(snapshot));
+    taskEXIT_CRITICAL();
+
+    for (uint32_t path = 0; path < LATENCY_PROBE_PATH_COUNT; path++)
+    {
+        path_stats = &out->path[path];
+        path_stats->samples = snapshot[path].samples;
+        path_stats->missed = snapshot[path].missed;
+        range_to_ns(&snapshot[path].isr, snapshot[path].samples, &path_stats->isr);
+        range_to_ns(&snapshot[path].duration, snapshot[path].samples, &path_stats->duration);
+        range_to_ns(&snapshot[path].task, snapshot[path].samples, &path_stats->task);
+    }
+}
+
+/* Sets up the loopback input with its interrupt and starts the probe PWM. */
+static cy_rslt_t probe_init(void)
+{
+    cy_rslt_t result;
+
+    result = cyhal_gpio_init(LATENCY_PROBE_IN_PIN, CYHAL_GPIO_DIR_INPUT, CYHAL_GPIO_DRIVE_NONE, false);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+    probe_cb_data.callback = isr_probe_edge;
+    probe_cb_data.callback_arg = NULL;
+    cyhal_gpio_register_callback(LATENCY_PROBE_IN_PIN, &probe_cb_data);
+    cyhal_gpio_enable_event(LATENCY_PROBE_IN_PIN, CYHAL_GPIO_IRQ_RISE,
+                            IRQ_PRIORITY_LATENCY_PROBE, true);
+
+    result = cyhal_clock_allocate(&probe_clock, CYHAL_CLOCK_BLOCK_PERIPHERAL_16BIT);
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_clock_set_frequency(&probe_clock, LATENCY_PROBE_CLOCK_HZ, NULL);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_clock_set_enabled(&probe_clock, true, true);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        probe_clock_hz = cyhal_clock_get_frequency(&probe_clock);
+        result = cyhal_pwm_init_adv(&probe_pwm, LATENCY_PROBE_OUT_PIN, NC, CYHAL_PWM_LEFT_ALIGN,
+                                    true, 0u, false, &probe_clock);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        /* Left aligned: the output rises when the counter restarts from 0. */
+        result = cyhal_pwm_set_period(&probe_pwm, LATENCY_PROBE_PERIOD_US, LATENCY_PROBE_PERIOD_US / 2u);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cyhal_pwm_start(&probe_pwm);
+    }
+
+    return result;
+}
+
+/* Waits for the next edge on a signalling path and returns the counter value
+ * read at ISR entry.
+ */
+static bool wait_edge(latency_probe_path_t path, uint32_t *edge_counts)
+{
+    TickType_t timeout = pdMS_TO_TICKS((2u * LATENCY_PROBE_PERIOD_US) / 1000u + 1u);
+
+    switch (path)
+    {
+        case LATENCY_PROBE_QUEUE:
+        {
+            return xQueueReceive(probe_q, edge_counts, timeout) == pdTRUE;
+        }
+
+        case LATENCY_PROBE_NOTIFY:
+        {
+            bool signalled = (isr_signal_wait(timeout) & ISR_SIGNAL_BIT(ISR_SIGNAL_LATENCY_PROBE)) != 0;
+            *edge_counts = isr_counts;
+            return signalled;
+        }
+
+        default:
+        {
+            return ((isr_signal_wait(timeout) & ISR_SIGNAL_BIT(ISR_SIGNAL_LATENCY_PROBE)) != 0) &&
+                   isr_signal_receive(ISR_SIGNAL_LATENCY_PROBE, edge_counts);
+        }
+    }
+}
+
+/* Discards the signals of edges that the task did not wait for. */
+static void drain_paths(void)
+{
+    uint32_t counts;
+
+    (void)xQueueReset(probe_q);
+    (void)isr_signal_wait(0);
+    while (isr_signal_receive(ISR_SIGNAL_LATENCY_PROBE, &counts))
+    {
+    }
+}
+
+/* Counter ticks since the last probe edge. */
+static uint32_t read_counter(void)
+{
+    return Cy_TCPWM_Counter_GetCounter(probe_pwm.tcpwm.base, probe_pwm.tcpwm.resource.channel_num);
+}
+
+static uint32_t counts_to_ns(uint32_t counts)
+{
+    return (uint32_t)(((uint64_t)counts * 1000000000u) / probe_clock_hz);
+}
+
+static void update_range(probe_range_t *range, uint32_t counts)
+{
+    if (counts < range->min_counts)
+    {
+        range->min_counts = counts;
+    }
+    if (counts > range->max_counts)
+    {
+        range->max_counts = counts;
+    }
+    range->total_counts += counts;
+}
+
+/* Converts a range of 'samples' samples in counter ticks to nanoseconds. */
+static void range_to_ns(const probe_range_t *range, uint32_t samples, latency_probe_range_t *out)
+{
+    if (samples == 0)
+    {
+        out->min_ns = 0;
+        out->avg_ns = 0;
+        out->max_ns = 0;
+        return;
+    }
+
+    out->min_ns = counts_to_ns(range->min_counts);
+    out->avg_ns = counts_to_ns((uint32_t)(range->total_counts / samples));
+    out->max_ns = counts_to_ns(range->max_counts);
+}
+
+/******************************************************************************
+ * Function Name: isr_probe_edge
+ ******************************************************************************
+ * Summary:
+ *  GPIO interrupt service routine of the loopback input. Reads the probe
+ *  counter and wakes the probe task on the signalling path of this edge.
+ *
+ * Parameters:
+ *  void *callback_arg : Unused
+ *  cyhal_gpio_event_t event : GPIO event type (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void isr_probe_edge(void *callback_arg, cyhal_gpio_event_t event)
+{
+    uint32_t entry_counts = read_counter();
+    uint32_t entry_cycles = isr_signal_timestamp();
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t edge = isr_edges;
+
+    /* To avoid compiler warnings */
+    (void) callback_arg;
+    (void) event;
+
+    isr_counts = entry_counts;
+    isr_edges = edge + 1u;
+
+    switch ((latency_probe_path_t)(edge % LATENCY_PROBE_PATH_COUNT))
+    {
+        case LATENCY_PROBE_QUEUE:
+        {
+            (void)xQueueSendFromISR(probe_q, &entry_counts, &xHigherPriorityTaskWoken);
+            break;
+        }
+
+        case LATENCY_PROBE_NOTIFY:
+        {
+            isr_signal_from_isr(ISR_SIGNAL_LATENCY_PROBE, entry_cycles, NULL,
+                                &xHigherPriorityTaskWoken);
+            break;
+        }
+
+        default:
+        {
+            isr_signal_from_isr(ISR_SIGNAL_LATENCY_PROBE, entry_cycles, &entry_counts,
+                                &xHigherPriorityTaskWoken);
+            break;
+        }
+    }
+
+    isr_duration_counts = read_counter() - entry_counts;
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/******************************************************************************
+ * Function Name: latency_probe_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the samples and the interrupt, ISR and task wake latencies of
+ *  every signalling path for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t latency_probe_format_stats(char *buf, size_t size)
+{
+    static const char *const path_names[LATENCY_PROBE_PATH_COUNT] =
+    {
+        "queue", "notify", "stream"
+    };
+    latency_probe_stats_t stats;
+    const latency_probe_path_stats_t *path_stats;
+    size_t pos = 0;
+    int len;
+
+    latency_probe_get_stats(&stats);
+    for (uint32_t path = 0; (path < LATENCY_PROBE_PATH_COUNT) && (pos < size); path++)
+    {
+        path_stats = &stats.path[path];
+        len = snprintf(&buf[pos], size - pos,
+                       "irq_latency %s samples %lu missed %lu\n"
+                       "  irq_latency_ns min %lu avg %lu max %lu\n"
+                       "  isr_duration_ns min %lu avg %lu max %lu\n"
+                       "  task_wake_latency_ns min %lu avg %lu max %lu\n",
+                       path_names[path],
+                       (unsigned long)path_stats->samples,
+                       (unsigned long)path_stats->missed,
+                       (unsigned long)path_stats->isr.min_ns,
+                       (unsigned long)path_stats->isr.avg_ns,
+                       (unsigned long)path_stats->isr.max_ns,
+                       (unsigned long)path_stats->duration.min_ns,
+                       (unsigned long)path_stats->duration.avg_ns,
+                       (unsigned long)path_stats->duration.max_ns,
+                       (unsigned long)path_stats->task.min_ns,
+                       (unsigned long)path_stats->task.avg_ns,
+                       (unsigned long)path_stats->task.max_ns);
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+#endif /* ENABLE_LATENCY_PROBE */
+
+/* [] END OF FILE */
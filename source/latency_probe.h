@@ -0,0 +1,75 @@
+/******************************************************************************
+* File Name:   latency_probe.h
+*
+* Description: This file is the public interface of latency_probe.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef LATENCY_PROBE_H_
+#define LATENCY_PROBE_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "irq_priority_config.h"
+#include "publisher_task.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Latency Probe Task. It runs at the priority of the
+ * publisher task, so that the wake latency is the one seen by radar events.
+ */
+#define LATENCY_PROBE_TASK_PRIORITY       (PUBLISHER_TASK_PRIORITY)
+#define LATENCY_PROBE_TASK_STACK_SIZE     (512u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Latency from the probe edge in nanoseconds. */
+typedef struct
+{
+    uint32_t min_ns;
+    uint32_t avg_ns;
+    uint32_t max_ns;
+} latency_probe_range_t;
+
+/* Signalling paths from the probe ISR to the probe task, used in turn. */
+typedef enum
+{
+    LATENCY_PROBE_QUEUE,            /* xQueueSendFromISR() of the counter value */
+    LATENCY_PROBE_NOTIFY,           /* Notification bit of isr_signal.c */
+    LATENCY_PROBE_STREAM,           /* Stream buffer record of isr_signal.c */
+    LATENCY_PROBE_PATH_COUNT
+} latency_probe_path_t;
+
+/* Latency statistics of a signalling path since start-up. */
+typedef struct
+{
+    uint32_t samples;
+    uint32_t missed;                /* Edges not seen by the task in time */
+    latency_probe_range_t isr;      /* Edge to the interrupt callback */
+    latency_probe_range_t duration; /* Time spent in the interrupt callback */
+    latency_probe_range_t task;     /* Edge to the task resuming */
+} latency_probe_path_stats_t;
+
+/* Latency statistics since start-up. */
+typedef struct
+{
+    latency_probe_path_stats_t path[LATENCY_PROBE_PATH_COUNT];
+} latency_probe_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_LATENCY_PROBE
+void latency_probe_task(void *pvParameters);
+void latency_probe_get_stats(latency_probe_stats_t *stats);
+size_t latency_probe_format_stats(char *buf, size_t size);
+#endif /* ENABLE_LATENCY_PROBE */
+
+#endif /* LATENCY_PROBE_H_ */
+
+/* [] END OF FILE */
@@ -19,6 +19,17 @@
 #include "mqtt_task.h"
 #include "tft_task.h"
 #include "motion_task.h"
+#include "presence_history.h"
+#include "sensor_scheduler.h"
+#include "effect_sequencer.h"
+#include "app_time.h"
+#include "render_server.h"
+#include "occupancy_task.h"
+#include "actuation_task.h"
+#include "metrics_task.h"
+#include "nn_task.h"
+#include "latency_probe.h"
+#include "wall_clock.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -86,6 +97,12 @@ int main()
 #endif
     printf("===============================================================\n\n");
 
+    /* Create the presence/light history before any task records into it. */
+    presence_history_init();
+
+    /* Create the draw command queue before any task posts to the display. */
+    render_server_init();
+
     /* Create the MQTT Client task. */
     xTaskCreate(mqtt_client_task, "MQTT Client task", MQTT_CLIENT_TASK_STACK_SIZE,
                 NULL, MQTT_CLIENT_TASK_PRIORITY, NULL);
@@ -94,6 +111,58 @@ int main()
     xTaskCreate(tft_task, "tftTask", TFT_TASK_STACK_SIZE,
                 NULL,  TFT_TASK_PRIORITY,  NULL);
 
+    /* Create the Sensor Scheduler task that samples all polled sensors */
+    xTaskCreate(sensor_scheduler_task, "Sensor task", SENSOR_SCHEDULER_TASK_STACK_SIZE,
+                NULL, SENSOR_SCHEDULER_TASK_PRIORITY, &sensor_scheduler_task_handle);
+
+#if ENABLE_VIRTUAL_TIME
+    /* Create the time master task that advances the virtual clock */
+    xTaskCreate(app_time_task, "Time task", APP_TIME_TASK_STACK_SIZE,
+                NULL, APP_TIME_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_WALL_CLOCK
+    /* Initialize the RTC before the MQTT client task sets it. */
+    result = wall_clock_init();
+    CY_ASSERT(result == CY_RSLT_SUCCESS);
+#endif
+
+#if ENABLE_OCCUPANCY_PREDICTOR
+    /* Create the Occupancy task that pre-starts the pump before arrivals */
+    xTaskCreate(occupancy_task, "Occupancy task", OCCUPANCY_TASK_STACK_SIZE,
+                NULL, OCCUPANCY_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_ACTUATION_VERIFIER
+    /* Create the Actuation task that verifies the smart plug switched */
+    xTaskCreate(actuation_task, "Actuation task", ACTUATION_TASK_STACK_SIZE,
+                NULL, ACTUATION_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_NN_CLASSIFIER
+    /* Create the NN Classifier task that classifies radar activations */
+    xTaskCreate(nn_task, "NN task", NN_TASK_STACK_SIZE,
+                NULL, NN_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_LATENCY_PROBE
+    /* Create the Latency Probe task that measures interrupt and wake latency */
+    xTaskCreate(latency_probe_task, "Latency task", LATENCY_PROBE_TASK_STACK_SIZE,
+                NULL, LATENCY_PROBE_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_METRICS
+    /* Create the Metrics task that exports the metrics registry */
+    xTaskCreate(metrics_task, "Metrics task", METRICS_TASK_STACK_SIZE,
+                NULL, METRICS_TASK_PRIORITY, NULL);
+#endif
+
+#if ENABLE_EFFECT_SEQUENCER
+    /* Create the Effect Sequencer task that drives the LED strip and pump */
+    xTaskCreate(effect_sequencer_task, "Effect task", EFFECT_SEQUENCER_TASK_STACK_SIZE,
+                NULL, EFFECT_SEQUENCER_TASK_PRIORITY, NULL);
+#endif
+
     /* Create the Motion Sensor task */
     //result = create_motion_sensor_task();
 
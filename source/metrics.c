@@ -0,0 +1,393 @@
+/******************************************************************************
+* File Name:   metrics.c
+*
+* Description: This file contains the metrics registry: counters, gauges and
+*              histograms with fixed bucket bounds, all declared in metrics.h
+*              and described in the tables below, so that the registry takes
+*              no RAM beyond the values themselves.
+*
+*              Every update is a single relaxed atomic operation, which the
+*              Cortex-M4 runs as an LDREX/STREX loop, so tasks and ISRs of
+*              any priority update the metrics without a critical section.
+*              A snapshot reads every value once; values updated while it is
+*              taken may belong to the next snapshot.
+*
+*              The registry has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "metrics.h"
+
+#if ENABLE_METRICS
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* FNV-1a parameters of the schema id. */
+#define FNV_OFFSET_BASIS            (2166136261u)
+#define FNV_PRIME                   (16777619u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Description of a histogram: name and the upper bounds of all buckets but
+ * the last. A value equal to a bound falls into its bucket.
+ */
+typedef struct
+{
+    const char *name;
+    uint32_t bounds[METRICS_HISTOGRAM_BUCKETS - 1u];
+} metrics_histogram_info_t;
+
+static const char *const counter_names[METRICS_COUNTER_COUNT] =
+{
+    [METRIC_MQTT_PUBLISHES]        = "mqtt_publishes_total",
+    [METRIC_MQTT_PUBLISH_FAILURES] = "mqtt_publish_failures_total",
+    [METRIC_MQTT_CONNECT_FAILURES] = "mqtt_connect_failures_total",
+    [METRIC_MQTT_RECONNECTS]       = "mqtt_reconnects_total",
+    [METRIC_ISR_DROPS]             = "isr_signal_drops_total",
+    [METRIC_RENDER_DROPS]          = "render_drops_total",
+    [METRIC_RADAR_EDGES]           = "radar_edges_total",
+    [METRIC_DEADLINE_MISSES]       = "deadline_misses_total"
+};
+
+static const char *const gauge_names[METRICS_GAUGE_COUNT] =
+{
+    [METRIC_HEAP_FREE_BYTES]     = "heap_free_bytes",
+    [METRIC_HEAP_FREE_MIN_BYTES] = "heap_free_min_bytes"
+};
+
+static const metrics_histogram_info_t histogram_infos[METRICS_HISTOGRAM_COUNT] =
+{
+    [METRIC_MQTT_PUBLISH_US] =
+    {
+        "mqtt_publish_us", { 1000u, 2000u, 5000u, 10000u, 20000u, 50000u, 100000u }
+    },
+    [METRIC_MQTT_CONNECT_MS] =
+    {
+        "mqtt_connect_ms", { 250u, 500u, 1000u, 2000u, 4000u, 8000u, 16000u }
+    }
+};
+
+/* Values of the metrics. The sum of a histogram wraps at 2^32. */
+static uint32_t counters[METRICS_COUNTER_COUNT];
+static int32_t gauges[METRICS_GAUGE_COUNT];
+static uint32_t histogram_buckets[METRICS_HISTOGRAM_COUNT][METRICS_HISTOGRAM_BUCKETS];
+static uint32_t histogram_sums[METRICS_HISTOGRAM_COUNT];
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool put_byte(uint8_t *buf, size_t size, size_t *len, uint8_t value);
+static bool put_varint(uint8_t *buf, size_t size, size_t *len, uint32_t value);
+static bool append(char *buf, size_t size, size_t *len, const char *format, ...);
+
+/******************************************************************************
+ * Function Name: metrics_counter_add
+ ******************************************************************************
+ * Summary:
+ *  Adds to a counter. Callable from tasks and ISRs.
+ *
+ * Parameters:
+ *  metrics_counter_t id : Counter
+ *  uint32_t value : Increment
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void metrics_counter_add(metrics_counter_t id, uint32_t value)
+{
+    (void)__atomic_fetch_add(&counters[id], value, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Function Name: metrics_gauge_set
+ ******************************************************************************
+ * Summary:
+ *  Sets a gauge. Callable from tasks and ISRs.
+ *
+ * Parameters:
+ *  metrics_gauge_t id : Gauge
+ *  int32_t value : New value
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void metrics_gauge_set(metrics_gauge_t id, int32_t value)
+{
+    __atomic_store_n(&gauges[id], value, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Function Name: metrics_histogram_record
+ ******************************************************************************
+ * Summary:
+ *  Records a value into the bucket of a histogram whose bound it does not
+ *  exceed. Callable from tasks and ISRs.
+ *
+ * Parameters:
+ *  metrics_histogram_t id : Histogram
+ *  uint32_t value : Value to be recorded
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void metrics_histogram_record(metrics_histogram_t id, uint32_t value)
+{
+    const uint32_t *bounds = histogram_infos[id].bounds;
+    uint32_t bucket = 0;
+
+    while ((bucket < (METRICS_HISTOGRAM_BUCKETS - 1u)) && (value > bounds[bucket]))
+    {
+        bucket++;
+    }
+
+    (void)__atomic_fetch_add(&histogram_buckets[id][bucket], 1u, __ATOMIC_RELAXED);
+    (void)__atomic_fetch_add(&histogram_sums[id], value, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Function Name: metrics_encode_binary
+ ******************************************************************************
+ * Summary:
+ *  Writes a binary snapshot of all metrics: the version byte, the schema id
+ *  as 4 bytes little-endian and the uptime, followed by the counters, the
+ *  gauges zigzag-encoded, and for every histogram its sum and the counts of
+ *  its buckets, all in registry order and as unsigned LEB128 varints.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  uint32_t schema_id : Value of metrics_schema_id() for the schema
+ *  uint32_t uptime_ms : Uptime at the snapshot
+ *
+ * Return:
+ *  size_t : Length of the snapshot, 0 if it does not fit
+ *
+ ******************************************************************************/
+size_t metrics_encode_binary(uint8_t *buf, size_t size, uint32_t schema_id, uint32_t uptime_ms)
+{
+    size_t len = 0;
+    bool ok = put_byte(buf, size, &len, METRICS_BINARY_VERSION);
+    int32_t gauge;
+
+    for (uint32_t shift = 0; shift < 32u; shift += 8u)
+    {
+        ok = ok && put_byte(buf, size, &len, (uint8_t)(schema_id >> shift));
+    }
+    ok = ok && put_varint(buf, size, &len, uptime_ms);
+
+    for (uint32_t i = 0; i < METRICS_COUNTER_COUNT; i++)
+    {
+        ok = ok && put_varint(buf, size, &len, __atomic_load_n(&counters[i], __ATOMIC_RELAXED));
+    }
+    for (uint32_t i = 0; i < METRICS_GAUGE_COUNT; i++)
+    {
+        gauge = __atomic_load_n(&gauges[i], __ATOMIC_RELAXED);
+        ok = ok && put_varint(buf, size, &len,
+                              ((uint32_t)gauge << 1) ^ (uint32_t)(gauge >> 31));
+    }
+    for (uint32_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++)
+    {
+        ok = ok && put_varint(buf, size, &len,
+                              __atomic_load_n(&histogram_sums[i], __ATOMIC_RELAXED));
+        for (uint32_t bucket = 0; bucket < METRICS_HISTOGRAM_BUCKETS; bucket++)
+        {
+            ok = ok && put_varint(buf, size, &len,
+                                  __atomic_load_n(&histogram_buckets[i][bucket], __ATOMIC_RELAXED));
+        }
+    }
+
+    return ok ? len : 0;
+}
+
+/******************************************************************************
+ * Function Name: metrics_encode_prometheus
+ ******************************************************************************
+ * Summary:
+ *  Writes a snapshot of all metrics in the Prometheus text exposition
+ *  format, with cumulative histogram buckets.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Length of the text without the terminator, 0 if it does not fit
+ *
+ ******************************************************************************/
+size_t metrics_encode_prometheus(char *buf, size_t size)
+{
+    size_t len = 0;
+    bool ok = true;
+    const metrics_histogram_info_t *info;
+    uint32_t cumulative;
+
+    for (uint32_t i = 0; i < METRICS_COUNTER_COUNT; i++)
+    {
+        ok = ok && append(buf, size, &len, "# TYPE %s counter\n%s %lu\n",
+                          counter_names[i], counter_names[i],
+                          (unsigned long)__atomic_load_n(&counters[i], __ATOMIC_RELAXED));
+    }
+    for (uint32_t i = 0; i < METRICS_GAUGE_COUNT; i++)
+    {
+        ok = ok && append(buf, size, &len, "# TYPE %s gauge\n%s %ld\n",
+                          gauge_names[i], gauge_names[i],
+                          (long)__atomic_load_n(&gauges[i], __ATOMIC_RELAXED));
+    }
+    for (uint32_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++)
+    {
+        info = &histogram_infos[i];
+        cumulative = 0;
+        ok = ok && append(buf, size, &len, "# TYPE %s histogram\n", info->name);
+        for (uint32_t bucket = 0; bucket < METRICS_HISTOGRAM_BUCKETS; bucket++)
+        {
+            cumulative += __atomic_load_n(&histogram_buckets[i][bucket], __ATOMIC_RELAXED);
+            if (bucket < (METRICS_HISTOGRAM_BUCKETS - 1u))
+            {
+                ok = ok && append(buf, size, &len, "%s_bucket{le=\"%lu\"} %lu\n", info->name,
+                                  (unsigned long)info->bounds[bucket], (unsigned long)cumulative);
+            }
+            else
+            {
+                ok = ok && append(buf, size, &len, "%s_bucket{le=\"+Inf\"} %lu\n", info->name,
+                                  (unsigned long)cumulative);
+            }
+        }
+        ok = ok && append(buf, size, &len, "%s_sum %lu\n%s_count %lu\n",
+                          info->name,
+                          (unsigned long)__atomic_load_n(&histogram_sums[i], __ATOMIC_RELAXED),
+                          info->name, (unsigned long)cumulative);
+    }
+
+    return ok ? len : 0;
+}
+
+/******************************************************************************
+ * Function Name: metrics_encode_schema
+ ******************************************************************************
+ * Summary:
+ *  Writes the schema of the binary snapshot: one line per metric in registry
+ *  order, "counter <name>", "gauge <name>" or "histogram <name>" followed by
+ *  the bucket bounds.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Length of the text without the terminator, 0 if it does not fit
+ *
+ ******************************************************************************/
+size_t metrics_encode_schema(char *buf, size_t size)
+{
+    size_t len = 0;
+    bool ok = true;
+
+    for (uint32_t i = 0; i < METRICS_COUNTER_COUNT; i++)
+    {
+        ok = ok && append(buf, size, &len, "counter %s\n", counter_names[i]);
+    }
+    for (uint32_t i = 0; i < METRICS_GAUGE_COUNT; i++)
+    {
+        ok = ok && append(buf, size, &len, "gauge %s\n", gauge_names[i]);
+    }
+    for (uint32_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++)
+    {
+        ok = ok && append(buf, size, &len, "histogram %s", histogram_infos[i].name);
+        for (uint32_t bucket = 0; bucket < (METRICS_HISTOGRAM_BUCKETS - 1u); bucket++)
+        {
+            ok = ok && append(buf, size, &len, " %lu",
+                              (unsigned long)histogram_infos[i].bounds[bucket]);
+        }
+        ok = ok && append(buf, size, &len, "\n");
+    }
+
+    return ok ? len : 0;
+}
+
+/******************************************************************************
+ * Function Name: metrics_schema_id
+ ******************************************************************************
+ * Summary:
+ *  Returns the 32-bit FNV-1a hash of a schema, which binary snapshots carry
+ *  so that a scraper only decodes them with the matching schema.
+ *
+ * Parameters:
+ *  const char *schema : Schema written by metrics_encode_schema()
+ *  size_t len : Length of the schema
+ *
+ * Return:
+ *  uint32_t : Schema id
+ *
+ ******************************************************************************/
+uint32_t metrics_schema_id(const char *schema, size_t len)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t)schema[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/* Appends a byte. Returns false if the buffer is full. */
+static bool put_byte(uint8_t *buf, size_t size, size_t *len, uint8_t value)
+{
+    if (*len >= size)
+    {
+        return false;
+    }
+    buf[(*len)++] = value;
+    return true;
+}
+
+/* Appends an unsigned LEB128 varint: 7 bits per byte, least significant
+ * first, with the top bit set on all bytes but the last.
+ */
+static bool put_varint(uint8_t *buf, size_t size, size_t *len, uint32_t value)
+{
+    while (value >= 0x80u)
+    {
+        if (!put_byte(buf, size, len, (uint8_t)(value | 0x80u)))
+        {
+            return false;
+        }
+        value >>= 7;
+    }
+    return put_byte(buf, size, len, (uint8_t)value);
+}
+
+/* Appends formatted text. Returns false if it does not fit with its
+ * terminator.
+ */
+static bool append(char *buf, size_t size, size_t *len, const char *format, ...)
+{
+    va_list args;
+    int written;
+
+    va_start(args, format);
+    written = vsnprintf(&buf[*len], size - *len, format, args);
+    va_end(args);
+
+    if ((written < 0) || ((size_t)written >= (size - *len)))
+    {
+        return false;
+    }
+    *len += (size_t)written;
+    return true;
+}
+
+#endif /* ENABLE_METRICS */
+
+/* [] END OF FILE */
@@ -0,0 +1,81 @@
+/******************************************************************************
+* File Name:   metrics.h
+*
+* Description: This file is the public interface of metrics.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Buckets of every histogram, the last one without upper bound. */
+#define METRICS_HISTOGRAM_BUCKETS         (8u)
+
+/* First byte of a binary snapshot. */
+#define METRICS_BINARY_VERSION            (1u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Counters, which only increase. */
+typedef enum
+{
+    METRIC_MQTT_PUBLISHES,
+    METRIC_MQTT_PUBLISH_FAILURES,
+    METRIC_MQTT_CONNECT_FAILURES,
+    METRIC_MQTT_RECONNECTS,
+    METRIC_ISR_DROPS,
+    METRIC_RENDER_DROPS,
+    METRIC_RADAR_EDGES,
+    METRIC_DEADLINE_MISSES,
+    METRICS_COUNTER_COUNT
+} metrics_counter_t;
+
+/* Gauges, which hold the last value set. */
+typedef enum
+{
+    METRIC_HEAP_FREE_BYTES,
+    METRIC_HEAP_FREE_MIN_BYTES,
+    METRICS_GAUGE_COUNT
+} metrics_gauge_t;
+
+/* Histograms with fixed bucket bounds. */
+typedef enum
+{
+    METRIC_MQTT_PUBLISH_US,
+    METRIC_MQTT_CONNECT_MS,
+    METRICS_HISTOGRAM_COUNT
+} metrics_histogram_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_METRICS
+void metrics_counter_add(metrics_counter_t id, uint32_t value);
+void metrics_gauge_set(metrics_gauge_t id, int32_t value);
+void metrics_histogram_record(metrics_histogram_t id, uint32_t value);
+size_t metrics_encode_binary(uint8_t *buf, size_t size, uint32_t schema_id, uint32_t uptime_ms);
+size_t metrics_encode_prometheus(char *buf, size_t size);
+size_t metrics_encode_schema(char *buf, size_t size);
+uint32_t metrics_schema_id(const char *schema, size_t len);
+#else
+#define metrics_counter_add(id, value)      do { (void)(value); } while (0)
+#define metrics_gauge_set(id, value)        do { (void)(value); } while (0)
+#define metrics_histogram_record(id, value) do { (void)(value); } while (0)
+#endif /* ENABLE_METRICS */
+
+#define metrics_counter_inc(id)           metrics_counter_add((id), 1u)
+
+#endif /* METRICS_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,219 @@
+/******************************************************************************
+* File Name:   metrics_task.c
+*
+* Description: This file contains the task that exports the metrics registry.
+*              Every METRICS_EXPORT_INTERVAL_MS it updates the heap gauges
+*              and hands one snapshot of all metrics to the publisher task,
+*              which publishes it on MQTT_METRICS_TOPIC through the
+*              configured transport. With the binary format, the schema is
+*              published on MQTT_METRICS_SCHEMA_TOPIC as well.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "metrics_task.h"
+#include "publisher_task.h"
+#include "app_time.h"
+
+/* Configuration file for MQTT client */
+#include "mqtt_client_config.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+#if ENABLE_METRICS
+
+/* The whole snapshot must fit into one PUBLISH packet with its topic. */
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_TCP) && ((METRICS_EXPORT_BUFFER_SIZE + 64) > MQTT_NETWORK_BUFFER_SIZE)
+#error "METRICS_EXPORT_BUFFER_SIZE does not fit into MQTT_NETWORK_BUFFER_SIZE."
+#endif
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Snapshot and schema, read by the publisher task until the next export. */
+static uint8_t snapshot[METRICS_EXPORT_BUFFER_SIZE];
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_BINARY)
+static char schema[METRICS_EXPORT_BUFFER_SIZE];
+static size_t schema_len;
+static uint32_t schema_id;
+#endif
+
+/* Statistics, and their copy for other tasks. */
+static metrics_export_stats_t stats;
+static metrics_export_stats_t last_stats;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void update_heap_gauges(void);
+static bool export_snapshot(uint32_t exports);
+void get_heap_usage(uint32_t *heap_size, uint32_t *max_used, uint32_t *in_use);
+
+/******************************************************************************
+ * Function Name: metrics_task
+ ******************************************************************************
+ * Summary:
+ *  Exports a snapshot of the metrics every METRICS_EXPORT_INTERVAL_MS while
+ *  the publisher task runs.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void metrics_task(void *pvParameters)
+{
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_BINARY)
+    schema_len = metrics_encode_schema(schema, sizeof(schema));
+    schema_id = metrics_schema_id(schema, schema_len);
+    if (schema_len == 0)
+    {
+        printf("Metrics: the schema does not fit into METRICS_EXPORT_BUFFER_SIZE\n");
+        vTaskSuspend(NULL);
+    }
+#endif
+
+    while (true)
+    {
+        app_time_delay_ms(METRICS_EXPORT_INTERVAL_MS);
+
+        update_heap_gauges();
+        if (export_snapshot(stats.exports))
+        {
+            stats.exports++;
+        }
+        else
+        {
+            stats.failed++;
+        }
+
+        taskENTER_CRITICAL();
+        last_stats = stats;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/******************************************************************************
+ * Function Name: metrics_task_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the number of exported and failed snapshots.
+ *
+ * Parameters:
+ *  metrics_export_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void metrics_task_get_stats(metrics_export_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* Sets the free heap and its low-water mark since start-up. */
+static void update_heap_gauges(void)
+{
+    uint32_t heap_size;
+    uint32_t max_used;
+    uint32_t in_use;
+
+    get_heap_usage(&heap_size, &max_used, &in_use);
+    metrics_gauge_set(METRIC_HEAP_FREE_BYTES, (int32_t)(heap_size - in_use));
+    metrics_gauge_set(METRIC_HEAP_FREE_MIN_BYTES, (int32_t)(heap_size - max_used));
+}
+
+/* Encodes a snapshot and queues it to the publisher task, preceded by the
+ * schema for the first snapshot and every METRICS_SCHEMA_INTERVAL snapshots.
+ * Returns false if the snapshot does not fit or was not queued.
+ */
+static bool export_snapshot(uint32_t exports)
+{
+    publisher_data_t publisher_q_data;
+    size_t len;
+
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_BINARY)
+    len = metrics_encode_binary(snapshot, sizeof(snapshot), schema_id, app_time_now_ms());
+#else
+    len = metrics_encode_prometheus((char *)snapshot, sizeof(snapshot));
+    (void)exports;
+#endif
+    stats.last_bytes = (uint32_t)len;
+    if (len == 0)
+    {
+        printf("Metrics: the snapshot does not fit into METRICS_EXPORT_BUFFER_SIZE\n");
+        return false;
+    }
+
+#if (METRICS_EXPORT_FORMAT == METRICS_FORMAT_BINARY)
+    if ((exports % METRICS_SCHEMA_INTERVAL) == 0u)
+    {
+        publisher_q_data.cmd = PUBLISH_METRICS_SCHEMA;
+        publisher_q_data.data = schema;
+        publisher_q_data.data_len = schema_len;
+        if (!publisher_task_send(&publisher_q_data, 0))
+        {
+            return false;
+        }
+    }
+#endif
+
+    publisher_q_data.cmd = PUBLISH_METRICS;
+    publisher_q_data.data = (char *)snapshot;
+    publisher_q_data.data_len = len;
+    return publisher_task_send(&publisher_q_data, 0);
+}
+
+/******************************************************************************
+ * Function Name: metrics_task_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the exported and failed snapshots for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t metrics_task_format_stats(char *buf, size_t size)
+{
+    metrics_export_stats_t stats;
+    int len;
+
+    metrics_task_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "metrics_exports %lu failed %lu last_bytes %lu\n",
+                   (unsigned long)stats.exports,
+                   (unsigned long)stats.failed,
+                   (unsigned long)stats.last_bytes);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_METRICS */
+
+/* [] END OF FILE */
@@ -0,0 +1,47 @@
+/******************************************************************************
+* File Name:   metrics_task.h
+*
+* Description: This file is the public interface of metrics_task.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef METRICS_TASK_H_
+#define METRICS_TASK_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "metrics.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Metrics Task. */
+#define METRICS_TASK_PRIORITY             (1)
+#define METRICS_TASK_STACK_SIZE           (1024 * 1)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Statistics of the export. */
+typedef struct
+{
+    uint32_t exports;           /* Snapshots handed to the publisher task */
+    uint32_t failed;            /* Snapshots too large or not queued */
+    uint32_t last_bytes;        /* Size of the last snapshot */
+} metrics_export_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_METRICS
+void metrics_task(void *pvParameters);
+void metrics_task_get_stats(metrics_export_stats_t *stats);
+size_t metrics_task_format_stats(char *buf, size_t size);
+#endif /* ENABLE_METRICS */
+
+#endif /* METRICS_TASK_H_ */
+
+/* [] END OF FILE */
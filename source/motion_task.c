@@ -42,6 +42,8 @@
 
 #include "mtb_bmi160.h"
 #include "motion_task.h"
+#include "render_server.h"
+#include "isr_signal.h"
 #include "cy_pdl.h"
 #include "cyhal.h"
 #include "cybsp.h"
@@ -192,6 +194,7 @@ static void task_motion(void* pvParameters)
 
     /* Variable used to store the orientation information */
     orientation_t orientation;
+    orientation_t last_orientation = ORIENTATION_NULL;
 
     /* Remove warning for unused parameter */
     (void)pvParameters;
@@ -214,6 +217,7 @@ static void task_motion(void* pvParameters)
     printf(" BMI160 Motion Sensor successfully initialized.\n");
 
     /* Configure orientation interrupt and suspend the task upon failure */
+    (void)isr_signal_register(ISR_SIGNAL_BMI160, motion_sensor_task_handle, 0, 0);
     result = motionsensor_config_interrupt();
     CHECK_RESULT(result, " Error : Motion Sensor interrupt configuration failed !!\n [Error code: 0x%lx]\n", (long unsigned int)result);
     printf(" BMI160 Motion Sensor interrupts successfully configured and enabled.\n\n\n");
@@ -250,10 +254,18 @@ static void task_motion(void* pvParameters)
                 break;
         }
 
+        /* Show the orientation on the display through the render server. */
+        render_set_field(RENDER_FIELD_MOTION, (int16_t)orientation);
+        if ((last_orientation != ORIENTATION_NULL) && (orientation != last_orientation))
+        {
+            render_show_alert("Motion detected");
+        }
+        last_orientation = orientation;
+
         /* Wait for notification from ISR. The ISR will notify the task upon
          * receiving interrupt from the Motion Sensor on orientation change.
          */
-        xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
+        (void)isr_signal_wait(portMAX_DELAY);
     }
 }
 
@@ -310,7 +322,7 @@ static cy_rslt_t motionsensor_init(void)
 ********************************************************************************
 * Summary:
 *  Interrupt service routine(ISR) for orientation interrupts from BMI160 sensor.
-*  The ISR notifies the Motion sensor task.
+*  The ISR signals the Motion sensor task through the ISR signal layer.
 *
 * Parameters:
 *  void *handler_arg            : Pointer to variable passed to the ISR (unused)
@@ -322,6 +334,7 @@ static cy_rslt_t motionsensor_init(void)
 *******************************************************************************/
 static void motionsensor_interrupt_handler(void *handler_arg, cyhal_gpio_event_t event)
 {
+    uint32_t entry_cycles = isr_signal_timestamp();
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
     /* To avoid compiler warnings */
@@ -329,7 +342,7 @@ static void motionsensor_interrupt_handler(void *handler_arg, cyhal_gpio_event_t
     (void)event;
 
     /* Notify the Motion sensor task */
-    xTaskNotifyFromISR(motion_sensor_task_handle, 0, eNoAction, &xHigherPriorityTaskWoken);
+    isr_signal_from_isr(ISR_SIGNAL_BMI160, entry_cycles, NULL, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
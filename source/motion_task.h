@@ -46,6 +46,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "cybsp.h"
+#include "irq_priority_config.h"
 
 /*******************************************************************************
 * Macros
@@ -85,7 +86,7 @@
 ********************************************************************************/
 /* Interrupt pin initial value and interrupt priority */
 #define BMI160_INTERRUPT_PIN_INITVAL    (0u)
-#define BMI160_INTERRUPT_PRIORITY       (5u)
+#define BMI160_INTERRUPT_PRIORITY       (IRQ_PRIORITY_BMI160)
 
 /* Task priority and stack size for the Motion sensor task */
 #define TASK_MOTION_SENSOR_PRIORITY     (configMAX_PRIORITIES - 1)
@@ -0,0 +1,149 @@
+/******************************************************************************
+* File Name:   mpsc_queue.c
+*
+* Description: This file contains a bounded lock-free queue for many producers
+*              and one consumer. Every slot carries a sequence number: a
+*              producer claims a slot by advancing the enqueue position with a
+*              compare-and-swap (LDREX/STREX on the CM4), copies its element
+*              and then publishes the slot by advancing its sequence number.
+*              Producers never block and never take a lock, so tasks of any
+*              priority and interrupt handlers can push. A producer that is
+*              preempted between claiming and publishing its slot only holds
+*              back the consumer, never another producer.
+*
+*              The queue has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "mpsc_queue.h"
+
+/******************************************************************************
+ * Function Name: mpsc_queue_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes an empty queue on caller-provided storage.
+ *
+ * Parameters:
+ *  mpsc_queue_t *queue : Queue to be initialized
+ *  uint32_t *sequence : Storage for 'length' sequence numbers
+ *  void *buffer : Storage for 'length' elements
+ *  size_t element_size : Size of one element in bytes
+ *  uint32_t length : Number of elements, a power of two
+ *
+ * Return:
+ *  bool : true on success, false if 'length' is not a power of two.
+ *
+ ******************************************************************************/
+bool mpsc_queue_init(mpsc_queue_t *queue, uint32_t *sequence, void *buffer,
+                     size_t element_size, uint32_t length)
+{
+    if ((length == 0) || ((length & (length - 1u)) != 0))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        sequence[i] = i;
+    }
+
+    queue->sequence = sequence;
+    queue->buffer = (uint8_t *)buffer;
+    queue->element_size = element_size;
+    queue->mask = length - 1u;
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: mpsc_queue_push
+ ******************************************************************************
+ * Summary:
+ *  Appends an element. Safe to call from any task or interrupt handler.
+ *
+ * Parameters:
+ *  mpsc_queue_t *queue : Queue
+ *  const void *element : Element to be copied into the queue
+ *
+ * Return:
+ *  bool : true if the element was queued, false if the queue is full.
+ *
+ ******************************************************************************/
+bool mpsc_queue_push(mpsc_queue_t *queue, const void *element)
+{
+    uint32_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    uint32_t seq;
+    int32_t diff;
+
+    while (true)
+    {
+        seq = __atomic_load_n(&queue->sequence[pos & queue->mask], __ATOMIC_ACQUIRE);
+        diff = (int32_t)(seq - pos);
+
+        if (diff == 0)
+        {
+            /* The slot is free; claim it unless another producer was faster. */
+            if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1u, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The slot still holds an element that was not consumed. */
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(&queue->buffer[(pos & queue->mask) * queue->element_size], element,
+           queue->element_size);
+    __atomic_store_n(&queue->sequence[pos & queue->mask], pos + 1u, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: mpsc_queue_pop
+ ******************************************************************************
+ * Summary:
+ *  Removes the oldest published element. Must only be called by the single
+ *  consumer.
+ *
+ * Parameters:
+ *  mpsc_queue_t *queue : Queue
+ *  void *element : Output element
+ *
+ * Return:
+ *  bool : true if an element was removed, false if none is published.
+ *
+ ******************************************************************************/
+bool mpsc_queue_pop(mpsc_queue_t *queue, void *element)
+{
+    uint32_t pos = queue->dequeue_pos;
+    uint32_t seq = __atomic_load_n(&queue->sequence[pos & queue->mask], __ATOMIC_ACQUIRE);
+
+    if ((int32_t)(seq - (pos + 1u)) < 0)
+    {
+        return false;
+    }
+
+    memcpy(element, &queue->buffer[(pos & queue->mask) * queue->element_size],
+           queue->element_size);
+    __atomic_store_n(&queue->sequence[pos & queue->mask], pos + queue->mask + 1u,
+                     __ATOMIC_RELEASE);
+    queue->dequeue_pos = pos + 1u;
+
+    return true;
+}
+
+/* [] END OF FILE */
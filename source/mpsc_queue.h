@@ -0,0 +1,43 @@
+/******************************************************************************
+* File Name:   mpsc_queue.h
+*
+* Description: This file is the public interface of mpsc_queue.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Bounded multi-producer, single-consumer queue of fixed-size elements. All
+ * fields are private to mpsc_queue.c.
+ */
+typedef struct
+{
+    uint32_t *sequence;
+    uint8_t *buffer;
+    size_t element_size;
+    uint32_t mask;
+    uint32_t enqueue_pos;
+    uint32_t dequeue_pos;
+} mpsc_queue_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+bool mpsc_queue_init(mpsc_queue_t *queue, uint32_t *sequence, void *buffer,
+                     size_t element_size, uint32_t length);
+bool mpsc_queue_push(mpsc_queue_t *queue, const void *element);
+bool mpsc_queue_pop(mpsc_queue_t *queue, void *element);
+
+#endif /* MPSC_QUEUE_H_ */
+
+/* [] END OF FILE */
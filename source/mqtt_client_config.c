@@ -42,8 +42,18 @@
 
 #include <stdio.h>
 #include "mqtt_client_config.h"
+#include "metrics_config.h"
 #include "cy_mqtt_api.h"
 
+#if (MQTT_SECURE_CONNECTION)
+#include "mbedtls/ssl.h"
+#include "credentials_config.h"
+#if ENABLE_DER_CREDENTIALS
+/* Generated by the PREBUILD step from the PEM credentials below. */
+#include "mqtt_credentials_der.h"
+#endif
+#endif
+
 /******************************************************************************
 * Global Variables
 *******************************************************************************/
@@ -60,7 +70,10 @@ cy_mqtt_broker_info_t broker_info =
 static cy_awsport_ssl_credentials_t credentials =
 {
     /* Configure the client certificate. */
-#ifdef CLIENT_CERTIFICATE
+#if ENABLE_DER_CREDENTIALS && defined(CLIENT_CERTIFICATE_DER)
+    .client_cert = (const char *)CLIENT_CERTIFICATE_DER,
+    .client_cert_size = sizeof(CLIENT_CERTIFICATE_DER),
+#elif defined(CLIENT_CERTIFICATE)
     .client_cert = (const char *)CLIENT_CERTIFICATE,
     .client_cert_size = sizeof(CLIENT_CERTIFICATE),
 #else
@@ -69,7 +82,10 @@ static cy_awsport_ssl_credentials_t credentials =
 #endif
 
     /* Configure the client private key. */
-#ifdef CLIENT_PRIVATE_KEY
+#if ENABLE_DER_CREDENTIALS && defined(CLIENT_PRIVATE_KEY_DER)
+    .private_key = (const char *)CLIENT_PRIVATE_KEY_DER,
+    .private_key_size = sizeof(CLIENT_PRIVATE_KEY_DER),
+#elif defined(CLIENT_PRIVATE_KEY)
     .private_key = (const char *)CLIENT_PRIVATE_KEY,
     .private_key_size = sizeof(CLIENT_PRIVATE_KEY),
 #else
@@ -78,7 +94,10 @@ static cy_awsport_ssl_credentials_t credentials =
 #endif
 
     /* Configure the Root CA certificate of the MQTT Broker/Server. */
-#ifdef ROOT_CA_CERTIFICATE
+#if ENABLE_DER_CREDENTIALS && defined(ROOT_CA_CERTIFICATE_DER)
+    .root_ca = (const char *)ROOT_CA_CERTIFICATE_DER,
+    .root_ca_size = sizeof(ROOT_CA_CERTIFICATE_DER),
+#elif defined(ROOT_CA_CERTIFICATE)
     .root_ca = (const char *)ROOT_CA_CERTIFICATE,
     .root_ca_size = sizeof(ROOT_CA_CERTIFICATE),
 #else
@@ -157,5 +176,21 @@ cy_mqtt_connect_info_t connection_info =
     #error "Invalid QoS setting! MQTT_MESSAGES_QOS must be either 0 or 1."
 #endif
 
+/* Largest PUBLISH payload the client sends: a metrics snapshot or schema, or
+ * an RPC response chunk with its header. The device state and actuation
+ * messages, the RTT probes and the burst buffer copies are shorter.
+ */
+#define MQTT_MAX_PUBLISH_PAYLOAD_SIZE \
+    ((METRICS_EXPORT_BUFFER_SIZE > (MQTT_RPC_CHUNK_HEADER_SIZE + MQTT_RPC_CHUNK_SIZE)) ? \
+     METRICS_EXPORT_BUFFER_SIZE : (MQTT_RPC_CHUNK_HEADER_SIZE + MQTT_RPC_CHUNK_SIZE))
+
+/* The MQTT library sends the payload of a PUBLISH in its own write, which
+ * mbedTLS encrypts into its own record. Check that the largest payload fits in
+ * one outgoing TLS record.
+ */
+#if (MQTT_SECURE_CONNECTION) && (MQTT_MAX_PUBLISH_PAYLOAD_SIZE > MBEDTLS_SSL_OUT_CONTENT_LEN)
+    #error "The largest PUBLISH payload must not exceed MBEDTLS_SSL_OUT_CONTENT_LEN in mbedtls_user_config.h."
+#endif
+
 
 /* [] END OF FILE */
@@ -0,0 +1,586 @@
+/******************************************************************************
+* File Name:   mqtt_rpc.c
+*
+* Description: This file contains the MQTT request/response RPC layer used for
+*              remote diagnostics. Requests are received on
+*              'MQTT_RPC_REQUEST_TOPIC' in the form "<correlation id> <command>"
+*              and are handled by a low priority task. Every response is
+*              streamed on 'MQTT_RPC_RESPONSE_TOPIC' in chunks of at most
+*              'MQTT_RPC_CHUNK_SIZE' bytes, each prefixed with the header
+*              "<correlation id> <chunk index>/<chunk count>\n".
+*
+*              The handlers only use statically allocated buffers.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Task header files */
+#include "mqtt_rpc.h"
+#include "mqtt_task.h"
+#include "publisher_task.h"
+#include "subscriber_task.h"
+#include "presence_history.h"
+#include "sensor_scheduler.h"
+#include "effect_sequencer.h"
+#include "render_server.h"
+#include "wifi_roam.h"
+#include "occupancy_task.h"
+#include "actuation_task.h"
+#include "metrics_task.h"
+#include "rtt_probe.h"
+#include "nn_task.h"
+#include "latency_probe.h"
+#include "isr_signal.h"
+#include "deadline_monitor.h"
+#include "app_time.h"
+#include "app_heap.h"
+
+/* Configuration file for MQTT client */
+#include "mqtt_client_config.h"
+
+/* Middleware libraries */
+#include "cy_mqtt_api.h"
+#include "cy_retarget_io.h"
+
+#if ENABLE_MQTT_RPC
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Queue length of the message queue holding pending RPC requests. Requests
+ * received while the queue is full are dropped.
+ */
+#define MQTT_RPC_QUEUE_LENGTH             (4u)
+
+/* Longest accepted request payload. */
+#define MQTT_RPC_MAX_REQUEST_LEN          (48u)
+
+/* Size of the buffer holding a complete response before it is chunked. */
+#define MQTT_RPC_RESPONSE_BUFFER_SIZE     (PRESENCE_HISTORY_MAX_ENCODED_SIZE)
+
+/* Maximum number of tasks listed by get-task-list. */
+#define MQTT_RPC_MAX_TASKS                (16u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Request passed from the subscription callback to the RPC task. */
+typedef struct
+{
+    uint32_t correlation_id;
+    char command[MQTT_RPC_MAX_REQUEST_LEN];
+} mqtt_rpc_request_t;
+
+/* Handler producing the response of one command into 'buf'. Returns the
+ * response length in bytes.
+ */
+typedef size_t (*mqtt_rpc_handler_t)(char *buf, size_t size);
+
+typedef struct
+{
+    const char *name;
+    mqtt_rpc_handler_t handler;
+} mqtt_rpc_command_t;
+
+/* One entry of the trace buffer. */
+typedef struct
+{
+    uint32_t timestamp_ms;
+    uint32_t arg;
+    mqtt_rpc_trace_event_t event;
+} mqtt_rpc_trace_entry_t;
+
+/* Task handle for this task. */
+TaskHandle_t mqtt_rpc_task_handle;
+
+/* Handle of the queue holding the pending RPC requests. */
+static QueueHandle_t mqtt_rpc_task_q;
+
+/* Response and chunk buffers. */
+static uint8_t response_buffer[MQTT_RPC_RESPONSE_BUFFER_SIZE];
+static uint8_t chunk_buffer[MQTT_RPC_CHUNK_HEADER_SIZE + MQTT_RPC_CHUNK_SIZE];
+
+/* Task status array used by get-task-list. */
+static TaskStatus_t task_status[MQTT_RPC_MAX_TASKS];
+
+/* Trace buffer filled between trace-start and trace-stop. */
+static mqtt_rpc_trace_entry_t trace_buffer[MQTT_RPC_TRACE_LENGTH];
+static volatile uint32_t trace_count;
+static volatile bool trace_active;
+
+/* Structure to store the RPC response publish information. */
+static cy_mqtt_publish_info_t response_info =
+{
+    .qos = CY_MQTT_QOS1,
+    .topic = MQTT_RPC_RESPONSE_TOPIC,
+    .topic_len = (sizeof(MQTT_RPC_RESPONSE_TOPIC) - 1),
+    .retain = false,
+    .dup = false
+};
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static size_t rpc_get_stats(char *buf, size_t size);
+static size_t rpc_get_heap(char *buf, size_t size);
+static size_t rpc_get_task_list(char *buf, size_t size);
+static size_t rpc_get_conn(char *buf, size_t size);
+static size_t rpc_trace_start(char *buf, size_t size);
+static size_t rpc_trace_stop(char *buf, size_t size);
+static size_t rpc_dump_history(char *buf, size_t size);
+static size_t rpc_format_uptime(char *buf, size_t size);
+static void send_response(uint32_t correlation_id, const uint8_t *data, size_t len);
+void get_heap_usage(uint32_t *heap_size, uint32_t *max_used, uint32_t *in_use);
+
+/* Table of the supported commands. */
+static const mqtt_rpc_command_t rpc_commands[] =
+{
+    { "get-stats",     rpc_get_stats     },
+    { "get-heap",      rpc_get_heap      },
+    { "get-task-list", rpc_get_task_list },
+    { "get-conn",      rpc_get_conn      },
+    { "trace-start",   rpc_trace_start   },
+    { "trace-stop",    rpc_trace_stop    },
+    { "dump-history",  rpc_dump_history  }
+};
+
+/* Sections of the get-stats response, in output order. Each one writes its
+ * lines into 'buf' of 'size' bytes and returns the number of characters
+ * written.
+ */
+static const mqtt_rpc_handler_t stats_formatters[] =
+{
+    rpc_format_uptime,
+    publisher_format_stats,
+    sensor_scheduler_format_stats,
+    render_server_format_stats,
+    mqtt_task_format_stats,
+    subscriber_task_format_stats,
+#if ENABLE_WIFI_ROAMING
+    wifi_roam_format_stats,
+#endif
+#if ENABLE_OCCUPANCY_PREDICTOR
+    occupancy_format_stats,
+#endif
+#if ENABLE_RTT_PROBE
+    rtt_probe_format_stats,
+#endif
+#if ENABLE_METRICS
+    metrics_task_format_stats,
+#endif
+#if ENABLE_ACTUATION_VERIFIER
+    actuation_format_stats,
+#endif
+#if ENABLE_EFFECT_SEQUENCER
+    effect_sequencer_format_stats,
+#endif
+#if ENABLE_EDGE_CLASSIFIER
+    publisher_format_edge_classifier_stats,
+#endif
+#if ENABLE_NN_CLASSIFIER
+    nn_task_format_stats,
+#endif
+    isr_signal_format_stats,
+#if ENABLE_DEADLINE_MONITOR
+    deadline_monitor_format_stats,
+#endif
+#if ENABLE_LATENCY_PROBE
+    latency_probe_format_stats,
+#endif
+};
+
+/******************************************************************************
+ * Function Name: mqtt_rpc_task
+ ******************************************************************************
+ * Summary:
+ *  Task that executes the RPC requests queued by the subscription callback and
+ *  streams the responses back to the MQTT broker.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void mqtt_rpc_task(void *pvParameters)
+{
+    mqtt_rpc_request_t request;
+    size_t response_len;
+    size_t i;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    /* Create a message queue to receive requests from the subscription callback. */
+    mqtt_rpc_task_q = xQueueCreate(MQTT_RPC_QUEUE_LENGTH, sizeof(mqtt_rpc_request_t));
+
+    while (true)
+    {
+        if (pdTRUE == xQueueReceive(mqtt_rpc_task_q, &request, portMAX_DELAY))
+        {
+            for (i = 0; i < (sizeof(rpc_commands) / sizeof(rpc_commands[0])); i++)
+            {
+                if (strcmp(rpc_commands[i].name, request.command) == 0)
+                {
+                    break;
+                }
+            }
+
+            if (i < (sizeof(rpc_commands) / sizeof(rpc_commands[0])))
+            {
+                response_len = rpc_commands[i].handler((char *)response_buffer,
+                                                       sizeof(response_buffer));
+            }
+            else
+            {
+                response_len = (size_t)snprintf((char *)response_buffer, sizeof(response_buffer),
+                                                "error: unknown command '%s'\n", request.command);
+            }
+
+            send_response(request.correlation_id, response_buffer,
+                          (response_len < sizeof(response_buffer)) ? response_len : sizeof(response_buffer));
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: mqtt_rpc_is_request
+ ******************************************************************************
+ * Summary:
+ *  Checks whether an incoming MQTT message was received on the RPC request
+ *  topic.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *received_msg_info : Information structure of
+ *                                                    the received MQTT message
+ *
+ * Return:
+ *  bool : true if the message is an RPC request
+ *
+ ******************************************************************************/
+bool mqtt_rpc_is_request(const cy_mqtt_publish_info_t *received_msg_info)
+{
+    return (received_msg_info->topic_len == (sizeof(MQTT_RPC_REQUEST_TOPIC) - 1)) &&
+           (strncmp(received_msg_info->topic, MQTT_RPC_REQUEST_TOPIC,
+                    received_msg_info->topic_len) == 0);
+}
+
+/******************************************************************************
+ * Function Name: mqtt_rpc_handle_request
+ ******************************************************************************
+ * Summary:
+ *  Parses an RPC request and queues it for the RPC task. This function is
+ *  called from the MQTT library context and therefore never blocks: requests
+ *  are dropped if the RPC task is busy.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *received_msg_info : Information structure of
+ *                                                    the received MQTT message
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void mqtt_rpc_handle_request(const cy_mqtt_publish_info_t *received_msg_info)
+{
+    mqtt_rpc_request_t request;
+    char payload[MQTT_RPC_MAX_REQUEST_LEN];
+    char *command;
+    size_t len = received_msg_info->payload_len;
+
+    if ((mqtt_rpc_task_q == NULL) || (len == 0) || (len >= sizeof(payload)))
+    {
+        printf("  RPC: Ignoring malformed request\n");
+        return;
+    }
+
+    memcpy(payload, received_msg_info->payload, len);
+    payload[len] = '\0';
+
+    request.correlation_id = (uint32_t)strtoul(payload, &command, 10);
+    while (*command == ' ')
+    {
+        command++;
+    }
+
+    if ((command == payload) || (*command == '\0'))
+    {
+        printf("  RPC: Ignoring malformed request\n");
+        return;
+    }
+
+    /* Strip a trailing newline sent by command line clients. */
+    command[strcspn(command, "\r\n")] = '\0';
+    strncpy(request.command, command, sizeof(request.command) - 1);
+    request.command[sizeof(request.command) - 1] = '\0';
+
+    if (pdTRUE != xQueueSend(mqtt_rpc_task_q, &request, 0))
+    {
+        printf("  RPC: Request %lu dropped, RPC task busy\n", (unsigned long)request.correlation_id);
+    }
+}
+
+/******************************************************************************
+ * Function Name: mqtt_rpc_trace
+ ******************************************************************************
+ * Summary:
+ *  Records an event in the trace buffer if a trace is active. Must not be
+ *  called from an ISR.
+ *
+ * Parameters:
+ *  mqtt_rpc_trace_event_t event : Event to be recorded
+ *  uint32_t arg : Event specific argument
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void mqtt_rpc_trace(mqtt_rpc_trace_event_t event, uint32_t arg)
+{
+    if (!trace_active)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if (trace_count < MQTT_RPC_TRACE_LENGTH)
+    {
+        trace_buffer[trace_count].timestamp_ms = app_time_now_ms();
+        trace_buffer[trace_count].event = event;
+        trace_buffer[trace_count].arg = arg;
+        trace_count++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: send_response
+ ******************************************************************************
+ * Summary:
+ *  Publishes a response in chunks of at most 'MQTT_RPC_CHUNK_SIZE' bytes.
+ *  The task yields between the chunks so that equal priority tasks are not
+ *  held off while a large response is streamed.
+ *
+ * Parameters:
+ *  uint32_t correlation_id : Correlation ID of the request
+ *  const uint8_t *data : Response data
+ *  size_t len : Length of the response data
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void send_response(uint32_t correlation_id, const uint8_t *data, size_t len)
+{
+    size_t chunk_count = (len + MQTT_RPC_CHUNK_SIZE - 1u) / MQTT_RPC_CHUNK_SIZE;
+    size_t offset = 0;
+    size_t chunk_len;
+    int header_len;
+    cy_rslt_t result;
+
+    /* An empty response is still acknowledged with one empty chunk. */
+    if (chunk_count == 0)
+    {
+        chunk_count = 1;
+    }
+
+    for (size_t chunk = 0; chunk < chunk_count; chunk++)
+    {
+        chunk_len = ((len - offset) < MQTT_RPC_CHUNK_SIZE) ? (len - offset) : MQTT_RPC_CHUNK_SIZE;
+
+        header_len = snprintf((char *)chunk_buffer, MQTT_RPC_CHUNK_HEADER_SIZE, "%lu %u/%u\n",
+                              (unsigned long)correlation_id, (unsigned int)(chunk + 1u),
+                              (unsigned int)chunk_count);
+        memcpy(&chunk_buffer[header_len], &data[offset], chunk_len);
+
+        response_info.payload = (const char *)chunk_buffer;
+        response_info.payload_len = (size_t)header_len + chunk_len;
+
+        result = cy_mqtt_publish(mqtt_connection, &response_info);
+        if (result != CY_RSLT_SUCCESS)
+        {
+            printf("  RPC: Response publish failed with error 0x%0X.\n", (int)result);
+            break;
+        }
+
+        offset += chunk_len;
+        taskYIELD();
+    }
+}
+
+/******************************************************************************
+ * RPC command handlers
+ ******************************************************************************
+ * Each handler writes its response into 'buf' of 'size' bytes and returns the
+ * number of bytes written.
+ ******************************************************************************/
+static size_t rpc_get_stats(char *buf, size_t size)
+{
+    size_t pos = 0;
+
+    for (uint32_t i = 0; (i < (sizeof(stats_formatters) / sizeof(stats_formatters[0]))) && ((pos + 1u) < size); i++)
+    {
+        pos += stats_formatters[i](&buf[pos], size - pos);
+    }
+
+    return pos;
+}
+
+static size_t rpc_format_uptime(char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "uptime_ms %lu\n",
+                       (unsigned long)app_time_now_ms());
+
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+static size_t rpc_get_heap(char *buf, size_t size)
+{
+    uint32_t heap_size;
+    uint32_t max_used;
+    uint32_t in_use;
+    int len;
+
+    get_heap_usage(&heap_size, &max_used, &in_use);
+    len = snprintf(buf, size,
+                   "heap_size %lu\n"
+                   "heap_max_used %lu\n"
+                   "heap_in_use %lu\n",
+                   (unsigned long)heap_size, (unsigned long)max_used, (unsigned long)in_use);
+
+#if ENABLE_TLSF_HEAP
+    if ((len > 0) && ((size_t)len < size))
+    {
+        len += (int)app_heap_format(&buf[len], size - (size_t)len);
+    }
+#endif
+
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+static size_t rpc_get_task_list(char *buf, size_t size)
+{
+    static const char task_state_char[] = { 'X', 'R', 'B', 'S', 'D', '?' };
+    UBaseType_t task_count;
+    size_t pos = 0;
+    int len;
+
+    task_count = uxTaskGetSystemState(task_status, MQTT_RPC_MAX_TASKS, NULL);
+
+    for (UBaseType_t i = 0; (i < task_count) && (pos < size); i++)
+    {
+        len = snprintf(&buf[pos], size - pos, "%-16s %c prio %lu stack_free %u\n",
+                       task_status[i].pcTaskName,
+                       task_state_char[(task_status[i].eCurrentState <= eDeleted) ?
+                                       task_status[i].eCurrentState : 5],
+                       (unsigned long)task_status[i].uxCurrentPriority,
+                       (unsigned int)task_status[i].usStackHighWaterMark);
+        if (len <= 0)
+        {
+            break;
+        }
+        pos += (size_t)len;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+static size_t rpc_get_conn(char *buf, size_t size)
+{
+    return mqtt_task_format_conn(buf, size);
+}
+
+static size_t rpc_trace_start(char *buf, size_t size)
+{
+    int len;
+
+    taskENTER_CRITICAL();
+    trace_count = 0;
+    trace_active = true;
+    taskEXIT_CRITICAL();
+
+    len = snprintf(buf, size, "trace started, capacity %u\n", (unsigned int)MQTT_RPC_TRACE_LENGTH);
+
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+static size_t rpc_trace_stop(char *buf, size_t size)
+{
+    static const char *const trace_event_name[] =
+    {
+        "publish", "publish-failure", "device-state", "disconnection"
+    };
+    size_t pos = 0;
+    int len;
+
+    trace_active = false;
+
+    for (uint32_t i = 0; (i < trace_count) && (pos < size); i++)
+    {
+        len = snprintf(&buf[pos], size - pos, "%lu %s %lu\n",
+                       (unsigned long)trace_buffer[i].timestamp_ms,
+                       trace_event_name[trace_buffer[i].event],
+                       (unsigned long)trace_buffer[i].arg);
+        if (len <= 0)
+        {
+            break;
+        }
+        pos += (size_t)len;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
+static size_t rpc_dump_history(char *buf, size_t size)
+{
+    presence_history_stats_t stats;
+    size_t len = presence_history_encode((uint8_t *)buf, size, false, &stats);
+
+    printf("  RPC: History dump %lu samples, %lu -> %lu bytes in %lu us\n",
+           (unsigned long)stats.sample_count, (unsigned long)stats.raw_bytes,
+           (unsigned long)stats.encoded_bytes, (unsigned long)stats.encode_time_us);
+
+    return len;
+}
+
+#endif /* ENABLE_MQTT_RPC */
+
+/* [] END OF FILE */
@@ -0,0 +1,63 @@
+/******************************************************************************
+* File Name:   mqtt_rpc.h
+*
+* Description: This file is the public interface of mqtt_rpc.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef MQTT_RPC_H_
+#define MQTT_RPC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cy_mqtt_api.h"
+#include "mqtt_client_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the RPC task. The task runs below the publisher task so
+ * that streaming a response never delays a presence publish.
+ */
+#define MQTT_RPC_TASK_PRIORITY            (1)
+#define MQTT_RPC_TASK_STACK_SIZE          (1024 * 1)
+
+/* Number of trace entries captured between trace-start and trace-stop. */
+#define MQTT_RPC_TRACE_LENGTH             (64u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Events recorded in the RPC trace buffer. */
+typedef enum
+{
+    MQTT_RPC_TRACE_PUBLISH,
+    MQTT_RPC_TRACE_PUBLISH_FAILURE,
+    MQTT_RPC_TRACE_DEVICE_STATE,
+    MQTT_RPC_TRACE_DISCONNECTION
+} mqtt_rpc_trace_event_t;
+
+/*******************************************************************************
+* Extern Variables
+********************************************************************************/
+extern TaskHandle_t mqtt_rpc_task_handle;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void mqtt_rpc_task(void *pvParameters);
+bool mqtt_rpc_is_request(const cy_mqtt_publish_info_t *received_msg_info);
+void mqtt_rpc_handle_request(const cy_mqtt_publish_info_t *received_msg_info);
+#if ENABLE_MQTT_RPC
+void mqtt_rpc_trace(mqtt_rpc_trace_event_t event, uint32_t arg);
+#else
+#define mqtt_rpc_trace(event, arg)        do { (void)(event); (void)(arg); } while (0)
+#endif /* ENABLE_MQTT_RPC */
+
+#endif /* MQTT_RPC_H_ */
+
+/* [] END OF FILE */
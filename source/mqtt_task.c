@@ -2,11 +2,14 @@
 * File Name:   mqtt_task.c
 *
 * Description: This file contains the task that handles initialization & 
-*              connection of Wi-Fi and the MQTT client. The task then starts 
-*              the subscriber and the publisher tasks. The task also implements
-*              reconnection mechanisms to handle WiFi and MQTT disconnections.
-*              The task also handles all the cleanup operations to gracefully 
-*              terminate the Wi-Fi and MQTT connections in case of any failure.
+*              connection of Wi-Fi and the MQTT client. The connection is run
+*              by a table-driven state machine (see conn_fsm.c): every join
+*              and connect attempt, the waits between retries and the
+*              reconnection after a lost connection are transitions of the
+*              table. The task starts the subscriber and the publisher tasks
+*              once connected, and handles all the cleanup operations to
+*              gracefully terminate the Wi-Fi and MQTT connections in case of
+*              any failure.
 *
 * Related Document: See README.md
 *
@@ -44,6 +47,7 @@
 * so agrees to indemnify Cypress against all liability.
 *******************************************************************************/
 
+#include <stdio.h>
 #include "cyhal.h"
 #include "cybsp.h"
 
@@ -55,10 +59,24 @@
 #include "mqtt_task.h"
 #include "subscriber_task.h"
 #include "publisher_task.h"
+#include "mqtt_rpc.h"
+#include "render_server.h"
+#include "wifi_roam.h"
+#include "app_time.h"
+#include "burst_connect.h"
+#include "mqttsn_client.h"
+#include "conn_fsm.h"
+#include "rtt_probe.h"
+#include "isr_signal.h"
+#include "metrics.h"
+#include "deadline_monitor.h"
+#include "wall_clock.h"
 
 /* Configuration file for Wi-Fi and MQTT client */
 #include "wifi_config.h"
 #include "mqtt_client_config.h"
+#include "credentials_config.h"
+#include "deadline_config.h"
 
 /* Middleware libraries */
 #include "cy_retarget_io.h"
@@ -66,6 +84,9 @@
 
 #include "cy_mqtt_api.h"
 #include "clock.h"
+#if (MQTT_SECURE_CONNECTION && ENABLE_ROOT_CA_CACHE)
+#include "cy_tls.h"
+#endif
 
 /* LwIP header files */
 #include "lwip/netif.h"
@@ -73,88 +94,211 @@
 /******************************************************************************
 * Macros
 ******************************************************************************/
-/* Queue length of a message queue that is used to communicate the status of 
+/* Queue length of a message queue that is used to communicate the status of
  * various operations.
  */
 #define MQTT_TASK_QUEUE_LENGTH           (3u)
 
-/* Time in milliseconds to wait before creating the publisher task. */
-#define TASK_CREATION_DELAY_MS           (2000u)
+/* Interval at which the end of a handover between APs is polled. */
+#define ROAM_POLL_INTERVAL_MS            (WIFI_ROAM_MONITOR_INTERVAL_MS / 10u)
 
-/* Flag Masks for tracking which cleanup functions must be called. */
-#define WCM_INITIALIZED                  (1lu << 0)
-#define WIFI_CONNECTED                   (1lu << 1)
-#define LIBS_INITIALIZED                 (1lu << 2)
-#define BUFFER_INITIALIZED               (1lu << 3)
-#define MQTT_INSTANCE_CREATED            (1lu << 4)
-#define MQTT_CONNECTION_SUCCESS          (1lu << 5)
-#define MQTT_MSG_RECEIVED                (1lu << 6)
+/* Sleep duration announced to the MQTT-SN gateway between bursts. It covers
+ * a late burst; the gateway drops the session when it expires.
+ */
+#define BURST_SLEEP_DURATION_S           ((2u * BURST_BATCH_INTERVAL_MS) / 1000u)
 
 /*String that describes the MQTT handle that is being created in order to uniquely identify it*/
 #define MQTT_HANDLE_DESCRIPTOR            "MQTThandleID"
 
-/* Macro to check if the result of an operation was successful and set the 
- * corresponding bit in the status_flag based on 'init_mask' parameter. When 
- * it has failed, print the error message and return the result to the 
- * calling function.
- */
-#define CHECK_RESULT(result, init_mask, error_message...)      \
-                     do                                        \
-                     {                                         \
-                         if ((int)result == CY_RSLT_SUCCESS)   \
-                         {                                     \
-                             status_flag |= init_mask;         \
-                         }                                     \
-                         else                                  \
-                         {                                     \
-                             printf(error_message);            \
-                             return result;                    \
-                         }                                     \
-                     } while(0)
-
 /******************************************************************************
 * Global Variables
 *******************************************************************************/
+/* Setup steps completed, in order. cleanup() undoes them in reverse. */
+typedef enum
+{
+    SETUP_NONE,
+    SETUP_WCM,                  /* Wi-Fi Connection Manager initialized */
+    SETUP_MQTT_LIB,             /* MQTT library (or MQTT-SN client) initialized */
+    SETUP_BUFFER,               /* Network buffer allocated */
+    SETUP_MQTT_INSTANCE         /* MQTT instance created */
+} setup_stage_t;
+
 /* MQTT connection handle. */
 cy_mqtt_t mqtt_connection;
 
-/* Queue handle used to communicate results of various operations - MQTT 
- * Publish, MQTT Subscribe, MQTT connection, and Wi-Fi connection between tasks 
+/* Queue handle used to communicate results of various operations - MQTT
+ * Publish, MQTT Subscribe, MQTT connection, and Wi-Fi connection between tasks
  * and callbacks.
  */
 QueueHandle_t mqtt_task_q;
 
-/* Flag to denote initialization status of various operations. */
-uint32_t status_flag;
-
-/* Pointer to the network buffer needed by the MQTT library for MQTT send and 
+/* Pointer to the network buffer needed by the MQTT library for MQTT send and
  * receive operations.
  */
 uint8_t *mqtt_network_buffer = NULL;
 
+/* Connection state machine, and the copies of its counters and time-in-state
+ * summaries printed by the get-conn command.
+ */
+static conn_fsm_t conn_fsm;
+static conn_fsm_counters_t conn_fsm_counters;
+static latency_summary_t conn_time_in_state[CONN_STATE_COUNT];
+
+/* Progress of the setup, and whether the broker connection is up. */
+static setup_stage_t setup_stage = SETUP_NONE;
+static bool broker_connected;
+
+/* Failed attempts of the current Wi-Fi join and broker connection. */
+static uint32_t wifi_retries;
+static uint32_t broker_retries;
+
+/* Duration of the broker connects, and the sum for the average. */
+static mqtt_connect_stats_t connect_stats;
+static uint32_t reconnect_total_ms;
+
+/* One-shot timer of the state machine. It belongs to the state that armed
+ * it and is dropped when that state is left.
+ */
+static bool timer_armed;
+static uint32_t timer_deadline_ms;
+static conn_state_t timer_state;
+
+#if ENABLE_BURST_CONNECT
+/* BSSID of the last AP joined, used for a directed join in the next burst. */
+static cy_wcm_mac_t burst_bssid;
+static bool burst_bssid_valid;
+
+/* Summary of the previous burst, published at the end of every burst. */
+static char burst_summary[160];
+
+/* Phases of the current burst, the start of the current phase, and its
+ * progress.
+ */
+static burst_phases_t burst_phases;
+static uint32_t burst_phase_start_ms;
+static uint32_t burst_events;
+static bool burst_wifi_up;
+static bool burst_published;
+#endif /* ENABLE_BURST_CONNECT */
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
-static cy_rslt_t wifi_connect(void);
+static cy_rslt_t setup(void);
+static void arm_timer(uint32_t delay_ms);
+static bool timer_expired(void);
+#if ENABLE_VIRTUAL_TIME
+static void post_timer_expiry(void *arg);
+#endif /* ENABLE_VIRTUAL_TIME */
+
+static conn_event_t join_wifi(void);
+static conn_event_t backoff_wifi(void);
+static conn_event_t connect_broker(void);
+static conn_event_t backoff_broker(void);
+
+#if ENABLE_BURST_CONNECT
+static conn_event_t start_burst(void);
+static conn_event_t burst_joined(void);
+static conn_event_t publish_burst(void);
+static conn_event_t end_burst(void);
+static cy_rslt_t transport_publish(cy_mqtt_publish_info_t *info);
+#else
+static conn_event_t give_up(void);
+static conn_event_t start_publishing(void);
+static conn_event_t recover(void);
+static conn_event_t check_link(void);
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+static conn_event_t ping_gateway(void);
+static conn_event_t arm_keep_alive(void);
+#else
+static conn_event_t subscribe(void);
+static conn_event_t subscribe_failed(void);
+static conn_event_t publish_unsubscribed(void);
+static conn_event_t publish_failed(void);
+#endif /* MQTT_TRANSPORT */
+#endif /* ENABLE_BURST_CONNECT */
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_TCP)
 static cy_rslt_t mqtt_init(void);
 static cy_rslt_t mqtt_connect(void);
-
 static void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event, void *user_data);
-static void cleanup(void);
-void print_heap_usage(char *msg);
 
 #if GENERATE_UNIQUE_CLIENT_ID
 static cy_rslt_t mqtt_get_unique_client_identifier(char *mqtt_client_identifier);
 #endif /* GENERATE_UNIQUE_CLIENT_ID */
+#endif /* MQTT_TRANSPORT */
+
+static void record_connect_time(uint32_t duration_ms);
+static void cleanup(void);
+void print_heap_usage(char *msg);
+
+/******************************************************************************
+* Transition Table
+*******************************************************************************/
+/* Every connection step is a single attempt run by the action of a
+ * transition; its result is the next event. Waits between attempts are
+ * backoff states left by the timer, and the results of other tasks and
+ * callbacks arrive as events over mqtt_task_q.
+ *
+ * Joining the AP includes DHCP, and connecting to the broker includes the
+ * TCP and TLS handshakes, because the WCM and the MQTT library run them in
+ * one call.
+ */
+static const conn_fsm_transition_t conn_table[] =
+{
+    /* State                        Event                          Next                           Action */
+#if ENABLE_BURST_CONNECT
+    { CONN_STATE_IDLE,              CONN_EVENT_START,              CONN_STATE_WIFI_JOINING,       start_burst      },
+    { CONN_STATE_WIFI_JOINING,      CONN_EVENT_WIFI_UP,            CONN_STATE_BROKER_CONNECTING,  burst_joined     },
+    { CONN_STATE_WIFI_BACKOFF,      CONN_EVENT_RETRIES_EXHAUSTED,  CONN_STATE_IDLE,               end_burst        },
+    { CONN_STATE_BROKER_BACKOFF,    CONN_EVENT_RETRIES_EXHAUSTED,  CONN_STATE_IDLE,               end_burst        },
+    { CONN_STATE_BROKER_CONNECTING, CONN_EVENT_BROKER_UP,          CONN_STATE_CONNECTED,          publish_burst    },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_DONE,               CONN_STATE_IDLE,               end_burst        },
+#else
+    { CONN_STATE_IDLE,              CONN_EVENT_START,              CONN_STATE_WIFI_JOINING,       join_wifi        },
+    { CONN_STATE_WIFI_JOINING,      CONN_EVENT_WIFI_UP,            CONN_STATE_BROKER_CONNECTING,  connect_broker   },
+    { CONN_STATE_WIFI_BACKOFF,      CONN_EVENT_RETRIES_EXHAUSTED,  CONN_STATE_FAILED,             give_up          },
+    { CONN_STATE_BROKER_BACKOFF,    CONN_EVENT_RETRIES_EXHAUSTED,  CONN_STATE_FAILED,             give_up          },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_SETUP_FAILED,       CONN_STATE_FAILED,             NULL             },
+    { CONN_STATE_RECOVERING,        CONN_EVENT_TIMER,              CONN_STATE_RECOVERING,         check_link       },
+    { CONN_STATE_RECOVERING,        CONN_EVENT_WIFI_UP,            CONN_STATE_BROKER_CONNECTING,  connect_broker   },
+    { CONN_STATE_RECOVERING,        CONN_EVENT_WIFI_DOWN,          CONN_STATE_WIFI_JOINING,       join_wifi        },
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    { CONN_STATE_BROKER_CONNECTING, CONN_EVENT_BROKER_UP,          CONN_STATE_CONNECTED,          start_publishing },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_TIMER,              CONN_STATE_PINGING,            ping_gateway     },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_PUBLISH_FAILED,     CONN_STATE_PINGING,            ping_gateway     },
+    { CONN_STATE_PINGING,           CONN_EVENT_BROKER_UP,          CONN_STATE_CONNECTED,          arm_keep_alive   },
+    { CONN_STATE_PINGING,           CONN_EVENT_BROKER_LOST,        CONN_STATE_RECOVERING,         recover          },
+#else
+    { CONN_STATE_BROKER_CONNECTING, CONN_EVENT_BROKER_UP,          CONN_STATE_SUBSCRIBING,        subscribe        },
+    { CONN_STATE_SUBSCRIBING,       CONN_EVENT_SUBSCRIBED,         CONN_STATE_CONNECTED,          start_publishing },
+    { CONN_STATE_SUBSCRIBING,       CONN_EVENT_SUBSCRIBE_FAILED,   CONN_STATE_CONNECTED,          publish_unsubscribed },
+    { CONN_STATE_SUBSCRIBING,       CONN_EVENT_SETUP_FAILED,       CONN_STATE_FAILED,             NULL             },
+    { CONN_STATE_SUBSCRIBING,       CONN_EVENT_BROKER_LOST,        CONN_STATE_RECOVERING,         recover          },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_BROKER_LOST,        CONN_STATE_RECOVERING,         recover          },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_LINK_DEGRADED,      CONN_STATE_RECOVERING,         recover          },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_PUBLISH_FAILED,     CONN_STATE_CONNECTED,          publish_failed   },
+    { CONN_STATE_CONNECTED,         CONN_EVENT_SUBSCRIBE_FAILED,   CONN_STATE_CONNECTED,          subscribe_failed },
+#endif /* MQTT_TRANSPORT */
+#endif /* ENABLE_BURST_CONNECT */
+    { CONN_STATE_IDLE,              CONN_EVENT_SETUP_FAILED,       CONN_STATE_FAILED,             NULL             },
+    { CONN_STATE_WIFI_JOINING,      CONN_EVENT_WIFI_FAILED,        CONN_STATE_WIFI_BACKOFF,       backoff_wifi     },
+    { CONN_STATE_WIFI_BACKOFF,      CONN_EVENT_TIMER,              CONN_STATE_WIFI_JOINING,       join_wifi        },
+    { CONN_STATE_BROKER_CONNECTING, CONN_EVENT_BROKER_FAILED,      CONN_STATE_BROKER_BACKOFF,     backoff_broker   },
+    { CONN_STATE_BROKER_CONNECTING, CONN_EVENT_WIFI_DOWN,          CONN_STATE_WIFI_JOINING,       join_wifi        },
+    { CONN_STATE_BROKER_BACKOFF,    CONN_EVENT_TIMER,              CONN_STATE_BROKER_CONNECTING,  connect_broker   }
+};
 
 /******************************************************************************
  * Function Name: mqtt_client_task
  ******************************************************************************
  * Summary:
  *  Task for handling initialization & connection of Wi-Fi and the MQTT client.
- *  The task also creates and manages the subscriber and publisher tasks upon 
- *  successful MQTT connection. The task also handles the WiFi and MQTT 
- *  connections by initiating reconnection on the event of disconnections.
+ *  The connection is run by the state machine in conn_table: the task waits
+ *  for events from other tasks, callbacks and the state timer and dispatches
+ *  them. The subscriber and publisher tasks are created upon the first
+ *  successful MQTT connection. When the retries are exhausted, the tasks are
+ *  deleted and the connections are terminated.
  *
  * Parameters:
  *  void *pvParameters : Task parameter defined during task creation (unused)
@@ -165,15 +309,11 @@ static cy_rslt_t mqtt_get_unique_client_identifier(char *mqtt_client_identifier)
  ******************************************************************************/
 void mqtt_client_task(void *pvParameters)
 {
-    /* Structures that store the data to be sent/received to/from various
-     * message queues.
-     */
+    /* Command received from other tasks and callbacks. */
     mqtt_task_cmd_t mqtt_status;
-    subscriber_data_t subscriber_q_data;
-    publisher_data_t publisher_q_data;
-
-    /* Configure the Wi-Fi interface as a Wi-Fi STA (i.e. Client). */
-    cy_wcm_config_t config = {.interface = CY_WCM_INTERFACE_TYPE_STA};
+    conn_event_t event;
+    TickType_t wait_ticks;
+    TaskHandle_t publisher_handle;
 
     /* To avoid compiler warnings */
     (void) pvParameters;
@@ -181,134 +321,75 @@ void mqtt_client_task(void *pvParameters)
     /* Create a message queue to communicate with other tasks and callbacks. */
     mqtt_task_q = xQueueCreate(MQTT_TASK_QUEUE_LENGTH, sizeof(mqtt_task_cmd_t));
 
-    /* Initialize the Wi-Fi Connection Manager and jump to the cleanup block 
-     * upon failure.
-     */
-    if (CY_RSLT_SUCCESS != cy_wcm_init(&config))
-    {
-        printf("\nWi-Fi Connection Manager initialization failed!\n");
-        goto exit_cleanup;
-    }
+    (void)conn_fsm_init(&conn_fsm, conn_table, sizeof(conn_table) / sizeof(conn_table[0]),
+                        CONN_STATE_IDLE, app_time_now_ms);
 
-    /* Set the appropriate bit in the status_flag to denote successful 
-     * WCM initialization.
-     */
-    status_flag |= WCM_INITIALIZED;
-    printf("\nWi-Fi Connection Manager initialized.\n");
-
-    /* Initiate connection to the Wi-Fi AP and cleanup if the operation fails. */
-    if (CY_RSLT_SUCCESS != wifi_connect())
+    if (CY_RSLT_SUCCESS != setup())
     {
-        goto exit_cleanup;
+        conn_fsm_dispatch(&conn_fsm, CONN_EVENT_SETUP_FAILED);
     }
-
-    /* Set-up the MQTT client and connect to the MQTT broker. Jump to the 
-     * cleanup block if any of the operations fail.
-     */
-    if ( (CY_RSLT_SUCCESS != mqtt_init()) || (CY_RSLT_SUCCESS != mqtt_connect()) )
+#if !ENABLE_BURST_CONNECT
+    else
     {
-        goto exit_cleanup;
+        conn_fsm_dispatch(&conn_fsm, CONN_EVENT_START);
     }
+#endif /* ENABLE_BURST_CONNECT */
 
-    /* Create the subscriber task and cleanup if the operation fails. */
-    if (pdPASS != xTaskCreate(subscriber_task, "Subscriber task", SUBSCRIBER_TASK_STACK_SIZE,
-                              NULL, SUBSCRIBER_TASK_PRIORITY, &subscriber_task_handle))
+    while (conn_fsm.state != CONN_STATE_FAILED)
     {
-        printf("Failed to create the Subscriber task!\n");
-        goto exit_cleanup;
-    }
-
-    /* Wait for the subscribe operation to complete. */
-    vTaskDelay(pdMS_TO_TICKS(TASK_CREATION_DELAY_MS));
+#if ENABLE_BURST_CONNECT
+        /* Stay disassociated until the next burst is due. */
+        if (conn_fsm.state == CONN_STATE_IDLE)
+        {
+            timer_armed = false;
+            burst_connect_wait();
+            conn_fsm_dispatch(&conn_fsm, CONN_EVENT_START);
+            continue;
+        }
+#endif /* ENABLE_BURST_CONNECT */
 
-    /* Create the publisher task and cleanup if the operation fails. */
-    if (pdPASS != xTaskCreate(publisher_task, "Publisher task", PUBLISHER_TASK_STACK_SIZE, 
-                              NULL, PUBLISHER_TASK_PRIORITY, &publisher_task_handle))
-    {
-        printf("Failed to create Publisher task!\n");
-        goto exit_cleanup;
-    }
+        if (timer_armed && (timer_state != conn_fsm.state))
+        {
+            timer_armed = false;
+        }
 
-    print_heap_usage("mqtt_client_task: subscriber & publisher tasks created\n");
+        wait_ticks = portMAX_DELAY;
+#if !ENABLE_VIRTUAL_TIME
+        if (timer_armed)
+        {
+            int32_t remaining_ms = (int32_t)(timer_deadline_ms - app_time_now_ms());
+            wait_ticks = (remaining_ms > 0) ? pdMS_TO_TICKS((uint32_t)remaining_ms) : 0;
+        }
+#endif /* ENABLE_VIRTUAL_TIME */
 
-    while (true)
-    {
-        /* Wait for results of MQTT operations from other tasks and callbacks. */
-        if (pdTRUE == xQueueReceive(mqtt_task_q, &mqtt_status, portMAX_DELAY))
+        /* Wait for results of MQTT operations from other tasks and callbacks,
+         * or for the state timer.
+         */
+        event = CONN_EVENT_NONE;
+        if (pdTRUE == xQueueReceive(mqtt_task_q, &mqtt_status, wait_ticks))
         {
-            /* In this code example, the disconnection from the MQTT Broker or 
-             * the Wi-Fi network is handled by the case 'HANDLE_DISCONNECTION'. 
-             * 
-             * The publish and subscribe failures (`HANDLE_MQTT_PUBLISH_FAILURE`
-             * and `HANDLE_MQTT_SUBSCRIBE_FAILURE`) does not initiate 
-             * reconnection in this example, but they can be handled as per the 
-             * application requirement in the following swich cases.
-             */
-            switch(mqtt_status)
+            switch (mqtt_status)
             {
-                case HANDLE_MQTT_PUBLISH_FAILURE:
-                {
-                    /* Handle Publish Failure here. */
-                    break;
-                }
-
-                case HANDLE_MQTT_SUBSCRIBE_FAILURE:
-                {
-                    /* Handle Subscribe Failure here. */
-                    break;
-                }
-
-                case HANDLE_DISCONNECTION:
-                {
-                    /* Deinit the publisher before initiating reconnections. */
-                    publisher_q_data.cmd = PUBLISHER_DEINIT;
-                    xQueueSend(publisher_task_q, &publisher_q_data, portMAX_DELAY);
-
-                    /* Although the connection with the MQTT Broker is lost, 
-                     * call the MQTT disconnect API for cleanup of threads and 
-                     * other resources before reconnection.
-                     */
-                    cy_mqtt_disconnect(mqtt_connection);
-
-                    /* Check if Wi-Fi connection is active. If not, update the 
-                     * status flag and initiate Wi-Fi reconnection.
-                     */
-                    if (cy_wcm_is_connected_to_ap() == 0)
-                    {
-                        status_flag &= ~(WIFI_CONNECTED);
-                        printf("\nInitiating Wi-Fi Reconnection...\n");
-                        if (CY_RSLT_SUCCESS != wifi_connect())
-                        {
-                            goto exit_cleanup;
-                        }
-                    }
-
-                    printf("\nInitiating MQTT Reconnection...\n");
-                    if (CY_RSLT_SUCCESS != mqtt_connect())
-                    {
-                        goto exit_cleanup;
-                    }
-
-                    /* Initiate MQTT subscribe post the reconnection. */
-                    subscriber_q_data.cmd = SUBSCRIBE_TO_TOPIC;
-                    xQueueSend(subscriber_task_q, &subscriber_q_data, portMAX_DELAY);
-
-                    /* Initialize Publisher post the reconnection. */
-                    publisher_q_data.cmd = PUBLISHER_INIT;
-                    xQueueSend(publisher_task_q, &publisher_q_data, portMAX_DELAY);
-                    break;
-                }
-
-                default:
-                    break;
+                case HANDLE_MQTT_PUBLISH_FAILURE:   event = CONN_EVENT_PUBLISH_FAILED; break;
+                case HANDLE_MQTT_SUBSCRIBE_FAILURE: event = CONN_EVENT_SUBSCRIBE_FAILED; break;
+                case HANDLE_MQTT_SUBSCRIBED:        event = CONN_EVENT_SUBSCRIBED; break;
+                case HANDLE_DISCONNECTION:          event = CONN_EVENT_BROKER_LOST; break;
+                case HANDLE_RTT_DEGRADED:           event = CONN_EVENT_LINK_DEGRADED; break;
+                default:                            break;
             }
         }
+
+        if ((event == CONN_EVENT_NONE) && timer_expired())
+        {
+            event = CONN_EVENT_TIMER;
+        }
+
+        conn_fsm_dispatch(&conn_fsm, event);
     }
 
     /* Cleanup section: Delete subscriber and publisher tasks and perform
-     * cleanup for various operations based on the status_flag.
+     * cleanup for various operations based on the setup progress.
      */
-    exit_cleanup:
     printf("\nTerminating Publisher and Subscriber tasks...\n");
     if (subscriber_task_handle != NULL)
     {
@@ -316,83 +397,851 @@ void mqtt_client_task(void *pvParameters)
     }
     if (publisher_task_handle != NULL)
     {
-        vTaskDelete(publisher_task_handle);
+        /* The radar interrupts stay enabled; stop them signalling the task.
+         * The metrics, actuation and occupancy tasks and the radar replay
+         * outlive the publisher task, so publisher_task_send() must see it
+         * gone before it is deleted. The queue is not deleted because a
+         * sender may still be blocked on it.
+         */
+        isr_signal_detach(ISR_SIGNAL_RADAR_TD);
+        taskENTER_CRITICAL();
+        publisher_handle = publisher_task_handle;
+        publisher_task_handle = NULL;
+        publisher_task_q = NULL;
+        taskEXIT_CRITICAL();
+        vTaskDelete(publisher_handle);
+    }
+#if ENABLE_MQTT_RPC
+    if (mqtt_rpc_task_handle != NULL)
+    {
+        vTaskDelete(mqtt_rpc_task_handle);
     }
+#endif /* ENABLE_MQTT_RPC */
+#if ENABLE_RTT_PROBE
+    if (rtt_probe_task_handle != NULL)
+    {
+        vTaskDelete(rtt_probe_task_handle);
+    }
+#endif /* ENABLE_RTT_PROBE */
+#if ENABLE_WIFI_ROAMING
+    if (wifi_roam_task_handle != NULL)
+    {
+        vTaskDelete(wifi_roam_task_handle);
+    }
+#endif /* ENABLE_WIFI_ROAMING */
     cleanup();
     printf("\nCleanup Done\nTerminating the MQTT task...\n\n");
     vTaskDelete(NULL);
 }
 
 /******************************************************************************
- * Function Name: wifi_connect
+ * Function Name: mqtt_task_get_connect_stats
  ******************************************************************************
  * Summary:
- *  Function that initiates connection to the Wi-Fi Access Point using the 
- *  specified SSID and PASSWORD. The connection is retried a maximum of 
- *  'MAX_WIFI_CONN_RETRIES' times with interval of 'WIFI_CONN_RETRY_INTERVAL_MS'
- *  milliseconds.
+ *  Returns the duration of the first broker connect and of the reconnects.
  *
  * Parameters:
+ *  mqtt_connect_stats_t *stats : Output statistics
+ *
+ * Return:
  *  void
  *
+ ******************************************************************************/
+void mqtt_task_get_connect_stats(mqtt_connect_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = connect_stats;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: mqtt_task_format_conn
+ ******************************************************************************
+ * Summary:
+ *  Prints the state, the transition log and counts, and the time-in-state
+ *  histograms of the connection state machine. Called by the RPC task.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
  * Return:
- *  cy_rslt_t : CY_RSLT_SUCCESS upon a successful Wi-Fi connection, else an 
- *              error code indicating the failure.
+ *  size_t : Number of characters written
  *
  ******************************************************************************/
-static cy_rslt_t wifi_connect(void)
+size_t mqtt_task_format_conn(char *buf, size_t size)
 {
-    cy_rslt_t result = CY_RSLT_SUCCESS;
+    taskENTER_CRITICAL();
+    conn_fsm_get_counters(&conn_fsm, &conn_fsm_counters);
+    taskEXIT_CRITICAL();
+
+    /* The scan of the histograms keeps the MQTT client task from recording,
+     * but leaves the interrupts enabled.
+     */
+    vTaskSuspendAll();
+    conn_fsm_summarize_time_in_state(&conn_fsm, conn_time_in_state);
+    (void)xTaskResumeAll();
+
+    return conn_fsm_format(&conn_fsm, &conn_fsm_counters, conn_time_in_state, buf, size);
+}
+
+/******************************************************************************
+ * Function Name: setup
+ ******************************************************************************
+ * Summary:
+ *  Initializes the Wi-Fi Connection Manager and the client of the selected
+ *  transport. In burst mode the publisher task is started as well, because
+ *  it buffers the events between bursts.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t setup(void)
+{
+    cy_rslt_t result;
+
+    /* Configure the Wi-Fi interface as a Wi-Fi STA (i.e. Client). */
+    cy_wcm_config_t config = {.interface = CY_WCM_INTERFACE_TYPE_STA};
+
+    result = cy_wcm_init(&config);
+    if (CY_RSLT_SUCCESS != result)
+    {
+        printf("\nWi-Fi Connection Manager initialization failed!\n");
+        return result;
+    }
+    setup_stage = SETUP_WCM;
+    printf("\nWi-Fi Connection Manager initialized.\n");
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    result = mqttsn_client_init();
+    if (CY_RSLT_SUCCESS != result)
+    {
+        printf("\nMQTT-SN client initialization failed!\n");
+        return result;
+    }
+    setup_stage = SETUP_MQTT_LIB;
+#else
+    result = mqtt_init();
+    if (CY_RSLT_SUCCESS != result)
+    {
+        return result;
+    }
+#endif /* MQTT_TRANSPORT */
+
+#if ENABLE_BURST_CONNECT
+    /* Burst mode: stay disassociated until the first burst. Only the
+     * publisher task is started.
+     */
+    burst_connect_init();
+
+    if (pdPASS != xTaskCreate(publisher_task, "Publisher task", PUBLISHER_TASK_STACK_SIZE,
+                              NULL, PUBLISHER_TASK_PRIORITY, &publisher_task_handle))
+    {
+        printf("Failed to create Publisher task!\n");
+        return ~CY_RSLT_SUCCESS;
+    }
+#endif /* ENABLE_BURST_CONNECT */
+
+    return result;
+}
+
+/* Arms the state timer for the current state. */
+static void arm_timer(uint32_t delay_ms)
+{
+    timer_armed = true;
+    timer_deadline_ms = app_time_now_ms() + delay_ms;
+    timer_state = conn_fsm.state;
+#if ENABLE_VIRTUAL_TIME
+    /* Queue timeouts run on the FreeRTOS tick: the virtual clock delivers the
+     * expiry over the queue instead.
+     */
+    (void)app_time_schedule(delay_ms, post_timer_expiry, NULL);
+#endif /* ENABLE_VIRTUAL_TIME */
+}
+
+/* Returns true once, when the deadline of the state timer has passed. */
+static bool timer_expired(void)
+{
+    if (!timer_armed || ((int32_t)(app_time_now_ms() - timer_deadline_ms) < 0))
+    {
+        return false;
+    }
+
+    timer_armed = false;
+    return true;
+}
+
+#if ENABLE_VIRTUAL_TIME
+/* Virtual-clock callback that wakes up the MQTT client task. It runs in a
+ * critical section and must not block; a stale expiry is ignored by
+ * timer_expired().
+ */
+static void post_timer_expiry(void *arg)
+{
+    mqtt_task_cmd_t mqtt_task_cmd = HANDLE_STATE_TIMER;
+
+    (void)arg;
+    (void)xQueueSend(mqtt_task_q, &mqtt_task_cmd, 0);
+}
+#endif /* ENABLE_VIRTUAL_TIME */
+
+/******************************************************************************
+ * Function Name: join_wifi
+ ******************************************************************************
+ * Summary:
+ *  Action that makes one attempt to join the Wi-Fi Access Point using the
+ *  specified SSID and PASSWORD.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_WIFI_UP once an IP address is assigned, else
+ *                 CONN_EVENT_WIFI_FAILED
+ *
+ ******************************************************************************/
+static conn_event_t join_wifi(void)
+{
+    cy_rslt_t result;
     cy_wcm_connect_params_t connect_param;
     cy_wcm_ip_address_t ip_address;
 
     /* Check if Wi-Fi connection is already established. */
+    if (cy_wcm_is_connected_to_ap() != 0)
+    {
+        return CONN_EVENT_WIFI_UP;
+    }
+
+    /* Configure the connection parameters for the Wi-Fi interface. */
+    memset(&connect_param, 0, sizeof(cy_wcm_connect_params_t));
+    memcpy(connect_param.ap_credentials.SSID, WIFI_SSID, sizeof(WIFI_SSID));
+    memcpy(connect_param.ap_credentials.password, WIFI_PASSWORD, sizeof(WIFI_PASSWORD));
+    connect_param.ap_credentials.security = WIFI_SECURITY;
+#if ENABLE_BURST_CONNECT
+    /* Skip the scan by joining the AP of the previous burst directly. */
+    if (burst_bssid_valid)
+    {
+        memcpy(connect_param.BSSID, burst_bssid, sizeof(cy_wcm_mac_t));
+    }
+#endif /* ENABLE_BURST_CONNECT */
+
+    printf("\nWi-Fi Connecting to '%s'\n", connect_param.ap_credentials.SSID);
+    render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_WIFI_CONNECTING);
+
+    result = cy_wcm_connect_ap(&connect_param, &ip_address);
+    if (result != CY_RSLT_SUCCESS)
+    {
+#if ENABLE_BURST_CONNECT
+        /* The AP may have moved or gone: fall back to a scan. */
+        burst_bssid_valid = false;
+#endif /* ENABLE_BURST_CONNECT */
+        printf("Wi-Fi Connection failed. Error code:0x%0X.\n", (int)result);
+        return CONN_EVENT_WIFI_FAILED;
+    }
+
+    printf("\nSuccessfully connected to Wi-Fi network '%s'.\n", connect_param.ap_credentials.SSID);
+    wifi_retries = 0;
+#if ENABLE_BURST_CONNECT
+    cy_wcm_associated_ap_info_t ap_info;
+    burst_bssid_valid = (cy_wcm_get_associated_ap_info(&ap_info) == CY_RSLT_SUCCESS);
+    if (burst_bssid_valid)
+    {
+        memcpy(burst_bssid, ap_info.BSSID, sizeof(cy_wcm_mac_t));
+    }
+#endif /* ENABLE_BURST_CONNECT */
+
+    /* Print the assigned IP address. */
+    if (ip_address.version == CY_WCM_IP_VER_V4)
+    {
+        printf("IPv4 Address Assigned: %s\n\n", ip4addr_ntoa((const ip4_addr_t *) &ip_address.ip.v4));
+    }
+    else if (ip_address.version == CY_WCM_IP_VER_V6)
+    {
+        printf("IPv6 Address Assigned: %s\n\n", ip6addr_ntoa((const ip6_addr_t *) &ip_address.ip.v6));
+    }
+
+    /* Set the RTC of the occupancy predictor. */
+    wall_clock_sync();
+
+    return CONN_EVENT_WIFI_UP;
+}
+
+/******************************************************************************
+ * Function Name: backoff_wifi
+ ******************************************************************************
+ * Summary:
+ *  Action that waits 'WIFI_CONN_RETRY_INTERVAL_MS' before the next join
+ *  attempt, at most 'MAX_WIFI_CONN_RETRIES' times in a row.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_RETRIES_EXHAUSTED after the last attempt, else
+ *                 CONN_EVENT_NONE
+ *
+ ******************************************************************************/
+static conn_event_t backoff_wifi(void)
+{
+    wifi_retries++;
+    if (wifi_retries >= MAX_WIFI_CONN_RETRIES)
+    {
+        wifi_retries = 0;
+        printf("\nExceeded maximum Wi-Fi connection attempts!\n");
+        printf("Wi-Fi connection failed after retrying for %d mins\n\n",
+            (int)(WIFI_CONN_RETRY_INTERVAL_MS * MAX_WIFI_CONN_RETRIES) / 60000u);
+        return CONN_EVENT_RETRIES_EXHAUSTED;
+    }
+
+    printf("Retrying in %d ms. Retries left: %d\n",
+           WIFI_CONN_RETRY_INTERVAL_MS, (int)(MAX_WIFI_CONN_RETRIES - wifi_retries));
+    arm_timer(WIFI_CONN_RETRY_INTERVAL_MS);
+    return CONN_EVENT_NONE;
+}
+
+/******************************************************************************
+ * Function Name: connect_broker
+ ******************************************************************************
+ * Summary:
+ *  Action that makes one attempt to connect to the MQTT broker, or to the
+ *  MQTT-SN gateway.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_BROKER_UP on success, CONN_EVENT_WIFI_DOWN if
+ *                 the AP was lost, else CONN_EVENT_BROKER_FAILED
+ *
+ ******************************************************************************/
+static conn_event_t connect_broker(void)
+{
+    cy_rslt_t result;
+    TickType_t start_ticks;
+
     if (cy_wcm_is_connected_to_ap() == 0)
     {
-        /* Configure the connection parameters for the Wi-Fi interface. */
-        memset(&connect_param, 0, sizeof(cy_wcm_connect_params_t));
-        memcpy(connect_param.ap_credentials.SSID, WIFI_SSID, sizeof(WIFI_SSID));
-        memcpy(connect_param.ap_credentials.password, WIFI_PASSWORD, sizeof(WIFI_PASSWORD));
-        connect_param.ap_credentials.security = WIFI_SECURITY;
+        printf("\nUnexpectedly disconnected from Wi-Fi network! \nInitiating Wi-Fi reconnection...\n");
+        return CONN_EVENT_WIFI_DOWN;
+    }
 
-        printf("\nWi-Fi Connecting to '%s'\n", connect_param.ap_credentials.SSID);
+    render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_BROKER_CONNECTING);
+
+    /* The handshakes run in real time, also with the virtual clock. The
+     * ECDHE and certificate verification of the TLS handshake take hundreds
+     * of milliseconds of CPU, so they run below the tasks with deadlines. A
+     * lock of the MQTT library that such a task waits for raises the
+     * priority back through priority inheritance.
+     */
+    start_ticks = xTaskGetTickCount();
+    deadline_monitor_set_handshake(true);
+#if ENABLE_HANDSHAKE_DEMOTION
+    vTaskPrioritySet(NULL, MQTT_HANDSHAKE_TASK_PRIORITY);
+#endif
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    printf("\n'%s' connecting to MQTT-SN gateway '%s'...\n",
+           MQTT_CLIENT_IDENTIFIER, MQTTSN_GATEWAY_ADDRESS);
+    result = mqttsn_client_connect();
+#else
+    result = mqtt_connect();
+#endif /* MQTT_TRANSPORT */
+#if ENABLE_HANDSHAKE_DEMOTION
+    vTaskPrioritySet(NULL, MQTT_CLIENT_TASK_PRIORITY);
+#endif
+    deadline_monitor_set_handshake(false);
+
+    if (result != CY_RSLT_SUCCESS)
+    {
+        taskENTER_CRITICAL();
+        connect_stats.failures++;
+        taskEXIT_CRITICAL();
+        metrics_counter_inc(METRIC_MQTT_CONNECT_FAILURES);
+
+        printf("\nMQTT connection failed with error code 0x%0X.\n", (int)result);
+        return CONN_EVENT_BROKER_FAILED;
+    }
+    record_connect_time((uint32_t)((xTaskGetTickCount() - start_ticks) * portTICK_PERIOD_MS));
+
+    printf("MQTT connection successful in %lu ms.\r\n", (unsigned long)connect_stats.last_ms);
+    render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_CONNECTED);
+    broker_connected = true;
+    broker_retries = 0;
+    return CONN_EVENT_BROKER_UP;
+}
 
-        /* Connect to the Wi-Fi AP. */
-        for (uint32_t retry_count = 0; retry_count < MAX_WIFI_CONN_RETRIES; retry_count++)
+/* Records the duration of a successful connect. */
+static void record_connect_time(uint32_t duration_ms)
+{
+    taskENTER_CRITICAL();
+    connect_stats.count++;
+    connect_stats.last_ms = duration_ms;
+    if (connect_stats.count == 1u)
+    {
+        connect_stats.first_ms = duration_ms;
+    }
+    else
+    {
+        if ((connect_stats.count == 2u) || (duration_ms < connect_stats.min_ms))
         {
-            result = cy_wcm_connect_ap(&connect_param, &ip_address);
+            connect_stats.min_ms = duration_ms;
+        }
+        if (duration_ms > connect_stats.max_ms)
+        {
+            connect_stats.max_ms = duration_ms;
+        }
+        reconnect_total_ms += duration_ms;
+        connect_stats.avg_ms = reconnect_total_ms / (connect_stats.count - 1u);
+    }
+    taskEXIT_CRITICAL();
 
-            if (result == CY_RSLT_SUCCESS)
-            {
-                printf("\nSuccessfully connected to Wi-Fi network '%s'.\n", connect_param.ap_credentials.SSID);
-
-                /* Set the appropriate bit in the status_flag to denote 
-                 * successful Wi-Fi connection, print the assigned IP address.
-                 */
-                status_flag |= WIFI_CONNECTED;
-                if (ip_address.version == CY_WCM_IP_VER_V4)
-                {
-                    printf("IPv4 Address Assigned: %s\n\n", ip4addr_ntoa((const ip4_addr_t *) &ip_address.ip.v4));
-                }
-                else if (ip_address.version == CY_WCM_IP_VER_V6)
-                {
-                    printf("IPv6 Address Assigned: %s\n\n", ip6addr_ntoa((const ip6_addr_t *) &ip_address.ip.v6));
-                }
-                return result;
-            }
+    if (connect_stats.count > 1u)
+    {
+        metrics_counter_inc(METRIC_MQTT_RECONNECTS);
+    }
+    metrics_histogram_record(METRIC_MQTT_CONNECT_MS, duration_ms);
+}
+
+/******************************************************************************
+ * Function Name: backoff_broker
+ ******************************************************************************
+ * Summary:
+ *  Action that waits 'MQTT_CONN_RETRY_INTERVAL_MS' before the next connect
+ *  attempt, at most 'MAX_MQTT_CONN_RETRIES' times in a row.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_RETRIES_EXHAUSTED after the last attempt, else
+ *                 CONN_EVENT_NONE
+ *
+ ******************************************************************************/
+static conn_event_t backoff_broker(void)
+{
+    broker_retries++;
+    if (broker_retries >= MAX_MQTT_CONN_RETRIES)
+    {
+        broker_retries = 0;
+        printf("\nExceeded maximum MQTT connection attempts\n");
+        printf("MQTT connection failed after retrying for %d mins\n\n",
+               (int)(MQTT_CONN_RETRY_INTERVAL_MS * MAX_MQTT_CONN_RETRIES) / 60000u);
+        return CONN_EVENT_RETRIES_EXHAUSTED;
+    }
 
-            printf("Wi-Fi Connection failed. Error code:0x%0X. Retrying in %d ms. Retries left: %d\n",
-                (int)result, WIFI_CONN_RETRY_INTERVAL_MS, (int)(MAX_WIFI_CONN_RETRIES - retry_count - 1));
-            vTaskDelay(pdMS_TO_TICKS(WIFI_CONN_RETRY_INTERVAL_MS));
+    printf("Retrying in %d ms. Retries left: %d\n",
+           MQTT_CONN_RETRY_INTERVAL_MS, (int)(MAX_MQTT_CONN_RETRIES - broker_retries));
+    arm_timer(MQTT_CONN_RETRY_INTERVAL_MS);
+    return CONN_EVENT_NONE;
+}
+
+#if ENABLE_BURST_CONNECT
+/* Action that starts a burst and the timing of its phases. */
+static conn_event_t start_burst(void)
+{
+    memset(&burst_phases, 0, sizeof(burst_phases));
+    burst_phase_start_ms = app_time_now_ms();
+    burst_events = 0;
+    burst_wifi_up = false;
+    burst_published = false;
+
+    return join_wifi();
+}
+
+/* Action that ends the join phase of a burst and connects to the broker. */
+static conn_event_t burst_joined(void)
+{
+    uint32_t now_ms = app_time_now_ms();
+
+    burst_phases.join_ms = now_ms - burst_phase_start_ms;
+    burst_phase_start_ms = now_ms;
+    burst_wifi_up = true;
+
+    return connect_broker();
+}
+
+/******************************************************************************
+ * Function Name: publish_burst
+ ******************************************************************************
+ * Summary:
+ *  Action that publishes the buffered messages and the summary of the
+ *  previous burst. Messages that could not be published stay buffered for
+ *  the next burst.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_DONE
+ *
+ ******************************************************************************/
+static conn_event_t publish_burst(void)
+{
+    burst_stats_t stats;
+    burst_event_t event;
+    cy_mqtt_publish_info_t info;
+    uint32_t now_ms = app_time_now_ms();
+
+    burst_phases.connect_ms = now_ms - burst_phase_start_ms;
+    burst_phase_start_ms = now_ms;
+
+    while (burst_connect_peek(&event))
+    {
+        if (CY_RSLT_SUCCESS != transport_publish(&event.info))
+        {
+            break;
         }
+        burst_connect_pop(event.sequence);
+        burst_events++;
+    }
 
-        printf("\nExceeded maximum Wi-Fi connection attempts!\n");
-        printf("Wi-Fi connection failed after retrying for %d mins\n\n", 
-            (int)(WIFI_CONN_RETRY_INTERVAL_MS * MAX_WIFI_CONN_RETRIES) / 60000u);
+    burst_connect_get_stats(&stats);
+    if (stats.bursts > 0)
+    {
+        memset(&info, 0, sizeof(info));
+        info.qos = (cy_mqtt_qos_t) MQTT_MESSAGES_QOS;
+        info.topic = MQTT_BURST_TOPIC;
+        info.topic_len = sizeof(MQTT_BURST_TOPIC) - 1u;
+        info.payload = burst_summary;
+        info.payload_len = (size_t)snprintf(burst_summary, sizeof(burst_summary),
+            "join %lu connect %lu publish %lu disconnect %lu ms events %lu energy_estimate %lu uJ",
+            (unsigned long)stats.last.join_ms, (unsigned long)stats.last.connect_ms,
+            (unsigned long)stats.last.publish_ms, (unsigned long)stats.last.disconnect_ms,
+            (unsigned long)stats.last_events, (unsigned long)stats.last_energy_estimate_uj);
+        (void)transport_publish(&info);
     }
-    return result;
+
+    burst_phases.publish_ms = app_time_now_ms() - burst_phase_start_ms;
+    burst_published = true;
+
+    return CONN_EVENT_DONE;
+}
+
+/******************************************************************************
+ * Function Name: end_burst
+ ******************************************************************************
+ * Summary:
+ *  Action that disconnects from the broker and leaves the AP at the end of a
+ *  burst, successful or not, and records the phases of the burst.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_NONE
+ *
+ ******************************************************************************/
+static conn_event_t end_burst(void)
+{
+    burst_stats_t stats;
+    uint32_t start_ms = app_time_now_ms();
+
+    /* A failed burst ends in the join or the connect phase. */
+    if (!burst_published)
+    {
+        if (burst_wifi_up)
+        {
+            burst_phases.connect_ms = start_ms - burst_phase_start_ms;
+        }
+        else
+        {
+            burst_phases.join_ms = start_ms - burst_phase_start_ms;
+        }
+    }
+
+    if (broker_connected)
+    {
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+        /* Sleep instead of disconnecting, so that the next burst resumes the
+         * session without registering the topics again.
+         */
+        mqttsn_client_sleep((uint16_t)BURST_SLEEP_DURATION_S);
+#else
+        cy_mqtt_disconnect(mqtt_connection);
+#endif /* MQTT_TRANSPORT */
+        broker_connected = false;
+    }
+    if (cy_wcm_is_connected_to_ap() != 0)
+    {
+        cy_wcm_disconnect_ap();
+    }
+    burst_phases.disconnect_ms = app_time_now_ms() - start_ms;
+
+    /* Drop the failures reported while the link went down. */
+    xQueueReset(mqtt_task_q);
+    render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_DISCONNECTED);
+    wifi_retries = 0;
+    broker_retries = 0;
+
+    burst_connect_record(&burst_phases, burst_events, burst_published);
+    burst_connect_get_stats(&stats);
+    printf("\nBurst: join %lu ms, connect %lu ms, publish %lu ms, disconnect %lu ms, "
+           "%lu events, estimated %lu uJ/event\n",
+           (unsigned long)burst_phases.join_ms, (unsigned long)burst_phases.connect_ms,
+           (unsigned long)burst_phases.publish_ms, (unsigned long)burst_phases.disconnect_ms,
+           (unsigned long)burst_events, (unsigned long)stats.energy_estimate_per_event_uj);
+
+    return CONN_EVENT_NONE;
+}
+
+/* Publishes a message through the selected transport. */
+static cy_rslt_t transport_publish(cy_mqtt_publish_info_t *info)
+{
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    uint32_t wire_bytes;
+    return mqttsn_client_publish(info, &wire_bytes);
+#else
+    return cy_mqtt_publish(mqtt_connection, info);
+#endif /* MQTT_TRANSPORT */
+}
+
+#else /* ENABLE_BURST_CONNECT */
+
+/* Action run when the retries are exhausted: the task terminates. */
+static conn_event_t give_up(void)
+{
+    render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_DISCONNECTED);
+    return CONN_EVENT_NONE;
+}
+
+/******************************************************************************
+ * Function Name: start_publishing
+ ******************************************************************************
+ * Summary:
+ *  Action that creates the publisher task, and the RPC and roaming tasks,
+ *  after the first connection, and initializes the publisher again after a
+ *  reconnection.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_SETUP_FAILED if a task could not be created,
+ *                 else CONN_EVENT_NONE
+ *
+ ******************************************************************************/
+static conn_event_t start_publishing(void)
+{
+    publisher_data_t publisher_q_data;
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    (void)arm_keep_alive();
+#endif /* MQTT_TRANSPORT */
+
+    rtt_probe_start();
+
+    if (publisher_task_handle != NULL)
+    {
+        publisher_q_data.cmd = PUBLISHER_INIT;
+        (void)publisher_task_send(&publisher_q_data, portMAX_DELAY);
+        return CONN_EVENT_NONE;
+    }
+
+    if (pdPASS != xTaskCreate(publisher_task, "Publisher task", PUBLISHER_TASK_STACK_SIZE,
+                              NULL, PUBLISHER_TASK_PRIORITY, &publisher_task_handle))
+    {
+        printf("Failed to create Publisher task!\n");
+        return CONN_EVENT_SETUP_FAILED;
+    }
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_TCP)
+#if ENABLE_MQTT_RPC
+    /* Create the RPC task used for remote diagnostics. */
+    if (pdPASS != xTaskCreate(mqtt_rpc_task, "RPC task", MQTT_RPC_TASK_STACK_SIZE,
+                              NULL, MQTT_RPC_TASK_PRIORITY, &mqtt_rpc_task_handle))
+    {
+        printf("Failed to create the RPC task!\n");
+        return CONN_EVENT_SETUP_FAILED;
+    }
+#endif /* ENABLE_MQTT_RPC */
+
+#if ENABLE_RTT_PROBE
+    /* Create the task that measures the round-trip time through the broker. */
+    if (pdPASS != xTaskCreate(rtt_probe_task, "RTT task", RTT_PROBE_TASK_STACK_SIZE,
+                              NULL, RTT_PROBE_TASK_PRIORITY, &rtt_probe_task_handle))
+    {
+        printf("Failed to create the RTT probe task!\n");
+        return CONN_EVENT_SETUP_FAILED;
+    }
+#endif /* ENABLE_RTT_PROBE */
+
+#if ENABLE_WIFI_ROAMING
+    /* Create the task that roams between the APs of WIFI_SSID. */
+    if (pdPASS != xTaskCreate(wifi_roam_task, "Roam task", WIFI_ROAM_TASK_STACK_SIZE,
+                              NULL, WIFI_ROAM_TASK_PRIORITY, &wifi_roam_task_handle))
+    {
+        printf("Failed to create the Wi-Fi roaming task!\n");
+        return CONN_EVENT_SETUP_FAILED;
+    }
+#endif /* ENABLE_WIFI_ROAMING */
+#endif /* MQTT_TRANSPORT */
+
+    print_heap_usage("mqtt_client_task: subscriber & publisher tasks created\n");
+    return CONN_EVENT_NONE;
+}
+
+/******************************************************************************
+ * Function Name: recover
+ ******************************************************************************
+ * Summary:
+ *  Action run when the broker connection is lost: stops the publisher and
+ *  releases the connection before the reconnection.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : See check_link()
+ *
+ ******************************************************************************/
+static conn_event_t recover(void)
+{
+    publisher_data_t publisher_q_data;
+
+    mqtt_rpc_trace(MQTT_RPC_TRACE_DISCONNECTION, conn_fsm.visits[CONN_STATE_RECOVERING]);
+    rtt_probe_stop();
+
+    /* Deinit the publisher before initiating reconnections. */
+    publisher_q_data.cmd = PUBLISHER_DEINIT;
+    (void)publisher_task_send(&publisher_q_data, portMAX_DELAY);
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_TCP)
+    /* Although the connection with the MQTT Broker is lost, call the MQTT
+     * disconnect API for cleanup of threads and other resources before
+     * reconnection.
+     */
+    cy_mqtt_disconnect(mqtt_connection);
+#endif /* MQTT_TRANSPORT */
+    broker_connected = false;
+
+    return check_link();
+}
+
+/******************************************************************************
+ * Function Name: check_link
+ ******************************************************************************
+ * Summary:
+ *  Action that decides how to reconnect. A handover between APs drops the
+ *  link briefly; it is polled until it finishes instead of starting a Wi-Fi
+ *  reconnection.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_NONE while roaming, else CONN_EVENT_WIFI_UP or
+ *                 CONN_EVENT_WIFI_DOWN
+ *
+ ******************************************************************************/
+static conn_event_t check_link(void)
+{
+    if (wifi_roam_in_progress())
+    {
+        arm_timer(ROAM_POLL_INTERVAL_MS);
+        return CONN_EVENT_NONE;
+    }
+
+    if (cy_wcm_is_connected_to_ap() == 0)
+    {
+        printf("\nInitiating Wi-Fi Reconnection...\n");
+        return CONN_EVENT_WIFI_DOWN;
+    }
+
+    printf("\nInitiating MQTT Reconnection...\n");
+    return CONN_EVENT_WIFI_UP;
+}
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+/* Action that checks the MQTT-SN gateway after the keep-alive timer or a
+ * failed publish; UDP reports no lost connection.
+ */
+static conn_event_t ping_gateway(void)
+{
+    if ((MQTTSN_QOS < 0) || (CY_RSLT_SUCCESS == mqttsn_client_ping()))
+    {
+        return CONN_EVENT_BROKER_UP;
+    }
+
+    printf("\nMQTT-SN gateway not responding!\n");
+    render_show_alert("Gateway connection lost");
+    return CONN_EVENT_BROKER_LOST;
+}
+
+/* Action that sends the next PINGREQ after half the keep-alive period. */
+static conn_event_t arm_keep_alive(void)
+{
+    arm_timer((MQTT_KEEP_ALIVE_SECONDS * 1000u) / 2u);
+    return CONN_EVENT_NONE;
+}
+
+#else /* MQTT_TRANSPORT */
+
+/******************************************************************************
+ * Function Name: subscribe
+ ******************************************************************************
+ * Summary:
+ *  Action that creates the subscriber task, which subscribes when it starts,
+ *  after the first connection, and subscribes again after a reconnection.
+ *  The subscriber task reports the result as an event.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  conn_event_t : CONN_EVENT_SETUP_FAILED if the task could not be created,
+ *                 else CONN_EVENT_NONE
+ *
+ ******************************************************************************/
+static conn_event_t subscribe(void)
+{
+    subscriber_data_t subscriber_q_data;
+
+    if (subscriber_task_handle != NULL)
+    {
+        subscriber_q_data.cmd = SUBSCRIBE_TO_TOPIC;
+        (void)subscriber_task_send(&subscriber_q_data, portMAX_DELAY);
+        return CONN_EVENT_NONE;
+    }
+
+    if (pdPASS != xTaskCreate(subscriber_task, "Subscriber task", SUBSCRIBER_TASK_STACK_SIZE,
+                              NULL, SUBSCRIBER_TASK_PRIORITY, &subscriber_task_handle))
+    {
+        printf("Failed to create the Subscriber task!\n");
+        return CONN_EVENT_SETUP_FAILED;
+    }
+
+    return CONN_EVENT_NONE;
+}
+
+/* Action run when a subscription failed. */
+static conn_event_t subscribe_failed(void)
+{
+    render_show_alert("MQTT subscribe failed");
+    return CONN_EVENT_NONE;
+}
+
+/* Action run when the first subscription after a connection failed:
+ * publishing goes on without it.
+ */
+static conn_event_t publish_unsubscribed(void)
+{
+    (void)subscribe_failed();
+    return start_publishing();
+}
+
+/* Action run when a publish failed. */
+static conn_event_t publish_failed(void)
+{
+    render_show_alert("MQTT publish failed");
+    return CONN_EVENT_NONE;
 }
+#endif /* MQTT_TRANSPORT */
+#endif /* ENABLE_BURST_CONNECT */
 
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_TCP)
 /******************************************************************************
  * Function Name: mqtt_init
  ******************************************************************************
@@ -416,31 +1265,58 @@ static cy_rslt_t mqtt_init(void)
 
     /* Initialize the MQTT library. */
     result = cy_mqtt_init();
-    CHECK_RESULT(result, LIBS_INITIALIZED, "\nMQTT library initialization failed!\n");
+    if (CY_RSLT_SUCCESS != result)
+    {
+        printf("\nMQTT library initialization failed!\n");
+        return result;
+    }
+    setup_stage = SETUP_MQTT_LIB;
+
+#if (MQTT_SECURE_CONNECTION && ENABLE_ROOT_CA_CACHE)
+    /* Parse the root CA once into the global trusted chain of the secure
+     * sockets library. Without a root CA in the credentials, every connect
+     * verifies the broker against that chain instead of parsing its own.
+     */
+    if (security_info->root_ca != NULL)
+    {
+        result = cy_tls_load_global_root_ca_certificates(security_info->root_ca,
+                                                         (uint32_t)security_info->root_ca_size);
+        if (CY_RSLT_SUCCESS != result)
+        {
+            printf("\nRoot CA certificate parsing failed!\n");
+            return result;
+        }
+        security_info->root_ca = NULL;
+        security_info->root_ca_size = 0;
+    }
+#endif /* MQTT_SECURE_CONNECTION && ENABLE_ROOT_CA_CACHE */
 
     /* Allocate buffer for MQTT send and receive operations. */
     mqtt_network_buffer = (uint8_t *) pvPortMalloc(sizeof(uint8_t) * MQTT_NETWORK_BUFFER_SIZE);
     if(mqtt_network_buffer == NULL)
     {
-        result = ~CY_RSLT_SUCCESS;
+        printf("Network Buffer allocation failed!\n\n");
+        return ~CY_RSLT_SUCCESS;
     }
-    CHECK_RESULT(result, BUFFER_INITIALIZED, "Network Buffer allocation failed!\n\n");
+    setup_stage = SETUP_BUFFER;
 
     /* Create the MQTT client instance. */
     result = cy_mqtt_create(mqtt_network_buffer, MQTT_NETWORK_BUFFER_SIZE,
                             security_info, &broker_info,MQTT_HANDLE_DESCRIPTOR,
                             &mqtt_connection);
-                            
-    CHECK_RESULT(result, MQTT_INSTANCE_CREATED, "\nMQTT instance creation failed!\n");
-    if(CY_RSLT_SUCCESS == result)
+    if (CY_RSLT_SUCCESS != result)
     {
-        /* Register a MQTT event callback */
-        result = cy_mqtt_register_event_callback( mqtt_connection, (cy_mqtt_callback_t)mqtt_event_callback, NULL );
-        if(CY_RSLT_SUCCESS == result)
-        {       
-            printf("\nMQTT library initialization successful.\n");
-        }
-    }   
+        printf("\nMQTT instance creation failed!\n");
+        return result;
+    }
+    setup_stage = SETUP_MQTT_INSTANCE;
+
+    /* Register a MQTT event callback */
+    result = cy_mqtt_register_event_callback( mqtt_connection, (cy_mqtt_callback_t)mqtt_event_callback, NULL );
+    if(CY_RSLT_SUCCESS == result)
+    {       
+        printf("\nMQTT library initialization successful.\n");
+    }
     return result;
 }
 
@@ -448,9 +1324,8 @@ static cy_rslt_t mqtt_init(void)
  * Function Name: mqtt_connect
  ******************************************************************************
  * Summary:
- *  Function that initiates MQTT connect operation. The connection is retried
- *  a maximum of 'MAX_MQTT_CONN_RETRIES' times with interval of 
- *  'MQTT_CONN_RETRY_INTERVAL_MS' milliseconds.
+ *  Function that makes one MQTT connect attempt. The retries are run by the
+ *  connection state machine.
  *
  * Parameters:
  *  void
@@ -482,7 +1357,11 @@ static cy_rslt_t mqtt_connect(void)
      */
 #if GENERATE_UNIQUE_CLIENT_ID
     result = mqtt_get_unique_client_identifier(mqtt_client_identifier);
-    CHECK_RESULT(result, 0, "Failed to generate unique client identifier for the MQTT client!\n");
+    if (CY_RSLT_SUCCESS != result)
+    {
+        printf("Failed to generate unique client identifier for the MQTT client!\n");
+        return result;
+    }
 #endif /* GENERATE_UNIQUE_CLIENT_ID */
 
     /* Set the client identifier buffer and length. */
@@ -495,44 +1374,8 @@ static cy_rslt_t mqtt_connect(void)
            broker_info.hostname_len,
            broker_info.hostname);
 
-    for (uint32_t retry_count = 0; retry_count < MAX_MQTT_CONN_RETRIES; retry_count++)
-    {
-        if (cy_wcm_is_connected_to_ap() == 0)
-        {
-            printf("\nUnexpectedly disconnected from Wi-Fi network! \nInitiating Wi-Fi reconnection...\n");
-            status_flag &= ~(WIFI_CONNECTED);
-
-            /* Initiate Wi-Fi reconnection. */
-            result = wifi_connect();
-            if (CY_RSLT_SUCCESS != result)
-            {
-                return result;
-            }
-        }
-
-        /* Establish the MQTT connection. */
-        result = cy_mqtt_connect(mqtt_connection, &connection_info);
-
-        if (result == CY_RSLT_SUCCESS)
-        {
-            printf("MQTT connection successful.\r\n");
-
-            /* Set the appropriate bit in the status_flag to denote successful
-             * MQTT connection, and return the result to the calling function.
-             */
-            status_flag |= MQTT_CONNECTION_SUCCESS;
-            return result;
-        }
-
-        printf("\nMQTT connection failed with error code 0x%0X. \nRetrying in %d ms. Retries left: %d\n", 
-               (int)result, MQTT_CONN_RETRY_INTERVAL_MS, (int)(MAX_MQTT_CONN_RETRIES - retry_count - 1));
-        vTaskDelay(pdMS_TO_TICKS(MQTT_CONN_RETRY_INTERVAL_MS));
-    }
-
-    printf("\nExceeded maximum MQTT connection attempts\n");
-    printf("MQTT connection failed after retrying for %d mins\n\n", 
-           (int)(MQTT_CONN_RETRY_INTERVAL_MS * MAX_MQTT_CONN_RETRIES) / 60000u);
-    return result;
+    /* Establish the MQTT connection. */
+    return cy_mqtt_connect(mqtt_connection, &connection_info);
 }
 
 /******************************************************************************
@@ -568,14 +1411,13 @@ static void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event, vo
     {
         case CY_MQTT_EVENT_TYPE_DISCONNECT:
         {
-            /* Clear the status flag bit to indicate MQTT disconnection. */
-            status_flag &= ~(MQTT_CONNECTION_SUCCESS);
-
             /* MQTT connection with the MQTT broker is broken as the client
              * is unable to communicate with the broker. Set the appropriate
              * command to be sent to the MQTT task.
              */
             printf("\nUnexpectedly disconnected from MQTT broker!\n");
+            render_set_field(RENDER_FIELD_MQTT_STATE, RENDER_MQTT_DISCONNECTED);
+            render_show_alert("Broker connection lost");
             mqtt_task_cmd = HANDLE_DISCONNECTION;
 
             /* Send the message to the MQTT client task to handle the 
@@ -587,8 +1429,6 @@ static void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event, vo
 
         case CY_MQTT_EVENT_TYPE_SUBSCRIPTION_MESSAGE_RECEIVE:
         {
-            status_flag |= MQTT_MSG_RECEIVED;
-
             /* Incoming MQTT message has been received. Send this message to 
              * the subscriber callback function to handle it. 
              */
@@ -640,13 +1480,14 @@ static cy_rslt_t mqtt_get_unique_client_identifier(char *mqtt_client_identifier)
     return status;
 }
 #endif /* GENERATE_UNIQUE_CLIENT_ID */
+#endif /* MQTT_TRANSPORT */
 
 /******************************************************************************
  * Function Name: cleanup
  ******************************************************************************
  * Summary:
  *  Function that invokes the deinit and cleanup functions for various 
- *  operations based on the status_flag.
+ *  operations based on the setup progress and the connection state.
  *
  * Parameters:
  *  void
@@ -659,8 +1500,20 @@ static void cleanup(void)
 {
     cy_rslt_t status = CY_RSLT_SUCCESS;
 
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    /* Disconnect from the MQTT-SN gateway and delete the UDP socket. */
+    if (broker_connected)
+    {
+        mqttsn_client_disconnect();
+        printf("Disconnected from the MQTT-SN gateway...\n");
+    }
+    if (setup_stage >= SETUP_MQTT_LIB)
+    {
+        mqttsn_client_deinit();
+    }
+#else
     /* Disconnect the MQTT connection if it was established. */
-    if (status_flag & MQTT_CONNECTION_SUCCESS)
+    if (broker_connected)
     {
         status = cy_mqtt_disconnect(mqtt_connection);
 
@@ -674,7 +1527,7 @@ static void cleanup(void)
         }
     }
     /* Delete the MQTT instance if it was created. */
-    if (status_flag & MQTT_INSTANCE_CREATED)
+    if (setup_stage >= SETUP_MQTT_INSTANCE)
     {
         status = cy_mqtt_delete(mqtt_connection);
 
@@ -688,13 +1541,16 @@ static void cleanup(void)
         }
     }
     /* Deallocate the network buffer. */
-    if (status_flag & BUFFER_INITIALIZED)
+    if (setup_stage >= SETUP_BUFFER)
     {
         vPortFree((void *) mqtt_network_buffer);
     }
     /* Deinit the MQTT library. */
-    if (status_flag & LIBS_INITIALIZED)
+    if (setup_stage >= SETUP_MQTT_LIB)
     {
+#if (MQTT_SECURE_CONNECTION && ENABLE_ROOT_CA_CACHE)
+        (void)cy_tls_release_global_root_ca_certificates();
+#endif /* MQTT_SECURE_CONNECTION && ENABLE_ROOT_CA_CACHE */
         status = cy_mqtt_deinit();
 
         if (status == CY_RSLT_SUCCESS)
@@ -706,8 +1562,9 @@ static void cleanup(void)
             printf("MQTT deinit API failed unexpectedly.\n");
         }
     }
+#endif /* MQTT_TRANSPORT */
     /* Disconnect from Wi-Fi AP. */
-    if (status_flag & WIFI_CONNECTED)
+    if ((setup_stage >= SETUP_WCM) && (cy_wcm_is_connected_to_ap() != 0))
     {
         status = cy_wcm_disconnect_ap();
 
@@ -721,7 +1578,7 @@ static void cleanup(void)
         }
     }
     /* De-initialize the Wi-Fi Connection Manager. */
-    if (status_flag & WCM_INITIALIZED)
+    if (setup_stage >= SETUP_WCM)
     {
         status = cy_wcm_deinit();
 
@@ -734,6 +1591,48 @@ static void cleanup(void)
             printf("WCM deinit API failed unexpectedly.\n");
         }
     }
+    setup_stage = SETUP_NONE;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_task_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the broker connect counts and durations for the get-stats RPC
+ *  command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t mqtt_task_format_stats(char *buf, size_t size)
+{
+    mqtt_connect_stats_t stats;
+    int len;
+
+    mqtt_task_get_connect_stats(&stats);
+    len = snprintf(buf, size,
+                   "broker_connects %lu failures %lu first_ms %lu\n"
+                   "broker_reconnect_ms last %lu min %lu avg %lu max %lu\n",
+                   (unsigned long)stats.count,
+                   (unsigned long)stats.failures,
+                   (unsigned long)stats.first_ms,
+                   (unsigned long)stats.last_ms,
+                   (unsigned long)stats.min_ms,
+                   (unsigned long)stats.avg_ms,
+                   (unsigned long)stats.max_ms);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
 }
 
 /* [] END OF FILE */
@@ -54,6 +54,11 @@
 #define MQTT_CLIENT_TASK_PRIORITY       (4)
 #define MQTT_CLIENT_TASK_STACK_SIZE     (1024 * 2)
 
+/* Priority of the MQTT Client Task while it connects to the broker, below
+ * the publisher, subscriber and TFT tasks. See ENABLE_HANDSHAKE_DEMOTION.
+ */
+#define MQTT_HANDSHAKE_TASK_PRIORITY    (1)
+
 /*******************************************************************************
 * Global Variables
 ********************************************************************************/
@@ -61,10 +66,25 @@
 typedef enum
 {
     HANDLE_MQTT_SUBSCRIBE_FAILURE,
+    HANDLE_MQTT_SUBSCRIBED,
     HANDLE_MQTT_PUBLISH_FAILURE,
-    HANDLE_DISCONNECTION
+    HANDLE_DISCONNECTION,
+    HANDLE_RTT_DEGRADED,
+    HANDLE_STATE_TIMER
 } mqtt_task_cmd_t;
 
+/* Duration of the broker connects, including the TCP and TLS handshakes. */
+typedef struct
+{
+    uint32_t count;             /* Successful connects */
+    uint32_t failures;
+    uint32_t first_ms;          /* First connect after start-up */
+    uint32_t last_ms;
+    uint32_t min_ms;            /* Reconnects only */
+    uint32_t avg_ms;
+    uint32_t max_ms;
+} mqtt_connect_stats_t;
+
 /*******************************************************************************
  * Extern variables
  ******************************************************************************/
@@ -75,6 +95,9 @@ extern QueueHandle_t mqtt_task_q;
 * Function Prototypes
 ********************************************************************************/
 void mqtt_client_task(void *pvParameters);
+size_t mqtt_task_format_conn(char *buf, size_t size);
+void mqtt_task_get_connect_stats(mqtt_connect_stats_t *stats);
+size_t mqtt_task_format_stats(char *buf, size_t size);
 
 #endif /* MQTT_TASK_H_ */
 
@@ -0,0 +1,807 @@
+/******************************************************************************
+* File Name:   mqttsn_client.c
+*
+* Description: This file contains a publish-only MQTT-SN 1.2 client over UDP.
+*              It publishes the same cy_mqtt_publish_info_t descriptors as the
+*              MQTT client, so the publisher task can use either transport.
+*
+*              Topics are sent as 2-byte topic IDs instead of topic names:
+*              MQTT_PUB_TOPIC and MQTT_PRESTART_TOPIC use IDs predefined on the
+*              gateway, 2-character topics are sent as short topics, and any
+*              other topic is registered with the gateway on its first publish.
+*              MQTT_PUB_TOPIC and MQTT_PRESTART_TOPIC, published on every
+*              presence change, have a PUBLISH template built at connect time,
+*              so their packets only need the length, the message ID and the
+*              payload written.
+*              QoS -1 publishes without a connection; QoS 0 and 1 need a
+*              CONNECT first, and QoS 1 waits for the PUBACK.
+*
+*              A sleeping client (mqttsn_client_sleep) keeps its session at the
+*              gateway, so the next mqttsn_client_connect resumes it and the
+*              registered topic IDs stay valid.
+*
+*              The client is shared by the MQTT client task and the publisher
+*              task and is protected by a mutex.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "mqttsn_client.h"
+#include "mqttsn_codec.h"
+#include "app_time.h"
+#include "cycle_counter.h"
+#include "cy_secure_sockets.h"
+
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+
+#if (MQTTSN_QOS < -1) || (MQTTSN_QOS > 1)
+#error "MQTTSN_QOS must be -1, 0 or 1"
+#endif
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* Size of the transmit and receive packet buffers. */
+#define PACKET_BUFFER_SIZE                (512u)
+
+/* PUBACK return code of a topic ID the gateway does not know. */
+#define RC_INVALID_TOPIC_ID               (0x02u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Topic registered with the gateway. Topic names must be static strings. */
+typedef struct
+{
+    const char *name;
+    size_t len;
+    uint16_t id;
+} registered_topic_t;
+
+/* PUBLISH template of a topic published on every presence change. */
+typedef struct
+{
+    const char *name;
+    size_t len;
+    bool valid;
+    uint8_t type;
+    uint16_t id;
+    mqttsn_publish_template_t publish;
+} topic_template_t;
+
+static cy_socket_t client_socket;
+static cy_socket_sockaddr_t gateway_addr;
+static SemaphoreHandle_t client_mutex;
+
+static uint8_t tx_buf[PACKET_BUFFER_SIZE];
+static uint8_t rx_buf[PACKET_BUFFER_SIZE];
+
+static registered_topic_t registered_topics[MQTTSN_MAX_REGISTERED_TOPICS];
+static uint32_t registered_topic_count;
+
+static topic_template_t topic_templates[] =
+{
+    { .name = MQTT_PUB_TOPIC, .len = sizeof(MQTT_PUB_TOPIC) - 1u },
+    { .name = MQTT_PRESTART_TOPIC, .len = sizeof(MQTT_PRESTART_TOPIC) - 1u },
+};
+
+static uint16_t next_msg_id;
+static bool connected;
+static bool asleep;
+
+static mqttsn_client_stats_t stats;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static cy_rslt_t connect_locked(void);
+static cy_rslt_t resolve_topic(const char *topic, size_t topic_len, uint8_t *type,
+                               uint16_t *id, uint32_t *wire_bytes);
+static void build_templates(void);
+static cy_rslt_t build_template(topic_template_t *entry, uint32_t *wire_bytes);
+static topic_template_t *find_template(const char *topic, size_t topic_len);
+static cy_rslt_t publish_topic(const cy_mqtt_publish_info_t *info, topic_template_t *entry,
+                               uint8_t *topic_type, uint16_t *topic_id, mqttsn_packet_t *ack,
+                               uint32_t *wire_bytes);
+static cy_rslt_t publish_once(const cy_mqtt_publish_info_t *info,
+                              const mqttsn_publish_template_t *tmpl, uint8_t topic_type,
+                              uint16_t topic_id, mqttsn_packet_t *ack, uint32_t *wire_bytes);
+static cy_rslt_t request(size_t len, uint8_t reply_type, uint16_t msg_id,
+                         mqttsn_packet_t *reply, uint32_t *wire_bytes);
+static cy_rslt_t send_packet(size_t len, uint32_t *wire_bytes);
+static cy_rslt_t wait_packet(uint8_t type, uint16_t msg_id, mqttsn_packet_t *reply,
+                             uint32_t *wire_bytes);
+static uint16_t take_msg_id(void);
+
+/******************************************************************************
+ * Function Name: mqttsn_client_init
+ ******************************************************************************
+ * Summary:
+ *  Creates the UDP socket and resolves the gateway address.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+cy_rslt_t mqttsn_client_init(void)
+{
+    cy_rslt_t result;
+    uint32_t timeout_ms = MQTTSN_RETRY_INTERVAL_MS;
+
+    cycle_counter_init();
+
+    client_mutex = xSemaphoreCreateMutex();
+    if (client_mutex == NULL)
+    {
+        return ~CY_RSLT_SUCCESS;
+    }
+
+    result = cy_socket_init();
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+
+    result = cy_socket_gethostbyname(MQTTSN_GATEWAY_ADDRESS, CY_SOCKET_IP_VER_V4,
+                                     &gateway_addr.ip_address);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+    gateway_addr.port = MQTTSN_GATEWAY_PORT;
+
+    result = cy_socket_create(CY_SOCKET_DOMAIN_AF_INET, CY_SOCKET_TYPE_DGRAM,
+                              CY_SOCKET_IPPROTO_UDP, &client_socket);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+
+    return cy_socket_setsockopt(client_socket, CY_SOCKET_SOL_SOCKET, CY_SOCKET_SO_RCVTIMEO,
+                                &timeout_ms, sizeof(timeout_ms));
+}
+
+/* Deletes the UDP socket. */
+void mqttsn_client_deinit(void)
+{
+    cy_socket_delete(client_socket);
+    cy_socket_deinit();
+    connected = false;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_client_connect
+ ******************************************************************************
+ * Summary:
+ *  Connects to the gateway. After a sleep the session is resumed, otherwise
+ *  a clean session is started and the registered topics are dropped. With
+ *  QoS -1 no connection is needed and nothing is sent.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+cy_rslt_t mqttsn_client_connect(void)
+{
+    cy_rslt_t result;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    result = connect_locked();
+    xSemaphoreGive(client_mutex);
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_client_publish
+ ******************************************************************************
+ * Summary:
+ *  Publishes a message with MQTTSN_QOS. The QoS of the descriptor is not
+ *  used. A topic the gateway has forgotten is registered again once.
+ *  Messages on a topic with a template are encoded from the template.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Message
+ *  uint32_t *wire_bytes : Bytes sent and received for the message, including
+ *                         registrations, retransmissions and UDP/IP headers
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+cy_rslt_t mqttsn_client_publish(const cy_mqtt_publish_info_t *info, uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+    mqttsn_packet_t ack = {0};
+    topic_template_t *entry = find_template(info->topic, info->topic_len);
+    uint8_t topic_type = MQTTSN_TOPIC_NORMAL;
+    uint16_t topic_id = 0;
+
+    *wire_bytes = 0;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+
+    if ((MQTTSN_QOS >= 0) && !connected)
+    {
+        xSemaphoreGive(client_mutex);
+        return ~CY_RSLT_SUCCESS;
+    }
+
+    result = publish_topic(info, entry, &topic_type, &topic_id, &ack, wire_bytes);
+
+    if ((result != CY_RSLT_SUCCESS) && (ack.return_code == RC_INVALID_TOPIC_ID) &&
+        (topic_type == MQTTSN_TOPIC_NORMAL))
+    {
+        /* The gateway lost the registration: drop it and register again. */
+        for (uint32_t i = 0; i < registered_topic_count; i++)
+        {
+            if (registered_topics[i].id == topic_id)
+            {
+                registered_topics[i] = registered_topics[--registered_topic_count];
+                break;
+            }
+        }
+        if (entry != NULL)
+        {
+            entry->valid = false;
+        }
+        result = publish_topic(info, entry, &topic_type, &topic_id, &ack, wire_bytes);
+    }
+
+    xSemaphoreGive(client_mutex);
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_client_ping
+ ******************************************************************************
+ * Summary:
+ *  Sends a keep-alive PINGREQ and waits for the PINGRESP.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if the gateway answered, else an error code.
+ *
+ ******************************************************************************/
+cy_rslt_t mqttsn_client_ping(void)
+{
+    cy_rslt_t result;
+    mqttsn_packet_t reply;
+    uint32_t wire_bytes = 0;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    result = request(mqttsn_encode_pingreq(tx_buf, sizeof(tx_buf), NULL),
+                     MQTTSN_PINGRESP, 0, &reply, &wire_bytes);
+    xSemaphoreGive(client_mutex);
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_client_sleep
+ ******************************************************************************
+ * Summary:
+ *  Puts the client to sleep at the gateway. The session and registrations
+ *  are kept for the sleep duration and resumed by mqttsn_client_connect.
+ *
+ * Parameters:
+ *  uint16_t duration_s : Sleep duration in seconds, more than the time until
+ *                        the next connect
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+cy_rslt_t mqttsn_client_sleep(uint16_t duration_s)
+{
+    cy_rslt_t result = CY_RSLT_SUCCESS;
+    mqttsn_packet_t reply;
+    uint32_t wire_bytes = 0;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    if (connected)
+    {
+        result = request(mqttsn_encode_disconnect(tx_buf, sizeof(tx_buf), duration_s),
+                         MQTTSN_DISCONNECT, 0, &reply, &wire_bytes);
+        connected = false;
+        asleep = (result == CY_RSLT_SUCCESS);
+    }
+    xSemaphoreGive(client_mutex);
+
+    return result;
+}
+
+/* Disconnects from the gateway and ends the session. */
+cy_rslt_t mqttsn_client_disconnect(void)
+{
+    cy_rslt_t result = CY_RSLT_SUCCESS;
+    mqttsn_packet_t reply;
+    uint32_t wire_bytes = 0;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    if (connected)
+    {
+        result = request(mqttsn_encode_disconnect(tx_buf, sizeof(tx_buf), 0u),
+                         MQTTSN_DISCONNECT, 0, &reply, &wire_bytes);
+    }
+    connected = false;
+    asleep = false;
+    xSemaphoreGive(client_mutex);
+
+    return result;
+}
+
+void mqttsn_client_get_stats(mqttsn_client_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = stats;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: connect_locked
+ ******************************************************************************
+ * Summary:
+ *  Sends a CONNECT and waits for an accepting CONNACK. Called with the
+ *  client mutex held.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t connect_locked(void)
+{
+    cy_rslt_t result;
+    mqttsn_packet_t reply;
+    uint32_t wire_bytes = 0;
+    bool clean_session = !asleep;
+
+    if (MQTTSN_QOS < 0)
+    {
+        build_templates();
+        return CY_RSLT_SUCCESS;
+    }
+
+    result = request(mqttsn_encode_connect(tx_buf, sizeof(tx_buf), MQTT_CLIENT_IDENTIFIER,
+                                           MQTT_KEEP_ALIVE_SECONDS, clean_session),
+                     MQTTSN_CONNACK, 0, &reply, &wire_bytes);
+    if ((result == CY_RSLT_SUCCESS) && (reply.return_code != MQTTSN_RC_ACCEPTED))
+    {
+        result = ~CY_RSLT_SUCCESS;
+    }
+
+    if (result == CY_RSLT_SUCCESS)
+    {
+        if (clean_session)
+        {
+            registered_topic_count = 0;
+        }
+        connected = true;
+        asleep = false;
+        stats.connects++;
+        build_templates();
+    }
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: resolve_topic
+ ******************************************************************************
+ * Summary:
+ *  Finds the topic ID of a topic name, registering the topic if needed.
+ *
+ * Parameters:
+ *  const char *topic : Topic name, a static string
+ *  size_t topic_len : Length of the topic name
+ *  uint8_t *type : Topic ID type
+ *  uint16_t *id : Topic ID
+ *  uint32_t *wire_bytes : Incremented by the bytes of a registration
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t resolve_topic(const char *topic, size_t topic_len, uint8_t *type,
+                               uint16_t *id, uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+    mqttsn_packet_t reply;
+    uint16_t msg_id;
+
+    if ((MQTTSN_PUB_TOPIC_ID != 0u) && (topic_len == (sizeof(MQTT_PUB_TOPIC) - 1u)) &&
+        (memcmp(topic, MQTT_PUB_TOPIC, topic_len) == 0))
+    {
+        *type = MQTTSN_TOPIC_PREDEFINED;
+        *id = MQTTSN_PUB_TOPIC_ID;
+        return CY_RSLT_SUCCESS;
+    }
+    if ((MQTTSN_PRESTART_TOPIC_ID != 0u) && (topic_len == (sizeof(MQTT_PRESTART_TOPIC) - 1u)) &&
+        (memcmp(topic, MQTT_PRESTART_TOPIC, topic_len) == 0))
+    {
+        *type = MQTTSN_TOPIC_PREDEFINED;
+        *id = MQTTSN_PRESTART_TOPIC_ID;
+        return CY_RSLT_SUCCESS;
+    }
+    if (topic_len == 2u)
+    {
+        *type = MQTTSN_TOPIC_SHORT;
+        *id = (uint16_t)(((uint16_t)(uint8_t)topic[0] << 8) | (uint8_t)topic[1]);
+        return CY_RSLT_SUCCESS;
+    }
+
+    for (uint32_t i = 0; i < registered_topic_count; i++)
+    {
+        if ((registered_topics[i].len == topic_len) &&
+            (memcmp(registered_topics[i].name, topic, topic_len) == 0))
+        {
+            *type = MQTTSN_TOPIC_NORMAL;
+            *id = registered_topics[i].id;
+            return CY_RSLT_SUCCESS;
+        }
+    }
+
+    /* Registration needs a connection, so QoS -1 cannot use other topics. */
+    if ((MQTTSN_QOS < 0) || (registered_topic_count == MQTTSN_MAX_REGISTERED_TOPICS))
+    {
+        return ~CY_RSLT_SUCCESS;
+    }
+
+    msg_id = take_msg_id();
+    result = request(mqttsn_encode_register(tx_buf, sizeof(tx_buf), msg_id, topic, topic_len),
+                     MQTTSN_REGACK, msg_id, &reply, wire_bytes);
+    if ((result != CY_RSLT_SUCCESS) || (reply.return_code != MQTTSN_RC_ACCEPTED))
+    {
+        return ~CY_RSLT_SUCCESS;
+    }
+
+    registered_topics[registered_topic_count].name = topic;
+    registered_topics[registered_topic_count].len = topic_len;
+    registered_topics[registered_topic_count].id = reply.topic_id;
+    registered_topic_count++;
+    stats.registrations++;
+
+    *type = MQTTSN_TOPIC_NORMAL;
+    *id = reply.topic_id;
+    return CY_RSLT_SUCCESS;
+}
+
+/* Builds the templates of all template topics, registering them if needed. */
+static void build_templates(void)
+{
+    uint32_t wire_bytes = 0;
+
+    for (uint32_t i = 0; i < (sizeof(topic_templates) / sizeof(topic_templates[0])); i++)
+    {
+        (void)build_template(&topic_templates[i], &wire_bytes);
+    }
+}
+
+/******************************************************************************
+ * Function Name: build_template
+ ******************************************************************************
+ * Summary:
+ *  Resolves the topic ID of a template topic and builds its PUBLISH template.
+ *  The template stays invalid if the topic cannot be resolved.
+ *
+ * Parameters:
+ *  topic_template_t *entry : Template topic
+ *  uint32_t *wire_bytes : Incremented by the bytes of a registration
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t build_template(topic_template_t *entry, uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+
+    entry->valid = false;
+    result = resolve_topic(entry->name, entry->len, &entry->type, &entry->id, wire_bytes);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+
+    entry->valid = mqttsn_publish_template_init(&entry->publish, MQTTSN_QOS,
+                                                entry->type, entry->id);
+    return entry->valid ? CY_RSLT_SUCCESS : ~CY_RSLT_SUCCESS;
+}
+
+/* Returns the template topic with the given name, or NULL. */
+static topic_template_t *find_template(const char *topic, size_t topic_len)
+{
+    for (uint32_t i = 0; i < (sizeof(topic_templates) / sizeof(topic_templates[0])); i++)
+    {
+        if ((topic_templates[i].len == topic_len) &&
+            (memcmp(topic_templates[i].name, topic, topic_len) == 0))
+        {
+            return &topic_templates[i];
+        }
+    }
+
+    return NULL;
+}
+
+/******************************************************************************
+ * Function Name: publish_topic
+ ******************************************************************************
+ * Summary:
+ *  Publishes a message from the template of its topic, building the template
+ *  first if it is invalid, or resolves the topic of a message without a
+ *  template topic.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Message
+ *  topic_template_t *entry : Template topic of the message, or NULL
+ *  uint8_t *topic_type : Topic ID type used
+ *  uint16_t *topic_id : Topic ID used
+ *  mqttsn_packet_t *ack : PUBACK of a QoS 1 message
+ *  uint32_t *wire_bytes : Incremented by the bytes sent and received
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t publish_topic(const cy_mqtt_publish_info_t *info, topic_template_t *entry,
+                               uint8_t *topic_type, uint16_t *topic_id, mqttsn_packet_t *ack,
+                               uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+
+    if (entry != NULL)
+    {
+        if (!entry->valid)
+        {
+            result = build_template(entry, wire_bytes);
+            if (result != CY_RSLT_SUCCESS)
+            {
+                return result;
+            }
+        }
+        *topic_type = entry->type;
+        *topic_id = entry->id;
+        return publish_once(info, &entry->publish, entry->type, entry->id, ack, wire_bytes);
+    }
+
+    result = resolve_topic(info->topic, info->topic_len, topic_type, topic_id, wire_bytes);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        return result;
+    }
+
+    return publish_once(info, NULL, *topic_type, *topic_id, ack, wire_bytes);
+}
+
+/******************************************************************************
+ * Function Name: publish_once
+ ******************************************************************************
+ * Summary:
+ *  Sends a PUBLISH. With QoS 1 the PUBLISH is retransmitted with the DUP
+ *  flag until it is acknowledged. The encoding time of the packet is added
+ *  to the template or generic encode counters.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Message
+ *  const mqttsn_publish_template_t *tmpl : Template of the topic, or NULL to
+ *                                          encode from the topic ID
+ *  uint8_t topic_type : Topic ID type
+ *  uint16_t topic_id : Topic ID
+ *  mqttsn_packet_t *ack : PUBACK of a QoS 1 message
+ *  uint32_t *wire_bytes : Incremented by the bytes sent and received
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t publish_once(const cy_mqtt_publish_info_t *info,
+                              const mqttsn_publish_template_t *tmpl, uint8_t topic_type,
+                              uint16_t topic_id, mqttsn_packet_t *ack, uint32_t *wire_bytes)
+{
+    cy_rslt_t result = ~CY_RSLT_SUCCESS;
+    uint16_t msg_id = (MQTTSN_QOS == 1) ? take_msg_id() : 0u;
+    uint32_t start_cycles;
+    uint32_t encode_cycles;
+    size_t len;
+
+    for (uint32_t attempt = 0; attempt <= MQTTSN_MAX_RETRIES; attempt++)
+    {
+        start_cycles = cycle_counter_get();
+        if (tmpl != NULL)
+        {
+            len = mqttsn_encode_publish_template(tx_buf, sizeof(tx_buf), tmpl, (attempt > 0),
+                                                 msg_id, info->payload, info->payload_len);
+            encode_cycles = cycle_counter_get() - start_cycles;
+            taskENTER_CRITICAL();
+            stats.template_encode_cycles += encode_cycles;
+            stats.template_encodes++;
+            taskEXIT_CRITICAL();
+        }
+        else
+        {
+            len = mqttsn_encode_publish(tx_buf, sizeof(tx_buf), MQTTSN_QOS, (attempt > 0),
+                                        topic_type, topic_id, msg_id,
+                                        info->payload, info->payload_len);
+            encode_cycles = cycle_counter_get() - start_cycles;
+            taskENTER_CRITICAL();
+            stats.generic_encode_cycles += encode_cycles;
+            stats.generic_encodes++;
+            taskEXIT_CRITICAL();
+        }
+        result = send_packet(len, wire_bytes);
+        if ((result != CY_RSLT_SUCCESS) || (MQTTSN_QOS < 1))
+        {
+            return result;
+        }
+
+        result = wait_packet(MQTTSN_PUBACK, msg_id, ack, wire_bytes);
+        if (result == CY_RSLT_SUCCESS)
+        {
+            return (ack->return_code == MQTTSN_RC_ACCEPTED) ? CY_RSLT_SUCCESS : ~CY_RSLT_SUCCESS;
+        }
+        stats.retransmissions++;
+    }
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: request
+ ******************************************************************************
+ * Summary:
+ *  Sends the packet in tx_buf and waits for its reply, retransmitting it up
+ *  to MQTTSN_MAX_RETRIES times.
+ *
+ * Parameters:
+ *  size_t len : Length of the packet, 0 if it could not be encoded
+ *  uint8_t reply_type : Expected reply
+ *  uint16_t msg_id : Expected message ID, 0 for replies without one
+ *  mqttsn_packet_t *reply : Reply
+ *  uint32_t *wire_bytes : Incremented by the bytes sent and received
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t request(size_t len, uint8_t reply_type, uint16_t msg_id,
+                         mqttsn_packet_t *reply, uint32_t *wire_bytes)
+{
+    cy_rslt_t result = ~CY_RSLT_SUCCESS;
+
+    for (uint32_t attempt = 0; attempt <= MQTTSN_MAX_RETRIES; attempt++)
+    {
+        result = send_packet(len, wire_bytes);
+        if (result != CY_RSLT_SUCCESS)
+        {
+            return result;
+        }
+
+        result = wait_packet(reply_type, msg_id, reply, wire_bytes);
+        if (result == CY_RSLT_SUCCESS)
+        {
+            return result;
+        }
+        stats.retransmissions++;
+    }
+
+    return result;
+}
+
+/* Sends the first 'len' bytes of tx_buf to the gateway. */
+static cy_rslt_t send_packet(size_t len, uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+    uint32_t bytes_sent = 0;
+
+    if (len == 0)
+    {
+        return ~CY_RSLT_SUCCESS;
+    }
+
+    result = cy_socket_sendto(client_socket, tx_buf, (uint32_t)len, CY_SOCKET_FLAGS_NONE,
+                              &gateway_addr, sizeof(gateway_addr), &bytes_sent);
+    if (result == CY_RSLT_SUCCESS)
+    {
+        *wire_bytes += bytes_sent + MQTTSN_UDP_IP_OVERHEAD;
+        stats.tx_bytes += bytes_sent + MQTTSN_UDP_IP_OVERHEAD;
+    }
+
+    return result;
+}
+
+/******************************************************************************
+ * Function Name: wait_packet
+ ******************************************************************************
+ * Summary:
+ *  Waits up to MQTTSN_RETRY_INTERVAL_MS for a packet of the given type and
+ *  message ID from the gateway. Other packets are dropped. A DISCONNECT
+ *  from the gateway ends the connection.
+ *
+ * Parameters:
+ *  uint8_t type : Expected packet type
+ *  uint16_t msg_id : Expected message ID, 0 for packets without one
+ *  mqttsn_packet_t *reply : Received packet
+ *  uint32_t *wire_bytes : Incremented by the bytes received
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if the packet was received, else an error code.
+ *
+ ******************************************************************************/
+static cy_rslt_t wait_packet(uint8_t type, uint16_t msg_id, mqttsn_packet_t *reply,
+                             uint32_t *wire_bytes)
+{
+    cy_rslt_t result;
+    cy_socket_sockaddr_t src_addr;
+    uint32_t src_addr_len;
+    uint32_t received;
+    uint32_t start_ms = app_time_now_ms();
+
+    while ((app_time_now_ms() - start_ms) < MQTTSN_RETRY_INTERVAL_MS)
+    {
+        src_addr_len = sizeof(src_addr);
+        received = 0;
+        result = cy_socket_recvfrom(client_socket, rx_buf, sizeof(rx_buf), CY_SOCKET_FLAGS_NONE,
+                                    &src_addr, &src_addr_len, &received);
+        if (result != CY_RSLT_SUCCESS)
+        {
+            return result;
+        }
+
+        *wire_bytes += received + MQTTSN_UDP_IP_OVERHEAD;
+        stats.rx_bytes += received + MQTTSN_UDP_IP_OVERHEAD;
+
+        if ((src_addr.ip_address.ip.v4 != gateway_addr.ip_address.ip.v4) ||
+            !mqttsn_decode(rx_buf, received, reply))
+        {
+            continue;
+        }
+
+        if (reply->type == type)
+        {
+            if ((msg_id == 0u) || (reply->msg_id == msg_id))
+            {
+                return CY_RSLT_SUCCESS;
+            }
+        }
+        else if (reply->type == MQTTSN_DISCONNECT)
+        {
+            connected = false;
+            return ~CY_RSLT_SUCCESS;
+        }
+    }
+
+    return CY_RSLT_MODULE_SECURE_SOCKETS_TIMEOUT;
+}
+
+/* Returns the next non-zero message ID. */
+static uint16_t take_msg_id(void)
+{
+    next_msg_id++;
+    if (next_msg_id == 0u)
+    {
+        next_msg_id = 1u;
+    }
+    return next_msg_id;
+}
+
+#endif /* MQTT_TRANSPORT */
+
+/* [] END OF FILE */
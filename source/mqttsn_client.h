@@ -0,0 +1,59 @@
+/******************************************************************************
+* File Name:   mqttsn_client.h
+*
+* Description: This file is the public interface of mqttsn_client.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef MQTTSN_CLIENT_H_
+#define MQTTSN_CLIENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cy_result.h"
+#include "cy_mqtt_api.h"
+#include "mqtt_client_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* IPv4 and UDP header bytes of every datagram, counted in the wire bytes. */
+#define MQTTSN_UDP_IP_OVERHEAD            (28u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Client statistics. */
+typedef struct
+{
+    uint32_t connects;
+    uint32_t registrations;
+    uint32_t retransmissions;
+    uint32_t tx_bytes;          /* Including the UDP/IP headers */
+    uint32_t rx_bytes;
+    uint32_t template_encodes;  /* PUBLISH packets encoded from a topic template */
+    uint64_t template_encode_cycles;
+    uint32_t generic_encodes;   /* PUBLISH packets encoded field by field */
+    uint64_t generic_encode_cycles;
+} mqttsn_client_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+cy_rslt_t mqttsn_client_init(void);
+void mqttsn_client_deinit(void);
+cy_rslt_t mqttsn_client_connect(void);
+cy_rslt_t mqttsn_client_publish(const cy_mqtt_publish_info_t *info, uint32_t *wire_bytes);
+cy_rslt_t mqttsn_client_ping(void);
+cy_rslt_t mqttsn_client_sleep(uint16_t duration_s);
+cy_rslt_t mqttsn_client_wake(void);
+cy_rslt_t mqttsn_client_disconnect(void);
+void mqttsn_client_get_stats(mqttsn_client_stats_t *stats);
+#endif /* MQTT_TRANSPORT */
+
+#endif /* MQTTSN_CLIENT_H_ */
+
+/* [] END OF FILE */
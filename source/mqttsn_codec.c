@@ -0,0 +1,464 @@
+/******************************************************************************
+* File Name:   mqttsn_codec.c
+*
+* Description: This file contains the encoder/decoder of the MQTT-SN 1.2
+*              packets used by the MQTT-SN client. Packets of up to 255 bytes
+*              use the 1-byte length field, longer ones the 3-byte form
+*              (0x01 followed by a 16-bit length). All 16-bit fields are big
+*              endian.
+*
+*              The codec has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "mqttsn_codec.h"
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* Flags field. */
+#define FLAG_DUP                          (0x80u)
+#define FLAG_QOS_0                        (0x00u)
+#define FLAG_QOS_1                        (0x20u)
+#define FLAG_QOS_MINUS_1                  (0x60u)
+#define FLAG_CLEAN_SESSION                (0x04u)
+
+/* Protocol ID of MQTT-SN 1.2 in the CONNECT packet. */
+#define PROTOCOL_ID                       (0x01u)
+
+/* Largest packet with the 1-byte length field. */
+#define SHORT_LENGTH_MAX                  (255u)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static size_t put_header(uint8_t *buf, size_t size, uint8_t type, size_t body_len);
+static void put_u16(uint8_t *buf, uint16_t value);
+static uint16_t get_u16(const uint8_t *buf);
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_connect
+ ******************************************************************************
+ * Summary:
+ *  Encodes a CONNECT packet without Will.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  const char *client_id : NUL terminated client identifier
+ *  uint16_t keep_alive_s : Keep-alive duration in seconds
+ *  bool clean_session : true to drop the registrations of an earlier session
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_connect(uint8_t *buf, size_t size, const char *client_id,
+                             uint16_t keep_alive_s, bool clean_session)
+{
+    size_t id_len = strlen(client_id);
+    size_t pos = put_header(buf, size, MQTTSN_CONNECT, 4u + id_len);
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    buf[pos++] = clean_session ? FLAG_CLEAN_SESSION : 0u;
+    buf[pos++] = PROTOCOL_ID;
+    put_u16(&buf[pos], keep_alive_s);
+    pos += 2u;
+    memcpy(&buf[pos], client_id, id_len);
+
+    return pos + id_len;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_register
+ ******************************************************************************
+ * Summary:
+ *  Encodes a REGISTER packet that asks the gateway for the topic ID of a
+ *  topic name.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  uint16_t msg_id : Message ID echoed in the REGACK
+ *  const char *topic : Topic name
+ *  size_t topic_len : Length of the topic name
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_register(uint8_t *buf, size_t size, uint16_t msg_id,
+                              const char *topic, size_t topic_len)
+{
+    size_t pos = put_header(buf, size, MQTTSN_REGISTER, 4u + topic_len);
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    /* The topic ID of a REGISTER sent by a client is 0. */
+    put_u16(&buf[pos], 0u);
+    put_u16(&buf[pos + 2u], msg_id);
+    pos += 4u;
+    memcpy(&buf[pos], topic, topic_len);
+
+    return pos + topic_len;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_publish
+ ******************************************************************************
+ * Summary:
+ *  Encodes a PUBLISH packet.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  int qos : -1, 0 or 1
+ *  bool dup : true for a retransmission
+ *  uint8_t topic_type : MQTTSN_TOPIC_NORMAL, _PREDEFINED or _SHORT
+ *  uint16_t topic_id : Topic ID, or the two characters of a short topic
+ *  uint16_t msg_id : Message ID, 0 for QoS -1 and 0
+ *  const void *payload : Payload
+ *  size_t payload_len : Length of the payload
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small or the QoS
+ *           is not supported.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_publish(uint8_t *buf, size_t size, int qos, bool dup,
+                             uint8_t topic_type, uint16_t topic_id, uint16_t msg_id,
+                             const void *payload, size_t payload_len)
+{
+    uint8_t flags;
+    size_t pos;
+
+    switch (qos)
+    {
+        case -1: flags = FLAG_QOS_MINUS_1; break;
+        case 0:  flags = FLAG_QOS_0; break;
+        case 1:  flags = FLAG_QOS_1; break;
+        default: return 0;
+    }
+
+    pos = put_header(buf, size, MQTTSN_PUBLISH, 5u + payload_len);
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    buf[pos++] = flags | (dup ? FLAG_DUP : 0u) | (topic_type & 0x03u);
+    put_u16(&buf[pos], topic_id);
+    put_u16(&buf[pos + 2u], (qos == 1) ? msg_id : 0u);
+    pos += 4u;
+    if (payload_len > 0)
+    {
+        memcpy(&buf[pos], payload, payload_len);
+    }
+
+    return pos + payload_len;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_publish_template_init
+ ******************************************************************************
+ * Summary:
+ *  Builds the PUBLISH fields of a topic for mqttsn_encode_publish_template.
+ *
+ * Parameters:
+ *  mqttsn_publish_template_t *tmpl : Template
+ *  int qos : -1, 0 or 1
+ *  uint8_t topic_type : MQTTSN_TOPIC_NORMAL, _PREDEFINED or _SHORT
+ *  uint16_t topic_id : Topic ID, or the two characters of a short topic
+ *
+ * Return:
+ *  bool : false if the QoS is not supported.
+ *
+ ******************************************************************************/
+bool mqttsn_publish_template_init(mqttsn_publish_template_t *tmpl, int qos,
+                                  uint8_t topic_type, uint16_t topic_id)
+{
+    uint8_t flags;
+
+    switch (qos)
+    {
+        case -1: flags = FLAG_QOS_MINUS_1; break;
+        case 0:  flags = FLAG_QOS_0; break;
+        case 1:  flags = FLAG_QOS_1; break;
+        default: return false;
+    }
+
+    tmpl->fields[0] = flags | (topic_type & 0x03u);
+    put_u16(&tmpl->fields[1], topic_id);
+    tmpl->has_msg_id = (qos == 1);
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_publish_template
+ ******************************************************************************
+ * Summary:
+ *  Encodes a PUBLISH packet from a template. The packet is the same as the
+ *  one of mqttsn_encode_publish with the QoS and topic of the template.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  const mqttsn_publish_template_t *tmpl : Template of the topic
+ *  bool dup : true for a retransmission
+ *  uint16_t msg_id : Message ID, ignored for QoS -1 and 0
+ *  const void *payload : Payload
+ *  size_t payload_len : Length of the payload
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_publish_template(uint8_t *buf, size_t size,
+                                      const mqttsn_publish_template_t *tmpl, bool dup,
+                                      uint16_t msg_id, const void *payload, size_t payload_len)
+{
+    size_t pos = put_header(buf, size, MQTTSN_PUBLISH, 5u + payload_len);
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    memcpy(&buf[pos], tmpl->fields, sizeof(tmpl->fields));
+    if (dup)
+    {
+        buf[pos] |= FLAG_DUP;
+    }
+    put_u16(&buf[pos + 3u], tmpl->has_msg_id ? msg_id : 0u);
+    pos += 5u;
+    if (payload_len > 0)
+    {
+        memcpy(&buf[pos], payload, payload_len);
+    }
+
+    return pos + payload_len;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_pingreq
+ ******************************************************************************
+ * Summary:
+ *  Encodes a PINGREQ packet. A sleeping client adds its client identifier to
+ *  wake up and receive the messages buffered by the gateway.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  const char *client_id : NUL terminated client identifier, or NULL
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_pingreq(uint8_t *buf, size_t size, const char *client_id)
+{
+    size_t id_len = (client_id != NULL) ? strlen(client_id) : 0u;
+    size_t pos = put_header(buf, size, MQTTSN_PINGREQ, id_len);
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+    if (id_len > 0)
+    {
+        memcpy(&buf[pos], client_id, id_len);
+    }
+
+    return pos + id_len;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_encode_disconnect
+ ******************************************************************************
+ * Summary:
+ *  Encodes a DISCONNECT packet. A non-zero duration puts the client to sleep
+ *  at the gateway, which then buffers its messages for that long.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  uint16_t duration_s : Sleep duration in seconds, 0 to disconnect
+ *
+ * Return:
+ *  size_t : Size of the packet, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t mqttsn_encode_disconnect(uint8_t *buf, size_t size, uint16_t duration_s)
+{
+    size_t pos = put_header(buf, size, MQTTSN_DISCONNECT, (duration_s > 0) ? 2u : 0u);
+
+    if (pos == 0)
+    {
+        return 0;
+    }
+    if (duration_s > 0)
+    {
+        put_u16(&buf[pos], duration_s);
+        pos += 2u;
+    }
+
+    return pos;
+}
+
+/******************************************************************************
+ * Function Name: mqttsn_decode
+ ******************************************************************************
+ * Summary:
+ *  Decodes the fields of a received packet that the client acts on.
+ *
+ * Parameters:
+ *  const uint8_t *buf : Received datagram
+ *  size_t len : Length of the datagram
+ *  mqttsn_packet_t *packet : Decoded fields
+ *
+ * Return:
+ *  bool : false if the datagram is not a well-formed packet
+ *
+ ******************************************************************************/
+bool mqttsn_decode(const uint8_t *buf, size_t len, mqttsn_packet_t *packet)
+{
+    size_t pos;
+    size_t packet_len;
+    size_t body_len;
+    const uint8_t *body;
+
+    if ((buf == NULL) || (len < 2u))
+    {
+        return false;
+    }
+
+    if (buf[0] == 0x01u)
+    {
+        if (len < 4u)
+        {
+            return false;
+        }
+        packet_len = get_u16(&buf[1]);
+        pos = 3u;
+    }
+    else
+    {
+        packet_len = buf[0];
+        pos = 1u;
+    }
+
+    if ((packet_len != len) || (packet_len <= pos))
+    {
+        return false;
+    }
+
+    memset(packet, 0, sizeof(*packet));
+    packet->type = buf[pos];
+    body = &buf[pos + 1u];
+    body_len = packet_len - pos - 1u;
+
+    switch (packet->type)
+    {
+        case MQTTSN_CONNACK:
+            if (body_len != 1u)
+            {
+                return false;
+            }
+            packet->return_code = body[0];
+            break;
+
+        case MQTTSN_REGACK:
+        case MQTTSN_PUBACK:
+            if (body_len != 5u)
+            {
+                return false;
+            }
+            packet->topic_id = get_u16(&body[0]);
+            packet->msg_id = get_u16(&body[2]);
+            packet->return_code = body[4];
+            break;
+
+        case MQTTSN_DISCONNECT:
+            if (body_len == 2u)
+            {
+                packet->duration_s = get_u16(&body[0]);
+            }
+            else if (body_len != 0u)
+            {
+                return false;
+            }
+            break;
+
+        default:
+            /* Other packets carry nothing the client needs. */
+            break;
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: put_header
+ ******************************************************************************
+ * Summary:
+ *  Writes the length and type fields of a packet.
+ *
+ * Parameters:
+ *  uint8_t *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *  uint8_t type : Packet type
+ *  size_t body_len : Length of the packet after the type field
+ *
+ * Return:
+ *  size_t : Size of the header, or 0 if the packet does not fit.
+ *
+ ******************************************************************************/
+static size_t put_header(uint8_t *buf, size_t size, uint8_t type, size_t body_len)
+{
+    size_t packet_len = 2u + body_len;
+
+    if (packet_len <= SHORT_LENGTH_MAX)
+    {
+        if ((buf == NULL) || (size < packet_len))
+        {
+            return 0;
+        }
+        buf[0] = (uint8_t)packet_len;
+        buf[1] = type;
+        return 2u;
+    }
+
+    packet_len += 2u;
+    if ((buf == NULL) || (size < packet_len) || (packet_len > UINT16_MAX))
+    {
+        return 0;
+    }
+    buf[0] = 0x01u;
+    put_u16(&buf[1], (uint16_t)packet_len);
+    buf[3] = type;
+    return 4u;
+}
+
+static void put_u16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = (uint8_t)(value >> 8);
+    buf[1] = (uint8_t)value;
+}
+
+static uint16_t get_u16(const uint8_t *buf)
+{
+    return (uint16_t)(((uint16_t)buf[0] << 8) | buf[1]);
+}
+
+/* [] END OF FILE */
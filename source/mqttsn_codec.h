@@ -0,0 +1,96 @@
+/******************************************************************************
+* File Name:   mqttsn_codec.h
+*
+* Description: This file is the public interface of mqttsn_codec.c, the
+*              encoder/decoder of the MQTT-SN 1.2 packets used by the MQTT-SN
+*              client.
+*
+*              The codec has no dependency on the HAL or on FreeRTOS so that
+*              the same file can be compiled into host tools.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef MQTTSN_CODEC_H_
+#define MQTTSN_CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Packet types used by the client. */
+#define MQTTSN_CONNECT                    (0x04u)
+#define MQTTSN_CONNACK                    (0x05u)
+#define MQTTSN_REGISTER                   (0x0Au)
+#define MQTTSN_REGACK                     (0x0Bu)
+#define MQTTSN_PUBLISH                    (0x0Cu)
+#define MQTTSN_PUBACK                     (0x0Du)
+#define MQTTSN_PINGREQ                    (0x16u)
+#define MQTTSN_PINGRESP                   (0x17u)
+#define MQTTSN_DISCONNECT                 (0x18u)
+
+/* Topic ID types. */
+#define MQTTSN_TOPIC_NORMAL               (0x00u)
+#define MQTTSN_TOPIC_PREDEFINED           (0x01u)
+#define MQTTSN_TOPIC_SHORT                (0x02u)
+
+/* Return code of an accepted request. */
+#define MQTTSN_RC_ACCEPTED                (0x00u)
+
+/* Size of the acknowledgements of REGISTER and PUBLISH. */
+#define MQTTSN_ACK_SIZE                   (7u)
+
+/* Overhead of a PUBLISH packet with a short length field. */
+#define MQTTSN_PUBLISH_OVERHEAD           (7u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Fields of a received packet. Fields that the packet type does not carry are
+ * 0.
+ */
+typedef struct
+{
+    uint8_t type;
+    uint8_t return_code;
+    uint16_t topic_id;
+    uint16_t msg_id;
+    uint16_t duration_s;
+} mqttsn_packet_t;
+
+/* PUBLISH fields that depend only on the topic and the QoS: the flags without
+ * DUP and the topic ID. Built once per topic, so a publish only writes the
+ * length, the DUP flag, the message ID and the payload.
+ */
+typedef struct
+{
+    uint8_t fields[3];
+    bool has_msg_id;
+} mqttsn_publish_template_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+size_t mqttsn_encode_connect(uint8_t *buf, size_t size, const char *client_id,
+                             uint16_t keep_alive_s, bool clean_session);
+size_t mqttsn_encode_register(uint8_t *buf, size_t size, uint16_t msg_id,
+                              const char *topic, size_t topic_len);
+size_t mqttsn_encode_publish(uint8_t *buf, size_t size, int qos, bool dup,
+                             uint8_t topic_type, uint16_t topic_id, uint16_t msg_id,
+                             const void *payload, size_t payload_len);
+bool mqttsn_publish_template_init(mqttsn_publish_template_t *tmpl, int qos,
+                                  uint8_t topic_type, uint16_t topic_id);
+size_t mqttsn_encode_publish_template(uint8_t *buf, size_t size,
+                                      const mqttsn_publish_template_t *tmpl, bool dup,
+                                      uint16_t msg_id, const void *payload, size_t payload_len);
+size_t mqttsn_encode_pingreq(uint8_t *buf, size_t size, const char *client_id);
+size_t mqttsn_encode_disconnect(uint8_t *buf, size_t size, uint16_t duration_s);
+bool mqttsn_decode(const uint8_t *buf, size_t len, mqttsn_packet_t *packet);
+
+#endif /* MQTTSN_CODEC_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,326 @@
+/******************************************************************************
+* File Name:   nn_runtime.c
+*
+* Description: This file contains a small int8 inference engine for dense and
+*              conv1d layers. A model is a constant blob in flash (see
+*              nn_runtime.h for the format) that is validated and planned once
+*              by nn_model_load(): the activations of consecutive layers are
+*              placed at opposite ends of a caller-provided arena, so the
+*              arena must hold the input and output of the largest layer and
+*              no memory is allocated at run time.
+*
+*              On cores with the DSP extension (Cortex-M4) the dot products
+*              use the dual 16-bit multiply-accumulate instructions, four int8
+*              pairs per step. All arithmetic is exact integer arithmetic, so
+*              the results are bit-exact against the portable reference
+*              kernel, which is also used on hosts without the DSP extension.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "nn_runtime.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#define NN_RUNTIME_USE_DSP                (1)
+#else
+#define NN_RUNTIME_USE_DSP                (0)
+#endif
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool validate_layer(const nn_layer_desc_t *layer, size_t blob_size,
+                           uint32_t in_size, uint32_t *out_size);
+static int32_t dot_s8_reference(const int8_t *weights, const int8_t *input,
+                                size_t count, int32_t input_offset);
+static int32_t dot_s8(const int8_t *weights, const int8_t *input,
+                      size_t count, int32_t input_offset);
+static int8_t requantize(int32_t acc, const nn_layer_desc_t *layer);
+static void run_layer(const nn_model_t *model, const nn_layer_desc_t *layer,
+                      const int8_t *input, int8_t *output, bool reference);
+
+/******************************************************************************
+ * Function Name: nn_model_load
+ ******************************************************************************
+ * Summary:
+ *  Validates a model blob and plans the activations of its layers in an
+ *  arena of the given size.
+ *
+ * Parameters:
+ *  nn_model_t *model : Model to be loaded
+ *  const uint8_t *blob : Model blob, 4-byte aligned
+ *  size_t blob_size : Size of the blob
+ *  size_t arena_size : Size of the arena that will be passed to nn_model_run()
+ *
+ * Return:
+ *  bool : true if the blob is valid and the largest layer fits in the arena
+ *
+ ******************************************************************************/
+bool nn_model_load(nn_model_t *model, const uint8_t *blob, size_t blob_size,
+                   size_t arena_size)
+{
+    const nn_model_header_t *header = (const nn_model_header_t *)blob;
+    uint32_t in_size;
+    uint32_t out_size;
+    size_t layers_end;
+
+    memset(model, 0, sizeof(nn_model_t));
+
+    if ((blob == NULL) || (((uintptr_t)blob & 3u) != 0) ||
+        (blob_size < sizeof(nn_model_header_t)) ||
+        (header->magic != NN_MODEL_MAGIC) || (header->version != NN_MODEL_VERSION) ||
+        (header->layer_count == 0) || (header->layer_count > NN_MAX_LAYERS) ||
+        (header->input_size == 0))
+    {
+        return false;
+    }
+
+    layers_end = sizeof(nn_model_header_t) + (header->layer_count * sizeof(nn_layer_desc_t));
+    if (layers_end > blob_size)
+    {
+        return false;
+    }
+
+    model->blob = blob;
+    model->header = header;
+    model->layers = (const nn_layer_desc_t *)&blob[sizeof(nn_model_header_t)];
+
+    /* Layer i reads from one end of the arena and writes to the other. */
+    in_size = header->input_size;
+    for (uint16_t i = 0; i < header->layer_count; i++)
+    {
+        if (!validate_layer(&model->layers[i], blob_size, in_size, &out_size) ||
+            ((size_t)in_size + out_size > arena_size))
+        {
+            return false;
+        }
+
+        model->out_size[i] = out_size;
+        if ((i % 2u) == 0)
+        {
+            model->in_offset[i] = 0;
+            model->out_offset[i] = (uint32_t)arena_size - out_size;
+        }
+        else
+        {
+            model->in_offset[i] = (uint32_t)arena_size - in_size;
+            model->out_offset[i] = 0;
+        }
+
+        if ((size_t)in_size + out_size > model->arena_peak)
+        {
+            model->arena_peak = (size_t)in_size + out_size;
+        }
+        in_size = out_size;
+    }
+
+    return (in_size == header->output_size);
+}
+
+/******************************************************************************
+ * Function Name: nn_model_run
+ ******************************************************************************
+ * Summary:
+ *  Runs an inference.
+ *
+ * Parameters:
+ *  const nn_model_t *model : Model loaded by nn_model_load()
+ *  const int8_t *input : Input tensor of 'input_size' bytes
+ *  int8_t *arena : Arena of the size passed to nn_model_load()
+ *  bool reference : true to use the portable reference kernel
+ *
+ * Return:
+ *  const int8_t * : Output tensor of 'output_size' bytes inside the arena,
+ *                   valid until the next inference
+ *
+ ******************************************************************************/
+const int8_t *nn_model_run(const nn_model_t *model, const int8_t *input,
+                           int8_t *arena, bool reference)
+{
+    /* nn_model_load() rejects a model without layers. */
+    uint16_t last = (uint16_t)(model->header->layer_count - 1u);
+
+    memcpy(&arena[model->in_offset[0]], input, model->header->input_size);
+
+    for (uint16_t i = 0; i <= last; i++)
+    {
+        run_layer(model, &model->layers[i], &arena[model->in_offset[i]],
+                  &arena[model->out_offset[i]], reference);
+    }
+
+    return &arena[model->out_offset[last]];
+}
+
+/* Checks the shape, parameters and data offsets of a layer and returns the
+ * size of its output.
+ */
+static bool validate_layer(const nn_layer_desc_t *layer, size_t blob_size,
+                           uint32_t in_size, uint32_t *out_size)
+{
+    uint32_t out_length;
+    uint32_t weights_size;
+
+    if ((layer->kernel == 0) || (layer->stride == 0) || (layer->in_channels == 0) ||
+        (layer->in_length == 0) || (layer->out_channels == 0) ||
+        (layer->activation > NN_ACTIVATION_RELU) ||
+        (layer->input_offset < -127) || (layer->input_offset > 128) ||
+        (layer->output_offset < -128) || (layer->output_offset > 127) ||
+        (layer->multiplier <= 0) || (layer->shift < 0) || (layer->shift > 30) ||
+        (((uint32_t)layer->in_channels * layer->in_length) != in_size))
+    {
+        return false;
+    }
+
+    switch (layer->type)
+    {
+        case NN_LAYER_DENSE:
+        {
+            if ((layer->kernel != 1u) || (layer->stride != 1u))
+            {
+                return false;
+            }
+            out_length = 1u;
+            weights_size = (uint32_t)layer->out_channels * in_size;
+            break;
+        }
+
+        case NN_LAYER_CONV1D:
+        {
+            if (layer->kernel > layer->in_length)
+            {
+                return false;
+            }
+            out_length = (((uint32_t)layer->in_length - layer->kernel) / layer->stride) + 1u;
+            weights_size = (uint32_t)layer->out_channels * layer->kernel * layer->in_channels;
+            break;
+        }
+
+        default:
+        {
+            return false;
+        }
+    }
+
+    if ((layer->weights_offset > blob_size) || (weights_size > blob_size - layer->weights_offset) ||
+        (layer->bias_offset > blob_size) ||
+        (((uint32_t)layer->out_channels * sizeof(int32_t)) > blob_size - layer->bias_offset))
+    {
+        return false;
+    }
+
+    *out_size = out_length * layer->out_channels;
+    return true;
+}
+
+/* Sum of weights[i] * (input[i] + input_offset), one pair per step. */
+static int32_t dot_s8_reference(const int8_t *weights, const int8_t *input,
+                                size_t count, int32_t input_offset)
+{
+    int32_t acc = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        acc += (int32_t)weights[i] * ((int32_t)input[i] + input_offset);
+    }
+
+    return acc;
+}
+
+/* Same as dot_s8_reference(), four pairs per step with the DSP extension:
+ * the bytes are sign-extended into 16-bit halves (even and odd bytes), the
+ * input offset is added to both halves by SXTAB16 and SMLAD accumulates two
+ * products at a time. input + offset is within -255..255, so the halves do
+ * not overflow.
+ */
+static int32_t dot_s8(const int8_t *weights, const int8_t *input,
+                      size_t count, int32_t input_offset)
+{
+    int32_t acc = 0;
+    size_t i = 0;
+
+#if NN_RUNTIME_USE_DSP
+    uint32_t offset_pair = ((uint32_t)input_offset & 0xFFFFu) * 0x00010001u;
+    uint32_t w;
+    uint32_t x;
+
+    for (; (i + 4u) <= count; i += 4u)
+    {
+        memcpy(&w, &weights[i], sizeof(w));
+        memcpy(&x, &input[i], sizeof(x));
+
+        acc = (int32_t)__SMLAD(__SXTB16(w), __SXTAB16(offset_pair, x), (uint32_t)acc);
+        acc = (int32_t)__SMLAD(__SXTB16(__ROR(w, 8)), __SXTAB16(offset_pair, __ROR(x, 8)),
+                               (uint32_t)acc);
+    }
+#endif
+
+    return acc + dot_s8_reference(&weights[i], &input[i], count - i, input_offset);
+}
+
+/* Scales an accumulator to the output zero point and range of a layer. */
+static int8_t requantize(int32_t acc, const nn_layer_desc_t *layer)
+{
+    int32_t total_shift = 31 + layer->shift;
+    int64_t scaled = ((int64_t)acc * layer->multiplier) + ((int64_t)1 << (total_shift - 1));
+    int32_t value = (int32_t)(scaled >> total_shift) + layer->output_offset;
+    int32_t low = (layer->activation == NN_ACTIVATION_RELU) ? layer->output_offset : -128;
+
+    if (value < low)
+    {
+        value = low;
+    }
+    if (value > 127)
+    {
+        value = 127;
+    }
+
+    return (int8_t)value;
+}
+
+/* Runs one layer. A dense layer is a convolution whose kernel spans the whole
+ * flattened input; with channels-last tensors the input window of every
+ * output position is contiguous, so both reduce to the same dot product.
+ */
+static void run_layer(const nn_model_t *model, const nn_layer_desc_t *layer,
+                      const int8_t *input, int8_t *output, bool reference)
+{
+    const int8_t *weights = (const int8_t *)&model->blob[layer->weights_offset];
+    const uint8_t *biases = &model->blob[layer->bias_offset];
+    size_t window;
+    size_t step;
+    size_t out_length;
+    int32_t bias;
+    int32_t acc;
+
+    if (layer->type == NN_LAYER_DENSE)
+    {
+        window = (size_t)layer->in_channels * layer->in_length;
+        step = 0;
+        out_length = 1u;
+    }
+    else
+    {
+        window = (size_t)layer->kernel * layer->in_channels;
+        step = (size_t)layer->stride * layer->in_channels;
+        out_length = (((uint32_t)layer->in_length - layer->kernel) / layer->stride) + 1u;
+    }
+
+    for (size_t position = 0; position < out_length; position++)
+    {
+        for (size_t channel = 0; channel < layer->out_channels; channel++)
+        {
+            memcpy(&bias, &biases[channel * sizeof(int32_t)], sizeof(bias));
+            acc = reference ?
+                  dot_s8_reference(&weights[channel * window], &input[position * step],
+                                   window, layer->input_offset) :
+                  dot_s8(&weights[channel * window], &input[position * step],
+                         window, layer->input_offset);
+            output[(position * layer->out_channels) + channel] = requantize(acc + bias, layer);
+        }
+    }
+}
+
+/* [] END OF FILE */
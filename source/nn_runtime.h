@@ -0,0 +1,107 @@
+/******************************************************************************
+* File Name:   nn_runtime.h
+*
+* Description: This file is the public interface of nn_runtime.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef NN_RUNTIME_H_
+#define NN_RUNTIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* First word of a model blob ("NN08", little endian) and its format version. */
+#define NN_MODEL_MAGIC                    (0x3830304Eu)
+#define NN_MODEL_VERSION                  (1u)
+
+/* Maximum number of layers of a model. */
+#define NN_MAX_LAYERS                     (8u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Layer types. */
+typedef enum
+{
+    NN_LAYER_DENSE = 1,
+    NN_LAYER_CONV1D = 2
+} nn_layer_type_t;
+
+/* Activations applied when the accumulator is requantized. */
+typedef enum
+{
+    NN_ACTIVATION_NONE = 0,
+    NN_ACTIVATION_RELU = 1
+} nn_activation_t;
+
+/* Header at the start of a model blob. The blob must be 4-byte aligned and is
+ * laid out as: header, 'layer_count' layer descriptors, then the weights and
+ * biases at the offsets given in the descriptors. All fields are little
+ * endian.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t layer_count;
+    uint16_t input_size;        /* Bytes of the int8 input tensor */
+    uint16_t output_size;       /* Bytes of the int8 output tensor */
+} nn_model_header_t;
+
+/* Layer descriptor. Tensors are int8 and channels-last ([length][channels]);
+ * a dense layer flattens its input. Weights are int8 with a zero point of 0,
+ * laid out as [out_channels][kernel][in_channels] (dense: [out][in]); biases
+ * are int32 per output channel. Convolutions use valid padding.
+ *
+ * The int32 accumulator of every output is requantized as
+ * round(acc * multiplier / 2^(31 + shift)) + output_offset and saturated to
+ * int8; ReLU saturates at output_offset instead of -128.
+ */
+typedef struct
+{
+    uint8_t type;               /* nn_layer_type_t */
+    uint8_t activation;         /* nn_activation_t */
+    uint8_t kernel;             /* Conv1d kernel size (dense: 1) */
+    uint8_t stride;             /* Conv1d stride (dense: 1) */
+    uint16_t in_channels;       /* Dense: number of inputs */
+    uint16_t in_length;         /* Dense: 1 */
+    uint16_t out_channels;
+    uint16_t reserved;
+    int32_t input_offset;       /* Negated zero point of the input */
+    int32_t output_offset;      /* Zero point of the output */
+    int32_t multiplier;         /* Q31 requantization multiplier */
+    int32_t shift;              /* Additional right shift, 0..30 */
+    uint32_t weights_offset;    /* Offset of the weights in the blob */
+    uint32_t bias_offset;       /* Offset of the biases in the blob */
+} nn_layer_desc_t;
+
+/* Model loaded from a blob, with the arena plan of every layer. */
+typedef struct
+{
+    const uint8_t *blob;
+    const nn_model_header_t *header;
+    const nn_layer_desc_t *layers;
+    uint32_t in_offset[NN_MAX_LAYERS];
+    uint32_t out_offset[NN_MAX_LAYERS];
+    uint32_t out_size[NN_MAX_LAYERS];
+    size_t arena_peak;          /* Arena bytes used by the largest layer */
+} nn_model_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+bool nn_model_load(nn_model_t *model, const uint8_t *blob, size_t blob_size,
+                   size_t arena_size);
+const int8_t *nn_model_run(const nn_model_t *model, const int8_t *input,
+                           int8_t *arena, bool reference);
+
+#endif /* NN_RUNTIME_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,408 @@
+/******************************************************************************
+* File Name:   nn_task.c
+*
+* Description: This file contains the task that classifies radar activations
+*              with the int8 inference engine. The publisher task forwards
+*              every raw TD/PD edge; when a TD pulse ends, its features are
+*              appended to a window of the last NN_WINDOW_PULSES pulses and
+*              the model classifies the window as person, animal or foliage.
+*
+*              Features of a pulse, each quantized to int8 (zero point -128):
+*               - width in units of 32 ms, saturated at 255
+*               - time since the previous pulse of the same sensor in units of
+*                 64 ms, saturated at 255
+*               - PD seen during the pulse: 255 or 0
+*               - ambient light: 0..100 % mapped to 0..255
+*
+*              The model blob is linked into flash by overriding
+*              nn_model_get_blob().
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "nn_task.h"
+#include "nn_runtime.h"
+#include "radar_config.h"
+#include "cycle_counter.h"
+#include "app_time.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Number of raw edges that can wait for the classifier. */
+#define NN_EDGE_QUEUE_LENGTH              (8u)
+
+/* Saturation of the time features. */
+#define NN_FEATURE_MAX                    (255u)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+#if ENABLE_NN_CLASSIFIER
+static bool load_model(void);
+static void append_pulse(uint32_t width_ms, uint32_t gap_ms, bool pd_seen, uint8_t light);
+static void classify(void);
+#endif
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+#if ENABLE_NN_CLASSIFIER
+/* Raw edge forwarded by the publisher task. */
+typedef struct
+{
+    radar_fusion_input_t edge;
+    uint8_t light;
+} nn_edge_t;
+
+/* TD pulse tracking of one sensor. */
+typedef struct
+{
+    bool active;
+    bool pd_seen;
+    uint32_t onset_ms;
+    uint32_t last_release_ms;
+} nn_pulse_state_t;
+
+/* Queue of raw edges, created once the model is loaded. */
+static QueueHandle_t nn_edge_q;
+
+/* Model and its static activation arena. */
+static nn_model_t model;
+static int8_t arena[NN_ARENA_SIZE] __attribute__((aligned(4)));
+
+/* Input window, oldest pulse first, and the number of pulses in it. */
+static int8_t window[NN_INPUT_SIZE];
+static uint32_t window_pulses;
+
+static nn_pulse_state_t pulses[RADAR_SENSOR_COUNT];
+
+/* Statistics, and the inference count and cycles of the current window. */
+static nn_task_stats_t stats;
+static uint64_t total_cycles;
+static uint32_t window_inferences;
+static uint32_t window_start_ms;
+#endif
+
+/******************************************************************************
+ * Function Name: nn_model_get_blob
+ ******************************************************************************
+ * Summary:
+ *  Returns the model blob. Weak default without a model; an application
+ *  links its model by defining this function next to the generated blob,
+ *  which must be 4-byte aligned.
+ *
+ * Parameters:
+ *  size_t *size : Size of the blob
+ *
+ * Return:
+ *  const uint8_t * : Model blob, or NULL
+ *
+ ******************************************************************************/
+__WEAK const uint8_t *nn_model_get_blob(size_t *size)
+{
+    *size = 0;
+    return NULL;
+}
+
+#if ENABLE_NN_CLASSIFIER
+/******************************************************************************
+ * Function Name: nn_task
+ ******************************************************************************
+ * Summary:
+ *  Loads the model, then extracts pulse features from the forwarded radar
+ *  edges and classifies every new window.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void nn_task(void *pvParameters)
+{
+    nn_edge_t item;
+    nn_pulse_state_t *pulse;
+    bool active;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    if (!load_model())
+    {
+        vTaskSuspend(NULL);
+    }
+
+    cycle_counter_init();
+    window_start_ms = app_time_now_ms();
+    nn_edge_q = xQueueCreate(NN_EDGE_QUEUE_LENGTH, sizeof(nn_edge_t));
+
+    while (true)
+    {
+        if (pdTRUE != xQueueReceive(nn_edge_q, &item, portMAX_DELAY))
+        {
+            continue;
+        }
+
+        if (item.edge.sensor >= RADAR_SENSOR_COUNT)
+        {
+            continue;
+        }
+        pulse = &pulses[item.edge.sensor];
+
+        /* TD is active low. */
+        active = !item.edge.td_level;
+        if (active && !pulse->active)
+        {
+            pulse->onset_ms = item.edge.timestamp_ms;
+            pulse->pd_seen = item.edge.pd_level;
+        }
+        else if (active)
+        {
+            pulse->pd_seen |= item.edge.pd_level;
+        }
+        else if (pulse->active)
+        {
+            append_pulse(item.edge.timestamp_ms - pulse->onset_ms,
+                         pulse->onset_ms - pulse->last_release_ms,
+                         pulse->pd_seen, item.light);
+            pulse->last_release_ms = item.edge.timestamp_ms;
+
+            if (window_pulses >= NN_WINDOW_PULSES)
+            {
+                classify();
+            }
+        }
+        pulse->active = active;
+    }
+}
+
+/******************************************************************************
+ * Function Name: nn_task_post_edge
+ ******************************************************************************
+ * Summary:
+ *  Forwards a raw radar edge to the classifier without blocking. Called by
+ *  the publisher task.
+ *
+ * Parameters:
+ *  const radar_fusion_input_t *edge : Raw TD/PD levels at the edge
+ *  uint8_t light : Ambient light level in percent
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void nn_task_post_edge(const radar_fusion_input_t *edge, uint8_t light)
+{
+    nn_edge_t item = { .edge = *edge, .light = light };
+
+    if ((nn_edge_q != NULL) && (pdTRUE != xQueueSend(nn_edge_q, &item, 0)))
+    {
+        taskENTER_CRITICAL();
+        stats.dropped_edges++;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/******************************************************************************
+ * Function Name: nn_task_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the inference statistics.
+ *
+ * Parameters:
+ *  nn_task_stats_t *out : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void nn_task_get_stats(nn_task_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = stats;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: nn_task_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the inference counters, timing and class counts for the
+ *  get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t nn_task_format_stats(char *buf, size_t size)
+{
+    nn_task_stats_t stats;
+    int len;
+
+    nn_task_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "nn_model_loaded %u\n"
+                   "nn_inferences %lu\n"
+                   "nn_inferences_per_sec_x100 %lu\n"
+                   "nn_capacity_per_sec_estimate %lu\n"
+                   "nn_inference_us avg %lu max %lu\n"
+                   "nn_arena_peak_bytes %lu\n"
+                   "nn_dropped_edges %lu\n"
+                   "nn_classes person %lu animal %lu foliage %lu\n",
+                   (unsigned int)stats.model_loaded,
+                   (unsigned long)stats.inferences,
+                   (unsigned long)stats.inferences_per_sec_x100,
+                   (unsigned long)stats.capacity_per_sec_estimate,
+                   (unsigned long)stats.inference_avg_us,
+                   (unsigned long)stats.inference_max_us,
+                   (unsigned long)stats.arena_peak_bytes,
+                   (unsigned long)stats.dropped_edges,
+                   (unsigned long)stats.class_count[NN_CLASS_PERSON],
+                   (unsigned long)stats.class_count[NN_CLASS_ANIMAL],
+                   (unsigned long)stats.class_count[NN_CLASS_FOLIAGE]);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+/* Loads the model blob and checks that the SIMD and reference kernels agree
+ * on a test pattern.
+ */
+static bool load_model(void)
+{
+    const uint8_t *blob;
+    const int8_t *output;
+    int8_t expected[NN_CLASS_COUNT];
+    size_t size;
+
+    blob = nn_model_get_blob(&size);
+    if (!nn_model_load(&model, blob, size, sizeof(arena)))
+    {
+        printf("NN: No valid model blob, or the largest layer does not fit in %u bytes\n",
+               (unsigned int)sizeof(arena));
+        return false;
+    }
+    if ((model.header->input_size != NN_INPUT_SIZE) ||
+        (model.header->output_size != NN_CLASS_COUNT))
+    {
+        printf("NN: Model shape %u -> %u does not match %u -> %u\n",
+               model.header->input_size, model.header->output_size,
+               (unsigned int)NN_INPUT_SIZE, (unsigned int)NN_CLASS_COUNT);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < NN_INPUT_SIZE; i++)
+    {
+        window[i] = (int8_t)((i * 37u) & 0xFFu);
+    }
+    output = nn_model_run(&model, window, arena, true);
+    memcpy(expected, output, sizeof(expected));
+    output = nn_model_run(&model, window, arena, false);
+    if (memcmp(expected, output, sizeof(expected)) != 0)
+    {
+        printf("NN: SIMD and reference kernels disagree\n");
+        return false;
+    }
+    memset(window, -128, sizeof(window));
+
+    stats.model_loaded = true;
+    stats.arena_peak_bytes = (uint32_t)model.arena_peak;
+    printf("NN: Model with %u layers loaded, arena %u of %u bytes\n",
+           model.header->layer_count, (unsigned int)model.arena_peak,
+           (unsigned int)sizeof(arena));
+
+    return true;
+}
+
+/* Quantizes the features of a finished pulse into the newest window slot. */
+static void append_pulse(uint32_t width_ms, uint32_t gap_ms, bool pd_seen, uint8_t light)
+{
+    int8_t *slot = &window[NN_INPUT_SIZE - NN_FEATURES_PER_PULSE];
+    uint32_t width = width_ms / 32u;
+    uint32_t gap = gap_ms / 64u;
+
+    memmove(window, &window[NN_FEATURES_PER_PULSE], NN_INPUT_SIZE - NN_FEATURES_PER_PULSE);
+
+    slot[0] = (int8_t)((int32_t)((width < NN_FEATURE_MAX) ? width : NN_FEATURE_MAX) - 128);
+    slot[1] = (int8_t)((int32_t)((gap < NN_FEATURE_MAX) ? gap : NN_FEATURE_MAX) - 128);
+    slot[2] = pd_seen ? 127 : -128;
+    slot[3] = (int8_t)((int32_t)(((uint32_t)((light < 100u) ? light : 100u) * 255u) / 100u) - 128);
+
+    if (window_pulses < NN_WINDOW_PULSES)
+    {
+        window_pulses++;
+    }
+}
+
+/* Runs the model on the window and updates the statistics. */
+static void classify(void)
+{
+    static const char * const class_names[NN_CLASS_COUNT] = { "person", "animal", "foliage" };
+    const int8_t *output;
+    uint32_t start_cycles;
+    uint32_t cycles;
+    uint32_t elapsed_ms;
+    uint32_t best = 0;
+
+    start_cycles = cycle_counter_get();
+    output = nn_model_run(&model, window, arena, false);
+    cycles = cycle_counter_get() - start_cycles;
+
+    for (uint32_t i = 1; i < NN_CLASS_COUNT; i++)
+    {
+        if (output[i] > output[best])
+        {
+            best = i;
+        }
+    }
+
+    total_cycles += cycles;
+    window_inferences++;
+    elapsed_ms = app_time_now_ms() - window_start_ms;
+
+    taskENTER_CRITICAL();
+    stats.inferences++;
+    stats.class_count[best]++;
+    stats.inference_avg_us = cycle_counter_to_us((uint32_t)(total_cycles / stats.inferences));
+    if (cycle_counter_to_us(cycles) > stats.inference_max_us)
+    {
+        stats.inference_max_us = cycle_counter_to_us(cycles);
+    }
+    stats.capacity_per_sec_estimate = (total_cycles > 0) ?
+                                      (uint32_t)(((uint64_t)SystemCoreClock * stats.inferences) / total_cycles) : 0;
+    if (elapsed_ms >= NN_STATS_WINDOW_MS)
+    {
+        stats.inferences_per_sec_x100 = (window_inferences * 100000u) / elapsed_ms;
+        window_inferences = 0;
+        window_start_ms += elapsed_ms;
+    }
+    taskEXIT_CRITICAL();
+
+    printf("NN: %s (%d %d %d)\n", class_names[best], output[0], output[1], output[2]);
+}
+#endif /* ENABLE_NN_CLASSIFIER */
+
+/* [] END OF FILE */
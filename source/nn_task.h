@@ -0,0 +1,76 @@
+/******************************************************************************
+* File Name:   nn_task.h
+*
+* Description: This file is the public interface of nn_task.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef NN_TASK_H_
+#define NN_TASK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "nn_config.h"
+#include "radar_fusion.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the NN Classifier Task. */
+#define NN_TASK_PRIORITY                  (1)
+#define NN_TASK_STACK_SIZE                (1024 * 1)
+
+/* Features of one TD pulse in the input window. */
+#define NN_FEATURES_PER_PULSE             (4u)
+
+/* Size of the int8 input tensor of the model: [NN_WINDOW_PULSES][features]. */
+#define NN_INPUT_SIZE                     (NN_WINDOW_PULSES * NN_FEATURES_PER_PULSE)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Classes of the int8 output tensor of the model, in this order. */
+typedef enum
+{
+    NN_CLASS_PERSON,
+    NN_CLASS_ANIMAL,
+    NN_CLASS_FOLIAGE,
+    NN_CLASS_COUNT
+} nn_class_t;
+
+/* Inference statistics. */
+typedef struct
+{
+    bool model_loaded;
+    uint32_t inferences;
+    uint32_t inferences_per_sec_x100;   /* Over the last NN_STATS_WINDOW_MS */
+    uint32_t capacity_per_sec_estimate; /* Inferences/s extrapolated from the average cost */
+    uint32_t inference_avg_us;
+    uint32_t inference_max_us;
+    uint32_t arena_peak_bytes;
+    uint32_t dropped_edges;
+    uint32_t class_count[NN_CLASS_COUNT];
+} nn_task_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+const uint8_t *nn_model_get_blob(size_t *size);
+
+#if ENABLE_NN_CLASSIFIER
+void nn_task(void *pvParameters);
+void nn_task_post_edge(const radar_fusion_input_t *edge, uint8_t light);
+void nn_task_get_stats(nn_task_stats_t *stats);
+size_t nn_task_format_stats(char *buf, size_t size);
+#else
+#define nn_task_post_edge(edge, light)    do { (void)(edge); (void)(light); } while (0)
+#endif /* ENABLE_NN_CLASSIFIER */
+
+#endif /* NN_TASK_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,191 @@
+/******************************************************************************
+* File Name:   occupancy_predictor.c
+*
+* Description: This file contains the occupancy predictor. It learns, for
+*              every time-of-week bin, the probability that somebody arrives
+*              within that bin. When a bin ends, its probability moves towards
+*              1 if there was an arrival and towards 0 otherwise by
+*              1/2^decay_shift, so old weeks fade out exponentially. The
+*              memory is fixed (one 16-bit value per bin) and every update is
+*              O(1) per minute.
+*
+*              The pump is pre-started when the probability of the current bin,
+*              or of the next bin within 'lead_minutes' of its start, reaches
+*              the threshold. The predictor scores its own decisions: an
+*              arrival during a pre-start window is a hit, an arrival outside
+*              one is a miss, and the minutes of a window that ends without an
+*              arrival are wasted pump minutes.
+*
+*              The predictor has no dependency on the HAL or FreeRTOS, so a
+*              recorded trace can be scored on a host by calling
+*              occupancy_predictor_tick() once per minute of the trace.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "occupancy_predictor.h"
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void close_bin(occupancy_predictor_t *predictor, uint16_t bin, bool arrived);
+static bool prestart_wanted(const occupancy_predictor_t *predictor, uint16_t minute_of_week);
+
+/******************************************************************************
+ * Function Name: occupancy_predictor_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes a predictor with all probabilities at zero.
+ *
+ * Parameters:
+ *  occupancy_predictor_t *predictor : Predictor to be initialized
+ *  uint8_t decay_shift : Learning rate 1/2^decay_shift per week
+ *  uint16_t threshold : Pre-start probability, OCCUPANCY_PROBABILITY_ONE = 1
+ *  uint16_t lead_minutes : Minutes before a likely bin to pre-start
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void occupancy_predictor_init(occupancy_predictor_t *predictor, uint8_t decay_shift,
+                              uint16_t threshold, uint16_t lead_minutes)
+{
+    memset(predictor, 0, sizeof(occupancy_predictor_t));
+    predictor->decay_shift = decay_shift;
+    predictor->threshold = threshold;
+    predictor->lead_minutes = lead_minutes;
+}
+
+/******************************************************************************
+ * Function Name: occupancy_predictor_tick
+ ******************************************************************************
+ * Summary:
+ *  Advances the predictor to 'minute_of_week', learns from the bins that
+ *  ended since the last tick and decides whether the pump is pre-started.
+ *  Expected to be called once per minute.
+ *
+ * Parameters:
+ *  occupancy_predictor_t *predictor : Predictor
+ *  uint16_t minute_of_week : Minutes since Sunday 00:00
+ *  bool arrival : true if presence started since the last tick
+ *
+ * Return:
+ *  bool : true while the pump should be pre-started
+ *
+ ******************************************************************************/
+bool occupancy_predictor_tick(occupancy_predictor_t *predictor, uint16_t minute_of_week,
+                              bool arrival)
+{
+    uint16_t bin;
+    uint16_t closed;
+
+    minute_of_week %= OCCUPANCY_MINUTES_PER_WEEK;
+    bin = minute_of_week / OCCUPANCY_BIN_MINUTES;
+
+    if (!predictor->started)
+    {
+        predictor->started = true;
+        predictor->current_bin = bin;
+    }
+
+    /* Learn from every bin that ended, including bins skipped by a gap. */
+    for (closed = 0; (predictor->current_bin != bin) && (closed < OCCUPANCY_BINS); closed++)
+    {
+        close_bin(predictor, predictor->current_bin, predictor->arrived_in_bin);
+        predictor->arrived_in_bin = false;
+        predictor->current_bin = (uint16_t)((predictor->current_bin + 1u) % OCCUPANCY_BINS);
+    }
+
+    if (arrival)
+    {
+        predictor->arrived_in_bin = true;
+        if (predictor->prestart_active)
+        {
+            /* Presence takes over the pump from here. */
+            predictor->score.hits++;
+            predictor->prestart_active = false;
+        }
+        else
+        {
+            predictor->score.misses++;
+        }
+    }
+
+    if (!predictor->arrived_in_bin && prestart_wanted(predictor, minute_of_week))
+    {
+        if (!predictor->prestart_active)
+        {
+            predictor->prestart_active = true;
+            predictor->prestart_minutes = 0;
+            predictor->score.prestarts++;
+        }
+        predictor->prestart_minutes++;
+    }
+    else if (predictor->prestart_active)
+    {
+        predictor->prestart_active = false;
+        predictor->score.wasted_minutes += predictor->prestart_minutes;
+    }
+
+    return predictor->prestart_active;
+}
+
+/******************************************************************************
+ * Function Name: occupancy_predictor_probability
+ ******************************************************************************
+ * Summary:
+ *  Returns the learned arrival probability of the bin of 'minute_of_week'.
+ *
+ * Parameters:
+ *  const occupancy_predictor_t *predictor : Predictor
+ *  uint16_t minute_of_week : Minutes since Sunday 00:00
+ *
+ * Return:
+ *  uint16_t : Probability, OCCUPANCY_PROBABILITY_ONE = 1
+ *
+ ******************************************************************************/
+uint16_t occupancy_predictor_probability(const occupancy_predictor_t *predictor,
+                                         uint16_t minute_of_week)
+{
+    return predictor->probability[(minute_of_week % OCCUPANCY_MINUTES_PER_WEEK) /
+                                  OCCUPANCY_BIN_MINUTES];
+}
+
+void occupancy_predictor_get_score(const occupancy_predictor_t *predictor,
+                                   occupancy_score_t *score)
+{
+    *score = predictor->score;
+}
+
+/* Moves the probability of a bin that ended towards its outcome. */
+static void close_bin(occupancy_predictor_t *predictor, uint16_t bin, bool arrived)
+{
+    uint16_t p = predictor->probability[bin];
+
+    if (arrived)
+    {
+        p = (uint16_t)(p + ((OCCUPANCY_PROBABILITY_ONE - p) >> predictor->decay_shift));
+    }
+    else
+    {
+        p = (uint16_t)(p - (p >> predictor->decay_shift));
+    }
+
+    predictor->probability[bin] = p;
+}
+
+/* Pre-start within a likely bin, or within the lead time of the next one. */
+static bool prestart_wanted(const occupancy_predictor_t *predictor, uint16_t minute_of_week)
+{
+    uint16_t bin = minute_of_week / OCCUPANCY_BIN_MINUTES;
+    uint16_t next_bin = (uint16_t)((bin + 1u) % OCCUPANCY_BINS);
+    uint16_t minutes_to_next = (uint16_t)(((bin + 1u) * OCCUPANCY_BIN_MINUTES) - minute_of_week);
+
+    return (predictor->probability[bin] >= predictor->threshold) ||
+           ((minutes_to_next <= predictor->lead_minutes) &&
+            (predictor->probability[next_bin] >= predictor->threshold));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,68 @@
+/******************************************************************************
+* File Name:   occupancy_predictor.h
+*
+* Description: This file is the public interface of occupancy_predictor.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef OCCUPANCY_PREDICTOR_H_
+#define OCCUPANCY_PREDICTOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Width of one time-of-week bin in minutes and the resulting number of bins. */
+#define OCCUPANCY_BIN_MINUTES             (10u)
+#define OCCUPANCY_MINUTES_PER_WEEK        (7u * 24u * 60u)
+#define OCCUPANCY_BINS                    (OCCUPANCY_MINUTES_PER_WEEK / OCCUPANCY_BIN_MINUTES)
+
+/* Fixed-point one of the arrival probabilities. */
+#define OCCUPANCY_PROBABILITY_ONE         (0xFFFFu)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Score of the pre-start decisions. */
+typedef struct
+{
+    uint32_t prestarts;         /* Pre-start windows opened */
+    uint32_t hits;              /* Arrivals during a pre-start window */
+    uint32_t misses;            /* Arrivals without a pre-start window */
+    uint32_t wasted_minutes;    /* Pump minutes of windows without arrival */
+} occupancy_score_t;
+
+/* Predictor state. All fields are private to occupancy_predictor.c. */
+typedef struct
+{
+    uint16_t probability[OCCUPANCY_BINS];
+    uint16_t current_bin;
+    bool started;
+    bool arrived_in_bin;
+    uint8_t decay_shift;
+    uint16_t threshold;
+    uint16_t lead_minutes;
+    bool prestart_active;
+    uint32_t prestart_minutes;
+    occupancy_score_t score;
+} occupancy_predictor_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void occupancy_predictor_init(occupancy_predictor_t *predictor, uint8_t decay_shift,
+                              uint16_t threshold, uint16_t lead_minutes);
+bool occupancy_predictor_tick(occupancy_predictor_t *predictor, uint16_t minute_of_week,
+                              bool arrival);
+uint16_t occupancy_predictor_probability(const occupancy_predictor_t *predictor,
+                                         uint16_t minute_of_week);
+void occupancy_predictor_get_score(const occupancy_predictor_t *predictor,
+                                   occupancy_score_t *score);
+
+#endif /* OCCUPANCY_PREDICTOR_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,208 @@
+/******************************************************************************
+* File Name:   occupancy_task.c
+*
+* Description: This file contains the task that runs the occupancy predictor.
+*              Once per minute it feeds the time of week and whether presence
+*              started during the minute into the predictor, and publishes a
+*              pre-start on MQTT_PRESTART_TOPIC whenever the decision changes.
+*              The effect sequencer runs the pump during a pre-start as well.
+*              Nothing is learned or published until the wall clock is set.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "occupancy_task.h"
+#include "publisher_task.h"
+#include "effect_sequencer.h"
+#include "app_time.h"
+#include "wall_clock.h"
+
+/* Configuration file for MQTT client */
+#include "mqtt_client_config.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+
+#if ENABLE_OCCUPANCY_PREDICTOR
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Predictor, owned by this task. */
+static occupancy_predictor_t predictor;
+
+/* Set by the publisher task when the fused presence starts. */
+static volatile bool arrival_pending;
+
+/* Copy of the score for other tasks. */
+static occupancy_score_t last_score;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool read_minute_of_week(uint16_t *minute);
+
+/******************************************************************************
+ * Function Name: occupancy_task
+ ******************************************************************************
+ * Summary:
+ *  Advances the predictor once per minute and publishes pre-start changes.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void occupancy_task(void *pvParameters)
+{
+    publisher_data_t publisher_q_data;
+    bool prestart = false;
+    bool next_prestart;
+    bool arrival;
+    uint16_t minute;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    occupancy_predictor_init(&predictor, OCCUPANCY_DECAY_SHIFT,
+                             (uint16_t)((OCCUPANCY_PRESTART_THRESHOLD_PERCENT * OCCUPANCY_PROBABILITY_ONE) / 100u),
+                             OCCUPANCY_PRESTART_LEAD_MINUTES);
+
+    while (true)
+    {
+        app_time_delay_ms(OCCUPANCY_TICK_MS);
+
+        if (!read_minute_of_week(&minute))
+        {
+            continue;
+        }
+
+        arrival = __atomic_exchange_n(&arrival_pending, false, __ATOMIC_RELAXED);
+        next_prestart = occupancy_predictor_tick(&predictor, minute, arrival);
+
+        taskENTER_CRITICAL();
+        occupancy_predictor_get_score(&predictor, &last_score);
+        taskEXIT_CRITICAL();
+
+        if (next_prestart != prestart)
+        {
+            prestart = next_prestart;
+            effect_sequencer_set_prestart(prestart);
+
+            publisher_q_data.cmd = PUBLISH_PRESTART;
+            publisher_q_data.data = prestart ? MQTT_DEVICE_ON_MESSAGE : MQTT_DEVICE_OFF_MESSAGE;
+            (void)publisher_task_send(&publisher_q_data, 0);
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: occupancy_note_arrival
+ ******************************************************************************
+ * Summary:
+ *  Records that the fused presence started. Called by the publisher task.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void occupancy_note_arrival(void)
+{
+    arrival_pending = true;
+}
+
+/******************************************************************************
+ * Function Name: occupancy_get_score
+ ******************************************************************************
+ * Summary:
+ *  Returns the pre-start hits, misses and wasted pump minutes.
+ *
+ * Parameters:
+ *  occupancy_score_t *score : Output score
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void occupancy_get_score(occupancy_score_t *score)
+{
+    taskENTER_CRITICAL();
+    *score = last_score;
+    taskEXIT_CRITICAL();
+}
+
+/* Minutes since Sunday 00:00 local time, from the wall clock or from the
+ * virtual clock. Returns false while the wall clock is not set.
+ */
+static bool read_minute_of_week(uint16_t *minute)
+{
+#if ENABLE_VIRTUAL_TIME
+    *minute = (uint16_t)((app_time_now_ms() / 60000u) % OCCUPANCY_MINUTES_PER_WEEK);
+#else
+    struct tm now;
+
+    if (!wall_clock_read(&now))
+    {
+        return false;
+    }
+
+    *minute = (uint16_t)((now.tm_wday * 24 * 60) + (now.tm_hour * 60) + now.tm_min);
+#endif
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: occupancy_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the pre-start score for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t occupancy_format_stats(char *buf, size_t size)
+{
+    occupancy_score_t score;
+    int len;
+
+    occupancy_get_score(&score);
+    len = snprintf(buf, size,
+                   "prestarts %lu hits %lu misses %lu\n"
+                   "prestart_wasted_minutes %lu\n",
+                   (unsigned long)score.prestarts,
+                   (unsigned long)score.hits,
+                   (unsigned long)score.misses,
+                   (unsigned long)score.wasted_minutes);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_OCCUPANCY_PREDICTOR */
+
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/******************************************************************************
+* File Name:   occupancy_task.h
+*
+* Description: This file is the public interface of occupancy_task.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef OCCUPANCY_TASK_H_
+#define OCCUPANCY_TASK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "occupancy_config.h"
+#include "occupancy_predictor.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Occupancy Task. */
+#define OCCUPANCY_TASK_PRIORITY           (1)
+#define OCCUPANCY_TASK_STACK_SIZE         (1024 * 1)
+
+/* Interval at which the predictor is advanced. */
+#define OCCUPANCY_TICK_MS                 (60000u)
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_OCCUPANCY_PREDICTOR
+void occupancy_task(void *pvParameters);
+void occupancy_note_arrival(void);
+void occupancy_get_score(occupancy_score_t *score);
+size_t occupancy_format_stats(char *buf, size_t size);
+#else
+#define occupancy_note_arrival()          do { } while (0)
+#endif /* ENABLE_OCCUPANCY_PREDICTOR */
+
+#endif /* OCCUPANCY_TASK_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,188 @@
+/******************************************************************************
+* File Name:   presence_history.c
+*
+* Description: This file contains the presence/light history ring. The
+*              publisher task records a sample on every radar TD edge and the
+*              history can be dumped in the compact columnar format of
+*              column_codec.c for upload over MQTT.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "presence_history.h"
+#include "cycle_counter.h"
+#include "app_time.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* History ring and its bookkeeping. */
+static column_codec_sample_t history[PRESENCE_HISTORY_LENGTH];
+static uint32_t history_head;
+static uint32_t history_count;
+
+/* Samples in chronological order, used as the input for the encoder. */
+static column_codec_sample_t history_linear[PRESENCE_HISTORY_LENGTH];
+
+/* Latest ambient light level, stored with every recorded sample. */
+static volatile uint8_t latest_light;
+
+/* Mutex protecting the history ring. */
+static SemaphoreHandle_t history_mutex;
+
+/******************************************************************************
+ * Function Name: presence_history_init
+ ******************************************************************************
+ * Summary:
+ *  Creates the mutex protecting the history ring. Must be called once before
+ *  any other function of this file.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void presence_history_init(void)
+{
+    history_mutex = xSemaphoreCreateMutex();
+    configASSERT(history_mutex != NULL);
+    cycle_counter_init();
+}
+
+/******************************************************************************
+ * Function Name: presence_history_set_light
+ ******************************************************************************
+ * Summary:
+ *  Updates the ambient light level stored with subsequent samples.
+ *
+ * Parameters:
+ *  uint8_t light : Ambient light level in percent
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void presence_history_set_light(uint8_t light)
+{
+    latest_light = light;
+}
+
+/******************************************************************************
+ * Function Name: presence_history_get_light
+ ******************************************************************************
+ * Summary:
+ *  Returns the latest ambient light level.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  uint8_t : Ambient light level in percent
+ *
+ ******************************************************************************/
+uint8_t presence_history_get_light(void)
+{
+    return latest_light;
+}
+
+/******************************************************************************
+ * Function Name: presence_history_record
+ ******************************************************************************
+ * Summary:
+ *  Appends a sample with the current time and light level to the history.
+ *
+ * Parameters:
+ *  bool td : State of the radar target detect line
+ *  bool pd : State of the radar phase detect line
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void presence_history_record(bool td, bool pd)
+{
+    column_codec_sample_t sample =
+    {
+        .timestamp_ms = app_time_now_ms(),
+        .light = latest_light,
+        .td = td,
+        .pd = pd
+    };
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+
+    history[history_head] = sample;
+    history_head = (history_head + 1u) % PRESENCE_HISTORY_LENGTH;
+    if (history_count < PRESENCE_HISTORY_LENGTH)
+    {
+        history_count++;
+    }
+
+    xSemaphoreGive(history_mutex);
+}
+
+/******************************************************************************
+ * Function Name: presence_history_encode
+ ******************************************************************************
+ * Summary:
+ *  Encodes the history, oldest sample first, into 'out'. The compression
+ *  ratio and the encode time are returned in 'stats'.
+ *
+ * Parameters:
+ *  uint8_t *out : Output buffer
+ *  size_t out_size : Size of the output buffer. PRESENCE_HISTORY_MAX_ENCODED_SIZE
+ *                    is always sufficient.
+ *  bool clear : Empty the history after a successful encode
+ *  presence_history_stats_t *stats : Encode statistics (can be NULL)
+ *
+ * Return:
+ *  size_t : Number of bytes written, or 0 on failure.
+ *
+ ******************************************************************************/
+size_t presence_history_encode(uint8_t *out, size_t out_size, bool clear,
+                               presence_history_stats_t *stats)
+{
+    size_t encoded_size;
+    uint32_t count;
+    uint32_t start_cycles;
+    uint32_t oldest;
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+
+    count = history_count;
+    oldest = (history_head + PRESENCE_HISTORY_LENGTH - count) % PRESENCE_HISTORY_LENGTH;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        history_linear[i] = history[(oldest + i) % PRESENCE_HISTORY_LENGTH];
+    }
+
+    start_cycles = cycle_counter_get();
+    encoded_size = column_codec_encode(history_linear, count, out, out_size);
+
+    if (stats != NULL)
+    {
+        stats->encode_time_us = cycle_counter_to_us(cycle_counter_get() - start_cycles);
+        stats->sample_count = count;
+        stats->raw_bytes = count * COLUMN_CODEC_RAW_SAMPLE_SIZE;
+        stats->encoded_bytes = (uint32_t)encoded_size;
+    }
+
+    if (clear && (encoded_size != 0))
+    {
+        history_count = 0;
+    }
+
+    xSemaphoreGive(history_mutex);
+
+    return encoded_size;
+}
+
+/* [] END OF FILE */
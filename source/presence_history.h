@@ -0,0 +1,53 @@
+/******************************************************************************
+* File Name:   presence_history.h
+*
+* Description: This file is the public interface of presence_history.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef PRESENCE_HISTORY_H_
+#define PRESENCE_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "column_codec.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Number of samples kept in the presence/light history ring. When the ring is
+ * full the oldest sample is overwritten.
+ */
+#define PRESENCE_HISTORY_LENGTH           (256u)
+
+/* Output buffer size that can always hold the encoded history. */
+#define PRESENCE_HISTORY_MAX_ENCODED_SIZE COLUMN_CODEC_MAX_ENCODED_SIZE(PRESENCE_HISTORY_LENGTH)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Statistics of the last encode operation. */
+typedef struct
+{
+    uint32_t sample_count;
+    uint32_t raw_bytes;
+    uint32_t encoded_bytes;
+    uint32_t encode_time_us;
+} presence_history_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void presence_history_init(void);
+void presence_history_set_light(uint8_t light);
+uint8_t presence_history_get_light(void);
+void presence_history_record(bool td, bool pd);
+size_t presence_history_encode(uint8_t *out, size_t out_size, bool clear,
+                               presence_history_stats_t *stats);
+
+#endif /* PRESENCE_HISTORY_H_ */
+
+/* [] END OF FILE */
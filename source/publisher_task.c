@@ -4,8 +4,9 @@
 * Description: This file contains the task that sets up the user button GPIO 
 *              for the publisher and publishes MQTT messages on the topic
 *              'MQTT_PUB_TOPIC' to control a device that is actuated by the
-*              subscriber task. The file also contains the ISR that notifies
-*              the publisher task about the new device state to be published.
+*              subscriber task. The file also contains the ISR that passes the
+*              radar TD/PD edges to the publisher task through the ISR signal
+*              layer.
 *
 * Related Document: See README.md
 *
@@ -43,6 +44,8 @@
 * so agrees to indemnify Cypress against all liability.
 *******************************************************************************/
 
+#include <stdio.h>
+#include <string.h>
 #include "cyhal.h"
 #include "cybsp.h"
 #include "FreeRTOS.h"
@@ -51,20 +54,38 @@
 #include "publisher_task.h"
 #include "mqtt_task.h"
 #include "subscriber_task.h"
-
-/* Configuration file for MQTT client */
+#include "presence_history.h"
+#include "mqtt_rpc.h"
+#include "effect_sequencer.h"
+#include "occupancy_task.h"
+#include "actuation_task.h"
+#include "app_time.h"
+#include "edge_classifier.h"
+#include "nn_task.h"
+#include "cycle_counter.h"
+#include "burst_connect.h"
+#include "mqttsn_client.h"
+#include "isr_signal.h"
+#include "metrics.h"
+#include "deadline_monitor.h"
+#include "rtt_probe.h"
+
+/* Configuration files for MQTT client, radar sensors and interrupt priorities */
 #include "mqtt_client_config.h"
+#include "radar_config.h"
+#include "irq_priority_config.h"
 
 /* Middleware libraries */
 #include "cy_mqtt_api.h"
 #include "cy_retarget_io.h"
 
+#if (RADAR_SENSOR_COUNT > RADAR_FUSION_MAX_SENSORS)
+#error "RADAR_SENSOR_COUNT exceeds RADAR_FUSION_MAX_SENSORS of the fusion stage and the edge classifier"
+#endif
+
 /******************************************************************************
 * Macros
 ******************************************************************************/
-/* Interrupt priority for User Button Input. */
-#define USER_BTN_INTR_PRIORITY          (3)
-
 /* The maximum number of times each PUBLISH in this example will be retried. */
 #define PUBLISH_RETRY_LIMIT             (10)
 
@@ -74,9 +95,25 @@
 #define PUBLISH_RETRY_MS                (1000)
 
 /* Queue length of a message queue that is used to communicate with the 
- * publisher task.
+ * publisher task. Every radar sensor can have a rising and a falling TD edge
+ * of the radar replay pending.
+ */
+#define PUBLISHER_TASK_QUEUE_LENGTH     (3u + (2u * RADAR_SENSOR_COUNT))
+
+/* Radar edges the stream buffer of the radar ISR holds. */
+#define RADAR_EDGE_BUFFER_LENGTH        (4u * RADAR_SENSOR_COUNT)
+
+/* Bytes added to every TLS record: 5 bytes of header, an 8-byte explicit
+ * nonce and a 16-byte tag with AES-GCM.
+ */
+#define TLS_RECORD_OVERHEAD             (29u)
+
+/* IPv4 and TCP header bytes of every segment, and the size of the PUBACK,
+ * PUBREC, PUBREL and PUBCOMP packets, used to estimate the bytes on the wire
+ * of a TCP publish.
  */
-#define PUBLISHER_TASK_QUEUE_LENGTH     (3u)
+#define TCP_IP_OVERHEAD                 (40u)
+#define MQTT_ACK_PACKET_SIZE            (4u)
 
 /******************************************************************************
 * Function Prototypes
@@ -84,6 +121,21 @@
 static void publisher_init(void);
 static void publisher_deinit(void);
 static void isr_button_press(void *callback_arg, cyhal_gpio_event_t event);
+static void publish_message(const char *topic, const char *payload);
+static void publish_payload(const char *topic, const char *payload, size_t payload_len,
+                            bool urgent);
+static void send_publish(const cy_mqtt_publish_info_t *info, uint32_t packet_size, bool urgent);
+#if !ENABLE_BURST_CONNECT
+static void publish_now(const cy_mqtt_publish_info_t *info, uint32_t packet_size);
+#endif
+static void handle_command(const publisher_data_t *publisher_q_data);
+static void handle_radar_edge(const radar_fusion_input_t *edge);
+static void handle_radar_input(const radar_fusion_input_t *input);
+static TickType_t next_classifier_wait(void);
+static uint32_t publish_packet_size(const cy_mqtt_publish_info_t *info);
+static uint32_t publish_write_count(const cy_mqtt_publish_info_t *info);
+static uint32_t tcp_wire_bytes(const cy_mqtt_publish_info_t *info, uint32_t packet_size);
+static bool payload_is_text(const cy_mqtt_publish_info_t *info);
 void print_heap_usage(char *msg);
 
 /******************************************************************************
@@ -95,6 +147,25 @@ TaskHandle_t publisher_task_handle;
 /* Handle of the queue holding the commands for the publisher task */
 QueueHandle_t publisher_task_q;
 
+/* Number of successful and failed MQTT publish operations. */
+uint32_t publish_count;
+uint32_t publish_failure_count;
+
+/* Bytes of the serialized PUBLISH packets, and an estimate of the bytes the
+ * transport copies to send them, computed from the packet size rather than
+ * counted at the socket: the packet into the lwIP buffers, and with TLS first
+ * into the record buffer, one record per write of the MQTT library.
+ */
+uint32_t publish_bytes;
+uint32_t publish_copy_bytes_estimate;
+
+/* Bytes on the wire of the successful publishes including acknowledgements
+ * and headers, and the cycles from handing a message to the transport until
+ * it is published (and acknowledged for QoS > 0).
+ */
+uint32_t publish_wire_bytes;
+publish_cycles_t publish_transport_cycles;
+
 /* Structure to store publish message information. */
 cy_mqtt_publish_info_t publish_info =
 {
@@ -105,12 +176,26 @@ cy_mqtt_publish_info_t publish_info =
     .dup = false
 };
 
-/* Structure that stores the callback data for the GPIO interrupt event. */
-cyhal_gpio_callback_data_t cb_data =
-{
-    .callback = isr_button_press,
-    .callback_arg = NULL
-};
+/* Pin table of the radar sensors. */
+const radar_sensor_config_t radar_sensors[RADAR_SENSOR_COUNT] = RADAR_SENSOR_TABLE;
+
+/* Structures that store the callback data for the GPIO interrupt event of
+ * each radar TD line. The callback argument is the index of the sensor.
+ */
+static cyhal_gpio_callback_data_t cb_data[RADAR_SENSOR_COUNT];
+
+/* Fusion of the TD/PD lines of all radar sensors. */
+static radar_fusion_t radar_fusion;
+
+#if ENABLE_EDGE_CLASSIFIER
+/* Classifier that suppresses spurious TD activations ahead of the fusion stage,
+ * a snapshot of its counters for the get-stats command, and the largest cost
+ * of classifying one edge.
+ */
+static edge_classifier_t edge_classifier;
+static edge_classifier_stats_t edge_classifier_stats;
+static uint32_t edge_classifier_max_cycles;
+#endif
 
 /******************************************************************************
  * Function Name: publisher_task
@@ -130,80 +215,684 @@ cyhal_gpio_callback_data_t cb_data =
  ******************************************************************************/
 void publisher_task(void *pvParameters)
 {
-    /* Status variable */
-    cy_rslt_t result;
-
     publisher_data_t publisher_q_data;
+    radar_fusion_input_t radar_input;
+    uint32_t signal_bits;
 
-    /* Command to the MQTT client task */
-    mqtt_task_cmd_t mqtt_task_cmd;
+    /* Zones of the radar sensors for the fusion stage. */
+    uint8_t radar_zones[RADAR_SENSOR_COUNT];
 
     /* To avoid compiler warnings */
     (void) pvParameters;
 
-    /* Initialize and set-up the user button GPIO. */
-    publisher_init();
+    for (uint32_t i = 0; i < RADAR_SENSOR_COUNT; i++)
+    {
+        radar_zones[i] = radar_sensors[i].zone;
+    }
+    radar_fusion_init(&radar_fusion, radar_zones, RADAR_SENSOR_COUNT,
+                      RADAR_FUSION_VOTE_THRESHOLD, RADAR_FUSION_DIRECTION_WINDOW_MS);
+
+#if ENABLE_EDGE_CLASSIFIER
+    const edge_classifier_config_t classifier_config =
+    {
+        .genuine_min_ms = EDGE_CLASSIFIER_GENUINE_MIN_MS,
+        .burst_gap_ms = EDGE_CLASSIFIER_BURST_GAP_MS,
+        .max_hold_ms = EDGE_CLASSIFIER_MAX_HOLD_MS,
+        .dusk_light_min = EDGE_CLASSIFIER_DUSK_LIGHT_MIN,
+        .dusk_light_max = EDGE_CLASSIFIER_DUSK_LIGHT_MAX
+    };
+    edge_classifier_init(&edge_classifier, RADAR_SENSOR_COUNT, &classifier_config);
+#endif
+    cycle_counter_init();
 
     /* Create a message queue to communicate with other tasks and callbacks. */
     publisher_task_q = xQueueCreate(PUBLISHER_TASK_QUEUE_LENGTH, sizeof(publisher_data_t));
 
+    /* The radar ISR passes its edges through a stream buffer. */
+    if (!isr_signal_register(ISR_SIGNAL_RADAR_TD, xTaskGetCurrentTaskHandle(),
+                             sizeof(radar_fusion_input_t), RADAR_EDGE_BUFFER_LENGTH))
+    {
+        printf("Publisher: Radar edge buffer allocation failed\n");
+        vTaskSuspend(NULL);
+    }
+
+    /* Initialize and set-up the radar sensor GPIOs. */
+    publisher_init();
+
     while (true)
     {
-        /* Wait for commands from other tasks and callbacks. */
-        if (pdTRUE == xQueueReceive(publisher_task_q, &publisher_q_data, portMAX_DELAY))
+        /* Wait for radar edges from the ISR and for commands from other tasks
+         * and callbacks, or until a held radar activation must be decided.
+         */
+        signal_bits = isr_signal_wait(next_classifier_wait());
+        if ((signal_bits & ISR_SIGNAL_BIT(ISR_SIGNAL_RADAR_TD)) != 0)
+        {
+            deadline_monitor_record(DEADLINE_RADAR_EDGE,
+                                    isr_signal_last_wake_us(ISR_SIGNAL_RADAR_TD));
+        }
+
+        while (isr_signal_receive(ISR_SIGNAL_RADAR_TD, &radar_input))
+        {
+            handle_radar_edge(&radar_input);
+        }
+        while (pdTRUE == xQueueReceive(publisher_task_q, &publisher_q_data, 0))
+        {
+            handle_command(&publisher_q_data);
+        }
+
+#if ENABLE_EDGE_CLASSIFIER
+        /* Report the held activations whose hold has expired. */
+        radar_fusion_input_t expired;
+        while (edge_classifier_poll(&edge_classifier, app_time_now_ms(), &expired))
+        {
+            taskENTER_CRITICAL();
+            edge_classifier_get_stats(&edge_classifier, &edge_classifier_stats);
+            taskEXIT_CRITICAL();
+
+            handle_radar_input(&expired);
+        }
+#endif
+    }
+}
+
+/******************************************************************************
+ * Function Name: publisher_task_send
+ ******************************************************************************
+ * Summary:
+ *  Queues a command to the publisher task and wakes the task. Must not be
+ *  called from an ISR; interrupts signal the task through isr_signal.c.
+ *
+ * Parameters:
+ *  const publisher_data_t *publisher_q_data : Command and its data
+ *  TickType_t ticks_to_wait : Time to wait for room in the queue
+ *
+ * Return:
+ *  bool : false if the task is not running or the queue stayed full
+ *
+ ******************************************************************************/
+bool publisher_task_send(const publisher_data_t *publisher_q_data, TickType_t ticks_to_wait)
+{
+    QueueHandle_t queue;
+
+    taskENTER_CRITICAL();
+    queue = publisher_task_q;
+    taskEXIT_CRITICAL();
+
+    if ((queue == NULL) || (xQueueSend(queue, publisher_q_data, ticks_to_wait) != pdTRUE))
+    {
+        return false;
+    }
+
+    /* The MQTT client task clears the handle before it deletes the task,
+     * also while the send above was blocked.
+     */
+    taskENTER_CRITICAL();
+    if (publisher_task_handle != NULL)
+    {
+        (void)xTaskNotify(publisher_task_handle, ISR_SIGNAL_BIT_TASK, eSetBits);
+    }
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: handle_command
+ ******************************************************************************
+ * Summary:
+ *  Runs a command received over the publisher task queue.
+ *
+ * Parameters:
+ *  const publisher_data_t *publisher_q_data : Command and its data
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void handle_command(const publisher_data_t *publisher_q_data)
+{
+    switch(publisher_q_data->cmd)
+    {
+        case PUBLISHER_INIT:
+        {
+            /* Initialize and set-up the radar sensor GPIOs. */
+            publisher_init();
+            break;
+        }
+
+        case PUBLISHER_DEINIT:
+        {
+            /* Deinit the radar sensor GPIOs and corresponding interrupts. */
+            publisher_deinit();
+            break;
+        }
+
+        case PUBLISH_MQTT_MSG:
+        {
+            /* Publish the data received over the message queue. */
+            publish_message(MQTT_PUB_TOPIC, publisher_q_data->data);
+            break;
+        }
+
+        case PUBLISH_PRESTART:
+        {
+            /* Publish the pump pre-start of the occupancy predictor. */
+            publish_message(MQTT_PRESTART_TOPIC, publisher_q_data->data);
+            break;
+        }
+
+        case PUBLISH_ACTUATION:
+        {
+            /* Publish the latency report of the actuation verifier. */
+            publish_message(MQTT_ACTUATION_TOPIC, publisher_q_data->data);
+            break;
+        }
+
+        case PUBLISH_METRICS:
+        {
+            /* Publish a snapshot of the metrics registry. */
+            publish_payload(MQTT_METRICS_TOPIC, publisher_q_data->data,
+                            publisher_q_data->data_len, false);
+            break;
+        }
+
+        case PUBLISH_METRICS_SCHEMA:
+        {
+            /* Publish the schema of the binary metrics snapshots. */
+            publish_payload(MQTT_METRICS_SCHEMA_TOPIC, publisher_q_data->data,
+                            publisher_q_data->data_len, false);
+            break;
+        }
+
+        case PUBLISH_RTT_PROBE:
+        {
+            /* Publish the broker round-trip time probe. */
+            rtt_probe_publish();
+            break;
+        }
+
+        case RADAR_EDGE:
         {
-            switch(publisher_q_data.cmd)
-            {
-                case PUBLISHER_INIT:
-                {
-                    /* Initialize and set-up the user button GPIO. */
-                    publisher_init();
-                    break;
-                }
-
-                case PUBLISHER_DEINIT:
-                {
-                    /* Deinit the user button GPIO and corresponding interrupt. */
-                    publisher_deinit();
-                    break;
-                }
-
-                case PUBLISH_MQTT_MSG:
-                {
-                    /* Publish the data received over the message queue. */
-                    publish_info.payload = publisher_q_data.data;
-                    publish_info.payload_len = strlen(publish_info.payload);
-
-                    printf("\nPublisher: Publishing '%s' on the topic '%s'\n",
-                           (char *) publish_info.payload, publish_info.topic);
-
-                    result = cy_mqtt_publish(mqtt_connection, &publish_info);
-
-                    if (result != CY_RSLT_SUCCESS)
-                    {
-                        printf("  Publisher: MQTT Publish failed with error 0x%0X.\n\n", (int)result);
-
-                        /* Communicate the publish failure with the the MQTT 
-                         * client task.
-                         */
-                        mqtt_task_cmd = HANDLE_MQTT_PUBLISH_FAILURE;
-                        xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
-                    }
-
-                    print_heap_usage("publisher_task: After publishing an MQTT message");
-                    break;
-                }
-            }
+            /* Edge of the radar replay. */
+            handle_radar_edge(&publisher_q_data->radar);
+            break;
         }
     }
 }
 
+/******************************************************************************
+ * Function Name: handle_radar_edge
+ ******************************************************************************
+ * Summary:
+ *  Records a raw radar edge and passes it through the edge classifier, if
+ *  enabled, to the fusion stage.
+ *
+ * Parameters:
+ *  const radar_fusion_input_t *edge : Raw radar edge
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void handle_radar_edge(const radar_fusion_input_t *edge)
+{
+    /* Record the raw radar state in the presence/light history, so that it
+     * can be replayed through the classifier offline.
+     */
+    presence_history_record(edge->td_level, edge->pd_level);
+    metrics_counter_inc(METRIC_RADAR_EDGES);
+
+    /* The NN classifier works on the raw edges as well. */
+    nn_task_post_edge(edge, presence_history_get_light());
+
+#if ENABLE_EDGE_CLASSIFIER
+    radar_fusion_input_t classified;
+    uint32_t start_cycles = cycle_counter_get();
+    bool pass = edge_classifier_process(&edge_classifier, edge,
+                                        presence_history_get_light(), &classified);
+    uint32_t cycles = cycle_counter_get() - start_cycles;
+
+    taskENTER_CRITICAL();
+    edge_classifier_get_stats(&edge_classifier, &edge_classifier_stats);
+    if (cycles > edge_classifier_max_cycles)
+    {
+        edge_classifier_max_cycles = cycles;
+    }
+    taskEXIT_CRITICAL();
+
+    if (pass)
+    {
+        handle_radar_input(&classified);
+    }
+#else
+    handle_radar_input(edge);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: handle_radar_input
+ ******************************************************************************
+ * Summary:
+ *  Updates the fusion stage with a radar edge and publishes the presence
+ *  state when it changes.
+ *
+ * Parameters:
+ *  const radar_fusion_input_t *input : Radar edge
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void handle_radar_input(const radar_fusion_input_t *input)
+{
+    /* Publish only when the fused presence state changes. */
+    bool presence_changed = radar_fusion_update(&radar_fusion, input);
+    radar_fused_state_t fused = radar_fusion_get_state(&radar_fusion);
+
+    if (presence_changed)
+    {
+        const char *message = fused.presence ? MQTT_DEVICE_ON_MESSAGE : MQTT_DEVICE_OFF_MESSAGE;
+
+        /* In burst-connect mode, a presence rise is sent right away. */
+        publish_payload(MQTT_PUB_TOPIC, message, strlen(message), fused.presence);
+        actuation_note_command(fused.presence);
+        if (fused.presence)
+        {
+            occupancy_note_arrival();
+        }
+    }
+
+    /* The effect also follows direction changes. */
+    effect_sequencer_set_presence(fused.presence, fused.approaching);
+}
+
+/******************************************************************************
+ * Function Name: next_classifier_wait
+ ******************************************************************************
+ * Summary:
+ *  Returns how long the publisher task may block before the earliest held
+ *  radar activation must be decided.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  TickType_t : Wait timeout in ticks
+ *
+ ******************************************************************************/
+static TickType_t next_classifier_wait(void)
+{
+#if ENABLE_EDGE_CLASSIFIER
+    uint32_t deadline_ms;
+    int32_t remaining_ms;
+
+    if (edge_classifier_next_deadline(&edge_classifier, &deadline_ms))
+    {
+        remaining_ms = (int32_t)(deadline_ms - app_time_now_ms());
+        return (remaining_ms > 0) ? pdMS_TO_TICKS((uint32_t)remaining_ms) : 0;
+    }
+#endif
+
+    return portMAX_DELAY;
+}
+
+/******************************************************************************
+ * Function Name: publisher_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the publish counters, bytes and transport time for the get-stats
+ *  RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t publisher_format_stats(char *buf, size_t size)
+{
+    int len;
+
+    len = snprintf(buf, size,
+                   "publish_count %lu\n"
+                   "publish_failures %lu\n"
+                   "publish_bytes %lu copied_estimate %lu\n"
+                   "publish_wire_bytes_per_event %lu time_to_publish_us %lu\n",
+                   (unsigned long)publish_count,
+                   (unsigned long)publish_failure_count,
+                   (unsigned long)publish_bytes,
+                   (unsigned long)publish_copy_bytes_estimate,
+                   (unsigned long)((publish_count > 0) ? (publish_wire_bytes / publish_count) : 0),
+                   (unsigned long)cycle_counter_to_us((publish_transport_cycles.count > 0) ?
+                                   (uint32_t)(publish_transport_cycles.total / publish_transport_cycles.count) : 0));
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#if ENABLE_EDGE_CLASSIFIER
+/******************************************************************************
+ * Function Name: publisher_get_edge_classifier_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the counters of the radar edge classifier and the largest time
+ *  spent classifying one edge.
+ *
+ * Parameters:
+ *  edge_classifier_stats_t *stats : Classifier counters
+ *  uint32_t *max_edge_us : Largest cost of one edge in microseconds
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void publisher_get_edge_classifier_stats(edge_classifier_stats_t *stats, uint32_t *max_edge_us)
+{
+    uint32_t max_cycles;
+
+    taskENTER_CRITICAL();
+    *stats = edge_classifier_stats;
+    max_cycles = edge_classifier_max_cycles;
+    taskEXIT_CRITICAL();
+
+    *max_edge_us = cycle_counter_to_us(max_cycles);
+}
+
+/******************************************************************************
+ * Function Name: publisher_format_edge_classifier_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the radar edge classifier counters for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t publisher_format_edge_classifier_stats(char *buf, size_t size)
+{
+    edge_classifier_stats_t stats;
+    uint32_t max_edge_us;
+    int len;
+
+    publisher_get_edge_classifier_stats(&stats, &max_edge_us);
+    len = snprintf(buf, size,
+                   "radar_activations %lu\n"
+                   "radar_passed immediate %lu held %lu\n"
+                   "radar_suppressed %lu\n"
+                   "radar_hold_ms dark %lu dusk %lu day %lu\n"
+                   "radar_classify_max_us %lu\n",
+                   (unsigned long)stats.activations,
+                   (unsigned long)stats.passed_immediately,
+                   (unsigned long)stats.passed_after_hold,
+                   (unsigned long)stats.suppressed,
+                   (unsigned long)stats.hold_ms[0],
+                   (unsigned long)stats.hold_ms[1],
+                   (unsigned long)stats.hold_ms[2],
+                   (unsigned long)max_edge_us);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+#endif
+
+/******************************************************************************
+ * Function Name: publish_message
+ ******************************************************************************
+ * Summary:
+ *  Publishes a NUL terminated message.
+ *
+ * Parameters:
+ *  const char *topic : NUL terminated topic
+ *  const char *payload : NUL terminated message to be published
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void publish_message(const char *topic, const char *payload)
+{
+    publish_payload(topic, payload, strlen(payload), false);
+}
+
+/******************************************************************************
+ * Function Name: publish_payload
+ ******************************************************************************
+ * Summary:
+ *  Publishes a payload of the given length, which may be binary.
+ *
+ * Parameters:
+ *  const char *topic : NUL terminated topic
+ *  const char *payload : Payload to be published
+ *  size_t payload_len : Length of the payload
+ *  bool urgent : Starts a burst right away in burst-connect mode
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void publish_payload(const char *topic, const char *payload, size_t payload_len,
+                            bool urgent)
+{
+    publish_info.topic = topic;
+    publish_info.topic_len = strlen(topic);
+    publish_info.payload = payload;
+    publish_info.payload_len = payload_len;
+
+    send_publish(&publish_info, publish_packet_size(&publish_info), urgent);
+}
+
+/******************************************************************************
+ * Function Name: send_publish
+ ******************************************************************************
+ * Summary:
+ *  Publishes a prepared message, or buffers it until the next burst in
+ *  burst-connect mode.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Publish descriptor
+ *  uint32_t packet_size : Size of the serialized PUBLISH packet
+ *  bool urgent : Starts a burst right away in burst-connect mode
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void send_publish(const cy_mqtt_publish_info_t *info, uint32_t packet_size, bool urgent)
+{
+#if ENABLE_BURST_CONNECT
+    /* The node is not connected between bursts: buffer a copy of the
+     * message.
+     */
+    (void)packet_size;
+    burst_connect_post(info, urgent);
+#else
+    (void)urgent;
+    publish_now(info, packet_size);
+#endif /* ENABLE_BURST_CONNECT */
+}
+
+#if !ENABLE_BURST_CONNECT
+/******************************************************************************
+ * Function Name: publish_now
+ ******************************************************************************
+ * Summary:
+ *  Publishes a message through the transport, measures its cost and
+ *  informs the MQTT client task about a publish failure.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Publish descriptor
+ *  uint32_t packet_size : Size of the serialized PUBLISH packet
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void publish_now(const cy_mqtt_publish_info_t *info, uint32_t packet_size)
+{
+    /* Status variable */
+    cy_rslt_t result;
+
+    /* Command to the MQTT client task */
+    mqtt_task_cmd_t mqtt_task_cmd;
+
+    /* Cost of the publish in the transport */
+    uint32_t wire_bytes = 0;
+    uint32_t transport_start;
+    uint32_t transport_cycles;
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    mqttsn_client_stats_t sn_stats;
+#endif
+
+    if (payload_is_text(info))
+    {
+        printf("\nPublisher: Publishing '%.*s' on the topic '%.*s'\n",
+               (int)info->payload_len, (const char *)info->payload,
+               (int)info->topic_len, info->topic);
+    }
+    else
+    {
+        printf("\nPublisher: Publishing %lu bytes on the topic '%.*s'\n",
+               (unsigned long)info->payload_len, (int)info->topic_len, info->topic);
+    }
+
+    transport_start = cycle_counter_get();
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+    result = mqttsn_client_publish(info, &wire_bytes);
+#else
+    /* The MQTT library does not modify the descriptor. */
+    result = cy_mqtt_publish(mqtt_connection, (cy_mqtt_publish_info_t *)info);
+    wire_bytes = tcp_wire_bytes(info, packet_size);
+#endif
+    transport_cycles = cycle_counter_get() - transport_start;
+
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("  Publisher: MQTT Publish failed with error 0x%0X.\n\n", (int)result);
+        publish_failure_count++;
+        metrics_counter_inc(METRIC_MQTT_PUBLISH_FAILURES);
+        mqtt_rpc_trace(MQTT_RPC_TRACE_PUBLISH_FAILURE, (uint32_t)result);
+
+        /* Communicate the publish failure with the the MQTT
+         * client task.
+         */
+        mqtt_task_cmd = HANDLE_MQTT_PUBLISH_FAILURE;
+        xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
+    }
+    else
+    {
+        publish_count++;
+        publish_bytes += packet_size;
+#if (MQTT_SECURE_CONNECTION)
+        publish_copy_bytes_estimate += (2u * packet_size) +
+                                       (publish_write_count(info) * TLS_RECORD_OVERHEAD);
+#else
+        publish_copy_bytes_estimate += packet_size;
+#endif
+        publish_wire_bytes += wire_bytes;
+        publish_transport_cycles.total += transport_cycles;
+        publish_transport_cycles.count++;
+        metrics_counter_inc(METRIC_MQTT_PUBLISHES);
+        metrics_histogram_record(METRIC_MQTT_PUBLISH_US, cycle_counter_to_us(transport_cycles));
+        mqtt_rpc_trace(MQTT_RPC_TRACE_PUBLISH, info->payload_len);
+        printf("  Publisher: %lu bytes on the wire, published in %lu us\n",
+               (unsigned long)wire_bytes, (unsigned long)cycle_counter_to_us(transport_cycles));
+#if (MQTT_TRANSPORT == MQTT_TRANSPORT_SN)
+        mqttsn_client_get_stats(&sn_stats);
+        printf("  Publisher: PUBLISH encoded in %lu cycles from a template, %lu cycles generic (averages)\n",
+               (unsigned long)((sn_stats.template_encodes > 0) ?
+                               (sn_stats.template_encode_cycles / sn_stats.template_encodes) : 0),
+               (unsigned long)((sn_stats.generic_encodes > 0) ?
+                               (sn_stats.generic_encode_cycles / sn_stats.generic_encodes) : 0));
+#endif
+    }
+
+    print_heap_usage("publisher_task: After publishing an MQTT message");
+}
+#endif /* ENABLE_BURST_CONNECT */
+
+/* Size of the serialized PUBLISH packet: fixed header byte, remaining length
+ * (1 to 4 bytes), topic length and topic, packet identifier for QoS > 0, and
+ * payload.
+ */
+static uint32_t publish_packet_size(const cy_mqtt_publish_info_t *info)
+{
+    uint32_t remaining = 2u + info->topic_len + info->payload_len +
+                         ((info->qos != CY_MQTT_QOS0) ? 2u : 0u);
+    uint32_t length_bytes = (remaining < 128u) ? 1u :
+                            (remaining < 16384u) ? 2u :
+                            (remaining < 2097152u) ? 3u : 4u;
+
+    return 1u + length_bytes + remaining;
+}
+
+/* Writes the MQTT library issues to send a PUBLISH packet: the fixed header
+ * with the topic length, the topic, the packet identifier for QoS > 0, and the
+ * payload. With TLS, every write is encrypted into its own record.
+ */
+static uint32_t publish_write_count(const cy_mqtt_publish_info_t *info)
+{
+    return 2u + ((info->qos != CY_MQTT_QOS0) ? 1u : 0u) +
+           ((info->payload_len > 0u) ? 1u : 0u);
+}
+
+/* Bytes on the wire of a TCP publish: the PUBLISH packet and its
+ * acknowledgements, each in a segment with IP and TCP headers. With TLS, the
+ * PUBLISH packet takes one record per write and every acknowledgement its own
+ * record. Segments that only carry a TCP ACK are not counted.
+ */
+static uint32_t tcp_wire_bytes(const cy_mqtt_publish_info_t *info, uint32_t packet_size)
+{
+#if (MQTT_SECURE_CONNECTION)
+    uint32_t segment_overhead = TCP_IP_OVERHEAD + TLS_RECORD_OVERHEAD;
+    uint32_t record_overhead = publish_write_count(info) * TLS_RECORD_OVERHEAD;
+#else
+    uint32_t segment_overhead = TCP_IP_OVERHEAD;
+    uint32_t record_overhead = 0u;
+#endif
+    uint32_t ack_count = (info->qos == CY_MQTT_QOS2) ? 3u :
+                         (info->qos == CY_MQTT_QOS1) ? 1u : 0u;
+
+    return packet_size + TCP_IP_OVERHEAD + record_overhead +
+           (ack_count * (MQTT_ACK_PACKET_SIZE + segment_overhead));
+}
+
+/* Checks that a payload is printable text, so that it can be logged. */
+static bool payload_is_text(const cy_mqtt_publish_info_t *info)
+{
+    const uint8_t *payload = (const uint8_t *)info->payload;
+
+    for (size_t i = 0; i < info->payload_len; i++)
+    {
+        if (((payload[i] < 0x20u) && (payload[i] != '\n')) || (payload[i] >= 0x7Fu))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 /******************************************************************************
  * Function Name: publisher_init
  ******************************************************************************
  * Summary:
- *  Function that initializes and sets-up the user button GPIO pin along with  
- *  its interrupt.
+ *  Function that initializes and sets-up the TD/PD GPIO pins of every radar
+ *  sensor in the pin table along with the TD interrupts, and seeds the fusion
+ *  stage with the current line levels.
  * 
  * Parameters:
  *  void
@@ -214,32 +903,47 @@ void publisher_task(void *pvParameters)
  ******************************************************************************/
 static void publisher_init(void)
 {
-	/* Initialize the GPIO pins for Radar TD and PD */
-	cyhal_gpio_init(CYBSP_A7, CYHAL_GPIO_DIR_INPUT, CYHAL_GPIO_DRIVE_NONE, false);   // TD outside row
-	cyhal_gpio_init(CYBSP_A15, CYHAL_GPIO_DIR_INPUT, CYHAL_GPIO_DRIVE_NONE, false);  // PD inside row
-	cyhal_gpio_register_callback(CYBSP_A7, &cb_data);
-	cyhal_gpio_enable_event(CYBSP_A7, CYHAL_GPIO_IRQ_BOTH,
-	                            USER_BTN_INTR_PRIORITY, true);
-
-	printf("  Publisher: MQTT Publish \n\n");
-
-	/* Initialize the user button GPIO and register interrupt on falling edge. */
-    //cyhal_gpio_init(CYBSP_USER_BTN, CYHAL_GPIO_DIR_INPUT,
-    //                CYHAL_GPIO_DRIVE_PULLUP, CYBSP_BTN_OFF);
-    //cyhal_gpio_register_callback(CYBSP_USER_BTN, &cb_data);
-    //cyhal_gpio_enable_event(CYBSP_USER_BTN, CYHAL_GPIO_IRQ_FALL,
-    //                        USER_BTN_INTR_PRIORITY, true);
-    
-    //printf("\nPress the user button (SW2) to publish \"%s\"/\"%s\" on the topic '%s'...\n",
-    //       MQTT_DEVICE_ON_MESSAGE, MQTT_DEVICE_OFF_MESSAGE, publish_info.topic);
+    radar_fusion_input_t radar_input;
+
+    for (uint32_t i = 0; i < RADAR_SENSOR_COUNT; i++)
+    {
+        /* Initialize the GPIO pins for Radar TD and PD */
+        cyhal_gpio_init(radar_sensors[i].td_pin, CYHAL_GPIO_DIR_INPUT, CYHAL_GPIO_DRIVE_NONE, false);
+        cyhal_gpio_init(radar_sensors[i].pd_pin, CYHAL_GPIO_DIR_INPUT, CYHAL_GPIO_DRIVE_NONE, false);
+
+        /* Seed the fusion stage with the current line levels. */
+        radar_input.sensor = (uint8_t)i;
+        radar_input.td_level = cyhal_gpio_read(radar_sensors[i].td_pin);
+        radar_input.pd_level = cyhal_gpio_read(radar_sensors[i].pd_pin);
+        radar_input.timestamp_ms = app_time_now_ms();
+#if ENABLE_EDGE_CLASSIFIER
+        radar_fusion_input_t classified;
+        if (edge_classifier_process(&edge_classifier, &radar_input,
+                                    presence_history_get_light(), &classified))
+        {
+            (void)radar_fusion_update(&radar_fusion, &classified);
+        }
+#else
+        (void)radar_fusion_update(&radar_fusion, &radar_input);
+#endif
+
+        /* Register interrupt on both edges of the TD line. */
+        cb_data[i].callback = isr_button_press;
+        cb_data[i].callback_arg = (void *)(uintptr_t)i;
+        cyhal_gpio_register_callback(radar_sensors[i].td_pin, &cb_data[i]);
+        cyhal_gpio_enable_event(radar_sensors[i].td_pin, CYHAL_GPIO_IRQ_BOTH,
+                                IRQ_PRIORITY_RADAR_TD, true);
+    }
+
+    printf("  Publisher: MQTT Publish, %u radar sensor(s)\n\n", (unsigned int)RADAR_SENSOR_COUNT);
 }
 
 /******************************************************************************
  * Function Name: publisher_deinit
  ******************************************************************************
  * Summary:
- *  Cleanup function for the publisher task that disables the user button  
- *  interrupt and deinits the user button GPIO pin.
+ *  Cleanup function for the publisher task that disables the radar TD
+ *  interrupts and deinits the radar sensor GPIO pins.
  *
  * Parameters:
  *  void
@@ -250,28 +954,28 @@ static void publisher_init(void)
  ******************************************************************************/
 static void publisher_deinit(void)
 {
-    /* Deregister the ISR and disable the interrupt on the user button. */
-    //cyhal_gpio_register_callback(CYBSP_USER_BTN, &cb_data);
-    //cyhal_gpio_enable_event(CYBSP_USER_BTN, CYHAL_GPIO_IRQ_FALL,
-    //                        USER_BTN_INTR_PRIORITY, false);
-    //cyhal_gpio_free(CYBSP_USER_BTN);
-	cyhal_gpio_register_callback(CYBSP_A7, &cb_data);
-	cyhal_gpio_enable_event(CYBSP_A15, CYHAL_GPIO_IRQ_BOTH,
-							USER_BTN_INTR_PRIORITY, true);
-	cyhal_gpio_free(CYBSP_A7);
+    for (uint32_t i = 0; i < RADAR_SENSOR_COUNT; i++)
+    {
+        /* Disable the interrupt and deregister the ISR of the TD line. */
+        cyhal_gpio_enable_event(radar_sensors[i].td_pin, CYHAL_GPIO_IRQ_BOTH,
+                                IRQ_PRIORITY_RADAR_TD, false);
+        cyhal_gpio_register_callback(radar_sensors[i].td_pin, NULL);
+        cyhal_gpio_free(radar_sensors[i].td_pin);
+        cyhal_gpio_free(radar_sensors[i].pd_pin);
+    }
 }
 
 /******************************************************************************
  * Function Name: isr_button_press
  ******************************************************************************
  * Summary:
- *  GPIO interrupt service routine. This function detects button
- *  presses and sends the publish command along with the data to be published 
- *  to the publisher task over a message queue. Based on the current device 
- *  state, the publish data is set so that the device state gets toggled.
+ *  GPIO interrupt service routine for the radar TD lines. This function
+ *  samples the TD and PD lines of the sensor that raised the interrupt and
+ *  passes them to the publisher task through the ISR signal layer, where the
+ *  fusion stage decides whether the presence state changed.
  *
  * Parameters:
- *  void *callback_arg : pointer to variable passed to the ISR (unused)
+ *  void *callback_arg : Index of the radar sensor in 'radar_sensors'
  *  cyhal_gpio_event_t event : GPIO event type (unused)
  *
  * Return:
@@ -280,43 +984,21 @@ static void publisher_deinit(void)
  ******************************************************************************/
 static void isr_button_press(void *callback_arg, cyhal_gpio_event_t event)
 {
-	bool tdetectState = 0;
-	bool pdetectState = 0;
-
-	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    publisher_data_t publisher_q_data;
+    uint32_t entry_cycles = isr_signal_timestamp();
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    radar_fusion_input_t radar_input;
+    uint32_t sensor = (uint32_t)(uintptr_t)callback_arg;
 
     /* To avoid compiler warnings */
-    (void) callback_arg;
     (void) event;
 
-    /* Assign the publish command to be sent to the publisher task. */
-    publisher_q_data.cmd = PUBLISH_MQTT_MSG;
-
-    /* Assign the publish message payload so that the device state toggles. */
-    //if (current_device_state == DEVICE_ON_STATE)
-    //{
-    //    publisher_q_data.data = (char *)MQTT_DEVICE_OFF_MESSAGE;
-    //}
-    //else
-    //{
-    //    publisher_q_data.data = (char *)MQTT_DEVICE_ON_MESSAGE;
-    //}
-
-    //printf("  Publisher: MQTT Publish \n\n");
-
-    tdetectState = cyhal_gpio_read(CYBSP_A7);
-    if (tdetectState)
-    {
-        publisher_q_data.data = (char *)MQTT_DEVICE_OFF_MESSAGE;
-    }
-    else
-    {
-        publisher_q_data.data = (char *)MQTT_DEVICE_ON_MESSAGE;
-    }
+    radar_input.sensor = (uint8_t)sensor;
+    radar_input.td_level = cyhal_gpio_read(radar_sensors[sensor].td_pin);
+    radar_input.pd_level = cyhal_gpio_read(radar_sensors[sensor].pd_pin);
+    radar_input.timestamp_ms = app_time_now_ms_from_isr();
 
-    /* Send the command and data to publisher task over the queue */
-    xQueueSendFromISR(publisher_task_q, &publisher_q_data, &xHigherPriorityTaskWoken);
+    /* Store the edge and wake the publisher task. */
+    isr_signal_from_isr(ISR_SIGNAL_RADAR_TD, entry_cycles, &radar_input, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
@@ -42,9 +42,13 @@
 #ifndef PUBLISHER_TASK_H_
 #define PUBLISHER_TASK_H_
 
+#include <stdbool.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "radar_fusion.h"
+#include "edge_classifier.h"
+#include "radar_config.h"
 
 /*******************************************************************************
 * Macros
@@ -61,25 +65,52 @@ typedef enum
 {
     PUBLISHER_INIT,
     PUBLISHER_DEINIT,
-    PUBLISH_MQTT_MSG
+    PUBLISH_MQTT_MSG,
+    PUBLISH_PRESTART,
+    PUBLISH_ACTUATION,
+    PUBLISH_METRICS,
+    PUBLISH_METRICS_SCHEMA,
+    PUBLISH_RTT_PROBE,
+    RADAR_EDGE
 } publisher_cmd_t;
 
 /* Struct to be passed via the publisher task queue */
 typedef struct{
     publisher_cmd_t cmd;
     char *data;
+    size_t data_len;            /* Length of the data of the PUBLISH_METRICS commands */
+    radar_fusion_input_t radar;
 } publisher_data_t;
 
+/* Cycles spent publishing, and the number of publishes. */
+typedef struct
+{
+    uint64_t total;
+    uint32_t count;
+} publish_cycles_t;
+
 /*******************************************************************************
 * Extern Variables
 ********************************************************************************/
 extern TaskHandle_t publisher_task_handle;
 extern QueueHandle_t publisher_task_q;
+extern uint32_t publish_count;
+extern uint32_t publish_failure_count;
+extern uint32_t publish_bytes;
+extern uint32_t publish_copy_bytes_estimate;
+extern uint32_t publish_wire_bytes;
+extern publish_cycles_t publish_transport_cycles;
 
 /*******************************************************************************
 * Function Prototypes
 ********************************************************************************/
 void publisher_task(void *pvParameters);
+bool publisher_task_send(const publisher_data_t *publisher_q_data, TickType_t ticks_to_wait);
+size_t publisher_format_stats(char *buf, size_t size);
+#if ENABLE_EDGE_CLASSIFIER
+void publisher_get_edge_classifier_stats(edge_classifier_stats_t *stats, uint32_t *max_edge_us);
+size_t publisher_format_edge_classifier_stats(char *buf, size_t size);
+#endif
 
 #endif /* PUBLISHER_TASK_H_ */
 
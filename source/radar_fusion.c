@@ -0,0 +1,166 @@
+/******************************************************************************
+* File Name:   radar_fusion.c
+*
+* Description: This file contains the fusion stage that combines the TD/PD
+*              lines of several BGT60LTR11 radar sensors into one presence
+*              state. Each edge updates the per sensor state and the fused
+*              counters in constant time, independent of the number of
+*              sensors.
+*
+*              - Voting   : presence is reported when at least 'vote_threshold'
+*                           sensors detect a target.
+*              - Zones    : bit mask of the zones with at least one detection.
+*              - Direction: derived from the zone order of consecutive
+*                           detection onsets within 'direction_window_ms'.
+*
+*              The fusion stage has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "radar_fusion.h"
+
+/******************************************************************************
+ * Function Name: radar_fusion_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes a fusion context with all sensors idle.
+ *
+ * Parameters:
+ *  radar_fusion_t *fusion : Fusion context
+ *  const uint8_t *zones : Zone of each sensor, 'sensor_count' entries
+ *  uint8_t sensor_count : Number of sensors (max RADAR_FUSION_MAX_SENSORS)
+ *  uint8_t vote_threshold : Number of detecting sensors needed for presence
+ *  uint32_t direction_window_ms : Maximum time between detection onsets in two
+ *                                 zones for them to define a direction
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void radar_fusion_init(radar_fusion_t *fusion, const uint8_t *zones, uint8_t sensor_count,
+                       uint8_t vote_threshold, uint32_t direction_window_ms)
+{
+    memset(fusion, 0, sizeof(*fusion));
+
+    fusion->sensor_count = (sensor_count <= RADAR_FUSION_MAX_SENSORS) ?
+                           sensor_count : RADAR_FUSION_MAX_SENSORS;
+    fusion->vote_threshold = (vote_threshold > 0u) ? vote_threshold : 1u;
+    fusion->direction_window_ms = direction_window_ms;
+
+    for (uint8_t i = 0; i < fusion->sensor_count; i++)
+    {
+        fusion->sensors[i].zone = (zones[i] < RADAR_FUSION_MAX_ZONES) ?
+                                  zones[i] : (RADAR_FUSION_MAX_ZONES - 1u);
+    }
+}
+
+/******************************************************************************
+ * Function Name: radar_fusion_update
+ ******************************************************************************
+ * Summary:
+ *  Applies one sensor edge to the fusion context. The TD line is active low
+ *  (low = target detected) and the PD line is high while the target is
+ *  approaching.
+ *
+ * Parameters:
+ *  radar_fusion_t *fusion : Fusion context
+ *  const radar_fusion_input_t *input : Line levels of the sensor that changed
+ *
+ * Return:
+ *  bool : true if the fused presence state changed
+ *
+ ******************************************************************************/
+bool radar_fusion_update(radar_fusion_t *fusion, const radar_fusion_input_t *input)
+{
+    radar_fusion_sensor_t *sensor;
+    bool detected;
+    bool approaching;
+    bool prev_presence = fusion->state.presence;
+
+    if (input->sensor >= fusion->sensor_count)
+    {
+        return false;
+    }
+
+    sensor = &fusion->sensors[input->sensor];
+    detected = !input->td_level;
+    approaching = detected && input->pd_level;
+
+    if (detected != sensor->detected)
+    {
+        sensor->detected = detected;
+
+        if (detected)
+        {
+            fusion->state.detected_count++;
+            fusion->zone_detect_count[sensor->zone]++;
+            fusion->state.zone_mask |= (uint8_t)(1u << sensor->zone);
+
+            /* Derive the direction from the previous onset in another zone. */
+            if (fusion->onset_seen && (fusion->last_onset_zone != sensor->zone) &&
+                ((input->timestamp_ms - fusion->last_onset_ms) <= fusion->direction_window_ms))
+            {
+                fusion->state.direction = (sensor->zone > fusion->last_onset_zone) ?
+                                          RADAR_DIRECTION_TOWARD : RADAR_DIRECTION_AWAY;
+            }
+
+            fusion->onset_seen = true;
+            fusion->last_onset_zone = sensor->zone;
+            fusion->last_onset_ms = input->timestamp_ms;
+        }
+        else
+        {
+            fusion->state.detected_count--;
+            if (--fusion->zone_detect_count[sensor->zone] == 0u)
+            {
+                fusion->state.zone_mask &= (uint8_t)~(1u << sensor->zone);
+            }
+        }
+    }
+
+    if (approaching != sensor->approaching)
+    {
+        sensor->approaching = approaching;
+        if (approaching)
+        {
+            fusion->approaching_count++;
+        }
+        else
+        {
+            fusion->approaching_count--;
+        }
+    }
+
+    fusion->state.presence = (fusion->state.detected_count >= fusion->vote_threshold);
+    fusion->state.approaching = fusion->state.presence && (fusion->approaching_count > 0u);
+
+    if (fusion->state.detected_count == 0u)
+    {
+        fusion->state.direction = RADAR_DIRECTION_NONE;
+    }
+
+    return (prev_presence != fusion->state.presence);
+}
+
+/******************************************************************************
+ * Function Name: radar_fusion_get_state
+ ******************************************************************************
+ * Summary:
+ *  Returns the fused presence state.
+ *
+ * Parameters:
+ *  const radar_fusion_t *fusion : Fusion context
+ *
+ * Return:
+ *  radar_fused_state_t : Fused presence state
+ *
+ ******************************************************************************/
+radar_fused_state_t radar_fusion_get_state(const radar_fusion_t *fusion)
+{
+    return fusion->state;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,89 @@
+/******************************************************************************
+* File Name:   radar_fusion.h
+*
+* Description: This file is the public interface of radar_fusion.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RADAR_FUSION_H_
+#define RADAR_FUSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Maximum number of radar sensors and zones handled by one fusion context. */
+#define RADAR_FUSION_MAX_SENSORS          (8u)
+#define RADAR_FUSION_MAX_ZONES            (8u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Direction of movement derived from the order in which zones detect a target.
+ * Zones are numbered from the outermost approach (0) towards the fountain.
+ */
+typedef enum
+{
+    RADAR_DIRECTION_NONE,
+    RADAR_DIRECTION_TOWARD,
+    RADAR_DIRECTION_AWAY
+} radar_direction_t;
+
+/* Raw line levels of one sensor at the time of an edge. */
+typedef struct
+{
+    uint8_t sensor;
+    bool td_level;
+    bool pd_level;
+    uint32_t timestamp_ms;
+} radar_fusion_input_t;
+
+/* Fused presence state over all sensors. */
+typedef struct
+{
+    bool presence;
+    bool approaching;
+    uint8_t detected_count;
+    uint8_t zone_mask;
+    radar_direction_t direction;
+} radar_fused_state_t;
+
+/* Per sensor state. */
+typedef struct
+{
+    bool detected;
+    bool approaching;
+    uint8_t zone;
+} radar_fusion_sensor_t;
+
+/* Fusion context. All fields are private to radar_fusion.c. */
+typedef struct
+{
+    radar_fusion_sensor_t sensors[RADAR_FUSION_MAX_SENSORS];
+    uint8_t zone_detect_count[RADAR_FUSION_MAX_ZONES];
+    uint8_t sensor_count;
+    uint8_t approaching_count;
+    uint8_t vote_threshold;
+    uint8_t last_onset_zone;
+    uint32_t last_onset_ms;
+    uint32_t direction_window_ms;
+    bool onset_seen;
+    radar_fused_state_t state;
+} radar_fusion_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void radar_fusion_init(radar_fusion_t *fusion, const uint8_t *zones, uint8_t sensor_count,
+                       uint8_t vote_threshold, uint32_t direction_window_ms);
+bool radar_fusion_update(radar_fusion_t *fusion, const radar_fusion_input_t *input);
+radar_fused_state_t radar_fusion_get_state(const radar_fusion_t *fusion);
+
+#endif /* RADAR_FUSION_H_ */
+
+/* [] END OF FILE */
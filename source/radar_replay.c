@@ -0,0 +1,151 @@
+/******************************************************************************
+* File Name:   radar_replay.c
+*
+* Description: This file replays a recorded radar trace in virtual time. Every
+*              trace entry is sent to the publisher task as a RADAR_EDGE at the
+*              virtual time of its timestamp, so the fusion, history and
+*              publish path run exactly as they do for a GPIO edge. Only the
+*              next entry is scheduled at any time.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#include "radar_replay.h"
+#include "app_time.h"
+#include "publisher_task.h"
+
+#if ENABLE_VIRTUAL_TIME
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+static const radar_fusion_input_t *trace;
+static size_t trace_length;
+static size_t trace_index;
+
+/* Entries sent to the publisher, and entries dropped because the publisher
+ * task was not running or its queue was full.
+ */
+static uint32_t replayed_count;
+static uint32_t dropped_count;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void replay_next(void *arg);
+static void schedule_next(void);
+
+/******************************************************************************
+ * Function Name: radar_replay_get_trace
+ ******************************************************************************
+ * Summary:
+ *  Returns the trace to be replayed. The entries must be ordered by
+ *  timestamp; the timestamps are relative to the start of the replay. The
+ *  simulator build provides the trace by overriding this weak function.
+ *
+ * Parameters:
+ *  size_t *count : Number of entries in the trace
+ *
+ * Return:
+ *  const radar_fusion_input_t * : First entry of the trace, or NULL
+ *
+ ******************************************************************************/
+__WEAK const radar_fusion_input_t *radar_replay_get_trace(size_t *count)
+{
+    *count = 0;
+    return NULL;
+}
+
+/******************************************************************************
+ * Function Name: radar_replay_start
+ ******************************************************************************
+ * Summary:
+ *  Schedules the first entry of the trace on the virtual clock.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void radar_replay_start(void)
+{
+    trace = radar_replay_get_trace(&trace_length);
+    trace_index = 0;
+
+    if (trace != NULL)
+    {
+        schedule_next();
+    }
+}
+
+/******************************************************************************
+ * Function Name: radar_replay_get_counts
+ ******************************************************************************
+ * Summary:
+ *  Returns the number of replayed and dropped trace entries.
+ *
+ * Parameters:
+ *  uint32_t *replayed : Entries sent to the publisher task
+ *  uint32_t *dropped : Entries dropped
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void radar_replay_get_counts(uint32_t *replayed, uint32_t *dropped)
+{
+    *replayed = replayed_count;
+    *dropped = dropped_count;
+}
+
+/* Virtual clock event: sends the current entry and schedules the next one. */
+static void replay_next(void *arg)
+{
+    publisher_data_t publisher_q_data;
+
+    (void)arg;
+
+    publisher_q_data.cmd = RADAR_EDGE;
+    publisher_q_data.data = NULL;
+    publisher_q_data.radar = trace[trace_index];
+    publisher_q_data.radar.timestamp_ms = app_time_now_ms();
+
+    if (publisher_task_send(&publisher_q_data, 0))
+    {
+        replayed_count++;
+    }
+    else
+    {
+        dropped_count++;
+    }
+
+    trace_index++;
+    schedule_next();
+}
+
+static void schedule_next(void)
+{
+    uint32_t current_ms = app_time_now_ms();
+    uint32_t due_ms;
+
+    if (trace_index >= trace_length)
+    {
+        return;
+    }
+
+    due_ms = trace[trace_index].timestamp_ms;
+    (void)app_time_schedule((due_ms > current_ms) ? (due_ms - current_ms) : 0u,
+                            replay_next, NULL);
+}
+
+#endif /* ENABLE_VIRTUAL_TIME */
+
+/* [] END OF FILE */
@@ -0,0 +1,29 @@
+/******************************************************************************
+* File Name:   radar_replay.h
+*
+* Description: This file is the public interface of radar_replay.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RADAR_REPLAY_H_
+#define RADAR_REPLAY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "virtual_time_config.h"
+#include "radar_fusion.h"
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_VIRTUAL_TIME
+const radar_fusion_input_t *radar_replay_get_trace(size_t *count);
+void radar_replay_start(void);
+void radar_replay_get_counts(uint32_t *replayed, uint32_t *dropped);
+#endif /* ENABLE_VIRTUAL_TIME */
+
+#endif /* RADAR_REPLAY_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,396 @@
+/******************************************************************************
+* File Name:   render_server.c
+*
+* Description: This file contains the display render server. emWin is only
+*              called from the TFT task, which owns the GUI. Any other task,
+*              or an interrupt handler, posts compact draw commands into a
+*              lock-free queue instead. Once per frame the TFT task drains the
+*              queue into its screen model, where the latest value of every
+*              field wins, and redraws only what changed. No lock is taken on
+*              the draw path.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "render_server.h"
+#include "mpsc_queue.h"
+#include "cycle_counter.h"
+#include "app_time.h"
+#include "metrics.h"
+#include "deadline_monitor.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Command queue and its storage. */
+static mpsc_queue_t render_queue;
+static uint32_t render_queue_sequence[RENDER_QUEUE_LENGTH];
+static render_cmd_t render_queue_buffer[RENDER_QUEUE_LENGTH];
+
+/* Commands that did not fit into the queue, updated by the producers. */
+static uint32_t dropped_count;
+
+/* State of the frame in progress, owned by the render task. */
+static uint32_t frame_drain_cycles;
+static uint32_t frame_commands;
+static uint64_t frame_age_sum_cycles;
+static uint32_t frame_age_max_cycles;
+
+/* Measurement window, owned by the render task. */
+static uint32_t window_start_ms;
+static uint32_t window_frames;
+static uint32_t window_commands;
+static uint32_t window_coalesced;
+static uint64_t window_latency_sum_us;
+static uint32_t window_latency_max_us;
+
+/* Statistics of the last complete window. */
+static render_server_stats_t last_stats;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool post_command(render_cmd_t *cmd);
+static bool apply_command(render_model_t *model, const render_cmd_t *cmd);
+static void update_stats(void);
+
+/******************************************************************************
+ * Function Name: render_server_init
+ ******************************************************************************
+ * Summary:
+ *  Creates the command queue. Must be called before any task posts a command.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void render_server_init(void)
+{
+    cycle_counter_init();
+    (void)mpsc_queue_init(&render_queue, render_queue_sequence, render_queue_buffer,
+                          sizeof(render_cmd_t), RENDER_QUEUE_LENGTH);
+    window_start_ms = app_time_now_ms();
+}
+
+/******************************************************************************
+ * Function Name: render_set_field
+ ******************************************************************************
+ * Summary:
+ *  Posts a new value of a screen field. Never blocks; may be called from an
+ *  interrupt handler.
+ *
+ * Parameters:
+ *  render_field_t field : Field to be updated
+ *  int16_t value : New value
+ *
+ * Return:
+ *  bool : true if the command was queued, false if the queue was full.
+ *
+ ******************************************************************************/
+bool render_set_field(render_field_t field, int16_t value)
+{
+    render_cmd_t cmd = { .type = RENDER_CMD_SET_FIELD, .field = (uint8_t)field, .value = value };
+
+    return post_command(&cmd);
+}
+
+/******************************************************************************
+ * Function Name: render_show_alert
+ ******************************************************************************
+ * Summary:
+ *  Posts an alert line. A later alert replaces an earlier one. Never blocks.
+ *
+ * Parameters:
+ *  const char *text : Alert text, truncated to RENDER_ALERT_TEXT_LEN - 1
+ *
+ * Return:
+ *  bool : true if the command was queued, false if the queue was full.
+ *
+ ******************************************************************************/
+bool render_show_alert(const char *text)
+{
+    render_cmd_t cmd = { .type = RENDER_CMD_SHOW_ALERT };
+
+    strncpy(cmd.text, text, RENDER_ALERT_TEXT_LEN - 1u);
+
+    return post_command(&cmd);
+}
+
+bool render_clear_alert(void)
+{
+    render_cmd_t cmd = { .type = RENDER_CMD_CLEAR_ALERT };
+
+    return post_command(&cmd);
+}
+
+/******************************************************************************
+ * Function Name: render_chart_point
+ ******************************************************************************
+ * Summary:
+ *  Appends a point to the chart. Never blocks.
+ *
+ * Parameters:
+ *  int16_t value : Value of the point
+ *
+ * Return:
+ *  bool : true if the command was queued, false if the queue was full.
+ *
+ ******************************************************************************/
+bool render_chart_point(int16_t value)
+{
+    render_cmd_t cmd = { .type = RENDER_CMD_CHART_POINT, .value = value };
+
+    return post_command(&cmd);
+}
+
+/******************************************************************************
+ * Function Name: render_server_begin_frame
+ ******************************************************************************
+ * Summary:
+ *  Drains all pending commands into the screen model. Must only be called by
+ *  the render task, followed by render_server_end_frame() once the changes
+ *  are drawn and the dirty flags cleared.
+ *
+ * Parameters:
+ *  render_model_t *model : Screen model of the render task
+ *
+ * Return:
+ *  bool : true if anything in the model needs to be redrawn.
+ *
+ ******************************************************************************/
+bool render_server_begin_frame(render_model_t *model)
+{
+    render_cmd_t cmd;
+    uint32_t age_cycles;
+
+    frame_drain_cycles = cycle_counter_get();
+    frame_commands = 0;
+    frame_age_sum_cycles = 0;
+    frame_age_max_cycles = 0;
+
+    while (mpsc_queue_pop(&render_queue, &cmd))
+    {
+        age_cycles = frame_drain_cycles - cmd.posted_cycles;
+        frame_age_sum_cycles += age_cycles;
+        if (age_cycles > frame_age_max_cycles)
+        {
+            frame_age_max_cycles = age_cycles;
+        }
+        frame_commands++;
+
+        if (apply_command(model, &cmd))
+        {
+            window_coalesced++;
+        }
+    }
+
+    return (model->field_dirty != 0) || model->alert_dirty || model->chart_dirty;
+}
+
+/******************************************************************************
+ * Function Name: render_server_end_frame
+ ******************************************************************************
+ * Summary:
+ *  Completes the frame started by render_server_begin_frame(). The latency of
+ *  every command is measured from posting to the end of the frame that drew
+ *  it, and the oldest command of the frame is checked against
+ *  DISPLAY_UPDATE_DEADLINE_US.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void render_server_end_frame(void)
+{
+    uint32_t draw_cycles = cycle_counter_get() - frame_drain_cycles;
+    uint32_t latency_max_us;
+
+    window_frames++;
+
+    if (frame_commands > 0)
+    {
+        window_commands += frame_commands;
+        window_latency_sum_us += cycle_counter_to_us((uint32_t)
+                                 ((frame_age_sum_cycles / frame_commands) + draw_cycles)) *
+                                 (uint64_t)frame_commands;
+
+        latency_max_us = cycle_counter_to_us(frame_age_max_cycles + draw_cycles);
+        deadline_monitor_record(DEADLINE_DISPLAY_UPDATE, latency_max_us);
+        if (latency_max_us > window_latency_max_us)
+        {
+            window_latency_max_us = latency_max_us;
+        }
+    }
+
+    update_stats();
+}
+
+/******************************************************************************
+ * Function Name: render_server_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the command throughput and frame latency of the last measurement
+ *  window.
+ *
+ * Parameters:
+ *  render_server_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void render_server_get_stats(render_server_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* Stamps and queues a command; counts it as dropped if the queue is full. */
+static bool post_command(render_cmd_t *cmd)
+{
+    cmd->posted_cycles = cycle_counter_get();
+
+    if (!mpsc_queue_push(&render_queue, cmd))
+    {
+        (void)__atomic_fetch_add(&dropped_count, 1u, __ATOMIC_RELAXED);
+        metrics_counter_inc(METRIC_RENDER_DROPS);
+        return false;
+    }
+
+    return true;
+}
+
+/* Applies a command to the screen model. Returns true if the command
+ * replaced an update that was not drawn yet.
+ */
+static bool apply_command(render_model_t *model, const render_cmd_t *cmd)
+{
+    bool coalesced = false;
+
+    switch (cmd->type)
+    {
+        case RENDER_CMD_SET_FIELD:
+        {
+            if (cmd->field < RENDER_FIELD_COUNT)
+            {
+                coalesced = (model->field_dirty & (1u << cmd->field)) != 0;
+                model->field_value[cmd->field] = cmd->value;
+                model->field_dirty |= (1u << cmd->field);
+            }
+            break;
+        }
+
+        case RENDER_CMD_SHOW_ALERT:
+        case RENDER_CMD_CLEAR_ALERT:
+        {
+            coalesced = model->alert_dirty;
+            memcpy(model->alert, cmd->text, RENDER_ALERT_TEXT_LEN);
+            model->alert[RENDER_ALERT_TEXT_LEN - 1u] = '\0';
+            model->alert_dirty = true;
+            break;
+        }
+
+        case RENDER_CMD_CHART_POINT:
+        {
+            model->chart[model->chart_head] = cmd->value;
+            model->chart_head = (model->chart_head + 1u) % RENDER_CHART_POINTS;
+            coalesced = model->chart_dirty;
+            model->chart_dirty = true;
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    return coalesced;
+}
+
+/* Closes the measurement window every RENDER_STATS_WINDOW_MS. */
+static void update_stats(void)
+{
+    uint32_t current_ms = app_time_now_ms();
+    uint32_t elapsed_ms = current_ms - window_start_ms;
+
+    if (elapsed_ms < RENDER_STATS_WINDOW_MS)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    last_stats.commands_per_sec_x100 = (uint32_t)(((uint64_t)window_commands * 100000u) / elapsed_ms);
+    last_stats.frames_per_sec_x100 = (uint32_t)(((uint64_t)window_frames * 100000u) / elapsed_ms);
+    last_stats.coalesced_per_sec_x100 = (uint32_t)(((uint64_t)window_coalesced * 100000u) / elapsed_ms);
+    last_stats.latency_avg_us = (window_commands > 0) ?
+                                (uint32_t)(window_latency_sum_us / window_commands) : 0;
+    last_stats.latency_max_us = window_latency_max_us;
+    last_stats.dropped = __atomic_load_n(&dropped_count, __ATOMIC_RELAXED);
+    taskEXIT_CRITICAL();
+
+    window_start_ms = current_ms;
+    window_frames = 0;
+    window_commands = 0;
+    window_coalesced = 0;
+    window_latency_sum_us = 0;
+    window_latency_max_us = 0;
+}
+
+/******************************************************************************
+ * Function Name: render_server_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the command throughput, frame rate and latency of the last
+ *  measurement window for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t render_server_format_stats(char *buf, size_t size)
+{
+    render_server_stats_t stats;
+    int len;
+
+    render_server_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "render_commands_per_sec_x100 %lu\n"
+                   "render_frames_per_sec_x100 %lu\n"
+                   "render_coalesced_per_sec_x100 %lu\n"
+                   "render_latency_us avg %lu max %lu\n"
+                   "render_dropped %lu\n",
+                   (unsigned long)stats.commands_per_sec_x100,
+                   (unsigned long)stats.frames_per_sec_x100,
+                   (unsigned long)stats.coalesced_per_sec_x100,
+                   (unsigned long)stats.latency_avg_us,
+                   (unsigned long)stats.latency_max_us,
+                   (unsigned long)stats.dropped);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+/* [] END OF FILE */
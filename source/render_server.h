@@ -0,0 +1,119 @@
+/******************************************************************************
+* File Name:   render_server.h
+*
+* Description: This file is the public interface of render_server.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RENDER_SERVER_H_
+#define RENDER_SERVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Number of draw commands that can be pending. Must be a power of two. */
+#define RENDER_QUEUE_LENGTH               (32u)
+
+/* Maximum length of an alert text including the terminating NUL. */
+#define RENDER_ALERT_TEXT_LEN             (28u)
+
+/* Number of points of the chart on the screen. */
+#define RENDER_CHART_POINTS               (80u)
+
+/* Interval in milliseconds over which command throughput and frame latency
+ * are measured.
+ */
+#define RENDER_STATS_WINDOW_MS            (10000u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Screen fields that other tasks can update. */
+typedef enum
+{
+    RENDER_FIELD_MQTT_STATE,        /* Value: render_mqtt_state_t */
+    RENDER_FIELD_LIGHT,             /* Value: ambient light in percent */
+    RENDER_FIELD_PRESENCE,          /* Value: RENDER_PRESENCE_* bits */
+    RENDER_FIELD_MOTION,            /* Value: orientation of the motion sensor */
+    RENDER_FIELD_COUNT
+} render_field_t;
+
+/* Connection state shown in RENDER_FIELD_MQTT_STATE. */
+typedef enum
+{
+    RENDER_MQTT_DISCONNECTED,
+    RENDER_MQTT_WIFI_CONNECTING,
+    RENDER_MQTT_BROKER_CONNECTING,
+    RENDER_MQTT_CONNECTED
+} render_mqtt_state_t;
+
+/* Bits of RENDER_FIELD_PRESENCE. */
+#define RENDER_PRESENCE_DETECTED          (1u << 0)
+#define RENDER_PRESENCE_APPROACHING       (1u << 1)
+
+/* Draw command types. */
+typedef enum
+{
+    RENDER_CMD_SET_FIELD,
+    RENDER_CMD_SHOW_ALERT,
+    RENDER_CMD_CLEAR_ALERT,
+    RENDER_CMD_CHART_POINT
+} render_cmd_type_t;
+
+/* Draw command as it travels through the queue. */
+typedef struct
+{
+    uint8_t type;
+    uint8_t field;
+    int16_t value;
+    uint32_t posted_cycles;
+    char text[RENDER_ALERT_TEXT_LEN];
+} render_cmd_t;
+
+/* Screen model owned by the render task. Commands are coalesced into it: the
+ * latest value of a field or alert wins, and the dirty flags tell the render
+ * task what to redraw in the next frame.
+ */
+typedef struct
+{
+    int16_t field_value[RENDER_FIELD_COUNT];
+    uint32_t field_dirty;
+    char alert[RENDER_ALERT_TEXT_LEN];
+    bool alert_dirty;
+    int16_t chart[RENDER_CHART_POINTS];
+    uint32_t chart_head;
+    bool chart_dirty;
+} render_model_t;
+
+/* Render server statistics over the last measurement window. */
+typedef struct
+{
+    uint32_t commands_per_sec_x100;
+    uint32_t frames_per_sec_x100;
+    uint32_t coalesced_per_sec_x100;
+    uint32_t latency_avg_us;
+    uint32_t latency_max_us;
+    uint32_t dropped;
+} render_server_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void render_server_init(void);
+bool render_set_field(render_field_t field, int16_t value);
+bool render_show_alert(const char *text);
+bool render_clear_alert(void);
+bool render_chart_point(int16_t value);
+bool render_server_begin_frame(render_model_t *model);
+void render_server_end_frame(void);
+void render_server_get_stats(render_server_stats_t *stats);
+size_t render_server_format_stats(char *buf, size_t size);
+
+#endif /* RENDER_SERVER_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,416 @@
+/******************************************************************************
+* File Name:   rtt_probe.c
+*
+* Description: This file contains the broker round-trip time probe. Every
+*              RTT_PROBE_INTERVAL_MS the task has the publisher task publish
+*              "<sequence> <cycles>" on MQTT_RTT_PROBE_TOPIC, which the
+*              subscriber task subscribes to as well. Going through the
+*              publisher task keeps the publish on the task that the MQTT
+*              client task stops before it tears the connection down. The echo is matched in the subscription callback
+*              and the round-trip time is taken from the DWT cycle counter
+*              stamped into the probe. The times are kept in a fixed-memory
+*              latency histogram.
+*
+*              When RTT_PROBE_DEGRADED_COUNT probes in a row are slower than
+*              RTT_PROBE_THRESHOLD_MS or lost, the task asks the MQTT client
+*              task to drop and reconnect the broker connection, which often
+*              recovers from a stalled TCP connection before the keep-alive
+*              notices it. The probe pauses until the connection is back.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "rtt_probe.h"
+#include "mqtt_task.h"
+#include "publisher_task.h"
+#include "app_time.h"
+#include "cycle_counter.h"
+
+/* Middleware libraries */
+#include "cy_mqtt_api.h"
+#include "cy_retarget_io.h"
+
+#if ENABLE_RTT_PROBE
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* Room for two 32-bit decimal numbers and a space. */
+#define PROBE_PAYLOAD_SIZE          (24u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Task handle for this task. */
+TaskHandle_t rtt_probe_task_handle;
+
+/* Set while the broker connection is up. */
+static volatile bool probe_active;
+
+/* Probe in flight, written by the task and by the subscription callback. */
+static uint32_t probe_sequence;
+static bool probe_echoed;
+static uint32_t probe_rtt_us;
+
+/* Round-trip times in microseconds, owned by this task. */
+static latency_histogram_t histogram;
+
+/* Statistics, and their copy for other tasks. */
+static rtt_probe_stats_t stats;
+static rtt_probe_stats_t last_stats;
+
+static char probe_payload[PROBE_PAYLOAD_SIZE];
+static cy_mqtt_publish_info_t probe_info =
+{
+    .qos = CY_MQTT_QOS0,
+    .topic = MQTT_RTT_PROBE_TOPIC,
+    .topic_len = (sizeof(MQTT_RTT_PROBE_TOPIC) - 1),
+    .retain = false,
+    .dup = false
+};
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool evaluate_probe(void);
+static void send_probe(void);
+
+/******************************************************************************
+ * Function Name: rtt_probe_task
+ ******************************************************************************
+ * Summary:
+ *  Publishes a probe every RTT_PROBE_INTERVAL_MS while the broker connection
+ *  is up, and requests a reconnection when the round-trip time degrades.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_task(void *pvParameters)
+{
+    bool in_flight = false;
+    uint32_t bad_in_row = 0;
+    mqtt_task_cmd_t mqtt_task_cmd;
+    rtt_probe_stats_t stats_copy;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    cycle_counter_init();
+    latency_histogram_init(&histogram);
+
+    while (true)
+    {
+        app_time_delay_ms(RTT_PROBE_INTERVAL_MS);
+
+        if (!probe_active)
+        {
+            in_flight = false;
+            bad_in_row = 0;
+            continue;
+        }
+
+        if (in_flight)
+        {
+            bad_in_row = evaluate_probe() ? 0 : (bad_in_row + 1u);
+        }
+
+        if (bad_in_row >= RTT_PROBE_DEGRADED_COUNT)
+        {
+            printf("RTT probe: %lu slow or lost probes, reconnecting\n",
+                   (unsigned long)bad_in_row);
+            probe_active = false;
+            in_flight = false;
+            bad_in_row = 0;
+            stats.reconnects++;
+
+            mqtt_task_cmd = HANDLE_RTT_DEGRADED;
+            xQueueSend(mqtt_task_q, &mqtt_task_cmd, 0);
+        }
+        else
+        {
+            send_probe();
+            in_flight = true;
+        }
+
+        stats_copy = stats;
+        latency_histogram_summarize(&histogram, &stats_copy.rtt_us);
+        taskENTER_CRITICAL();
+        last_stats = stats_copy;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_start
+ ******************************************************************************
+ * Summary:
+ *  Starts probing. Called by the MQTT client task when the broker connection
+ *  is up.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_start(void)
+{
+    probe_active = true;
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_stop
+ ******************************************************************************
+ * Summary:
+ *  Stops probing. Called by the MQTT client task when the broker connection
+ *  is lost.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_stop(void)
+{
+    probe_active = false;
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_is_echo
+ ******************************************************************************
+ * Summary:
+ *  Checks whether an incoming MQTT message was received on the probe topic.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *received_msg_info : Information structure of
+ *                                                    the received MQTT message
+ *
+ * Return:
+ *  bool : true if the message is a probe echo
+ *
+ ******************************************************************************/
+bool rtt_probe_is_echo(const cy_mqtt_publish_info_t *received_msg_info)
+{
+    return (received_msg_info->topic_len == (sizeof(MQTT_RTT_PROBE_TOPIC) - 1)) &&
+           (strncmp(received_msg_info->topic, MQTT_RTT_PROBE_TOPIC,
+                    received_msg_info->topic_len) == 0);
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_handle_echo
+ ******************************************************************************
+ * Summary:
+ *  Takes the round-trip time of the probe in flight from its echo. This
+ *  function is called from the MQTT library context and never blocks. Echoes
+ *  of earlier probes are ignored.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *received_msg_info : Information structure of
+ *                                                    the received MQTT message
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_handle_echo(const cy_mqtt_publish_info_t *received_msg_info)
+{
+    uint32_t now_cycles = cycle_counter_get();
+    char text[PROBE_PAYLOAD_SIZE];
+    size_t len = received_msg_info->payload_len;
+    char *end;
+    uint32_t sequence;
+    uint32_t sent_cycles;
+
+    if (len >= sizeof(text))
+    {
+        return;
+    }
+    memcpy(text, received_msg_info->payload, len);
+    text[len] = '\0';
+
+    sequence = (uint32_t)strtoul(text, &end, 10);
+    sent_cycles = (uint32_t)strtoul(end, NULL, 10);
+
+    taskENTER_CRITICAL();
+    if ((sequence == probe_sequence) && !probe_echoed)
+    {
+        probe_echoed = true;
+        probe_rtt_us = cycle_counter_to_us(now_cycles - sent_cycles);
+    }
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the probe counters and the round-trip time percentiles.
+ *
+ * Parameters:
+ *  rtt_probe_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_get_stats(rtt_probe_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* Records the outcome of the probe in flight. Returns false if it was lost
+ * or slower than RTT_PROBE_THRESHOLD_MS.
+ */
+static bool evaluate_probe(void)
+{
+    bool echoed;
+    uint32_t rtt_us;
+
+    taskENTER_CRITICAL();
+    echoed = probe_echoed;
+    rtt_us = probe_rtt_us;
+    taskEXIT_CRITICAL();
+
+    if (!echoed)
+    {
+        stats.lost++;
+        return false;
+    }
+
+    latency_histogram_record(&histogram, rtt_us);
+    stats.last_us = rtt_us;
+    if (rtt_us > (RTT_PROBE_THRESHOLD_MS * 1000u))
+    {
+        stats.degraded++;
+        return false;
+    }
+
+    return true;
+}
+
+/* Queues the next probe to the publisher task. */
+static void send_probe(void)
+{
+    publisher_data_t publisher_q_data;
+    uint32_t sequence = probe_sequence + 1u;
+
+    taskENTER_CRITICAL();
+    probe_sequence = sequence;
+    probe_echoed = false;
+    taskEXIT_CRITICAL();
+
+    stats.probes++;
+    publisher_q_data.cmd = PUBLISH_RTT_PROBE;
+    if (!publisher_task_send(&publisher_q_data, 0))
+    {
+        /* Counted as lost when the echo does not arrive. */
+        printf("RTT probe: publisher queue full\n");
+    }
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_publish
+ ******************************************************************************
+ * Summary:
+ *  Publishes the probe in flight, stamped with the cycle counter just before
+ *  the publish so that the time in the publisher queue is not counted.
+ *  Called by the publisher task.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void rtt_probe_publish(void)
+{
+    uint32_t sequence;
+    int len;
+
+    if (!probe_active)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    sequence = probe_sequence;
+    taskEXIT_CRITICAL();
+
+    len = snprintf(probe_payload, sizeof(probe_payload), "%lu %lu",
+                   (unsigned long)sequence, (unsigned long)cycle_counter_get());
+    probe_info.payload = probe_payload;
+    probe_info.payload_len = (len > 0) ? (size_t)len : 0;
+
+    if (cy_mqtt_publish(mqtt_connection, &probe_info) != CY_RSLT_SUCCESS)
+    {
+        /* Counted as lost when the echo does not arrive. */
+        printf("RTT probe: publish failed\n");
+    }
+}
+
+/******************************************************************************
+ * Function Name: rtt_probe_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the probe counters and round-trip time percentiles for the
+ *  get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t rtt_probe_format_stats(char *buf, size_t size)
+{
+    rtt_probe_stats_t stats;
+    int len;
+
+    rtt_probe_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "rtt_probes %lu lost %lu degraded %lu reconnects %lu\n"
+                   "rtt_us last %lu p50 %lu p90 %lu p99 %lu max %lu\n",
+                   (unsigned long)stats.probes,
+                   (unsigned long)stats.lost,
+                   (unsigned long)stats.degraded,
+                   (unsigned long)stats.reconnects,
+                   (unsigned long)stats.last_us,
+                   (unsigned long)stats.rtt_us.p50,
+                   (unsigned long)stats.rtt_us.p90,
+                   (unsigned long)stats.rtt_us.p99,
+                   (unsigned long)stats.rtt_us.max);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_RTT_PROBE */
+
+/* [] END OF FILE */
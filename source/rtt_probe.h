@@ -0,0 +1,72 @@
+/******************************************************************************
+* File Name:   rtt_probe.h
+*
+* Description: This file is the public interface of rtt_probe.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef RTT_PROBE_H_
+#define RTT_PROBE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "rtt_probe_config.h"
+#include "burst_config.h"
+#include "mqtt_client_config.h"
+#include "latency_histogram.h"
+
+#if ENABLE_RTT_PROBE && ((MQTT_TRANSPORT != MQTT_TRANSPORT_TCP) || ENABLE_BURST_CONNECT)
+#error "The RTT probe needs the subscription of the TCP transport outside of burst-connect mode."
+#endif
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the RTT Probe Task. */
+#define RTT_PROBE_TASK_PRIORITY           (1)
+#define RTT_PROBE_TASK_STACK_SIZE         (1024 * 1)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Statistics of the probe. */
+typedef struct
+{
+    uint32_t probes;            /* Probes published */
+    uint32_t lost;              /* Probes without echo, including failed publishes */
+    uint32_t degraded;          /* Probes above RTT_PROBE_THRESHOLD_MS */
+    uint32_t reconnects;        /* Reconnections requested by the probe */
+    uint32_t last_us;
+    latency_summary_t rtt_us;
+} rtt_probe_stats_t;
+
+/*******************************************************************************
+* Extern Variables
+********************************************************************************/
+extern TaskHandle_t rtt_probe_task_handle;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_RTT_PROBE
+void rtt_probe_task(void *pvParameters);
+void rtt_probe_start(void);
+void rtt_probe_stop(void);
+bool rtt_probe_is_echo(const cy_mqtt_publish_info_t *received_msg_info);
+void rtt_probe_handle_echo(const cy_mqtt_publish_info_t *received_msg_info);
+void rtt_probe_get_stats(rtt_probe_stats_t *stats);
+size_t rtt_probe_format_stats(char *buf, size_t size);
+void rtt_probe_publish(void);
+#else
+#define rtt_probe_start()                 do { } while (0)
+#define rtt_probe_stop()                  do { } while (0)
+#define rtt_probe_publish()               do { } while (0)
+#endif /* ENABLE_RTT_PROBE */
+
+#endif /* RTT_PROBE_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,491 @@
+/******************************************************************************
+* File Name:   sensor_scheduler.c
+*
+* Description: This file contains the sensor scheduler task. Sensor drivers
+*              register a sample period and an I/O type. Every driver is due
+*              on multiples of its period on a common time base, so drivers
+*              with related periods share the same wakeup slots. In a slot the
+*              due drivers are grouped by I/O type and sampled back-to-back
+*              while the bus lock of that type is taken only once. The results
+*              are handed to the consumers through a ring that every consumer
+*              reads with its own cursor.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "sensor_scheduler.h"
+#include "cycle_counter.h"
+#include "app_time.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* Registered driver and its scheduling state. */
+typedef struct
+{
+    sensor_driver_t driver;
+    uint32_t next_due_ms;
+    int32_t latest;
+    bool valid;
+} sensor_slot_t;
+
+/* Task handle for this task. */
+TaskHandle_t sensor_scheduler_task_handle;
+
+/* Registered drivers. */
+static sensor_slot_t sensor_slots[SENSOR_SCHEDULER_MAX_DRIVERS];
+static volatile uint8_t sensor_count;
+
+/* Result ring. 'ring_write' counts all samples ever written. */
+static sensor_sample_t sample_ring[SENSOR_SCHEDULER_RING_LENGTH];
+static volatile uint32_t ring_write;
+
+/* Optional lock of each bus, taken once per batch. */
+static SemaphoreHandle_t bus_locks[SENSOR_IO_TYPE_COUNT];
+
+/* Statistics of the current and of the last completed window. */
+static uint32_t window_start_ms;
+static uint32_t window_wakeups;
+static uint32_t window_samples;
+static uint32_t window_bus_cycles[SENSOR_IO_TYPE_COUNT];
+static sensor_scheduler_stats_t last_stats;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint32_t now_ms(void);
+static void sample_batch(sensor_io_type_t io_type, uint32_t slot_ms);
+static void update_stats(uint32_t slot_ms);
+static uint32_t gcd(uint32_t a, uint32_t b);
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_task
+ ******************************************************************************
+ * Summary:
+ *  Task that sleeps until the next wakeup slot in which at least one sensor
+ *  is due, and samples all due sensors batched by I/O type.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void sensor_scheduler_task(void *pvParameters)
+{
+    uint32_t next_due_ms;
+    uint32_t current_ms;
+    bool any_driver;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    cycle_counter_init();
+    window_start_ms = now_ms();
+
+    while (true)
+    {
+        /* Find the next slot in which any driver is due. */
+        any_driver = false;
+        next_due_ms = 0;
+        for (uint8_t i = 0; i < sensor_count; i++)
+        {
+            if (!any_driver || ((int32_t)(sensor_slots[i].next_due_ms - next_due_ms) < 0))
+            {
+                next_due_ms = sensor_slots[i].next_due_ms;
+                any_driver = true;
+            }
+        }
+
+        current_ms = now_ms();
+        if (!any_driver)
+        {
+            /* Sleep until a driver is registered. */
+            app_time_notify_take(APP_TIME_WAIT_FOREVER);
+            continue;
+        }
+
+        if ((int32_t)(next_due_ms - current_ms) > 0)
+        {
+            /* Sleep until the slot; a new registration wakes the task early
+             * so that the plan is recomputed.
+             */
+            app_time_notify_take(next_due_ms - current_ms);
+            continue;
+        }
+
+        window_wakeups++;
+        for (uint32_t io_type = 0; io_type < SENSOR_IO_TYPE_COUNT; io_type++)
+        {
+            sample_batch((sensor_io_type_t)io_type, current_ms);
+        }
+
+        update_stats(current_ms);
+    }
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_register
+ ******************************************************************************
+ * Summary:
+ *  Registers a sensor driver. The first sample is taken on the next multiple
+ *  of the driver period.
+ *
+ * Parameters:
+ *  const sensor_driver_t *driver : Driver description, copied by the scheduler
+ *
+ * Return:
+ *  uint8_t : ID of the driver, or SENSOR_SCHEDULER_INVALID_ID on failure
+ *
+ ******************************************************************************/
+uint8_t sensor_scheduler_register(const sensor_driver_t *driver)
+{
+    uint8_t id = SENSOR_SCHEDULER_INVALID_ID;
+    uint32_t current_ms = now_ms();
+
+    if ((driver == NULL) || (driver->sample == NULL) || (driver->period_ms == 0) ||
+        (driver->io_type >= SENSOR_IO_TYPE_COUNT))
+    {
+        return id;
+    }
+
+    taskENTER_CRITICAL();
+    if (sensor_count < SENSOR_SCHEDULER_MAX_DRIVERS)
+    {
+        id = sensor_count;
+        sensor_slots[id].driver = *driver;
+        sensor_slots[id].next_due_ms = ((current_ms / driver->period_ms) + 1u) * driver->period_ms;
+        sensor_slots[id].valid = false;
+        sensor_count++;
+    }
+    taskEXIT_CRITICAL();
+
+    if ((id != SENSOR_SCHEDULER_INVALID_ID) && (sensor_scheduler_task_handle != NULL))
+    {
+        xTaskNotifyGive(sensor_scheduler_task_handle);
+    }
+
+    return id;
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_set_bus_lock
+ ******************************************************************************
+ * Summary:
+ *  Sets the lock that is taken around every batch of the given I/O type, for
+ *  buses that are shared with code outside the scheduler.
+ *
+ * Parameters:
+ *  sensor_io_type_t io_type : I/O type
+ *  SemaphoreHandle_t lock : Mutex or binary semaphore, NULL for none
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void sensor_scheduler_set_bus_lock(sensor_io_type_t io_type, SemaphoreHandle_t lock)
+{
+    if (io_type < SENSOR_IO_TYPE_COUNT)
+    {
+        bus_locks[io_type] = lock;
+    }
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_read
+ ******************************************************************************
+ * Summary:
+ *  Reads the next sample from the result ring for one consumer. Every
+ *  consumer owns a cursor that starts at 0. A consumer that falls more than
+ *  SENSOR_SCHEDULER_RING_LENGTH samples behind skips to the oldest sample
+ *  still in the ring.
+ *
+ * Parameters:
+ *  uint32_t *cursor : Read cursor of the consumer
+ *  sensor_sample_t *sample : Output sample
+ *
+ * Return:
+ *  bool : true if a sample was read, false if the consumer is up to date
+ *
+ ******************************************************************************/
+bool sensor_scheduler_read(uint32_t *cursor, sensor_sample_t *sample)
+{
+    bool available = false;
+
+    taskENTER_CRITICAL();
+    if ((ring_write - *cursor) > SENSOR_SCHEDULER_RING_LENGTH)
+    {
+        *cursor = ring_write - SENSOR_SCHEDULER_RING_LENGTH;
+    }
+    if (*cursor != ring_write)
+    {
+        *sample = sample_ring[*cursor % SENSOR_SCHEDULER_RING_LENGTH];
+        (*cursor)++;
+        available = true;
+    }
+    taskEXIT_CRITICAL();
+
+    return available;
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_latest
+ ******************************************************************************
+ * Summary:
+ *  Returns the latest sample of a driver.
+ *
+ * Parameters:
+ *  uint8_t driver_id : ID returned by sensor_scheduler_register()
+ *  int32_t *value : Latest sampled value
+ *
+ * Return:
+ *  bool : true if the driver has been sampled at least once
+ *
+ ******************************************************************************/
+bool sensor_scheduler_latest(uint8_t driver_id, int32_t *value)
+{
+    if ((driver_id >= sensor_count) || !sensor_slots[driver_id].valid)
+    {
+        return false;
+    }
+
+    *value = sensor_slots[driver_id].latest;
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_find
+ ******************************************************************************
+ * Summary:
+ *  Returns the ID of a registered driver, for consumers of the result ring
+ *  that did not register the driver themselves.
+ *
+ * Parameters:
+ *  const char *name : Name of the driver
+ *
+ * Return:
+ *  uint8_t : ID of the driver, or SENSOR_SCHEDULER_INVALID_ID if not registered
+ *
+ ******************************************************************************/
+uint8_t sensor_scheduler_find(const char *name)
+{
+    for (uint8_t i = 0; i < sensor_count; i++)
+    {
+        if (strcmp(sensor_slots[i].driver.name, name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return SENSOR_SCHEDULER_INVALID_ID;
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the statistics of the last completed measurement window.
+ *
+ * Parameters:
+ *  sensor_scheduler_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void sensor_scheduler_get_stats(sensor_scheduler_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = last_stats;
+    taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: sample_batch
+ ******************************************************************************
+ * Summary:
+ *  Samples all due drivers of one I/O type back-to-back, holding the bus lock
+ *  of that type once for the whole batch.
+ *
+ * Parameters:
+ *  sensor_io_type_t io_type : I/O type of the batch
+ *  uint32_t slot_ms : Time of the wakeup slot
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void sample_batch(sensor_io_type_t io_type, uint32_t slot_ms)
+{
+    bool locked = false;
+    uint32_t start_cycles;
+    int32_t value;
+    sensor_slot_t *slot;
+
+    for (uint8_t i = 0; i < sensor_count; i++)
+    {
+        slot = &sensor_slots[i];
+        if ((slot->driver.io_type != io_type) || ((int32_t)(slot->next_due_ms - slot_ms) > 0))
+        {
+            continue;
+        }
+
+        if (!locked && (bus_locks[io_type] != NULL))
+        {
+            xSemaphoreTake(bus_locks[io_type], portMAX_DELAY);
+        }
+        locked = true;
+
+        start_cycles = cycle_counter_get();
+        if (slot->driver.sample(slot->driver.context, &value) == CY_RSLT_SUCCESS)
+        {
+            slot->latest = value;
+            slot->valid = true;
+
+            taskENTER_CRITICAL();
+            sample_ring[ring_write % SENSOR_SCHEDULER_RING_LENGTH] = (sensor_sample_t)
+            {
+                .driver_id = i,
+                .value = value,
+                .timestamp_ms = slot_ms
+            };
+            ring_write++;
+            taskEXIT_CRITICAL();
+
+            window_samples++;
+        }
+        window_bus_cycles[io_type] += cycle_counter_get() - start_cycles;
+
+        /* Schedule the next sample, skipping slots that were missed. */
+        do
+        {
+            slot->next_due_ms += slot->driver.period_ms;
+        } while ((int32_t)(slot->next_due_ms - slot_ms) <= 0);
+    }
+
+    if (locked && (bus_locks[io_type] != NULL))
+    {
+        xSemaphoreGive(bus_locks[io_type]);
+    }
+}
+
+/******************************************************************************
+ * Function Name: update_stats
+ ******************************************************************************
+ * Summary:
+ *  Closes the measurement window when it has elapsed and computes the
+ *  wakeups per second and the utilization of every bus.
+ *
+ * Parameters:
+ *  uint32_t slot_ms : Time of the current wakeup slot
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void update_stats(uint32_t slot_ms)
+{
+    uint32_t elapsed_ms = slot_ms - window_start_ms;
+    uint64_t window_cycles;
+    sensor_scheduler_stats_t stats;
+
+    if (elapsed_ms < SENSOR_SCHEDULER_STATS_WINDOW_MS)
+    {
+        return;
+    }
+
+    window_cycles = ((uint64_t)SystemCoreClock * elapsed_ms) / 1000u;
+
+    stats.wakeups_per_sec_x100 = (window_wakeups * 100000u) / elapsed_ms;
+    stats.samples_per_sec_x100 = (window_samples * 100000u) / elapsed_ms;
+    stats.slot_period_ms = 0;
+    for (uint8_t i = 0; i < sensor_count; i++)
+    {
+        stats.slot_period_ms = gcd(stats.slot_period_ms, sensor_slots[i].driver.period_ms);
+    }
+    for (uint32_t io_type = 0; io_type < SENSOR_IO_TYPE_COUNT; io_type++)
+    {
+        stats.bus_utilization_ppm[io_type] =
+            (uint32_t)(((uint64_t)window_bus_cycles[io_type] * 1000000u) / window_cycles);
+        window_bus_cycles[io_type] = 0;
+    }
+
+    taskENTER_CRITICAL();
+    last_stats = stats;
+    taskEXIT_CRITICAL();
+
+    window_start_ms = slot_ms;
+    window_wakeups = 0;
+    window_samples = 0;
+}
+
+/* Current time in milliseconds. */
+static uint32_t now_ms(void)
+{
+    return app_time_now_ms();
+}
+
+/* Greatest common divisor, used to report the base slot period. */
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/******************************************************************************
+ * Function Name: sensor_scheduler_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the wakeup rate, sample rate, slot period and bus utilization
+ *  for the get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t sensor_scheduler_format_stats(char *buf, size_t size)
+{
+    sensor_scheduler_stats_t stats;
+    int len;
+
+    sensor_scheduler_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "sensor_wakeups_per_sec_x100 %lu\n"
+                   "sensor_samples_per_sec_x100 %lu\n"
+                   "sensor_slot_period_ms %lu\n"
+                   "bus_utilization_ppm adc %lu i2c %lu gpio %lu\n",
+                   (unsigned long)stats.wakeups_per_sec_x100,
+                   (unsigned long)stats.samples_per_sec_x100,
+                   (unsigned long)stats.slot_period_ms,
+                   (unsigned long)stats.bus_utilization_ppm[SENSOR_IO_ADC],
+                   (unsigned long)stats.bus_utilization_ppm[SENSOR_IO_I2C],
+                   (unsigned long)stats.bus_utilization_ppm[SENSOR_IO_GPIO]);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+/* [] END OF FILE */
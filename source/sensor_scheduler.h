@@ -0,0 +1,104 @@
+/******************************************************************************
+* File Name:   sensor_scheduler.h
+*
+* Description: This file is the public interface of sensor_scheduler.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef SENSOR_SCHEDULER_H_
+#define SENSOR_SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cy_result.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Sensor Scheduler Task. */
+#define SENSOR_SCHEDULER_TASK_PRIORITY    (3)
+#define SENSOR_SCHEDULER_TASK_STACK_SIZE  (1024 * 1)
+
+/* Maximum number of registered sensor drivers. */
+#define SENSOR_SCHEDULER_MAX_DRIVERS      (8u)
+
+/* Number of samples kept in the result ring shared by all consumers. */
+#define SENSOR_SCHEDULER_RING_LENGTH      (32u)
+
+/* Interval in milliseconds over which wakeups and bus utilization are
+ * measured.
+ */
+#define SENSOR_SCHEDULER_STATS_WINDOW_MS  (10000u)
+
+/* Value returned by sensor_scheduler_register() on failure. */
+#define SENSOR_SCHEDULER_INVALID_ID       (0xFFu)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* I/O type of a sensor. Drivers of the same type are sampled back-to-back in a
+ * wakeup slot while holding the bus lock of that type once.
+ */
+typedef enum
+{
+    SENSOR_IO_ADC,
+    SENSOR_IO_I2C,
+    SENSOR_IO_GPIO,
+    SENSOR_IO_TYPE_COUNT
+} sensor_io_type_t;
+
+/* Sampling function of a sensor driver. */
+typedef cy_rslt_t (*sensor_sample_fn_t)(void *context, int32_t *value);
+
+/* Sensor driver registered with the scheduler. */
+typedef struct
+{
+    const char *name;
+    sensor_io_type_t io_type;
+    uint32_t period_ms;
+    sensor_sample_fn_t sample;
+    void *context;
+} sensor_driver_t;
+
+/* One sample in the result ring. */
+typedef struct
+{
+    uint8_t driver_id;
+    int32_t value;
+    uint32_t timestamp_ms;
+} sensor_sample_t;
+
+/* Scheduler statistics over the last SENSOR_SCHEDULER_STATS_WINDOW_MS. */
+typedef struct
+{
+    uint32_t wakeups_per_sec_x100;
+    uint32_t samples_per_sec_x100;
+    uint32_t bus_utilization_ppm[SENSOR_IO_TYPE_COUNT];
+    uint32_t slot_period_ms;
+} sensor_scheduler_stats_t;
+
+/*******************************************************************************
+* Extern Variables
+********************************************************************************/
+extern TaskHandle_t sensor_scheduler_task_handle;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void sensor_scheduler_task(void *pvParameters);
+uint8_t sensor_scheduler_register(const sensor_driver_t *driver);
+void sensor_scheduler_set_bus_lock(sensor_io_type_t io_type, SemaphoreHandle_t lock);
+bool sensor_scheduler_read(uint32_t *cursor, sensor_sample_t *sample);
+bool sensor_scheduler_latest(uint8_t driver_id, int32_t *value);
+uint8_t sensor_scheduler_find(const char *name);
+void sensor_scheduler_get_stats(sensor_scheduler_stats_t *stats);
+size_t sensor_scheduler_format_stats(char *buf, size_t size);
+
+#endif /* SENSOR_SCHEDULER_H_ */
+
+/* [] END OF FILE */
@@ -42,6 +42,7 @@
 * so agrees to indemnify Cypress against all liability.
 *******************************************************************************/
 
+#include <stdio.h>
 #include "cyhal.h"
 #include "cybsp.h"
 #include "string.h"
@@ -50,6 +51,10 @@
 /* Task header files */
 #include "subscriber_task.h"
 #include "mqtt_task.h"
+#include "mqtt_rpc.h"
+#include "rtt_probe.h"
+#include "app_time.h"
+#include "cycle_counter.h"
 
 /* Configuration file for MQTT client */
 #include "mqtt_client_config.h"
@@ -67,14 +72,17 @@
 /* Time interval in milliseconds between MQTT subscribe retries. */
 #define MQTT_SUBSCRIBE_RETRY_INTERVAL_MS        (1000)
 
-/* The number of MQTT topics to be subscribed to. */
-#define SUBSCRIPTION_COUNT                      (1)
-
 /* Queue length of a message queue that is used to communicate with the 
  * subscriber task.
  */
 #define SUBSCRIBER_TASK_QUEUE_LENGTH            (1u)
 
+/* Notification bits of the subscriber task: a command in the queue, and a
+ * command in the mailbox of an actuator.
+ */
+#define SUBSCRIBER_NOTIFY_QUEUE                 (1uL << 31)
+#define SUBSCRIBER_NOTIFY_MAILBOX               (1uL << 0)
+
 /******************************************************************************
 * Global Variables
 *******************************************************************************/
@@ -89,19 +97,51 @@ QueueHandle_t subscriber_task_q;
  */
 uint32_t current_device_state = DEVICE_OFF_STATE;
 
-/* Configure the subscription information structure. */
-static cy_mqtt_subscribe_info_t subscribe_info =
+/* Latest-value-wins command mailbox of every actuator, posted to by the
+ * subscription callback. Only the subscriber task records latencies.
+ */
+static command_mailbox_t mailboxes[SUBSCRIBER_ACTUATOR_COUNT];
+
+static const char *const actuator_names[SUBSCRIBER_ACTUATOR_COUNT] =
+{
+    [SUBSCRIBER_ACTUATOR_LED] = "led"
+};
+
+/* Configure the subscription information structures. */
+static cy_mqtt_subscribe_info_t subscribe_info[] =
 {
-    .qos = (cy_mqtt_qos_t) MQTT_MESSAGES_QOS,
-    .topic = MQTT_SUB_TOPIC,
-    .topic_len = (sizeof(MQTT_SUB_TOPIC) - 1)
+    {
+        .qos = (cy_mqtt_qos_t) MQTT_MESSAGES_QOS,
+        .topic = MQTT_SUB_TOPIC,
+        .topic_len = (sizeof(MQTT_SUB_TOPIC) - 1)
+    },
+#if ENABLE_MQTT_RPC
+    {
+        .qos = CY_MQTT_QOS1,
+        .topic = MQTT_RPC_REQUEST_TOPIC,
+        .topic_len = (sizeof(MQTT_RPC_REQUEST_TOPIC) - 1)
+    },
+#endif /* ENABLE_MQTT_RPC */
+#if ENABLE_RTT_PROBE
+    {
+        .qos = CY_MQTT_QOS0,
+        .topic = MQTT_RTT_PROBE_TOPIC,
+        .topic_len = (sizeof(MQTT_RTT_PROBE_TOPIC) - 1)
+    },
+#endif /* ENABLE_RTT_PROBE */
 };
 
+/* The number of MQTT topics to be subscribed to. */
+#define SUBSCRIPTION_COUNT                      (sizeof(subscribe_info) / sizeof(subscribe_info[0]))
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
 static void subscribe_to_topic(void);
 static void unsubscribe_from_topic(void);
+static void post_command(subscriber_actuator_t actuator, uint32_t value);
+static void apply_mailbox(subscriber_actuator_t actuator);
+static void apply_command(subscriber_actuator_t actuator, uint32_t value);
 void print_heap_usage(char *msg);
 
 /******************************************************************************
@@ -109,9 +149,9 @@ void print_heap_usage(char *msg);
  ******************************************************************************
  * Summary:
  *  Task that sets up the user LED GPIO, subscribes to the specified MQTT topic,
- *  and controls the user LED based on the received commands over the message 
- *  queue. The task can also unsubscribe from the topic based on the commands
- *  via the message queue.
+ *  and controls the user LED based on the commands in its mailbox. The task
+ *  can also subscribe again or unsubscribe from the topic based on the
+ *  commands via the message queue.
  *
  * Parameters:
  *  void *pvParameters : Task parameter defined during task creation (unused)
@@ -130,17 +170,25 @@ void subscriber_task(void *pvParameters)
     /* Initialize the User LED. */
     cyhal_gpio_init(CYBSP_USER_LED, CYHAL_GPIO_DIR_OUTPUT, CYHAL_GPIO_DRIVE_PULLUP,
                     CYBSP_LED_STATE_OFF);
+    cycle_counter_init();
 
-    /* Subscribe to the specified MQTT topic. */
-    subscribe_to_topic();
+    /* The mailboxes must be ready before the first command arrives. */
+    command_mailbox_init(&mailboxes[SUBSCRIBER_ACTUATOR_LED], DEVICE_OFF_STATE);
 
     /* Create a message queue to communicate with other tasks and callbacks. */
     subscriber_task_q = xQueueCreate(SUBSCRIBER_TASK_QUEUE_LENGTH, sizeof(subscriber_data_t));
 
+    /* Subscribe to the specified MQTT topic. */
+    subscribe_to_topic();
+
     while (true)
     {
-        /* Wait for commands from other tasks and callbacks. */
-        if (pdTRUE == xQueueReceive(subscriber_task_q, &subscriber_q_data, portMAX_DELAY))
+        /* Wait for commands from the MQTT client task and for device
+         * commands posted by the subscription callback.
+         */
+        (void)xTaskNotifyWait(0, UINT32_MAX, NULL, portMAX_DELAY);
+
+        while (pdTRUE == xQueueReceive(subscriber_task_q, &subscriber_q_data, 0))
         {
             switch(subscriber_q_data.cmd)
             {
@@ -155,23 +203,89 @@ void subscriber_task(void *pvParameters)
                     unsubscribe_from_topic();
                     break;
                 }
-
-                case UPDATE_DEVICE_STATE:
-                {
-                    /* Update the LED state as per received notification. */
-                    cyhal_gpio_write(CYBSP_USER_LED, subscriber_q_data.data);
-
-                    /* Update the current device state extern variable. */
-                    current_device_state = subscriber_q_data.data;
-
-                    print_heap_usage("subscriber_task: After updating LED state");
-                    break;
-                }
             }
         }
+
+        for (uint32_t i = 0; i < SUBSCRIBER_ACTUATOR_COUNT; i++)
+        {
+            apply_mailbox((subscriber_actuator_t)i);
+        }
     }
 }
 
+/******************************************************************************
+ * Function Name: subscriber_task_send
+ ******************************************************************************
+ * Summary:
+ *  Queues a command to the subscriber task and wakes the task.
+ *
+ * Parameters:
+ *  const subscriber_data_t *subscriber_q_data : Command
+ *  TickType_t ticks_to_wait : Time to wait for room in the queue
+ *
+ * Return:
+ *  bool : false if the task is not running or the queue stayed full
+ *
+ ******************************************************************************/
+bool subscriber_task_send(const subscriber_data_t *subscriber_q_data, TickType_t ticks_to_wait)
+{
+    if ((subscriber_task_q == NULL) ||
+        (xQueueSend(subscriber_task_q, subscriber_q_data, ticks_to_wait) != pdTRUE))
+    {
+        return false;
+    }
+
+    (void)xTaskNotify(subscriber_task_handle, SUBSCRIBER_NOTIFY_QUEUE, eSetBits);
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: subscriber_get_command_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the received, merged, skipped and applied commands of an actuator
+ *  and the percentiles of their apply latency in microseconds.
+ *
+ * Parameters:
+ *  subscriber_actuator_t actuator : Actuator
+ *  command_mailbox_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void subscriber_get_command_stats(subscriber_actuator_t actuator, command_mailbox_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    command_mailbox_get_counters(&mailboxes[actuator], stats);
+    taskEXIT_CRITICAL();
+
+    /* The scan of the latency histogram keeps the subscriber task from
+     * recording, but leaves the interrupts enabled.
+     */
+    vTaskSuspendAll();
+    command_mailbox_get_latency(&mailboxes[actuator], &stats->latency);
+    (void)xTaskResumeAll();
+}
+
+/******************************************************************************
+ * Function Name: subscriber_actuator_name
+ ******************************************************************************
+ * Summary:
+ *  Returns the name of an actuator for the statistics.
+ *
+ * Parameters:
+ *  subscriber_actuator_t actuator : Actuator
+ *
+ * Return:
+ *  const char * : Name of the actuator
+ *
+ ******************************************************************************/
+const char *subscriber_actuator_name(subscriber_actuator_t actuator)
+{
+    return actuator_names[actuator];
+}
+
 /******************************************************************************
  * Function Name: subscribe_to_topic
  ******************************************************************************
@@ -199,15 +313,21 @@ static void subscribe_to_topic(void)
     /* Subscribe with the configured parameters. */
     for (uint32_t retry_count = 0; retry_count < MAX_SUBSCRIBE_RETRIES; retry_count++)
     {
-        result = cy_mqtt_subscribe(mqtt_connection, &subscribe_info, SUBSCRIPTION_COUNT);
+        result = cy_mqtt_subscribe(mqtt_connection, subscribe_info, SUBSCRIPTION_COUNT);
         if (result == CY_RSLT_SUCCESS)
         {
-            printf("\nMQTT client subscribed to the topic '%.*s' successfully.\n", 
-                    subscribe_info.topic_len, subscribe_info.topic);
+            for (uint32_t i = 0; i < SUBSCRIPTION_COUNT; i++)
+            {
+                printf("\nMQTT client subscribed to the topic '%.*s' successfully.\n",
+                        subscribe_info[i].topic_len, subscribe_info[i].topic);
+            }
             break;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(MQTT_SUBSCRIBE_RETRY_INTERVAL_MS));
+        /* The delay keeps the mailbox and queue bits of the notification
+         * value, so commands posted meanwhile are served afterwards.
+         */
+        app_time_delay_ms(MQTT_SUBSCRIBE_RETRY_INTERVAL_MS);
     }
 
     if (result != CY_RSLT_SUCCESS)
@@ -217,8 +337,13 @@ static void subscribe_to_topic(void)
 
         /* Notify the MQTT client task about the subscription failure */
         mqtt_task_cmd = HANDLE_MQTT_SUBSCRIBE_FAILURE;
-        xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
     }
+    else
+    {
+        /* Let the MQTT client task start publishing. */
+        mqtt_task_cmd = HANDLE_MQTT_SUBSCRIBED;
+    }
+    xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
 }
 
 /******************************************************************************
@@ -226,9 +351,9 @@ static void subscribe_to_topic(void)
  ******************************************************************************
  * Summary:
  *  Callback to handle incoming MQTT messages. This callback prints the 
- *  contents of the incoming message and informs the subscriber task, via a 
- *  message queue, to turn on / turn off the device based on the received 
- *  message.
+ *  contents of the incoming message and posts the device state to the
+ *  mailbox of the user LED without blocking; the subscriber task applies
+ *  only the latest state.
  *
  * Parameters:
  *  cy_mqtt_publish_info_t *received_msg_info : Information structure of the 
@@ -244,8 +369,26 @@ void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info)
     const char *received_msg = received_msg_info->payload;
     int received_msg_len = received_msg_info->payload_len;
 
-    /* Data to be sent to the subscriber task queue. */
-    subscriber_data_t subscriber_q_data;
+    /* Device state of the command. */
+    uint32_t device_state;
+
+#if ENABLE_MQTT_RPC
+    /* Diagnostic requests are handed to the RPC task. */
+    if (mqtt_rpc_is_request(received_msg_info))
+    {
+        mqtt_rpc_handle_request(received_msg_info);
+        return;
+    }
+#endif /* ENABLE_MQTT_RPC */
+
+#if ENABLE_RTT_PROBE
+    /* Echoes of the round-trip time probe are not device commands. */
+    if (rtt_probe_is_echo(received_msg_info))
+    {
+        rtt_probe_handle_echo(received_msg_info);
+        return;
+    }
+#endif /* ENABLE_RTT_PROBE */
 
     printf("  \nSubsciber: Incoming MQTT message received:\n"
            "    Publish topic name: %.*s\n"
@@ -255,19 +398,16 @@ void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info)
            (int) received_msg_info->qos,
            (int) received_msg_info->payload_len, (const char *)received_msg_info->payload);
 
-    /* Assign the command to be sent to the subscriber task. */
-    subscriber_q_data.cmd = UPDATE_DEVICE_STATE;
-
     /* Assign the device state depending on the received MQTT message. */
     if ((strlen(MQTT_DEVICE_ON_MESSAGE) == received_msg_len) &&
         (strncmp(MQTT_DEVICE_ON_MESSAGE, received_msg, received_msg_len) == 0))
     {
-        subscriber_q_data.data = DEVICE_ON_STATE;
+        device_state = DEVICE_ON_STATE;
     }
     else if ((strlen(MQTT_DEVICE_OFF_MESSAGE) == received_msg_len) &&
              (strncmp(MQTT_DEVICE_OFF_MESSAGE, received_msg, received_msg_len) == 0))
     {
-        subscriber_q_data.data = DEVICE_OFF_STATE;
+        device_state = DEVICE_OFF_STATE;
     }
     else
     {
@@ -275,10 +415,7 @@ void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info)
         return;
     }
 
-    print_heap_usage("MQTT subscription callback");
-
-    /* Send the command and data to subscriber task queue */
-    xQueueSend(subscriber_task_q, &subscriber_q_data, portMAX_DELAY);
+    post_command(SUBSCRIBER_ACTUATOR_LED, device_state);
 }
 
 /******************************************************************************
@@ -298,7 +435,7 @@ void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info)
 static void unsubscribe_from_topic(void)
 {
     cy_rslt_t result = cy_mqtt_unsubscribe(mqtt_connection, 
-                                           (cy_mqtt_unsubscribe_info_t *) &subscribe_info, 
+                                           (cy_mqtt_unsubscribe_info_t *) subscribe_info,
                                            SUBSCRIPTION_COUNT);
 
     if (result != CY_RSLT_SUCCESS)
@@ -307,4 +444,122 @@ static void unsubscribe_from_topic(void)
     }
 }
 
+/* Posts a command to the mailbox of an actuator and wakes the subscriber
+ * task if the mailbox was empty. Never blocks.
+ */
+static void post_command(subscriber_actuator_t actuator, uint32_t value)
+{
+    uint32_t now_cycles = cycle_counter_get();
+    bool wake;
+
+    taskENTER_CRITICAL();
+    wake = command_mailbox_post(&mailboxes[actuator], value, now_cycles);
+    taskEXIT_CRITICAL();
+
+    if (wake)
+    {
+        (void)xTaskNotify(subscriber_task_handle, SUBSCRIBER_NOTIFY_MAILBOX, eSetBits);
+    }
+}
+
+/* Applies the command in the mailbox of an actuator, if any, and records its
+ * latency from the post.
+ */
+static void apply_mailbox(subscriber_actuator_t actuator)
+{
+    command_mailbox_t *mailbox = &mailboxes[actuator];
+    uint32_t value;
+    uint32_t posted_cycles;
+    uint32_t latency_us;
+    bool taken;
+
+    taskENTER_CRITICAL();
+    taken = command_mailbox_take(mailbox, &value, &posted_cycles);
+    taskEXIT_CRITICAL();
+
+    if (!taken)
+    {
+        return;
+    }
+
+    apply_command(actuator, value);
+    latency_us = cycle_counter_to_us(cycle_counter_get() - posted_cycles);
+
+    taskENTER_CRITICAL();
+    command_mailbox_applied(mailbox, latency_us);
+    taskEXIT_CRITICAL();
+}
+
+/* Drives an actuator to the state of a command. */
+static void apply_command(subscriber_actuator_t actuator, uint32_t value)
+{
+    switch (actuator)
+    {
+        case SUBSCRIBER_ACTUATOR_LED:
+        {
+            /* Update the LED state as per received notification. */
+            cyhal_gpio_write(CYBSP_USER_LED, value);
+
+            /* Update the current device state extern variable. */
+            current_device_state = value;
+            mqtt_rpc_trace(MQTT_RPC_TRACE_DEVICE_STATE, value);
+
+            print_heap_usage("subscriber_task: After updating LED state");
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: subscriber_task_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the command counters and apply latency of every actuator for the
+ *  get-stats RPC command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t subscriber_task_format_stats(char *buf, size_t size)
+{
+    command_mailbox_stats_t stats;
+    size_t pos = 0;
+    int len;
+
+    for (uint32_t actuator = 0; (actuator < SUBSCRIBER_ACTUATOR_COUNT) && (pos < size); actuator++)
+    {
+        subscriber_get_command_stats((subscriber_actuator_t)actuator, &stats);
+        len = snprintf(&buf[pos], size - pos,
+                       "commands %s received %lu merged %lu skipped %lu applied %lu "
+                       "apply_us p50 %lu p99 %lu max %lu\n",
+                       subscriber_actuator_name((subscriber_actuator_t)actuator),
+                       (unsigned long)stats.received,
+                       (unsigned long)stats.merged,
+                       (unsigned long)stats.skipped,
+                       (unsigned long)stats.applied,
+                       (unsigned long)stats.latency.p50,
+                       (unsigned long)stats.latency.p99,
+                       (unsigned long)stats.latency.max);
+        pos = (len > 0) ? (pos + (size_t)len) : pos;
+    }
+
+    /* snprintf truncated the last line. */
+    if ((size > 0) && (pos >= size))
+    {
+        pos = size - 1u;
+    }
+
+    return pos;
+}
+
 /* [] END OF FILE */
@@ -42,10 +42,12 @@
 #ifndef SUBSCRIBER_TASK_H_
 #define SUBSCRIBER_TASK_H_
 
+#include <stdbool.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 #include "cy_mqtt_api.h"
+#include "command_mailbox.h"
 
 /*******************************************************************************
 * Macros
@@ -65,16 +67,21 @@
 typedef enum
 {
     SUBSCRIBE_TO_TOPIC,
-    UNSUBSCRIBE_FROM_TOPIC,
-    UPDATE_DEVICE_STATE
+    UNSUBSCRIBE_FROM_TOPIC
 } subscriber_cmd_t;
 
 /* Struct to be passed via the subscriber task queue */
 typedef struct{
     subscriber_cmd_t cmd;
-    uint8_t data;
 } subscriber_data_t;
 
+/* Actuators driven by the subscriber task, each with a command mailbox. */
+typedef enum
+{
+    SUBSCRIBER_ACTUATOR_LED,
+    SUBSCRIBER_ACTUATOR_COUNT
+} subscriber_actuator_t;
+
 /*******************************************************************************
 * Extern Variables
 ********************************************************************************/
@@ -86,7 +93,11 @@ extern uint32_t current_device_state;
 * Function Prototypes
 ********************************************************************************/
 void subscriber_task(void *pvParameters);
+bool subscriber_task_send(const subscriber_data_t *subscriber_q_data, TickType_t ticks_to_wait);
 void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info);
+void subscriber_get_command_stats(subscriber_actuator_t actuator, command_mailbox_stats_t *stats);
+const char *subscriber_actuator_name(subscriber_actuator_t actuator);
+size_t subscriber_task_format_stats(char *buf, size_t size);
 
 #endif /* SUBSCRIBER_TASK_H_ */
 
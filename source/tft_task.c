@@ -13,6 +13,12 @@
 #include "mtb_st7789v.h"
 #include "mtb_light_sensor.h"
 #include "tft_task.h"
+#include "presence_history.h"
+#include "radar_fusion.h"
+#include "radar_config.h"
+#include "sensor_scheduler.h"
+#include "app_time.h"
+#include "render_server.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -36,12 +42,33 @@ const mtb_st7789v_pins_t tft_pins =
 
 #define LIGHT_SENSOR_PIN (CYBSP_A0)
 
+/* Sample period of the ambient light sensor in the sensor scheduler. */
+#define LIGHT_SENSOR_PERIOD_MS  (200u)
+
+/* Frame period of the display. */
+#define TFT_FRAME_PERIOD_MS     (100u)
+
+/* Time an alert stays on the screen. */
+#define TFT_ALERT_DURATION_MS   (5000u)
+#define TFT_ALERT_Y             (226)
+
+/* Position and height of the ambient light chart, and its sample interval. */
+#define TFT_CHART_X             (10)
+#define TFT_CHART_Y             (130)
+#define TFT_CHART_HEIGHT        (70)
+#define TFT_CHART_INTERVAL_MS   (1000u)
+
 cyhal_adc_t adc;
 mtb_light_sensor_t light_sensor;
 
+/* ID of the light sensor driver in the sensor scheduler. */
+static uint8_t light_sensor_id = SENSOR_SCHEDULER_INVALID_ID;
+
 /*******************************************************************************
 * Forward Function Prototypes
 *******************************************************************************/
+static cy_rslt_t light_sensor_sample(void *context, int32_t *value);
+static void draw_model(render_model_t *model);
 
 /*******************************************************************************
 * Function Name: void tft_task(void *arg)
@@ -73,13 +100,36 @@ void tft_task(void *arg)
       result = mtb_light_sensor_init(&light_sensor, &adc, LIGHT_SENSOR_PIN);
       CY_ASSERT(result == CY_RSLT_SUCCESS);
 
+    /* Hand the light sensor over to the sensor scheduler. */
+    const sensor_driver_t light_sensor_driver =
+    {
+        .name = "light",
+        .io_type = SENSOR_IO_ADC,
+        .period_ms = LIGHT_SENSOR_PERIOD_MS,
+        .sample = light_sensor_sample,
+        .context = &light_sensor
+    };
+    light_sensor_id = sensor_scheduler_register(&light_sensor_driver);
+    CY_ASSERT(light_sensor_id != SENSOR_SCHEDULER_INVALID_ID);
+
     /* To avoid compiler warning */
     (void)result;
     
-    bool tdState = 0;
-    bool pdState = 0;
+    /* Fusion of the polled TD/PD lines of all radar sensors. */
+    static radar_fusion_t display_fusion;
+    radar_fusion_input_t radar_input;
+    radar_fused_state_t fused;
+    uint8_t radar_zones[RADAR_SENSOR_COUNT];
+
+    for (uint32_t i = 0; i < RADAR_SENSOR_COUNT; i++)
+    {
+        radar_zones[i] = radar_sensors[i].zone;
+    }
+    radar_fusion_init(&display_fusion, radar_zones, RADAR_SENSOR_COUNT,
+                      RADAR_FUSION_VOTE_THRESHOLD, RADAR_FUSION_DIRECTION_WINDOW_MS);
 
-    uint8_t light = mtb_light_sensor_light_level(&light_sensor);
+    uint8_t light = 0;
+    int32_t light_sample;
 
     GUI_Init();
     GUI_SetBkColor(GUI_BLUE);
@@ -90,35 +140,192 @@ void tft_task(void *arg)
     GUI_DispStringHCenterAt("Controller" , 160, 90);
     GUI_SetFont(&GUI_Font16B_1);
 
+    /* Screen model of the render server; everything starts dirty. */
+    static render_model_t model;
+    model.field_value[RENDER_FIELD_MQTT_STATE] = RENDER_MQTT_DISCONNECTED;
+    model.field_dirty = (1u << RENDER_FIELD_COUNT) - 1u;
+    model.chart_dirty = true;
+
+    uint32_t last_chart_ms = app_time_now_ms();
+    uint32_t alert_shown_ms = 0;
+    int16_t last_presence = -1;
+    int16_t last_light = -1;
+
     for(;;)
     {
-    	light = mtb_light_sensor_light_level(&light_sensor);
-    	GUI_DispStringAt("Ambient Light:  ", 100, 150);   //90,180
-    	GUI_DispDec(light, 3);
+    	if (sensor_scheduler_latest(light_sensor_id, &light_sample))
+    	{
+    		light = (uint8_t)light_sample;
+    	}
+    	presence_history_set_light(light);
+    	if (light != last_light)
+    	{
+    		last_light = light;
+    		render_set_field(RENDER_FIELD_LIGHT, light);
+    	}
+
+    	if ((app_time_now_ms() - last_chart_ms) >= TFT_CHART_INTERVAL_MS)
+    	{
+    		last_chart_ms = app_time_now_ms();
+    		render_chart_point(light);
+    	}
 
-    	tdState = cyhal_gpio_read(CYBSP_A7);
-    	pdState = cyhal_gpio_read(CYBSP_A15);
-    	cyhal_gpio_write(CYBSP_USER_LED, tdState);
-    	cyhal_gpio_write(CYBSP_USER_LED2, pdState);
+    	/* Poll every radar sensor in one pass and fuse their states. */
+    	radar_input.timestamp_ms = app_time_now_ms();
+    	for (uint32_t i = 0; i < RADAR_SENSOR_COUNT; i++)
+    	{
+    		radar_input.sensor = (uint8_t)i;
+    		radar_input.td_level = cyhal_gpio_read(radar_sensors[i].td_pin);
+    		radar_input.pd_level = cyhal_gpio_read(radar_sensors[i].pd_pin);
+    		(void)radar_fusion_update(&display_fusion, &radar_input);
+    	}
+    	fused = radar_fusion_get_state(&display_fusion);
 
-    	if (!tdState)
+    	cyhal_gpio_write(CYBSP_USER_LED, !fused.presence);
+    	cyhal_gpio_write(CYBSP_USER_LED2, fused.approaching);
+
+    	int16_t presence = (fused.presence ? RENDER_PRESENCE_DETECTED : 0) |
+    	                   (fused.approaching ? RENDER_PRESENCE_APPROACHING : 0);
+    	if (presence != last_presence)
     	{
-    		GUI_DispStringAt("Presence Detected", 100, 170);
-    		if (pdState)
+    		last_presence = presence;
+    		render_set_field(RENDER_FIELD_PRESENCE, presence);
+    	}
+
+    	/* Drain the draw commands of all tasks and redraw what changed. */
+    	if (render_server_begin_frame(&model))
+    	{
+    		if (model.alert_dirty)
     		{
-				GUI_DispStringAt("Approaching", 100, 190);
-			} else
-			{
-				GUI_ClearRect(90, 190, 250, 250);
-			}
-    	} else
+    			alert_shown_ms = app_time_now_ms();
+    		}
+    		draw_model(&model);
+    	}
+    	render_server_end_frame();
+
+    	/* Remove an alert once it has been shown long enough. */
+    	if ((model.alert[0] != '\0') && ((app_time_now_ms() - alert_shown_ms) >= TFT_ALERT_DURATION_MS))
     	{
-    		GUI_ClearRect(90, 170, 250, 250);
+    		model.alert[0] = '\0';
+    		model.alert_dirty = true;
+    		draw_model(&model);
     	}
 
+    	app_time_delay_ms(TFT_FRAME_PERIOD_MS);
+    }
+}
+
+/*******************************************************************************
+* Function Name: void draw_model(render_model_t *model)
+********************************************************************************
+*
+* Summary: Redraws the dirty parts of the screen model and clears their dirty
+*           flags. Only called from the TFT task, the single owner of emWin.
+*
+* Parameters:
+*  model: screen model of the render server
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+static void draw_model(render_model_t *model)
+{
+    static const char *const mqtt_state_names[] =
+    {
+        "Disconnected  ", "Wi-Fi joining ", "Broker connect", "Connected     "
+    };
+    static const char *const orientation_names[] =
+    {
+        "-          ", "Top edge   ", "Bottom edge", "Left edge  ",
+        "Right edge ", "Display up ", "Display dn "
+    };
+    int16_t value;
+
+    if (model->field_dirty & (1u << RENDER_FIELD_MQTT_STATE))
+    {
+        value = model->field_value[RENDER_FIELD_MQTT_STATE];
+        GUI_DispStringAt("MQTT: ", 100, 130);
+        GUI_DispString(((value >= 0) && (value <= RENDER_MQTT_CONNECTED)) ?
+                       mqtt_state_names[value] : "?");
+    }
+
+    if (model->field_dirty & (1u << RENDER_FIELD_LIGHT))
+    {
+        GUI_DispStringAt("Ambient Light:  ", 100, 150);
+        GUI_DispDec(model->field_value[RENDER_FIELD_LIGHT], 3);
+    }
+
+    if (model->field_dirty & (1u << RENDER_FIELD_PRESENCE))
+    {
+        value = model->field_value[RENDER_FIELD_PRESENCE];
+        GUI_ClearRect(90, 170, 250, 205);
+        if (value & RENDER_PRESENCE_DETECTED)
+        {
+            GUI_DispStringAt("Presence Detected", 100, 170);
+        }
+        if (value & RENDER_PRESENCE_APPROACHING)
+        {
+            GUI_DispStringAt("Approaching", 100, 190);
+        }
+    }
+
+    if (model->field_dirty & (1u << RENDER_FIELD_MOTION))
+    {
+        value = model->field_value[RENDER_FIELD_MOTION];
+        GUI_DispStringAt("Orientation: ", 100, 210);
+        GUI_DispString(((value >= 0) && (value < (int16_t)(sizeof(orientation_names) / sizeof(orientation_names[0])))) ?
+                       orientation_names[value] : "?");
+    }
+
+    if (model->alert_dirty)
+    {
+        GUI_ClearRect(0, TFT_ALERT_Y, 319, 239);
+        if (model->alert[0] != '\0')
+        {
+            GUI_SetColor(GUI_RED);
+            GUI_DispStringAt(model->alert, 10, TFT_ALERT_Y);
+            GUI_SetColor(GUI_WHITE);
+        }
+    }
 
-    	cyhal_system_delay_ms(100);
+    if (model->chart_dirty)
+    {
+        /* Unroll the ring oldest first and scale 0..100 % to the chart height. */
+        static I16 chart_y[RENDER_CHART_POINTS];
+        for (uint32_t i = 0; i < RENDER_CHART_POINTS; i++)
+        {
+            value = model->chart[(model->chart_head + i) % RENDER_CHART_POINTS];
+            chart_y[i] = (I16)(TFT_CHART_HEIGHT - ((value * TFT_CHART_HEIGHT) / 100));
+        }
+        GUI_ClearRect(TFT_CHART_X, TFT_CHART_Y, TFT_CHART_X + RENDER_CHART_POINTS, TFT_CHART_Y + TFT_CHART_HEIGHT);
+        GUI_DrawGraph(chart_y, RENDER_CHART_POINTS, TFT_CHART_X, TFT_CHART_Y);
     }
+
+    model->field_dirty = 0;
+    model->alert_dirty = false;
+    model->chart_dirty = false;
+}
+
+/*******************************************************************************
+* Function Name: cy_rslt_t light_sensor_sample(void *context, int32_t *value)
+********************************************************************************
+*
+* Summary: Sampling function of the light sensor driver registered with the
+*           sensor scheduler.
+*
+* Parameters:
+*  context: pointer to the light sensor object
+*  value: sampled ambient light level in percent
+*
+* Return:
+*  CY_RSLT_SUCCESS
+*
+*******************************************************************************/
+static cy_rslt_t light_sensor_sample(void *context, int32_t *value)
+{
+    *value = mtb_light_sensor_light_level((mtb_light_sensor_t *)context);
+    return CY_RSLT_SUCCESS;
 }
 
 /*******************************************************************************
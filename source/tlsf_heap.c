@@ -0,0 +1,547 @@
+/******************************************************************************
+* File Name:   tlsf_heap.c
+*
+* Description: This file contains a Two-Level Segregated Fit allocator.
+*
+*              Free blocks are kept in lists by size class: the first level
+*              is the power of two of the size, the second level splits it
+*              into TLSF_SL_COUNT linear steps. A bitmap per level records the
+*              non-empty lists, so a fitting list is found with two
+*              find-first-set operations, and a freed block is merged with
+*              its free neighbours in memory through the physical links of
+*              the block headers. Neither operation walks a list, so both run
+*              in bounded time whatever the fragmentation of the heap.
+*
+*              A request is rounded up to the start of the next size class
+*              before the search, so every block of the list found fits
+*              (good fit instead of best fit).
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "tlsf_heap.h"
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Flags and tag in the size field of a block header. */
+#define BLOCK_FREE                        ((size_t)1u)
+#define BLOCK_PREV_FREE                   ((size_t)2u)
+#define BLOCK_TAG_SHIFT                   (TLSF_FL_MAX)
+#define BLOCK_TAG_MASK                    ((size_t)0xFFu << BLOCK_TAG_SHIFT)
+#define BLOCK_SIZE_MASK                   (((size_t)1u << BLOCK_TAG_SHIFT) - TLSF_ALIGN)
+
+/* Bytes of a header in front of the payload, and smallest payload, which must
+ * hold the free list links.
+ */
+#define BLOCK_OVERHEAD                    (offsetof(tlsf_block_t, next_free))
+#define BLOCK_MIN_SIZE                    (sizeof(tlsf_block_t) - BLOCK_OVERHEAD)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static uint32_t find_last_set(uint32_t word);
+static uint32_t find_first_set(uint32_t word);
+static void mapping(size_t size, uint32_t *fl, uint32_t *sl);
+static size_t adjust_size(size_t size);
+static void insert_block(tlsf_heap_t *heap, tlsf_block_t *block);
+static void remove_block(tlsf_heap_t *heap, tlsf_block_t *block);
+static void release_block(tlsf_heap_t *heap, tlsf_block_t *block);
+static void split_block(tlsf_heap_t *heap, tlsf_block_t *block, size_t size);
+static void account(tlsf_heap_t *heap, uint8_t tag, size_t allocated, size_t released);
+
+/******************************************************************************
+* Block helpers
+*******************************************************************************/
+static inline size_t block_size(const tlsf_block_t *block)
+{
+    return block->size & BLOCK_SIZE_MASK;
+}
+
+static inline void block_set_size(tlsf_block_t *block, size_t size)
+{
+    block->size = (block->size & ~BLOCK_SIZE_MASK) | size;
+}
+
+static inline uint8_t block_tag(const tlsf_block_t *block)
+{
+    return (uint8_t)((block->size & BLOCK_TAG_MASK) >> BLOCK_TAG_SHIFT);
+}
+
+static inline tlsf_block_t *block_next(const tlsf_block_t *block)
+{
+    return (tlsf_block_t *)((uint8_t *)block + BLOCK_OVERHEAD + block_size(block));
+}
+
+static inline void *block_payload(const tlsf_block_t *block)
+{
+    return (uint8_t *)block + BLOCK_OVERHEAD;
+}
+
+static inline tlsf_block_t *block_from_payload(const void *ptr)
+{
+    return (tlsf_block_t *)((uint8_t *)ptr - BLOCK_OVERHEAD);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_heap_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes a heap on a memory region. The region is turned into one free
+ *  block followed by a zero-sized sentinel block.
+ *
+ * Parameters:
+ *  tlsf_heap_t *heap : Heap
+ *  void *mem : Start of the region
+ *  size_t size : Size of the region in bytes
+ *
+ * Return:
+ *  bool : false if the region is too small
+ *
+ ******************************************************************************/
+bool tlsf_heap_init(tlsf_heap_t *heap, void *mem, size_t size)
+{
+    uintptr_t start = ((uintptr_t)mem + (TLSF_ALIGN - 1u)) & ~(uintptr_t)(TLSF_ALIGN - 1u);
+    uintptr_t end = ((uintptr_t)mem + size) & ~(uintptr_t)(TLSF_ALIGN - 1u);
+    tlsf_block_t *sentinel;
+    size_t pool_size;
+
+    memset(heap, 0, sizeof(*heap));
+
+    if ((end <= start) || ((end - start) < ((2u * BLOCK_OVERHEAD) + BLOCK_MIN_SIZE)))
+    {
+        return false;
+    }
+
+    pool_size = (size_t)(end - start) - (2u * BLOCK_OVERHEAD);
+    if (pool_size > TLSF_MAX_BLOCK_SIZE)
+    {
+        pool_size = TLSF_MAX_BLOCK_SIZE;
+    }
+
+    heap->first = (tlsf_block_t *)start;
+    heap->first->prev_phys = NULL;
+    heap->first->size = pool_size;
+
+    sentinel = block_next(heap->first);
+    sentinel->prev_phys = heap->first;
+    sentinel->size = 0;
+
+    release_block(heap, heap->first);
+    heap->pool_size = pool_size;
+    heap->min_free_bytes = heap->free_bytes;
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: tlsf_heap_malloc
+ ******************************************************************************
+ * Summary:
+ *  Allocates a block of at least 'size' bytes, aligned to TLSF_ALIGN, and
+ *  accounts it to 'tag'.
+ *
+ * Parameters:
+ *  tlsf_heap_t *heap : Heap
+ *  size_t size : Requested size in bytes
+ *  uint8_t tag : Allocation tag, below TLSF_TAG_COUNT
+ *
+ * Return:
+ *  void * : Allocated memory, or NULL if no free block fits
+ *
+ ******************************************************************************/
+void *tlsf_heap_malloc(tlsf_heap_t *heap, size_t size, uint8_t tag)
+{
+    tlsf_block_t *block = NULL;
+    uint32_t sl_map;
+    uint32_t fl_map;
+    uint32_t fl;
+    uint32_t sl;
+    size_t search;
+
+    if (tag >= TLSF_TAG_COUNT)
+    {
+        tag = 0;
+    }
+
+    size = adjust_size(size);
+    if (size != 0)
+    {
+        /* Round up to the next size class, so that the first block of the
+         * list found fits.
+         */
+        search = size;
+        if (search >= TLSF_SMALL_BLOCK_SIZE)
+        {
+            search += ((size_t)1u << (find_last_set((uint32_t)search) - TLSF_SL_LOG2)) - 1u;
+        }
+
+        if (search <= TLSF_MAX_BLOCK_SIZE)
+        {
+            mapping(search, &fl, &sl);
+
+            sl_map = heap->sl_bitmap[fl] & (~0u << sl);
+            if (sl_map == 0)
+            {
+                fl_map = heap->fl_bitmap & (~0u << (fl + 1u));
+                if (fl_map != 0)
+                {
+                    fl = find_first_set(fl_map);
+                    sl_map = heap->sl_bitmap[fl];
+                }
+            }
+
+            if (sl_map != 0)
+            {
+                block = heap->free_lists[fl][find_first_set(sl_map)];
+            }
+        }
+    }
+
+    if (block == NULL)
+    {
+        heap->tags[tag].failures++;
+        return NULL;
+    }
+
+    remove_block(heap, block);
+    block->size &= ~(BLOCK_FREE | BLOCK_TAG_MASK);
+    block->size |= (size_t)tag << BLOCK_TAG_SHIFT;
+    block_next(block)->size &= ~BLOCK_PREV_FREE;
+    split_block(heap, block, size);
+
+    heap->tags[tag].allocations++;
+    heap->tags[tag].blocks++;
+    account(heap, tag, block_size(block), 0);
+
+    return block_payload(block);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_heap_free
+ ******************************************************************************
+ * Summary:
+ *  Frees a block returned by tlsf_heap_malloc() and merges it with its free
+ *  neighbours.
+ *
+ * Parameters:
+ *  tlsf_heap_t *heap : Heap
+ *  void *ptr : Block to be freed, or NULL
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void tlsf_heap_free(tlsf_heap_t *heap, void *ptr)
+{
+    tlsf_block_t *block;
+    uint8_t tag;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    block = block_from_payload(ptr);
+    tag = block_tag(block);
+    heap->tags[tag].blocks--;
+    account(heap, tag, 0, block_size(block));
+
+    block->size &= ~BLOCK_TAG_MASK;
+    release_block(heap, block);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_heap_resize
+ ******************************************************************************
+ * Summary:
+ *  Resizes a block in place: a block is shrunk by splitting off its tail, and
+ *  grown by absorbing the next block if that one is free and large enough.
+ *  Moving the block is left to the caller, so that the copy can run without
+ *  the heap lock.
+ *
+ * Parameters:
+ *  tlsf_heap_t *heap : Heap
+ *  void *ptr : Block returned by tlsf_heap_malloc()
+ *  size_t size : New size in bytes
+ *
+ * Return:
+ *  void * : 'ptr' if resized in place, else NULL and the block is unchanged
+ *
+ ******************************************************************************/
+void *tlsf_heap_resize(tlsf_heap_t *heap, void *ptr, size_t size)
+{
+    tlsf_block_t *block = block_from_payload(ptr);
+    tlsf_block_t *next = block_next(block);
+    size_t current = block_size(block);
+    uint8_t tag = block_tag(block);
+
+    size = adjust_size(size);
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    if (size > current)
+    {
+        if (((next->size & BLOCK_FREE) == 0) ||
+            ((current + BLOCK_OVERHEAD + block_size(next)) < size))
+        {
+            return NULL;
+        }
+
+        remove_block(heap, next);
+        block_set_size(block, current + BLOCK_OVERHEAD + block_size(next));
+        next = block_next(block);
+        next->prev_phys = block;
+        next->size &= ~BLOCK_PREV_FREE;
+    }
+
+    split_block(heap, block, size);
+
+    if (block_size(block) > current)
+    {
+        account(heap, tag, block_size(block) - current, 0);
+    }
+    else
+    {
+        account(heap, tag, 0, current - block_size(block));
+    }
+
+    return ptr;
+}
+
+/* Usable size of an allocated block, at least the size requested. */
+size_t tlsf_heap_block_size(const void *ptr)
+{
+    return block_size(block_from_payload(ptr));
+}
+
+/* Tag of an allocated block. */
+uint8_t tlsf_heap_block_tag(const void *ptr)
+{
+    return block_tag(block_from_payload(ptr));
+}
+
+/******************************************************************************
+ * Function Name: tlsf_heap_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the statistics of the heap in constant time. The free bytes and
+ *  blocks are counted by every operation. The largest free block is taken
+ *  as the head of the highest non-empty free list without walking the list:
+ *  all blocks of a list are in the same size class, so it is within
+ *  1/TLSF_SL_COUNT of the largest free block.
+ *
+ * Parameters:
+ *  const tlsf_heap_t *heap : Heap
+ *  tlsf_heap_stats_t *stats : Statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void tlsf_heap_get_stats(const tlsf_heap_t *heap, tlsf_heap_stats_t *stats)
+{
+    uint32_t fl;
+    uint32_t sl;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->pool_size = (uint32_t)heap->pool_size;
+    stats->free_bytes = (uint32_t)heap->free_bytes;
+    stats->min_free_bytes = (uint32_t)heap->min_free_bytes;
+    stats->free_blocks = heap->free_blocks;
+
+    if (heap->fl_bitmap != 0)
+    {
+        fl = find_last_set(heap->fl_bitmap);
+        sl = find_last_set(heap->sl_bitmap[fl]);
+        stats->largest_free_estimate = (uint32_t)block_size(heap->free_lists[fl][sl]);
+    }
+
+    if (stats->free_bytes > 0)
+    {
+        stats->fragmentation_pct_estimate = 100u -
+            (uint32_t)(((uint64_t)stats->largest_free_estimate * 100u) / stats->free_bytes);
+    }
+}
+
+/* Index of the highest set bit; 'word' must not be zero. */
+static uint32_t find_last_set(uint32_t word)
+{
+#if defined(__GNUC__)
+    return 31u - (uint32_t)__builtin_clz(word);
+#else
+    uint32_t bit = 0;
+
+    while (word >>= 1)
+    {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/* Index of the lowest set bit; 'word' must not be zero. */
+static uint32_t find_first_set(uint32_t word)
+{
+    return find_last_set(word & (~word + 1u));
+}
+
+/* First- and second-level index of the list that holds blocks of 'size'. */
+static void mapping(size_t size, uint32_t *fl, uint32_t *sl)
+{
+    uint32_t bit;
+
+    if (size < TLSF_SMALL_BLOCK_SIZE)
+    {
+        *fl = 0;
+        *sl = (uint32_t)size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_COUNT);
+    }
+    else
+    {
+        bit = find_last_set((uint32_t)size);
+        *sl = (uint32_t)(size >> (bit - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+        *fl = bit - (TLSF_FL_SHIFT - 1u);
+    }
+}
+
+/* Payload size of a request, or 0 if the request is too large. */
+static size_t adjust_size(size_t size)
+{
+    if (size > TLSF_MAX_BLOCK_SIZE)
+    {
+        return 0;
+    }
+
+    size = (size + (TLSF_ALIGN - 1u)) & ~(size_t)(TLSF_ALIGN - 1u);
+    return (size < BLOCK_MIN_SIZE) ? BLOCK_MIN_SIZE : size;
+}
+
+/* Pushes a free block on the head of its list. */
+static void insert_block(tlsf_heap_t *heap, tlsf_block_t *block)
+{
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(block_size(block), &fl, &sl);
+
+    block->prev_free = NULL;
+    block->next_free = heap->free_lists[fl][sl];
+    if (block->next_free != NULL)
+    {
+        block->next_free->prev_free = block;
+    }
+    heap->free_lists[fl][sl] = block;
+    heap->fl_bitmap |= (1u << fl);
+    heap->sl_bitmap[fl] |= (1u << sl);
+
+    heap->free_bytes += block_size(block);
+    heap->free_blocks++;
+}
+
+/* Unlinks a free block from its list. */
+static void remove_block(tlsf_heap_t *heap, tlsf_block_t *block)
+{
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(block_size(block), &fl, &sl);
+
+    if (block->prev_free != NULL)
+    {
+        block->prev_free->next_free = block->next_free;
+    }
+    else
+    {
+        heap->free_lists[fl][sl] = block->next_free;
+        if (block->next_free == NULL)
+        {
+            heap->sl_bitmap[fl] &= ~(1u << sl);
+            if (heap->sl_bitmap[fl] == 0)
+            {
+                heap->fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+    if (block->next_free != NULL)
+    {
+        block->next_free->prev_free = block->prev_free;
+    }
+
+    heap->free_bytes -= block_size(block);
+    heap->free_blocks--;
+}
+
+/* Marks a block free, merges it with its free neighbours and inserts the
+ * result into its list.
+ */
+static void release_block(tlsf_heap_t *heap, tlsf_block_t *block)
+{
+    tlsf_block_t *prev;
+    tlsf_block_t *next;
+
+    block->size |= BLOCK_FREE;
+
+    if ((block->size & BLOCK_PREV_FREE) != 0)
+    {
+        prev = block->prev_phys;
+        remove_block(heap, prev);
+        block_set_size(prev, block_size(prev) + BLOCK_OVERHEAD + block_size(block));
+        block = prev;
+    }
+
+    next = block_next(block);
+    if ((next->size & BLOCK_FREE) != 0)
+    {
+        remove_block(heap, next);
+        block_set_size(block, block_size(block) + BLOCK_OVERHEAD + block_size(next));
+        next = block_next(block);
+    }
+
+    next->prev_phys = block;
+    next->size |= BLOCK_PREV_FREE;
+    insert_block(heap, block);
+}
+
+/* Splits the tail of an allocated block off into a free block, if the tail
+ * can hold a block of its own.
+ */
+static void split_block(tlsf_heap_t *heap, tlsf_block_t *block, size_t size)
+{
+    tlsf_block_t *rest;
+    size_t current = block_size(block);
+
+    if (current < (size + BLOCK_OVERHEAD + BLOCK_MIN_SIZE))
+    {
+        return;
+    }
+
+    block_set_size(block, size);
+    rest = block_next(block);
+    rest->prev_phys = block;
+    rest->size = current - size - BLOCK_OVERHEAD;
+    block_next(rest)->prev_phys = rest;
+
+    release_block(heap, rest);
+}
+
+/* Updates the accounting of a tag and the low-water mark of the heap. */
+static void account(tlsf_heap_t *heap, uint8_t tag, size_t allocated, size_t released)
+{
+    tlsf_tag_stats_t *stats = &heap->tags[tag];
+
+    stats->in_use = stats->in_use + (uint32_t)allocated - (uint32_t)released;
+    if (stats->in_use > stats->peak)
+    {
+        stats->peak = stats->in_use;
+    }
+    if (heap->free_bytes < heap->min_free_bytes)
+    {
+        heap->min_free_bytes = heap->free_bytes;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,113 @@
+/******************************************************************************
+* File Name:   tlsf_heap.h
+*
+* Description: This file is the public interface of tlsf_heap.c, a
+*              Two-Level Segregated Fit allocator whose allocation and free
+*              run in constant time, independent of the number of free blocks.
+*
+*              The allocator has no locking and no dependency on the HAL or
+*              on FreeRTOS so that the same file can be compiled into host
+*              tools; the caller serializes the calls (see app_heap.c).
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef TLSF_HEAP_H_
+#define TLSF_HEAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Alignment of every returned pointer. */
+#define TLSF_ALIGN_LOG2                   (3u)
+#define TLSF_ALIGN                        (1u << TLSF_ALIGN_LOG2)
+
+/* Number of second-level lists per power of two. 16 lists bound the waste of
+ * a block taken from a list to 1/16 of its size.
+ */
+#define TLSF_SL_LOG2                      (4u)
+#define TLSF_SL_COUNT                     (1u << TLSF_SL_LOG2)
+
+/* Blocks below this size are kept in the first-level list 0, in steps of
+ * TLSF_ALIGN bytes.
+ */
+#define TLSF_FL_SHIFT                     (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK_SIZE             (1u << TLSF_FL_SHIFT)
+
+/* Blocks are smaller than 2^TLSF_FL_MAX bytes (16 MB). */
+#define TLSF_FL_MAX                       (24u)
+#define TLSF_FL_COUNT                     (TLSF_FL_MAX - TLSF_FL_SHIFT + 1u)
+#define TLSF_MAX_BLOCK_SIZE               ((1u << TLSF_FL_MAX) - TLSF_ALIGN)
+
+/* Number of allocation tags. The tag of a block is kept in its header. */
+#define TLSF_TAG_COUNT                    (8u)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Header of a block. The free list links are only used while the block is
+ * free and overlap its payload.
+ */
+typedef struct tlsf_block
+{
+    struct tlsf_block *prev_phys;       /* Previous block in memory */
+    size_t size;                        /* Payload size, tag and flags */
+    struct tlsf_block *next_free;
+    struct tlsf_block *prev_free;
+} tlsf_block_t;
+
+/* Accounting of one tag. */
+typedef struct
+{
+    uint32_t in_use;                    /* Payload bytes currently allocated */
+    uint32_t peak;
+    uint32_t blocks;                    /* Blocks currently allocated */
+    uint32_t allocations;               /* Successful allocations */
+    uint32_t failures;                  /* Failed allocations */
+} tlsf_tag_stats_t;
+
+/* Heap with its free lists and statistics. */
+typedef struct
+{
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    tlsf_block_t *free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+
+    tlsf_block_t *first;                /* First block in memory */
+    size_t pool_size;                   /* Payload bytes of the initial block */
+    size_t free_bytes;
+    size_t min_free_bytes;
+    uint32_t free_blocks;
+    tlsf_tag_stats_t tags[TLSF_TAG_COUNT];
+} tlsf_heap_t;
+
+/* Statistics of the whole heap. */
+typedef struct
+{
+    uint32_t pool_size;
+    uint32_t free_bytes;
+    uint32_t min_free_bytes;                /* Low-water mark of free_bytes */
+    uint32_t free_blocks;
+    uint32_t largest_free_estimate;         /* At most the largest free block, within 1/TLSF_SL_COUNT */
+    uint32_t fragmentation_pct_estimate;    /* 100 - 100 * largest_free_estimate / free_bytes */
+} tlsf_heap_stats_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+bool tlsf_heap_init(tlsf_heap_t *heap, void *mem, size_t size);
+void *tlsf_heap_malloc(tlsf_heap_t *heap, size_t size, uint8_t tag);
+void tlsf_heap_free(tlsf_heap_t *heap, void *ptr);
+void *tlsf_heap_resize(tlsf_heap_t *heap, void *ptr, size_t size);
+size_t tlsf_heap_block_size(const void *ptr);
+uint8_t tlsf_heap_block_tag(const void *ptr);
+void tlsf_heap_get_stats(const tlsf_heap_t *heap, tlsf_heap_stats_t *stats);
+
+#endif /* TLSF_HEAP_H_ */
+
+/* [] END OF FILE */
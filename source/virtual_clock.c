@@ -0,0 +1,279 @@
+/******************************************************************************
+* File Name:   virtual_clock.c
+*
+* Description: This file contains a discrete-event clock. Time does not pass
+*              on its own: it jumps straight to the earliest scheduled event
+*              when that event is run, so hours of timeouts and retry
+*              intervals pass in as many steps as there are events. Events due
+*              at the same time run in the order in which they were
+*              scheduled, which makes a replay deterministic.
+*
+*              The clock has no dependency on the HAL or FreeRTOS; the caller
+*              serializes access.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include "virtual_clock.h"
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool event_before(const virtual_clock_event_t *a, const virtual_clock_event_t *b);
+static void swap_events(virtual_clock_event_t *a, virtual_clock_event_t *b);
+static void sift_up(virtual_clock_t *clock, size_t child);
+static void sift_down(virtual_clock_t *clock, size_t parent);
+
+/******************************************************************************
+ * Function Name: virtual_clock_init
+ ******************************************************************************
+ * Summary:
+ *  Initializes a clock at time 0 with no scheduled events.
+ *
+ * Parameters:
+ *  virtual_clock_t *clock : Clock to be initialized
+ *  virtual_clock_event_t *storage : Storage for the pending events
+ *  size_t capacity : Maximum number of pending events
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void virtual_clock_init(virtual_clock_t *clock, virtual_clock_event_t *storage,
+                        size_t capacity)
+{
+    clock->events = storage;
+    clock->capacity = capacity;
+    clock->count = 0;
+    clock->now_ms = 0;
+    clock->next_sequence = 0;
+}
+
+/******************************************************************************
+ * Function Name: virtual_clock_schedule
+ ******************************************************************************
+ * Summary:
+ *  Schedules an event 'delay_ms' after the current virtual time. The pending
+ *  events are kept in a binary min-heap ordered by due time and scheduling
+ *  order.
+ *
+ * Parameters:
+ *  virtual_clock_t *clock : Clock
+ *  uint32_t delay_ms : Delay from the current virtual time
+ *  virtual_clock_callback_t callback : Function called when the event is due
+ *  void *arg : Argument passed to the callback
+ *
+ * Return:
+ *  bool : true if the event was scheduled, false if the clock is full.
+ *
+ ******************************************************************************/
+bool virtual_clock_schedule(virtual_clock_t *clock, uint32_t delay_ms,
+                            virtual_clock_callback_t callback, void *arg)
+{
+    size_t child;
+
+    if ((callback == NULL) || (clock->count >= clock->capacity))
+    {
+        return false;
+    }
+
+    child = clock->count++;
+    clock->events[child] = (virtual_clock_event_t)
+    {
+        .due_ms = clock->now_ms + delay_ms,
+        .sequence = clock->next_sequence++,
+        .callback = callback,
+        .arg = arg
+    };
+    sift_up(clock, child);
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: virtual_clock_cancel
+ ******************************************************************************
+ * Summary:
+ *  Removes the earliest pending event with the given callback and argument,
+ *  for a timeout that ended early.
+ *
+ * Parameters:
+ *  virtual_clock_t *clock : Clock
+ *  virtual_clock_callback_t callback : Callback of the event
+ *  void *arg : Argument of the event
+ *
+ * Return:
+ *  bool : true if an event was removed, false if none was pending.
+ *
+ ******************************************************************************/
+bool virtual_clock_cancel(virtual_clock_t *clock, virtual_clock_callback_t callback,
+                          void *arg)
+{
+    size_t found = clock->count;
+
+    for (size_t i = 0; i < clock->count; i++)
+    {
+        if ((clock->events[i].callback == callback) && (clock->events[i].arg == arg) &&
+            ((found == clock->count) || event_before(&clock->events[i], &clock->events[found])))
+        {
+            found = i;
+        }
+    }
+    if (found == clock->count)
+    {
+        return false;
+    }
+
+    /* Move the last event into the hole and restore the heap order. */
+    clock->events[found] = clock->events[--clock->count];
+    if (found < clock->count)
+    {
+        sift_up(clock, found);
+        sift_down(clock, found);
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: virtual_clock_now
+ ******************************************************************************
+ * Summary:
+ *  Returns the current virtual time.
+ *
+ * Parameters:
+ *  const virtual_clock_t *clock : Clock
+ *
+ * Return:
+ *  uint64_t : Virtual time in milliseconds
+ *
+ ******************************************************************************/
+uint64_t virtual_clock_now(const virtual_clock_t *clock)
+{
+    return clock->now_ms;
+}
+
+/******************************************************************************
+ * Function Name: virtual_clock_step
+ ******************************************************************************
+ * Summary:
+ *  Advances the virtual time to the earliest pending event and runs it. The
+ *  callback may schedule further events.
+ *
+ * Parameters:
+ *  virtual_clock_t *clock : Clock
+ *
+ * Return:
+ *  bool : true if an event was run, false if no event is pending.
+ *
+ ******************************************************************************/
+bool virtual_clock_step(virtual_clock_t *clock)
+{
+    virtual_clock_event_t event;
+
+    if (clock->count == 0)
+    {
+        return false;
+    }
+
+    event = clock->events[0];
+    clock->events[0] = clock->events[--clock->count];
+    sift_down(clock, 0);
+
+    if (event.due_ms > clock->now_ms)
+    {
+        clock->now_ms = event.due_ms;
+    }
+    event.callback(event.arg);
+
+    return true;
+}
+
+/******************************************************************************
+ * Function Name: virtual_clock_run_until
+ ******************************************************************************
+ * Summary:
+ *  Runs all events that are due up to 'end_ms' and then sets the virtual time
+ *  to 'end_ms'.
+ *
+ * Parameters:
+ *  virtual_clock_t *clock : Clock
+ *  uint64_t end_ms : Virtual time at which to stop
+ *
+ * Return:
+ *  size_t : Number of events run
+ *
+ ******************************************************************************/
+size_t virtual_clock_run_until(virtual_clock_t *clock, uint64_t end_ms)
+{
+    size_t run_count = 0;
+
+    while ((clock->count > 0) && (clock->events[0].due_ms <= end_ms))
+    {
+        (void)virtual_clock_step(clock);
+        run_count++;
+    }
+
+    if (end_ms > clock->now_ms)
+    {
+        clock->now_ms = end_ms;
+    }
+
+    return run_count;
+}
+
+/* Ordering of the heap: earlier due time first, then scheduling order. */
+static bool event_before(const virtual_clock_event_t *a, const virtual_clock_event_t *b)
+{
+    return (a->due_ms < b->due_ms) ||
+           ((a->due_ms == b->due_ms) && ((int32_t)(a->sequence - b->sequence) < 0));
+}
+
+static void swap_events(virtual_clock_event_t *a, virtual_clock_event_t *b)
+{
+    virtual_clock_event_t tmp = *a;
+
+    *a = *b;
+    *b = tmp;
+}
+
+/* Moves an event towards the root until its parent is due before it. */
+static void sift_up(virtual_clock_t *clock, size_t child)
+{
+    size_t parent;
+
+    while (child > 0)
+    {
+        parent = (child - 1u) / 2u;
+        if (!event_before(&clock->events[child], &clock->events[parent]))
+        {
+            break;
+        }
+        swap_events(&clock->events[child], &clock->events[parent]);
+        child = parent;
+    }
+}
+
+/* Moves an event towards the leaves until its children are due after it. */
+static void sift_down(virtual_clock_t *clock, size_t parent)
+{
+    size_t child;
+
+    while ((child = (2u * parent) + 1u) < clock->count)
+    {
+        if (((child + 1u) < clock->count) &&
+            event_before(&clock->events[child + 1u], &clock->events[child]))
+        {
+            child++;
+        }
+        if (!event_before(&clock->events[child], &clock->events[parent]))
+        {
+            break;
+        }
+        swap_events(&clock->events[child], &clock->events[parent]);
+        parent = child;
+    }
+}
+
+/* [] END OF FILE */
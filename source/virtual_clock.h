@@ -0,0 +1,57 @@
+/******************************************************************************
+* File Name:   virtual_clock.h
+*
+* Description: This file is the public interface of virtual_clock.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef VIRTUAL_CLOCK_H_
+#define VIRTUAL_CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Function called when a scheduled event becomes due. */
+typedef void (*virtual_clock_callback_t)(void *arg);
+
+/* One scheduled event. */
+typedef struct
+{
+    uint64_t due_ms;
+    uint32_t sequence;
+    virtual_clock_callback_t callback;
+    void *arg;
+} virtual_clock_event_t;
+
+/* Discrete-event clock. All fields are private to virtual_clock.c. */
+typedef struct
+{
+    virtual_clock_event_t *events;
+    size_t capacity;
+    size_t count;
+    uint64_t now_ms;
+    uint32_t next_sequence;
+} virtual_clock_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+void virtual_clock_init(virtual_clock_t *clock, virtual_clock_event_t *storage,
+                        size_t capacity);
+bool virtual_clock_schedule(virtual_clock_t *clock, uint32_t delay_ms,
+                            virtual_clock_callback_t callback, void *arg);
+bool virtual_clock_cancel(virtual_clock_t *clock, virtual_clock_callback_t callback,
+                          void *arg);
+uint64_t virtual_clock_now(const virtual_clock_t *clock);
+bool virtual_clock_step(virtual_clock_t *clock);
+size_t virtual_clock_run_until(virtual_clock_t *clock, uint64_t end_ms);
+
+#endif /* VIRTUAL_CLOCK_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,214 @@
+/******************************************************************************
+* File Name:   wall_clock.c
+*
+* Description: This file contains the wall clock of the occupancy predictor.
+*              The RTC is set from an SNTP server (RFC 4330) after every
+*              Wi-Fi join, at most once per WALL_CLOCK_RESYNC_MS, and holds
+*              the local time WALL_CLOCK_UTC_OFFSET_MINUTES ahead of UTC.
+*              The clock reads as not set until the first answer arrives, so
+*              the predictor neither learns nor pre-starts on the reset value
+*              of the RTC.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+
+#include "wall_clock.h"
+#include "app_time.h"
+#include "cy_secure_sockets.h"
+
+#if ENABLE_WALL_CLOCK
+
+/******************************************************************************
+* Macros
+*******************************************************************************/
+/* NTP packet without extension fields or authenticator. */
+#define NTP_PACKET_SIZE                   (48u)
+#define NTP_PORT                          (123u)
+
+/* First byte of a request: no leap indicator, version 4, client mode. */
+#define NTP_REQUEST_FLAGS                 (0x23u)
+
+/* Mode of a server reply, in the 3 low bits of the first byte. */
+#define NTP_MODE_MASK                     (0x07u)
+#define NTP_MODE_SERVER                   (4u)
+
+/* Offset of the seconds of the transmit timestamp. */
+#define NTP_TRANSMIT_SECONDS_OFFSET       (40u)
+
+/* Seconds from 1900-01-01, the NTP epoch, to 1970-01-01. */
+#define NTP_UNIX_EPOCH_OFFSET             (2208988800u)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+static cyhal_rtc_t rtc;
+
+/* Set by the MQTT client task, read by the occupancy task. */
+static volatile bool clock_set;
+static uint32_t last_sync_ms;
+
+static uint8_t ntp_packet[NTP_PACKET_SIZE];
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static bool query_server(uint32_t *unix_seconds);
+
+/* Initializes the RTC. Called before the scheduler starts. */
+cy_rslt_t wall_clock_init(void)
+{
+    return cyhal_rtc_init(&rtc);
+}
+
+/******************************************************************************
+ * Function Name: wall_clock_sync
+ ******************************************************************************
+ * Summary:
+ *  Sets the RTC from the SNTP server unless it was set less than
+ *  WALL_CLOCK_RESYNC_MS ago. Blocks for up to WALL_CLOCK_TIMEOUT_MS when the
+ *  server does not answer. Called by the MQTT client task after a Wi-Fi join.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void wall_clock_sync(void)
+{
+    uint32_t unix_seconds;
+    time_t local_seconds;
+    struct tm now;
+    bool answered;
+
+    if (clock_set && ((app_time_now_ms() - last_sync_ms) < WALL_CLOCK_RESYNC_MS))
+    {
+        return;
+    }
+
+    if (cy_socket_init() != CY_RSLT_SUCCESS)
+    {
+        return;
+    }
+    answered = query_server(&unix_seconds);
+    cy_socket_deinit();
+
+    if (!answered)
+    {
+        printf("Wall clock: no answer from '%s'\n", WALL_CLOCK_NTP_SERVER);
+        return;
+    }
+
+    local_seconds = (time_t)unix_seconds + ((time_t)WALL_CLOCK_UTC_OFFSET_MINUTES * 60);
+    if ((gmtime_r(&local_seconds, &now) == NULL) || (cyhal_rtc_write(&rtc, &now) != CY_RSLT_SUCCESS))
+    {
+        printf("Wall clock: RTC write failed\n");
+        return;
+    }
+
+    last_sync_ms = app_time_now_ms();
+    clock_set = true;
+    printf("Wall clock: set to %04d-%02d-%02d %02d:%02d:%02d from '%s'\n",
+           now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
+           now.tm_hour, now.tm_min, now.tm_sec, WALL_CLOCK_NTP_SERVER);
+}
+
+/******************************************************************************
+ * Function Name: wall_clock_read
+ ******************************************************************************
+ * Summary:
+ *  Reads the local time from the RTC.
+ *
+ * Parameters:
+ *  struct tm *now : Local time
+ *
+ * Return:
+ *  bool : false until the RTC has been set from the SNTP server, or if the
+ *         RTC cannot be read.
+ *
+ ******************************************************************************/
+bool wall_clock_read(struct tm *now)
+{
+    return clock_set && (cyhal_rtc_read(&rtc, now) == CY_RSLT_SUCCESS);
+}
+
+/******************************************************************************
+ * Function Name: query_server
+ ******************************************************************************
+ * Summary:
+ *  Sends one SNTP request to WALL_CLOCK_NTP_SERVER and waits for the reply.
+ *  Replies from another address, in another mode or with stratum 0 (a
+ *  kiss-o'-death) are rejected. The seconds wrap like the NTP timestamp,
+ *  which keeps them right until 2106.
+ *
+ * Parameters:
+ *  uint32_t *unix_seconds : Seconds since 1970-01-01 UTC of the server
+ *
+ * Return:
+ *  bool : true if the server answered.
+ *
+ ******************************************************************************/
+static bool query_server(uint32_t *unix_seconds)
+{
+    cy_rslt_t result;
+    cy_socket_t ntp_socket;
+    cy_socket_sockaddr_t server_addr;
+    cy_socket_sockaddr_t src_addr;
+    uint32_t src_addr_len = sizeof(src_addr);
+    uint32_t timeout_ms = WALL_CLOCK_TIMEOUT_MS;
+    uint32_t bytes = 0;
+    const uint8_t *seconds = &ntp_packet[NTP_TRANSMIT_SECONDS_OFFSET];
+    bool answered;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    if (cy_socket_gethostbyname(WALL_CLOCK_NTP_SERVER, CY_SOCKET_IP_VER_V4,
+                                &server_addr.ip_address) != CY_RSLT_SUCCESS)
+    {
+        return false;
+    }
+    server_addr.port = NTP_PORT;
+
+    if (cy_socket_create(CY_SOCKET_DOMAIN_AF_INET, CY_SOCKET_TYPE_DGRAM,
+                         CY_SOCKET_IPPROTO_UDP, &ntp_socket) != CY_RSLT_SUCCESS)
+    {
+        return false;
+    }
+
+    memset(ntp_packet, 0, sizeof(ntp_packet));
+    ntp_packet[0] = NTP_REQUEST_FLAGS;
+
+    result = cy_socket_setsockopt(ntp_socket, CY_SOCKET_SOL_SOCKET, CY_SOCKET_SO_RCVTIMEO,
+                                  &timeout_ms, sizeof(timeout_ms));
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cy_socket_sendto(ntp_socket, ntp_packet, sizeof(ntp_packet), CY_SOCKET_FLAGS_NONE,
+                                  &server_addr, sizeof(server_addr), &bytes);
+    }
+    if (result == CY_RSLT_SUCCESS)
+    {
+        result = cy_socket_recvfrom(ntp_socket, ntp_packet, sizeof(ntp_packet), CY_SOCKET_FLAGS_NONE,
+                                    &src_addr, &src_addr_len, &bytes);
+    }
+    cy_socket_delete(ntp_socket);
+
+    answered = (result == CY_RSLT_SUCCESS) && (bytes >= NTP_PACKET_SIZE) &&
+               (src_addr.ip_address.ip.v4 == server_addr.ip_address.ip.v4) &&
+               ((ntp_packet[0] & NTP_MODE_MASK) == NTP_MODE_SERVER) && (ntp_packet[1] != 0u);
+    if (answered)
+    {
+        *unix_seconds = (((uint32_t)seconds[0] << 24) | ((uint32_t)seconds[1] << 16) |
+                         ((uint32_t)seconds[2] << 8) | (uint32_t)seconds[3]) - NTP_UNIX_EPOCH_OFFSET;
+    }
+
+    return answered;
+}
+
+#endif /* ENABLE_WALL_CLOCK */
+
+/* [] END OF FILE */
@@ -0,0 +1,41 @@
+/******************************************************************************
+* File Name:   wall_clock.h
+*
+* Description: This file is the public interface of wall_clock.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef WALL_CLOCK_H_
+#define WALL_CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "cy_result.h"
+#include "occupancy_config.h"
+#include "virtual_time_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* The wall clock is only read by the occupancy predictor; with virtual time
+ * the predictor takes the time of week from the virtual clock instead.
+ */
+#define ENABLE_WALL_CLOCK                 (ENABLE_OCCUPANCY_PREDICTOR && !ENABLE_VIRTUAL_TIME)
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_WALL_CLOCK
+cy_rslt_t wall_clock_init(void);
+void wall_clock_sync(void);
+bool wall_clock_read(struct tm *now);
+#else
+#define wall_clock_sync()                 do { } while (0)
+#endif /* ENABLE_WALL_CLOCK */
+
+#endif /* WALL_CLOCK_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,416 @@
+/******************************************************************************
+* File Name:   wifi_roam.c
+*
+* Description: This file contains the Wi-Fi roaming task. The task watches the
+*              RSSI of the current AP. When the signal gets weak it refreshes
+*              a list of candidate APs of the same SSID with a background scan
+*              while it is still associated, so that by the time the signal
+*              crosses the roam threshold the best BSSID is already known and
+*              the handover is a single directed join instead of a full
+*              reconnect with retries.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "cyhal.h"
+#include "cybsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "wifi_roam.h"
+#include "app_time.h"
+#include "render_server.h"
+
+/* Middleware libraries */
+#include "cy_retarget_io.h"
+#include "cy_wcm.h"
+
+#if ENABLE_WIFI_ROAMING
+
+/******************************************************************************
+* Macros
+******************************************************************************/
+/* Candidates older than this are not used for a handover. */
+#define WIFI_ROAM_CANDIDATE_MAX_AGE_MS    (2u * WIFI_ROAM_SCAN_INTERVAL_MS)
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* One AP of WIFI_SSID found by a scan. */
+typedef struct
+{
+    cy_wcm_mac_t bssid;
+    int16_t rssi_dbm;
+    cy_wcm_wifi_band_t band;
+} wifi_roam_candidate_t;
+
+TaskHandle_t wifi_roam_task_handle;
+
+/* Candidates of the last completed scan, strongest first. */
+static wifi_roam_candidate_t candidates[WIFI_ROAM_MAX_CANDIDATES];
+static uint32_t candidate_count;
+static uint32_t candidates_time_ms;
+
+/* Candidates of the scan in progress, written by the scan callback. */
+static wifi_roam_candidate_t scan_candidates[WIFI_ROAM_MAX_CANDIDATES];
+static uint32_t scan_candidate_count;
+static cy_wcm_mac_t scan_exclude_bssid;
+static volatile bool scan_in_progress;
+static uint32_t last_scan_ms;
+
+static volatile bool roam_in_progress;
+static uint64_t total_gap_ms;
+static wifi_roam_stats_t roam_stats;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void start_scan(const cy_wcm_mac_t *current_bssid);
+static void scan_callback(cy_wcm_scan_result_t *result_ptr, void *user_data,
+                          cy_wcm_scan_status_t status);
+static void roam_to(const wifi_roam_candidate_t *candidate);
+
+/******************************************************************************
+ * Function Name: wifi_roam_task
+ ******************************************************************************
+ * Summary:
+ *  Task that monitors the RSSI of the current AP, keeps the candidate list
+ *  fresh while the signal is weak and hands over to a stronger BSSID once the
+ *  RSSI falls below WIFI_ROAM_RSSI_THRESHOLD_DBM.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void wifi_roam_task(void *pvParameters)
+{
+    cy_wcm_associated_ap_info_t ap_info;
+    wifi_roam_candidate_t best;
+    bool have_candidate;
+    uint32_t current_ms;
+
+    /* To avoid compiler warnings */
+    (void) pvParameters;
+
+    while (true)
+    {
+        app_time_delay_ms(WIFI_ROAM_MONITOR_INTERVAL_MS);
+
+        if ((cy_wcm_is_connected_to_ap() == 0) ||
+            (cy_wcm_get_associated_ap_info(&ap_info) != CY_RSLT_SUCCESS))
+        {
+            continue;
+        }
+
+        roam_stats.rssi_dbm = ap_info.signal_strength;
+        current_ms = app_time_now_ms();
+
+        /* Refresh the candidates in the background while still associated. */
+        if ((ap_info.signal_strength < WIFI_ROAM_SCAN_RSSI_DBM) && !scan_in_progress &&
+            ((roam_stats.scan_count == 0) || ((current_ms - last_scan_ms) >= WIFI_ROAM_SCAN_INTERVAL_MS)))
+        {
+            start_scan(&ap_info.BSSID);
+        }
+
+        if (ap_info.signal_strength >= WIFI_ROAM_RSSI_THRESHOLD_DBM)
+        {
+            continue;
+        }
+
+        /* Hand over to the strongest fresh candidate that is clearly better. */
+        taskENTER_CRITICAL();
+        have_candidate = (candidate_count > 0) &&
+                         ((current_ms - candidates_time_ms) < WIFI_ROAM_CANDIDATE_MAX_AGE_MS) &&
+                         (candidates[0].rssi_dbm >= (ap_info.signal_strength + WIFI_ROAM_HYSTERESIS_DB));
+        best = candidates[0];
+        taskEXIT_CRITICAL();
+
+        if (have_candidate)
+        {
+            roam_to(&best);
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: wifi_roam_in_progress
+ ******************************************************************************
+ * Summary:
+ *  Returns whether a handover is in progress. The MQTT client task waits for
+ *  the handover instead of starting its own Wi-Fi reconnection.
+ *
+ * Parameters:
+ *  void
+ *
+ * Return:
+ *  bool : true while a handover is in progress
+ *
+ ******************************************************************************/
+bool wifi_roam_in_progress(void)
+{
+    return roam_in_progress;
+}
+
+/******************************************************************************
+ * Function Name: wifi_roam_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Returns the roaming statistics.
+ *
+ * Parameters:
+ *  wifi_roam_stats_t *stats : Output statistics
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+void wifi_roam_get_stats(wifi_roam_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = roam_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* Starts a background scan for WIFI_SSID that skips the current BSSID. */
+static void start_scan(const cy_wcm_mac_t *current_bssid)
+{
+    cy_wcm_scan_filter_t scan_filter;
+
+    memset(&scan_filter, 0, sizeof(scan_filter));
+    scan_filter.mode = CY_WCM_SCAN_FILTER_TYPE_SSID;
+    memcpy(scan_filter.param.SSID, WIFI_SSID, sizeof(WIFI_SSID));
+
+    memcpy(scan_exclude_bssid, *current_bssid, sizeof(cy_wcm_mac_t));
+    scan_candidate_count = 0;
+    scan_in_progress = true;
+    last_scan_ms = app_time_now_ms();
+
+    if (cy_wcm_start_scan(scan_callback, NULL, &scan_filter) != CY_RSLT_SUCCESS)
+    {
+        scan_in_progress = false;
+    }
+}
+
+/******************************************************************************
+ * Function Name: scan_callback
+ ******************************************************************************
+ * Summary:
+ *  Scan callback of the WCM. Keeps the strongest APs of the scan, sorted by
+ *  RSSI, and publishes them as the new candidate list when the scan
+ *  completes.
+ *
+ * Parameters:
+ *  cy_wcm_scan_result_t *result_ptr : Scan result
+ *  void *user_data : User data (unused)
+ *  cy_wcm_scan_status_t status : Scan status
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void scan_callback(cy_wcm_scan_result_t *result_ptr, void *user_data,
+                          cy_wcm_scan_status_t status)
+{
+    uint32_t i;
+
+    (void)user_data;
+
+    if (status == CY_WCM_SCAN_COMPLETE)
+    {
+        taskENTER_CRITICAL();
+        memcpy(candidates, scan_candidates, sizeof(candidates));
+        candidate_count = scan_candidate_count;
+        candidates_time_ms = app_time_now_ms();
+        roam_stats.scan_count++;
+        taskEXIT_CRITICAL();
+
+        scan_in_progress = false;
+        return;
+    }
+
+    if ((result_ptr == NULL) ||
+        (memcmp(result_ptr->BSSID, scan_exclude_bssid, sizeof(cy_wcm_mac_t)) == 0))
+    {
+        return;
+    }
+
+    /* Drop a weaker duplicate of the same BSSID reported on another channel. */
+    for (i = 0; i < scan_candidate_count; i++)
+    {
+        if (memcmp(scan_candidates[i].bssid, result_ptr->BSSID, sizeof(cy_wcm_mac_t)) == 0)
+        {
+            if (scan_candidates[i].rssi_dbm >= result_ptr->signal_strength)
+            {
+                return;
+            }
+            memmove(&scan_candidates[i], &scan_candidates[i + 1u],
+                    (scan_candidate_count - i - 1u) * sizeof(wifi_roam_candidate_t));
+            scan_candidate_count--;
+            break;
+        }
+    }
+
+    /* Insert sorted by RSSI; the weakest entry falls off a full list. */
+    for (i = scan_candidate_count; i > 0; i--)
+    {
+        if (scan_candidates[i - 1u].rssi_dbm >= result_ptr->signal_strength)
+        {
+            break;
+        }
+    }
+    if (i >= WIFI_ROAM_MAX_CANDIDATES)
+    {
+        return;
+    }
+
+    memmove(&scan_candidates[i + 1u], &scan_candidates[i],
+            (((scan_candidate_count < WIFI_ROAM_MAX_CANDIDATES) ? scan_candidate_count :
+              (WIFI_ROAM_MAX_CANDIDATES - 1u)) - i) * sizeof(wifi_roam_candidate_t));
+    memcpy(scan_candidates[i].bssid, result_ptr->BSSID, sizeof(cy_wcm_mac_t));
+    scan_candidates[i].rssi_dbm = result_ptr->signal_strength;
+    scan_candidates[i].band = result_ptr->band;
+    if (scan_candidate_count < WIFI_ROAM_MAX_CANDIDATES)
+    {
+        scan_candidate_count++;
+    }
+}
+
+/******************************************************************************
+ * Function Name: roam_to
+ ******************************************************************************
+ * Summary:
+ *  Hands over to the given BSSID and measures the gap. If the directed join
+ *  fails, any AP of WIFI_SSID is joined instead so that the client does not
+ *  stay offline until the MQTT client task notices.
+ *
+ * Parameters:
+ *  const wifi_roam_candidate_t *candidate : AP to hand over to
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void roam_to(const wifi_roam_candidate_t *candidate)
+{
+    cy_wcm_connect_params_t connect_param;
+    cy_wcm_ip_address_t ip_address;
+    uint32_t gap_start_ms;
+    uint32_t gap_ms;
+    cy_rslt_t result;
+
+    memset(&connect_param, 0, sizeof(cy_wcm_connect_params_t));
+    memcpy(connect_param.ap_credentials.SSID, WIFI_SSID, sizeof(WIFI_SSID));
+    memcpy(connect_param.ap_credentials.password, WIFI_PASSWORD, sizeof(WIFI_PASSWORD));
+    connect_param.ap_credentials.security = WIFI_SECURITY;
+    memcpy(connect_param.BSSID, candidate->bssid, sizeof(cy_wcm_mac_t));
+    connect_param.band = candidate->band;
+
+    printf("\nRoaming to %02X:%02X:%02X:%02X:%02X:%02X (RSSI %d dBm)...\n",
+           candidate->bssid[0], candidate->bssid[1], candidate->bssid[2],
+           candidate->bssid[3], candidate->bssid[4], candidate->bssid[5],
+           (int)candidate->rssi_dbm);
+
+    roam_in_progress = true;
+    if (scan_in_progress)
+    {
+        (void)cy_wcm_stop_scan();
+        scan_in_progress = false;
+    }
+
+    gap_start_ms = app_time_now_ms();
+    (void)cy_wcm_disconnect_ap();
+    result = cy_wcm_connect_ap(&connect_param, &ip_address);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        memset(connect_param.BSSID, 0, sizeof(cy_wcm_mac_t));
+        connect_param.band = CY_WCM_WIFI_BAND_ANY;
+        result = cy_wcm_connect_ap(&connect_param, &ip_address);
+    }
+    gap_ms = app_time_now_ms() - gap_start_ms;
+
+    taskENTER_CRITICAL();
+    if (result == CY_RSLT_SUCCESS)
+    {
+        roam_stats.roam_count++;
+        roam_stats.last_gap_ms = gap_ms;
+        if (gap_ms > roam_stats.max_gap_ms)
+        {
+            roam_stats.max_gap_ms = gap_ms;
+        }
+        total_gap_ms += gap_ms;
+        roam_stats.avg_gap_ms = (uint32_t)(total_gap_ms / roam_stats.roam_count);
+    }
+    else
+    {
+        roam_stats.roam_failures++;
+    }
+
+    /* The candidates were measured from the old position. */
+    candidate_count = 0;
+    taskEXIT_CRITICAL();
+
+    roam_in_progress = false;
+
+    if (result == CY_RSLT_SUCCESS)
+    {
+        printf("Roaming done in %lu ms.\n", (unsigned long)gap_ms);
+    }
+    else
+    {
+        printf("Roaming failed with error code 0x%0X.\n", (int)result);
+        render_show_alert("Wi-Fi roaming failed");
+    }
+}
+
+/******************************************************************************
+ * Function Name: wifi_roam_format_stats
+ ******************************************************************************
+ * Summary:
+ *  Prints the RSSI, scans, roams and handover gaps for the get-stats RPC
+ *  command.
+ *
+ * Parameters:
+ *  char *buf : Output buffer
+ *  size_t size : Size of the output buffer
+ *
+ * Return:
+ *  size_t : Number of characters written
+ *
+ ******************************************************************************/
+size_t wifi_roam_format_stats(char *buf, size_t size)
+{
+    wifi_roam_stats_t stats;
+    int len;
+
+    wifi_roam_get_stats(&stats);
+    len = snprintf(buf, size,
+                   "wifi_rssi_dbm %d\n"
+                   "wifi_scans %lu\n"
+                   "wifi_roams %lu failures %lu\n"
+                   "wifi_roam_gap_ms last %lu avg %lu max %lu\n",
+                   (int)stats.rssi_dbm,
+                   (unsigned long)stats.scan_count,
+                   (unsigned long)stats.roam_count,
+                   (unsigned long)stats.roam_failures,
+                   (unsigned long)stats.last_gap_ms,
+                   (unsigned long)stats.avg_gap_ms,
+                   (unsigned long)stats.max_gap_ms);
+
+    /* snprintf truncated the last line. */
+    if ((len > 0) && ((size_t)len >= size))
+    {
+        len = (int)size - 1;
+    }
+
+    return (len > 0) ? (size_t)len : 0;
+}
+
+#endif /* ENABLE_WIFI_ROAMING */
+
+/* [] END OF FILE */
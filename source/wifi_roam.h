@@ -0,0 +1,64 @@
+/******************************************************************************
+* File Name:   wifi_roam.h
+*
+* Description: This file is the public interface of wifi_roam.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef WIFI_ROAM_H_
+#define WIFI_ROAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "wifi_config.h"
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Task parameters for the Wi-Fi roaming task. It runs at the publisher
+ * priority so that a handover is not delayed by the RPC task.
+ */
+#define WIFI_ROAM_TASK_PRIORITY           (2)
+#define WIFI_ROAM_TASK_STACK_SIZE         (1024 * 1)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Roaming statistics. The gap is the time from leaving the old AP until the
+ * new AP has assigned an IP address.
+ */
+typedef struct
+{
+    int16_t rssi_dbm;
+    uint32_t scan_count;
+    uint32_t roam_count;
+    uint32_t roam_failures;
+    uint32_t last_gap_ms;
+    uint32_t max_gap_ms;
+    uint32_t avg_gap_ms;
+} wifi_roam_stats_t;
+
+/*******************************************************************************
+* Extern Variables
+********************************************************************************/
+extern TaskHandle_t wifi_roam_task_handle;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+#if ENABLE_WIFI_ROAMING
+void wifi_roam_task(void *pvParameters);
+bool wifi_roam_in_progress(void);
+void wifi_roam_get_stats(wifi_roam_stats_t *stats);
+size_t wifi_roam_format_stats(char *buf, size_t size);
+#else
+#define wifi_roam_in_progress()           (false)
+#endif /* ENABLE_WIFI_ROAMING */
+
+#endif /* WIFI_ROAM_H_ */
+
+/* [] END OF FILE */
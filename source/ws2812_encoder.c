@@ -0,0 +1,97 @@
+/******************************************************************************
+* File Name:   ws2812_encoder.c
+*
+* Description: This file contains the WS2812 bitstream generator. Every WS2812
+*              data bit is sent as three SPI bits at WS2812_SPI_FREQ_HZ:
+*              '1' -> 110 (0.83 us high), '0' -> 100 (0.42 us high). Colors are
+*              sent in G, R, B order, MSB first. The bitstream is streamed by
+*              the SPI DMA so that no CPU time is spent per bit.
+*
+*              The generator has no dependency on the HAL or FreeRTOS.
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#include <string.h>
+#include "ws2812_encoder.h"
+
+/******************************************************************************
+* Global Variables
+*******************************************************************************/
+/* SPI pattern of every nibble: 4 WS2812 bits -> 12 SPI bits. */
+static const uint16_t nibble_pattern[16] =
+{
+    0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+    0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6
+};
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+static void encode_byte(uint8_t value, uint8_t *out);
+
+/******************************************************************************
+ * Function Name: ws2812_encode
+ ******************************************************************************
+ * Summary:
+ *  Generates the SPI bitstream of a frame, followed by the reset low time.
+ *
+ * Parameters:
+ *  const ws2812_color_t *colors : Colors of the LEDs, first LED first
+ *  size_t led_count : Number of LEDs
+ *  uint8_t *out : Output buffer
+ *  size_t out_size : Size of the output buffer, at least
+ *                    WS2812_FRAME_SIZE(led_count)
+ *
+ * Return:
+ *  size_t : Number of bytes written, or 0 if the buffer is too small.
+ *
+ ******************************************************************************/
+size_t ws2812_encode(const ws2812_color_t *colors, size_t led_count,
+                     uint8_t *out, size_t out_size)
+{
+    size_t frame_size = WS2812_FRAME_SIZE(led_count);
+
+    if ((out == NULL) || (out_size < frame_size) || ((colors == NULL) && (led_count > 0)))
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < led_count; i++)
+    {
+        encode_byte(colors[i].g, &out[(i * WS2812_BYTES_PER_LED) + 0u]);
+        encode_byte(colors[i].r, &out[(i * WS2812_BYTES_PER_LED) + 3u]);
+        encode_byte(colors[i].b, &out[(i * WS2812_BYTES_PER_LED) + 6u]);
+    }
+
+    memset(&out[led_count * WS2812_BYTES_PER_LED], 0, WS2812_RESET_BYTES);
+
+    return frame_size;
+}
+
+/******************************************************************************
+ * Function Name: encode_byte
+ ******************************************************************************
+ * Summary:
+ *  Expands one color byte into the 24 SPI bits (3 bytes) that represent it.
+ *
+ * Parameters:
+ *  uint8_t value : Color byte
+ *  uint8_t *out : Output, 3 bytes
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void encode_byte(uint8_t value, uint8_t *out)
+{
+    uint32_t bits = ((uint32_t)nibble_pattern[value >> 4] << 12) |
+                    (uint32_t)nibble_pattern[value & 0x0Fu];
+
+    out[0] = (uint8_t)(bits >> 16);
+    out[1] = (uint8_t)(bits >> 8);
+    out[2] = (uint8_t)bits;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,52 @@
+/******************************************************************************
+* File Name:   ws2812_encoder.h
+*
+* Description: This file is the public interface of ws2812_encoder.c
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef WS2812_ENCODER_H_
+#define WS2812_ENCODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* SPI clock that makes one SPI bit last 1/3 of a 1.25 us WS2812 bit. */
+#define WS2812_SPI_FREQ_HZ                (2400000u)
+
+/* SPI bytes per LED: 24 color bits, 3 SPI bits per color bit. */
+#define WS2812_BYTES_PER_LED              (9u)
+
+/* Low time appended to every frame so that the LEDs latch the colors. 90 bytes
+ * at 2.4 MHz is 300 us, which covers the 280 us reset of newer WS2812B parts.
+ */
+#define WS2812_RESET_BYTES                (90u)
+
+/* Size of the SPI bitstream of a frame of 'n' LEDs. */
+#define WS2812_FRAME_SIZE(n)              (((n) * WS2812_BYTES_PER_LED) + WS2812_RESET_BYTES)
+
+/*******************************************************************************
+* Global Variables
+********************************************************************************/
+/* Color of one LED. */
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} ws2812_color_t;
+
+/*******************************************************************************
+* Function Prototypes
+********************************************************************************/
+size_t ws2812_encode(const ws2812_color_t *colors, size_t led_count,
+                     uint8_t *out, size_t out_size);
+
+#endif /* WS2812_ENCODER_H_ */
+
+/* [] END OF FILE */